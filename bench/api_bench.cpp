@@ -0,0 +1,144 @@
+// API core benchmark: the transport-independent handlers in api_core.h on the
+// host, without any HTTP in the way. Reports ns per call and heap allocations
+// per call, so a handler change that adds parsing cost or a String shows up.
+//
+//   pio run -e native_api && .pio/build/native_api/program [--iterations 100000] [--out api.json]
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "api_core.h"
+#include "host_hal.h"
+#include "sys_init.h"
+
+// main.cpp's status LED, used by ConfigManager and the web server
+Adafruit_NeoPixel led(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
+
+static size_t alloc_count = 0;
+
+// Counts operator new calls, through the host heap hook (host_heap.cpp)
+static void countAllocation(size_t size, bool freed) {
+    if (!freed) alloc_count++;
+}
+
+// The fields the web UI posts to /api/config
+static const char* const config_form[][2] = {
+    {"output1_enabled", "1"}, {"output1_min", "100"}, {"output1_max", "300"},
+    {"output1_hysteresis", "25"}, {"output1_polarity", "in_range"},
+    {"output2_enabled", "1"}, {"output2_min", "400"}, {"output2_max", "800"},
+    {"output2_hysteresis", "50"}, {"output2_polarity", "out_of_range"},
+    {"capture_pre", "64"}, {"capture_post", "32"},
+};
+
+struct ApiBenchResult {
+    const char* name;
+    double ns_per_call;
+    double allocations;
+};
+
+template <typename F>
+static ApiBenchResult measure(const char* name, uint32_t iterations, F call) {
+    call();  // warm up, lazily sized buffers
+    size_t allocs_before = alloc_count;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) call();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return {name, (double)ns / iterations, (double)(alloc_count - allocs_before) / iterations};
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = 100000;
+    const char* out_path = "api.json";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--out api.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char fs_root[] = "/tmp/api_bench_XXXXXX";
+    if (mkdtemp(fs_root) == nullptr) {
+        fprintf(stderr, "cannot create a LittleFS directory\n");
+        return 2;
+    }
+    hostSetLogOutput(nullptr);
+    hostSetHeapHook(countAllocation);
+    hostSetLittleFsRoot(fs_root);
+
+    ConfigManager config;
+    config.initialize();
+    Adafruit_VL53L1X sensor;
+    SensorManager manager(&sensor, &led, PIN_OUT_1, PIN_OUT_2);
+    manager.initialize();
+    manager.updateConfiguration(config.getDeviceConfig());
+    ApiCore api(&config, &manager);
+
+    // Put the form's values in place first, so set_config measures the no-change path
+    ApiConfigParams params;
+    memset(&params, 0, sizeof(params));
+    for (const auto& field : config_form) apiParseConfigField(params, field[0], field[1]);
+    api.setConfig(params);
+
+    ApiLoginParams login;
+    login.has_password = true;
+    strcpy(login.password, DEFAULT_ADMIN_PASSWORD);
+    char token[API_TOKEN_LENGTH + 1];
+    for (int i = 0; i < SESSION_MAX_ACTIVE; i++) api.login(login, token);
+    char cookie[64];
+    snprintf(cookie, sizeof(cookie), "lang=en; session_token=%s", token);
+
+    char buffer[512];
+    volatile size_t sink = 0;
+    ApiBenchResult results[] = {
+        measure("parse_config", iterations, [&]() {
+            ApiConfigParams p;
+            memset(&p, 0, sizeof(p));
+            for (const auto& field : config_form) apiParseConfigField(p, field[0], field[1]);
+            sink = sink + p.outputs[1].max;
+        }),
+        measure("set_config_no_change", iterations, [&]() { sink = sink + api.setConfig(params).code; }),
+        measure("status_json", iterations, [&]() {
+            JsonWriter json(buffer, sizeof(buffer));
+            api.writeStatusJson(json);
+            sink = sink + json.finish();
+        }),
+        measure("status_cbor", iterations, [&]() {
+            StatusSample sample;
+            api.readStatus(sample);
+            sink = sink + encodeStatusCbor(sample, (uint8_t*)buffer, sizeof(buffer));
+        }),
+        measure("config_json", iterations, [&]() {
+            JsonWriter json(buffer, sizeof(buffer));
+            api.writeConfigJson(json);
+            sink = sink + json.finish();
+        }),
+        measure("session_check", iterations, [&]() {
+            const char* t;
+            size_t len;
+            sink = sink + (sessionTokenFromCookie(cookie, t, len) && api.validateSession(t, len));
+        }),
+        measure("login", iterations, [&]() { sink = sink + api.login(login, token).code; }),
+    };
+
+    FILE* out = fopen(out_path, "w");
+    if (out == nullptr) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 2;
+    }
+    fprintf(out, "{\"iterations\":%u,\"results\":[", iterations);
+    bool first = true;
+    for (const ApiBenchResult& r : results) {
+        printf("%-22s %9.1f ns/call  allocs/call %.3f\n", r.name, r.ns_per_call, r.allocations);
+        fprintf(out, "%s{\"name\":\"%s\",\"ns_per_call\":%.1f,\"allocations_per_call\":%.3f}",
+                first ? "" : ",", r.name, r.ns_per_call, r.allocations);
+        first = false;
+    }
+    fprintf(out, "]}\n");
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,339 @@
+// Filter and trigger benchmark: runs MovingAverage, NoiseFilter, AdaptiveFilter
+// and the full SensorManager sample path over the same traces and writes the
+// results as JSON so releases can be compared.
+//
+// Host (virtual clock and sensor stand-in from host/), ns per sample, worst
+// case and heap allocations per sample:
+//   pio run -e native_bench && .pio/build/native_bench/program [--log rawlog.bin] [--out bench.json]
+//
+// Target, CPU cycles per sample from esp_cpu_get_cycle_count(). The filters run
+// over the synthetic traces; the SensorManager path runs against the real
+// sensor, so its numbers include the I2C reads. The JSON document is printed
+// between BENCH-BEGIN and BENCH-END lines:
+//   pio run -e bench -t upload && pio device monitor
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include "sensor_manager.h"
+#include "sys_init.h"
+
+#ifdef ARDUINO
+#include <esp_cpu.h>
+#define BENCH_UNIT "cycles"
+#define BENCH_PASSES 4
+#define BENCH_DEVICE_SAMPLES 400
+static inline uint32_t benchNow() { return esp_cpu_get_cycle_count(); }
+#else
+#include <chrono>
+#include <map>
+#include "host_hal.h"
+#include "raw_log.h"
+#define BENCH_UNIT "ns"
+#define BENCH_PASSES 50
+static inline uint32_t benchNow() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t alloc_count = 0;
+
+// Counts operator new calls, through the host heap hook (host_heap.cpp)
+static void countAllocation(size_t size, bool freed) {
+    if (!freed) alloc_count++;
+}
+#endif
+
+#define BENCH_TRACE_SAMPLES 2000
+#define BENCH_SAMPLE_US 50000   // 50 ms timing budget
+
+struct BenchTrace {
+    const char* name;
+    int16_t distance[BENCH_TRACE_SAMPLES];
+    uint8_t range_status[BENCH_TRACE_SAMPLES];
+    uint16_t count;
+};
+
+struct BenchResult {
+    uint32_t samples;
+    double per_sample;
+    uint32_t worst;
+    double allocations;
+};
+
+static BenchTrace traces[4];
+static uint32_t rng_state;
+
+// Small LCG so host and target generate identical traces
+static int32_t benchRandom(int32_t range) {
+    rng_state = rng_state * 1664525UL + 1013904223UL;
+    return (int32_t)((rng_state >> 8) % (uint32_t)(2 * range + 1)) - range;
+}
+
+static void generateTraces() {
+    rng_state = 12345;
+    const char* names[] = {"steady", "steps", "noisy", "dropouts"};
+    for (uint8_t t = 0; t < 4; t++) {
+        BenchTrace& trace = traces[t];
+        trace.name = names[t];
+        trace.count = BENCH_TRACE_SAMPLES;
+        for (uint16_t i = 0; i < BENCH_TRACE_SAMPLES; i++) {
+            int16_t d = 500 + benchRandom(5);
+            uint8_t status = 0;
+            if (t == 1) {
+                d = ((i / 100) % 2 ? 900 : 300) + benchRandom(8);
+            } else if (t == 2) {
+                d = 500 + benchRandom(60);
+                if (benchRandom(50) == 0) d += 400;   // impulse
+            } else if (t == 3 && benchRandom(10) == 0) {
+                d = -1;
+                status = 4;
+            }
+            trace.distance[i] = d;
+            trace.range_status[i] = status;
+        }
+    }
+}
+
+// Runs step(i) over the trace: a bulk pass for the mean, a timed pass per sample for the worst case
+template <typename Step>
+static BenchResult runBench(uint16_t count, Step step) {
+    BenchResult result = {0, 0.0, 0, 0.0};
+#ifndef ARDUINO
+    size_t allocs_before = alloc_count;
+#endif
+    uint32_t start = benchNow();
+    for (uint16_t pass = 0; pass < BENCH_PASSES; pass++) {
+        for (uint16_t i = 0; i < count; i++) step(i);
+    }
+    uint32_t elapsed = benchNow() - start;
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t t0 = benchNow();
+        step(i);
+        uint32_t t = benchNow() - t0;
+        if (t > result.worst) result.worst = t;
+    }
+    result.samples = (uint32_t)count * (BENCH_PASSES + 1);
+    result.per_sample = (double)elapsed / ((double)count * BENCH_PASSES);
+#ifndef ARDUINO
+    result.allocations = (double)(alloc_count - allocs_before) / result.samples;
+#endif
+    return result;
+}
+
+// Writes the JSON document to a file on the host, to Serial on the target
+class BenchReport {
+private:
+    FILE* out;
+    bool first;
+
+    void emit(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char line[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+#ifdef ARDUINO
+        Serial.print(line);
+#else
+        fputs(line, out);
+#endif
+    }
+
+public:
+    BenchReport(FILE* file = nullptr) : out(file), first(true) {}
+
+    void begin() {
+        emit("{\"firmware\":\"%s\",\"platform\":\"%s\",\"unit\":\"%s\",\"results\":[",
+             FW_VERSION,
+#ifdef ARDUINO
+             "esp32-c6",
+#else
+             "host",
+#endif
+             BENCH_UNIT);
+    }
+
+    void add(const char* name, const char* trace, const BenchResult& r) {
+        emit("%s\n{\"name\":\"%s\",\"trace\":\"%s\",\"samples\":%lu,\"per_sample\":%.1f,"
+             "\"worst\":%lu,\"allocations_per_sample\":%.3f}",
+             first ? "" : ",", name, trace, (unsigned long)r.samples, r.per_sample,
+             (unsigned long)r.worst, r.allocations);
+        first = false;
+#ifndef ARDUINO
+        // Progress on stderr, so the JSON file stays clean
+        fprintf(stderr, "%-16s %-10s %8.1f %s/sample  worst %6lu  allocs/sample %.3f\n",
+                name, trace, r.per_sample, BENCH_UNIT, (unsigned long)r.worst, r.allocations);
+#endif
+    }
+
+    void end() { emit("\n]}\n"); }
+};
+
+static void benchFilters(BenchReport& report, const BenchTrace& trace) {
+    volatile int32_t sink = 0;
+
+    MovingAverage moving_average(MOVING_AVERAGE_SIZE);
+    report.add("MovingAverage", trace.name, runBench(trace.count, [&](uint16_t i) {
+        if (trace.distance[i] < 0) return;
+        moving_average.addValue(trace.distance[i]);
+        sink += moving_average.getAverage();
+    }));
+
+    NoiseFilter noise_filter(MEDIAN_FILTER_SIZE);
+    report.add("NoiseFilter", trace.name, runBench(trace.count, [&](uint16_t i) {
+        if (trace.distance[i] < 0) return;
+        noise_filter.addValue(trace.distance[i]);
+        sink += noise_filter.getFilteredValue();
+    }));
+
+    // What SensorManager calls per accepted sample
+    AdaptiveFilter adaptive_filter(MOVING_AVERAGE_SIZE);
+    report.add("AdaptiveFilter", trace.name, runBench(trace.count, [&](uint16_t i) {
+        if (trace.distance[i] < 0) return;
+        adaptive_filter.addValue(trace.distance[i]);
+        sink += adaptive_filter.getFilteredValue();
+        sink += (int32_t)adaptive_filter.getVariance();
+    }));
+}
+
+static void configureOutputs(SensorManager& manager) {
+    manager.setOutput1Config(200, 600, 30, true);
+    manager.enableOutput1(true);
+    manager.setOutput2Config(400, 800, 50, false);
+    manager.enableOutput2(true);
+}
+
+#ifdef ARDUINO
+
+Adafruit_NeoPixel led = Adafruit_NeoPixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
+Adafruit_VL53L1X vl53 = Adafruit_VL53L1X(PIN_TOF_SHUTDOWN, PIN_TOF_INT);
+
+// Times update() on the calls that consumed a sample from the real sensor
+static BenchResult benchDevice(SensorManager& manager) {
+    BenchResult result = {0, 0.0, 0, 0.0};
+    uint64_t total = 0;
+    uint32_t last_sequence = manager.getSampleSequence();
+    uint32_t deadline = millis() + BENCH_DEVICE_SAMPLES * 100;
+
+    while (result.samples < BENCH_DEVICE_SAMPLES && (int32_t)(deadline - millis()) > 0) {
+        uint32_t t0 = benchNow();
+        manager.update();
+        uint32_t t = benchNow() - t0;
+        if (manager.getSampleSequence() != last_sequence) {
+            last_sequence = manager.getSampleSequence();
+            total += t;
+            if (t > result.worst) result.worst = t;
+            result.samples++;
+        }
+        delay(1);
+    }
+    result.per_sample = result.samples > 0 ? (double)total / result.samples : 0.0;
+    return result;
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(2000);
+    led.begin();
+    generateTraces();
+
+    // Filter output is noise here; the serial prints are part of what a sample costs though
+    Serial.println("BENCH-BEGIN");
+    BenchReport report;
+    report.begin();
+    for (const BenchTrace& trace : traces) {
+        benchFilters(report, trace);
+    }
+
+    SensorManager manager(&vl53, &led, PIN_OUT_1, PIN_OUT_2);
+    configureOutputs(manager);
+    if (manager.initialize()) {
+        report.add("SensorManager", "sensor", benchDevice(manager));
+    }
+    report.end();
+    Serial.println("BENCH-END");
+}
+
+void loop() {
+    delay(1000);
+}
+
+#else
+
+static BenchResult benchSensorManager(const int16_t* distance, const uint8_t* range_status, uint16_t count) {
+    hostSetMicros(1000000);
+    Adafruit_VL53L1X sensor;
+    Adafruit_NeoPixel pixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
+    SensorManager manager(&sensor, &pixel, PIN_OUT_1, PIN_OUT_2);
+    configureOutputs(manager);
+    manager.initialize();
+
+    return runBench(count, [&](uint16_t i) {
+        uint64_t now = hostMicros() + BENCH_SAMPLE_US;
+        HostSensorSample sample = {now, distance[i], range_status[i], 0, 0};
+        sensor.hostQueue(sample);
+        hostSetMicros(now);
+        manager.update();
+    });
+}
+
+int main(int argc, char** argv) {
+    const char* log_path = nullptr;
+    const char* out_path = "bench.json";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--log rawlog.bin] [--out bench.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    FILE* out = fopen(out_path, "w");
+    if (out == nullptr) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 2;
+    }
+    hostSetLogOutput(nullptr);
+    hostSetHeapHook(countAllocation);
+    generateTraces();
+
+    BenchReport report(out);
+    report.begin();
+    for (const BenchTrace& trace : traces) {
+        benchFilters(report, trace);
+        report.add("SensorManager", trace.name,
+                   benchSensorManager(trace.distance, trace.range_status, trace.count));
+    }
+
+    // Recorded sessions, in chunks of one trace length
+    std::map<uint16_t, RawLogSession> sessions;
+    if (log_path != nullptr && loadRawLog(log_path, sessions)) {
+        static BenchTrace recorded;
+        for (auto& entry : sessions) {
+            const std::vector<RawLogSample>& samples = entry.second.samples;
+            if (samples.empty()) continue;
+            char name[24];
+            snprintf(name, sizeof(name), "session-%u", entry.first);
+            recorded.name = name;
+            recorded.count = (uint16_t)min(samples.size(), (size_t)BENCH_TRACE_SAMPLES);
+            for (uint16_t i = 0; i < recorded.count; i++) {
+                recorded.distance[i] = samples[i].raw.distance;
+                recorded.range_status[i] = samples[i].raw.range_status;
+            }
+            benchFilters(report, recorded);
+            report.add("SensorManager", recorded.name,
+                       benchSensorManager(recorded.distance, recorded.range_status, recorded.count));
+        }
+    }
+
+    report.end();
+    fclose(out);
+    fprintf(stderr, "results written to %s\n", out_path);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,135 @@
+// I2C bus cost of the sample path: the real Adafruit/ST ULD driver runs
+// unchanged against the register-level emulator (host/vl53l1x_emulator.h)
+// behind the mock TwoWire, driven by SensorManager::initialize() and update()
+// in the same loop shape as main.cpp.
+//
+//   pio run -e native_i2c && .pio/build/native_i2c/program [--seconds 60]
+//       [--budget-bytes 40] [--record] [--out i2c.json]
+//
+// Reports transactions, bytes and bus time per delivered sample (init is
+// reported separately) and exits with 1 when bytes per sample exceed the
+// budget, so batching or interrupt-driven reads can be measured and kept.
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include "host_hal.h"
+#include "raw_recorder.h"
+#include "sensor_manager.h"
+#include "sys_init.h"
+#include "vl53l1x_emulator.h"
+
+#define I2C_BUDGET_BYTES_PER_SAMPLE 40   // polling dataReady() every loop, one distance read, one clear
+#define I2C_FAR_MM 1500
+#define I2C_NEAR_MM 400
+#define I2C_PERIOD_MS 4000               // object present for half of every period
+
+static int16_t stepScene(uint64_t time_us, void* arg) {
+    return (time_us / 1000) % I2C_PERIOD_MS < I2C_PERIOD_MS / 2 ? I2C_FAR_MM : I2C_NEAR_MM;
+}
+
+static void printPerSample(const char* name, const HostI2CStats& stats, uint32_t samples) {
+    printf("%-8s %8u transactions %9u bytes %9llu us", name, stats.transactions, stats.bytes,
+           (unsigned long long)stats.bus_us);
+    if (samples > 0) {
+        printf("   per sample %.2f / %.2f / %.1f us", (double)stats.transactions / samples,
+               (double)stats.bytes / samples, (double)stats.bus_us / samples);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    uint32_t seconds = 60;
+    uint32_t budget_bytes = I2C_BUDGET_BYTES_PER_SAMPLE;
+    bool record = false;
+    const char* out_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--budget-bytes") == 0 && i + 1 < argc) {
+            budget_bytes = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0) {
+            record = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--seconds N] [--budget-bytes N] [--record] [--out i2c.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    hostSetLogOutput(nullptr);
+    hostSetMicros(1000000);
+
+    Vl53l1xEmulator emulator;
+    emulator.setScene(stepScene, nullptr);
+    Wire.hostAttach(&emulator);
+
+    Adafruit_VL53L1X sensor;
+    Adafruit_NeoPixel pixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
+    SensorManager manager(&sensor, &pixel, PIN_OUT_1, PIN_OUT_2);
+    manager.setOutput1Config(200, 600, HYSTERESIS_DEFAULT, true);
+    manager.enableOutput1(true);
+
+    RawRecorder recorder;
+    if (record) {
+        hostAddPartition(RAW_PARTITION_LABEL, ESP_PARTITION_TYPE_DATA, RAW_PARTITION_SUBTYPE, 1024 * 1024);
+        recorder.begin();
+        manager.setRawRecorder(&recorder);
+    }
+
+    if (!manager.initialize()) {
+        fprintf(stderr, "initialize() failed against the emulator\n");
+        return 2;
+    }
+    if (record) manager.startRawRecording();
+
+    HostI2CStats init = Wire.hostStats();
+    uint32_t clears_before = emulator.getInterruptClears();
+    uint32_t measurements_before = emulator.getMeasurements();
+    uint32_t lost_before = emulator.getLostMeasurements();
+    Wire.hostResetStats();
+
+    uint64_t end_us = hostMicros() + seconds * 1000000ULL;
+    while (hostMicros() < end_us) {
+        manager.update();
+        delay(MAIN_LOOP_DELAY_MS);
+    }
+
+    HostI2CStats run = Wire.hostStats();
+    // Every delivered sample ends with exactly one interrupt clear
+    uint32_t samples = emulator.getInterruptClears() - clears_before;
+    uint32_t measurements = emulator.getMeasurements() - measurements_before;
+    uint32_t lost = emulator.getLostMeasurements() - lost_before;
+    double bytes_per_sample = samples ? (double)run.bytes / samples : 0;
+
+    printf("timing budget %u ms, period %u us, loop delay %u ms, clock %u Hz%s\n",
+           emulator.getTimingBudgetMs(), emulator.getPeriodUs(), MAIN_LOOP_DELAY_MS, Wire.getClock(),
+           record ? ", recording" : "");
+    printf("measurements %u, delivered %u, lost %u, nacks %u\n", measurements, samples, lost, run.nacks);
+    printPerSample("init", init, 0);
+    printPerSample("run", run, samples);
+
+    if (out_path != nullptr) {
+        FILE* out = fopen(out_path, "w");
+        if (out != nullptr) {
+            fprintf(out, "{\"seconds\":%u,\"timing_budget_ms\":%u,\"loop_delay_ms\":%u,\"clock_hz\":%u,"
+                         "\"recording\":%s,\"budget_bytes_per_sample\":%u,"
+                         "\"init\":{\"transactions\":%u,\"bytes\":%u,\"bus_us\":%llu},"
+                         "\"run\":{\"measurements\":%u,\"samples\":%u,\"lost\":%u,\"transactions\":%u,"
+                         "\"bytes\":%u,\"bus_us\":%llu,\"bytes_per_sample\":%.2f}}\n",
+                    seconds, emulator.getTimingBudgetMs(), MAIN_LOOP_DELAY_MS, Wire.getClock(),
+                    record ? "true" : "false", budget_bytes,
+                    init.transactions, init.bytes, (unsigned long long)init.bus_us,
+                    measurements, samples, lost, run.transactions, run.bytes,
+                    (unsigned long long)run.bus_us, bytes_per_sample);
+            fclose(out);
+        }
+    }
+
+    if (samples == 0 || bytes_per_sample > budget_bytes) {
+        printf("FAIL: %.2f bytes per sample, budget %u\n", bytes_per_sample, budget_bytes);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Host benchmark: JsonWriter vs. the previous ArduinoJson + String path for the
+// /api/status payload. Reports bytes, heap allocations and time per document.
+//
+//   pio run -e native_json && .pio/build/native_json/program
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "host_hal.h"
+#include "json_writer.h"
+
+#define BENCH_ITERATIONS 200000
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+// Counts operator new calls, through the host heap hook (host_heap.cpp)
+static void countAllocation(size_t size, bool freed) {
+    if (freed) return;
+    alloc_count++;
+    alloc_bytes += size;
+}
+
+// Counts the pool allocations ArduinoJson makes for its document
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override {
+        alloc_count++;
+        alloc_bytes += size;
+        return malloc(size);
+    }
+    void deallocate(void* ptr) override { free(ptr); }
+    void* reallocate(void* ptr, size_t new_size) override {
+        alloc_count++;
+        alloc_bytes += new_size;
+        return realloc(ptr, new_size);
+    }
+};
+
+struct StatusValues {
+    int16_t distance;
+    int16_t raw_distance;
+    bool sensor_ready;
+    bool out_of_range;
+    const char* status;
+    bool output1_state;
+    bool output2_state;
+    uint32_t timestamp;
+};
+
+static CountingAllocator counting_allocator;
+
+static size_t buildArduinoJson(const StatusValues& v, std::string& out) {
+    JsonDocument doc(&counting_allocator);
+    doc["distance"] = v.distance;
+    doc["raw_distance"] = v.raw_distance;
+    doc["sensor_ready"] = v.sensor_ready;
+    doc["out_of_range"] = v.out_of_range;
+    doc["status"] = v.status;
+    doc["output1_state"] = v.output1_state;
+    doc["output2_state"] = v.output2_state;
+    doc["timestamp"] = v.timestamp;
+
+    out.clear();
+    out.shrink_to_fit();  // The firmware built a fresh String for every request
+    serializeJson(doc, out);
+    return out.size();
+}
+
+static size_t buildJsonWriter(const StatusValues& v, char* buffer, size_t capacity) {
+    JsonWriter json(buffer, capacity);
+    json.beginObject();
+    json.addInt("distance", v.distance);
+    json.addInt("raw_distance", v.raw_distance);
+    json.addBool("sensor_ready", v.sensor_ready);
+    json.addBool("out_of_range", v.out_of_range);
+    json.addString("status", v.status);
+    json.addBool("output1_state", v.output1_state);
+    json.addBool("output2_state", v.output2_state);
+    json.addUInt("timestamp", v.timestamp);
+    json.endObject();
+    return json.finish();
+}
+
+static void report(const char* name, size_t bytes, size_t allocs, size_t heap, double ns_total) {
+    printf("%-12s bytes=%-4zu allocs/doc=%-6.2f heap/doc=%-8.1f ns/doc=%.1f\n",
+           name, bytes,
+           (double)allocs / BENCH_ITERATIONS,
+           (double)heap / BENCH_ITERATIONS,
+           ns_total / BENCH_ITERATIONS);
+}
+
+int main() {
+    StatusValues v = {412, 418, true, false, "TRIGGERED", true, false, 123456789};
+    std::string json_string;
+    char buffer[256];
+    size_t bytes = 0;
+    volatile size_t sink = 0;
+    hostSetHeapHook(countAllocation);
+
+    // ArduinoJson document + growing string (previous implementation)
+    alloc_count = alloc_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        v.timestamp = 123456789 + i;
+        bytes = buildArduinoJson(v, json_string);
+        sink += bytes;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    report("ArduinoJson", bytes, alloc_count, alloc_bytes, ns);
+
+    // JsonWriter into a fixed buffer
+    alloc_count = alloc_bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        v.timestamp = 123456789 + i;
+        bytes = buildJsonWriter(v, buffer, sizeof(buffer));
+        sink += bytes;
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    report("JsonWriter", bytes, alloc_count, alloc_bytes, ns);
+
+    // Both paths must produce identical documents
+    buildArduinoJson(v, json_string);
+    buildJsonWriter(v, buffer, sizeof(buffer));
+    if (json_string != buffer) {
+        printf("Output mismatch!\n  ArduinoJson: %s\n  JsonWriter:  %s\n", json_string.c_str(), buffer);
+        return 1;
+    }
+    printf("Outputs identical: %s\n", buffer);
+    return 0;
+}
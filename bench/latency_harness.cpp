@@ -0,0 +1,202 @@
+// End-to-end trigger latency: runs the firmware's main loop structure against a
+// simulated VL53L1X, moves an object in or out of the output 1 window at a
+// known time and measures when the output pin changes. Thousands of runs with
+// random sensor and loop phases give the latency distribution.
+//
+//   pio run -e native_latency && .pio/build/native_latency/program [--runs 2000]
+//       [--budget-p99-ms 300] [--out latency.json]
+//
+// Exits with 1 when the p99 of either edge exceeds the budget, so CI catches a
+// longer loop delay, confirmation count or filter lag.
+//
+// Sensor model: continuous ranging, one measurement every timing budget. A
+// measurement reports the distance at the middle of its integration window and
+// becomes readable at its end; a measurement not read before the next one
+// completes is lost.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "host_hal.h"
+#include "sensor_manager.h"
+#include "sys_init.h"
+
+#define LATENCY_TIMING_BUDGET_MS 50
+#define LATENCY_LOOP_WORK_US 1500      // update(), web server and history per loop on the device
+#define LATENCY_BUDGET_P99_MS 300      // baseline p99 is ~275 ms for the assert edge
+#define LATENCY_FAR_MM 1500
+#define LATENCY_NEAR_MM 400
+#define LATENCY_NOISE_MM 3.0f
+#define LATENCY_SETTLE_MS 3000         // before the step, so the filter has converged
+#define LATENCY_TIMEOUT_MS 3000        // after the step
+
+struct EdgeRun {
+    bool changed;
+    uint32_t latency_us;
+};
+
+static volatile uint64_t pin_change_us;
+
+static void onPinChange(uint8_t pin, uint8_t level, void* arg) {
+    if (pin == PIN_OUT_1 && pin_change_us == 0) {
+        pin_change_us = hostMicros();
+    }
+}
+
+// One run: settle at from_mm, step to to_mm at a random time, run until output 1 changes
+static EdgeRun runEdge(std::mt19937& rng, int16_t from_mm, int16_t to_mm) {
+    const uint64_t budget_us = LATENCY_TIMING_BUDGET_MS * 1000ULL;
+    std::uniform_int_distribution<uint32_t> phase(0, budget_us - 1);
+    std::uniform_int_distribution<uint32_t> loop_phase(0, MAIN_LOOP_DELAY_MS * 1000 - 1);
+    std::normal_distribution<float> noise(0.0f, LATENCY_NOISE_MM);
+
+    uint64_t start_us = 1000000;
+    uint64_t sensor_phase_us = start_us + phase(rng);
+    uint64_t step_us = start_us + LATENCY_SETTLE_MS * 1000ULL + phase(rng);
+    uint64_t end_us = step_us + LATENCY_TIMEOUT_MS * 1000ULL;
+
+    hostSetMicros(start_us);
+    Adafruit_VL53L1X sensor;
+    Adafruit_NeoPixel pixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
+    SensorManager manager(&sensor, &pixel, PIN_OUT_1, PIN_OUT_2);
+    manager.setOutput1Config(200, 600, HYSTERESIS_DEFAULT, true);
+    manager.enableOutput1(true);
+    manager.initialize();
+    sensor.setTimingBudget(LATENCY_TIMING_BUDGET_MS);
+
+    int64_t last_measurement = -1;
+    uint64_t now = start_us + loop_phase(rng);
+    bool armed = false;
+    EdgeRun run = {false, 0};
+
+    while (now < end_us) {
+        // Newest completed measurement, if the previous one was read
+        if (now >= sensor_phase_us + budget_us && sensor.hostPending() == 0) {
+            int64_t k = (int64_t)((now - sensor_phase_us) / budget_us) - 1;
+            if (k > last_measurement) {
+                last_measurement = k;
+                uint64_t ready_us = sensor_phase_us + (k + 1) * budget_us;
+                uint64_t middle_us = ready_us - budget_us / 2;
+                int16_t truth = middle_us >= step_us ? to_mm : from_mm;
+                HostSensorSample sample = {ready_us, (int16_t)lroundf(truth + noise(rng)), 0, 0, 0};
+                sensor.hostQueue(sample);
+            }
+        }
+
+        hostSetMicros(now);
+        if (!armed && now >= step_us) {
+            // Only changes caused by the step count
+            pin_change_us = 0;
+            armed = true;
+        }
+        manager.update();
+        if (armed && pin_change_us != 0) {
+            run.changed = true;
+            run.latency_us = (uint32_t)(pin_change_us - step_us);
+            break;
+        }
+
+        // Same shape as loop() in main.cpp: the work, then the delay
+        now += LATENCY_LOOP_WORK_US + MAIN_LOOP_DELAY_MS * 1000ULL;
+    }
+    return run;
+}
+
+struct EdgeStats {
+    const char* name;
+    uint32_t runs;
+    uint32_t missed;
+    uint32_t p50_ms, p90_ms, p99_ms, max_ms, min_ms;
+    std::vector<uint32_t> histogram;   // 25 ms buckets
+};
+
+static EdgeStats measure(const char* name, int16_t from_mm, int16_t to_mm, uint32_t runs, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> latencies;
+    EdgeStats stats = {name, runs, 0, 0, 0, 0, 0, 0, {}};
+
+    for (uint32_t i = 0; i < runs; i++) {
+        EdgeRun run = runEdge(rng, from_mm, to_mm);
+        if (run.changed) {
+            latencies.push_back(run.latency_us);
+        } else {
+            stats.missed++;
+        }
+    }
+    if (latencies.empty()) return stats;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto at = [&](uint32_t pct) { return latencies[(latencies.size() - 1) * pct / 100] / 1000; };
+    stats.p50_ms = at(50);
+    stats.p90_ms = at(90);
+    stats.p99_ms = at(99);
+    stats.min_ms = latencies.front() / 1000;
+    stats.max_ms = latencies.back() / 1000;
+    stats.histogram.assign(stats.max_ms / 25 + 1, 0);
+    for (uint32_t l : latencies) stats.histogram[l / 1000 / 25]++;
+    return stats;
+}
+
+int main(int argc, char** argv) {
+    uint32_t runs = 2000;
+    uint32_t budget_ms = LATENCY_BUDGET_P99_MS;
+    const char* out_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--budget-p99-ms") == 0 && i + 1 < argc) {
+            budget_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--runs N] [--budget-p99-ms MS] [--out latency.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    hostSetLogOutput(nullptr);
+    hostSetPinHook(onPinChange, nullptr);
+
+    EdgeStats edges[] = {
+        measure("assert", LATENCY_FAR_MM, LATENCY_NEAR_MM, runs, 1),
+        measure("release", LATENCY_NEAR_MM, LATENCY_FAR_MM, runs, 2),
+    };
+
+    printf("loop delay %u ms, timing budget %u ms, confirmation count %u, budget p99 %u ms\n",
+           MAIN_LOOP_DELAY_MS, LATENCY_TIMING_BUDGET_MS, CHANGE_CONFIRMATION_COUNT, budget_ms);
+    bool over_budget = false;
+    for (const EdgeStats& e : edges) {
+        printf("%-8s runs %u missed %u  min %u  p50 %u  p90 %u  p99 %u  max %u ms\n", e.name, e.runs,
+               e.missed, e.min_ms, e.p50_ms, e.p90_ms, e.p99_ms, e.max_ms);
+        for (size_t b = 0; b < e.histogram.size(); b++) {
+            if (e.histogram[b] == 0) continue;
+            printf("  %4zu-%-4zu ms %6u %.*s\n", b * 25, b * 25 + 24, e.histogram[b],
+                   (int)min<uint32_t>(60, e.histogram[b] * 60 / e.runs + 1), "############################################################");
+        }
+        if (e.p99_ms > budget_ms || e.missed > 0) over_budget = true;
+    }
+
+    if (out_path != nullptr) {
+        FILE* out = fopen(out_path, "w");
+        if (out != nullptr) {
+            fprintf(out, "{\"loop_delay_ms\":%u,\"timing_budget_ms\":%u,\"budget_p99_ms\":%u,\"edges\":[",
+                    MAIN_LOOP_DELAY_MS, LATENCY_TIMING_BUDGET_MS, budget_ms);
+            for (size_t i = 0; i < 2; i++) {
+                const EdgeStats& e = edges[i];
+                fprintf(out, "%s{\"edge\":\"%s\",\"runs\":%u,\"missed\":%u,\"min_ms\":%u,\"p50_ms\":%u,"
+                             "\"p90_ms\":%u,\"p99_ms\":%u,\"max_ms\":%u}",
+                        i ? "," : "", e.name, e.runs, e.missed, e.min_ms, e.p50_ms, e.p90_ms, e.p99_ms, e.max_ms);
+            }
+            fprintf(out, "]}\n");
+            fclose(out);
+        }
+    }
+
+    if (over_budget) {
+        printf("FAIL: p99 latency over the %u ms budget or a step without an output change\n", budget_ms);
+        return 1;
+    }
+    return 0;
+}
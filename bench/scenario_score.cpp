@@ -0,0 +1,170 @@
+// Scenario scorecard: runs generated distance traces (see host/scenario.h)
+// through the firmware's filter and trigger code for several output
+// configurations and scores how the output follows the true distance.
+//
+//   pio run -e native_scenarios
+//   .pio/build/native_scenarios/program [--seeds 20] [--label baseline] [--out scorecard.json]
+//   tools/scorecard_compare.py baseline.json candidate.json
+//
+// Filter constants can be overridden for a run without editing the source, e.g.
+//   PLATFORMIO_BUILD_FLAGS="-D CHANGE_CONFIRMATION_COUNT=2" pio run -e native_scenarios
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "host_hal.h"
+#include "scenario.h"
+#include "sensor_manager.h"
+
+#define SCENARIO_SAMPLE_MS 50
+#define SCENARIO_GRACE_MS 1000
+
+static ScenarioParams scenario(const char* name, ScenarioKind kind, uint32_t duration_ms) {
+    ScenarioParams p;
+    memset(&p, 0, sizeof(p));
+    p.name = name;
+    p.kind = kind;
+    p.duration_ms = duration_ms;
+    p.far_mm = 1500;
+    p.near_mm = 400;
+    p.noise_sigma_mm = 3.0f;
+    return p;
+}
+
+static std::vector<ScenarioParams> buildScenarios() {
+    std::vector<ScenarioParams> list;
+
+    ScenarioParams p = scenario("step_arrival", SCENARIO_STEP, 8000);
+    p.event_ms = 2000;
+    p.hold_ms = 4000;
+    list.push_back(p);
+
+    p = scenario("ramp_approach", SCENARIO_RAMP, 10000);
+    p.near_mm = 250;
+    p.event_ms = 1000;
+    p.ramp_ms = 3000;
+    p.hold_ms = 1500;
+    list.push_back(p);
+
+    p = scenario("vibration", SCENARIO_VIBRATION, 8000);
+    p.event_ms = 1000;
+    p.hold_ms = 5000;
+    p.vibration_mm = 40.0f;
+    p.vibration_hz = 8.0f;
+    list.push_back(p);
+
+    p = scenario("gaussian_edge", SCENARIO_STEADY, 10000);
+    p.near_mm = 585;             // just inside the in_range window
+    p.noise_sigma_mm = 15.0f;
+    list.push_back(p);
+
+    p = scenario("impulses", SCENARIO_STEADY, 10000);
+    p.near_mm = 1500;            // nothing in range; impulses reach into it
+    p.impulse_rate = 0.05f;
+    p.impulse_mm = 1100;
+    list.push_back(p);
+
+    p = scenario("dropout_status2", SCENARIO_STEP, 8000);
+    p.event_ms = 1000;
+    p.hold_ms = 6000;
+    p.dropout_rate = 0.1f;
+    p.dropout_status = 2;
+    list.push_back(p);
+
+    p = scenario("dropout_status4", SCENARIO_STEP, 8000);
+    p.event_ms = 1000;
+    p.hold_ms = 6000;
+    p.dropout_rate = 0.1f;
+    p.dropout_status = 4;
+    list.push_back(p);
+
+    p = scenario("hand_wave", SCENARIO_STEP, 4000);
+    p.near_mm = 350;
+    p.event_ms = 2000;
+    p.hold_ms = 250;
+    list.push_back(p);
+
+    return list;
+}
+
+static const ScenarioOutput outputs[] = {
+    {"in_range", 200, 600, 30, true},
+    {"out_of_range", 300, 800, 50, false},
+    {"narrow", 350, 450, 10, true},
+};
+
+static uint32_t percentile(std::vector<uint32_t> values, uint8_t pct) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() - 1) * pct / 100;
+    return values[index];
+}
+
+int main(int argc, char** argv) {
+    uint32_t seeds = 20;
+    const char* label = "unnamed";
+    const char* out_path = "scorecard.json";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+            seeds = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--seeds N] [--label NAME] [--out scorecard.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    FILE* out = fopen(out_path, "w");
+    if (out == nullptr) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 2;
+    }
+    hostSetLogOutput(nullptr);
+
+    fprintf(out, "{\"label\":\"%s\",\"seeds\":%u,\"sample_ms\":%u,\"filter\":{\"size\":%u,"
+                 "\"change_threshold\":%u,\"confirmation_count\":%u,\"rapid_alpha\":%.3f,\"normal_alpha\":%.3f},"
+                 "\"results\":[",
+            label, seeds, SCENARIO_SAMPLE_MS, MOVING_AVERAGE_SIZE, CHANGE_DETECTION_THRESHOLD,
+            CHANGE_CONFIRMATION_COUNT, RAPID_ADAPT_ALPHA, NORMAL_ADAPT_ALPHA);
+
+    printf("%-16s %-13s %5s %6s %6s %7s %13s %13s\n", "scenario", "output", "runs", "missed",
+           "false", "glitch", "assert p50/95", "release p50/95");
+
+    std::vector<ScenarioSample> samples;
+    std::vector<uint8_t> states;
+    bool first = true;
+    for (const ScenarioParams& params : buildScenarios()) {
+        for (const ScenarioOutput& output : outputs) {
+            ScenarioScore score = {};
+            for (uint32_t seed = 1; seed <= seeds; seed++) {
+                generateScenario(params, seed, SCENARIO_SAMPLE_MS, samples);
+                runScenario(samples, output, states);
+                scoreScenario(samples, output, states, SCENARIO_GRACE_MS, score);
+            }
+
+            uint32_t assert_p50 = percentile(score.assert_ms, 50);
+            uint32_t assert_p95 = percentile(score.assert_ms, 95);
+            uint32_t release_p50 = percentile(score.release_ms, 50);
+            uint32_t release_p95 = percentile(score.release_ms, 95);
+            printf("%-16s %-13s %5u %6u %6u %7u %6u/%-6u %6u/%-6u\n", params.name, output.name, seeds,
+                   score.missed, score.false_triggers, score.glitches,
+                   assert_p50, assert_p95, release_p50, release_p95);
+
+            fprintf(out, "%s\n{\"scenario\":\"%s\",\"output\":\"%s\",\"expected\":%u,\"missed\":%u,"
+                         "\"false_triggers\":%u,\"glitches\":%u,\"assert_p50_ms\":%u,\"assert_p95_ms\":%u,"
+                         "\"release_p50_ms\":%u,\"release_p95_ms\":%u}",
+                    first ? "" : ",", params.name, output.name, score.expected_episodes, score.missed,
+                    score.false_triggers, score.glitches, assert_p50, assert_p95, release_p50, release_p95);
+            first = false;
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    fprintf(stderr, "scorecard written to %s\n", out_path);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+typedef uint16_t neoPixelType;
+
+// Keeps the pixel colours in memory; show() only counts refreshes
+class Adafruit_NeoPixel {
+private:
+    uint32_t pixels[8];
+    uint16_t num_pixels;
+    uint8_t brightness;
+    uint32_t show_count;
+
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800)
+        : num_pixels(n < 8 ? n : 8), brightness(255), show_count(0) {
+        memset(pixels, 0, sizeof(pixels));
+    }
+
+    void begin() {}
+    void show() { show_count++; }
+    void clear() { memset(pixels, 0, sizeof(pixels)); }
+    void setBrightness(uint8_t b) { brightness = b; }
+    void setPixelColor(uint16_t n, uint32_t c) { if (n < num_pixels) pixels[n] = c; }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) { setPixelColor(n, Color(r, g, b)); }
+    uint32_t getPixelColor(uint16_t n) const { return n < num_pixels ? pixels[n] : 0; }
+    uint16_t numPixels() const { return num_pixels; }
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+
+    uint32_t hostShowCount() const { return show_count; }
+};
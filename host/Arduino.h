@@ -0,0 +1,197 @@
+#pragma once
+
+// Minimal Arduino core for the native (Linux) build. Covers what the firmware
+// and the Adafruit VL53L1X driver use: Serial and Print/Stream, a
+// millis()/micros() clock, GPIO, random(), ESP, flash string macros and a
+// small String. By default time only moves when the harness advances
+// it (see host_hal.h), so runs are deterministic and independent of the host's
+// speed; the simulator switches the clock to real time.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define DEC 10
+#define HEX 16
+#define PI 3.1415926535897932384626433832795
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Flash strings and PROGMEM tables are ordinary memory, as on the ESP32
+class __FlashStringHelper;
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+
+using std::abs;
+using std::max;
+using std::min;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+class String {
+private:
+    std::string value;
+
+public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+    String(const char* s, unsigned int n) : value(s, n) {}
+    String(char c) : value(1, c) {}
+    String(unsigned char v, unsigned char base = DEC) : String((unsigned long)v, base) {}
+    String(int v, unsigned char base = DEC) : String((long)v, base) {}
+    String(unsigned int v, unsigned char base = DEC) : String((unsigned long)v, base) {}
+    String(long v, unsigned char base = DEC);
+    String(unsigned long v, unsigned char base = DEC);
+    String(float v, unsigned int decimals = 2);
+    String(double v, unsigned int decimals = 2);
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    bool isEmpty() const { return value.empty(); }
+    char operator[](unsigned int i) const { return i < value.size() ? value[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    String& operator+=(const String& s) { value += s.value; return *this; }
+    String& operator+=(const char* s) { if (s) value += s; return *this; }
+    String& operator+=(char c) { value += c; return *this; }
+    bool concat(const char* s) { if (s) value += s; return true; }
+    bool concat(const char* s, unsigned int n) { value.append(s, n); return true; }
+    bool concat(char c) { value += c; return true; }
+    friend String operator+(String a, const String& b) { a += b; return a; }
+    friend String operator+(String a, const char* b) { a += b; return a; }
+    friend String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+
+    bool operator==(const String& s) const { return value == s.value; }
+    bool operator==(const char* s) const { return s && value == s; }
+    bool operator!=(const String& s) const { return value != s.value; }
+    bool operator!=(const char* s) const { return !(*this == s); }
+    bool operator<(const String& s) const { return value < s.value; }
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const char* s, unsigned int from = 0) const;
+    bool startsWith(const char* s) const { return value.compare(0, strlen(s), s) == 0; }
+    bool endsWith(const char* s) const;
+    String substring(unsigned int from, unsigned int to = (unsigned int)-1) const;
+    void trim();
+    void toLowerCase();
+    void toUpperCase();
+    long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(value.c_str(), nullptr); }
+    void reserve(unsigned int n) { value.reserve(n); }
+};
+
+// Operand type of String concatenation in the Arduino core; ArduinoJson
+// adapts it alongside String
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t len);
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = DEC);
+    size_t print(unsigned long v, int base = DEC);
+    size_t print(long long v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned long long v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(double v, int digits = 2);
+    size_t print(const Printable& p) { return p.printTo(*this); }
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(T v) { size_t n = print(v); return n + println(); }
+    template <typename T>
+    size_t println(T v, int base) { size_t n = print(v, base); return n + println(); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char* buffer, size_t len);
+    size_t readBytes(uint8_t* buffer, size_t len) { return readBytes((char*)buffer, len); }
+    void setTimeout(unsigned long) {}
+};
+
+// Serial writes to stdout unless the harness redirects or silences it
+class HardwareSerial : public Stream {
+private:
+    FILE* out;
+
+public:
+    HardwareSerial() : out(stdout) {}
+    void begin(unsigned long) {}
+    void setOutput(FILE* f) { out = f; }
+    operator bool() const { return true; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() { if (out) fflush(out); }
+
+    using Print::write;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t len) override;
+};
+
+extern HardwareSerial Serial;
+
+// ESP.restart() ends the process (see hostSetRestartHook() in host_hal.h)
+class EspClass {
+public:
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();      // lowest free heap since boot
+    uint32_t getMaxAllocHeap();     // largest free block
+    uint32_t getFreeSketchSpace();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// AsyncUDP stand-in: a UDP socket with one receive thread that runs the
+// packet handler, as the async_udp task does on the device. Covers what the
+// firmware uses: listen(), onPacket(), replying through the packet, close().
+// The address and port it binds can be moved with hostSetUdpListen().
+
+class AsyncUDP;
+
+class AsyncUDPPacket {
+private:
+    AsyncUDP* udp;
+    uint8_t* payload;
+    size_t payload_len;
+    uint32_t remote_addr;       // network byte order
+    uint16_t remote_port;
+
+public:
+    AsyncUDPPacket(AsyncUDP* udp, uint8_t* data, size_t len, uint32_t addr, uint16_t port)
+        : udp(udp), payload(data), payload_len(len), remote_addr(addr), remote_port(port) {}
+
+    uint8_t* data() { return payload; }
+    size_t length() { return payload_len; }
+    IPAddress remoteIP() const;
+    uint16_t remotePort() const { return remote_port; }
+
+    // Sends data back to where the packet came from
+    size_t write(const uint8_t* data, size_t len);
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+private:
+    int fd;
+    std::atomic<bool> running;
+    std::thread thread;
+    AuPacketHandlerFunction handler;
+
+    void run();
+
+public:
+    AsyncUDP() : fd(-1), running(false) {}
+    ~AsyncUDP() { close(); }
+
+    bool listen(uint16_t port);
+    bool listen(const IPAddress& addr, uint16_t port) { return listen(port); }
+    void onPacket(AuPacketHandlerFunction cb) { handler = cb; }
+    void close();
+    bool connected() const { return fd >= 0; }
+
+    size_t hostSendTo(const uint8_t* data, size_t len, uint32_t addr, uint16_t port);
+};
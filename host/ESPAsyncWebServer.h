@@ -0,0 +1,228 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ESPAsyncWebServer on a local socket. One server thread accepts and parses
+// requests and runs the handlers, in the place of the async_tcp task on the
+// device, so handlers run concurrently with loop() just like there. Requests
+// are answered one response per connection (the handlers send
+// "Connection: close" anyway). Covers what web_server.cpp uses: routes with
+// upload and body handlers, query, urlencoded and multipart parameters,
+// headers, the client address, disconnect callbacks, redirects, and basic,
+// stream and chunked responses.
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+class AsyncResponseStream;
+struct HostHttpServer;
+struct HostHttpConnection;
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data,
+                           size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index,
+                           size_t total)> ArBodyHandlerFunction;
+typedef std::function<size_t(uint8_t* buffer, size_t max_len, size_t index)> AwsResponseFiller;
+typedef std::function<void(void)> ArDisconnectHandler;
+
+// lwIP's connection; here only an identity (the host connection)
+struct tcp_pcb;
+
+class AsyncWebParameter {
+private:
+    String param_name;
+    String param_value;
+    bool is_post;
+    bool is_file;
+
+public:
+    AsyncWebParameter(const String& name, const String& value, bool post = false, bool file = false)
+        : param_name(name), param_value(value), is_post(post), is_file(file) {}
+    const String& name() const { return param_name; }
+    const String& value() const { return param_value; }
+    size_t size() const { return param_value.length(); }
+    bool isPost() const { return is_post; }
+    bool isFile() const { return is_file; }
+};
+
+class AsyncWebHeader {
+private:
+    String header_name;
+    String header_value;
+
+public:
+    AsyncWebHeader(const String& name, const String& value) : header_name(name), header_value(value) {}
+    const String& name() const { return header_name; }
+    const String& value() const { return header_value; }
+};
+
+class AsyncWebServerResponse {
+protected:
+    int code;
+    String content_type;
+    std::vector<AsyncWebHeader> headers;
+    std::string body;
+
+public:
+    AsyncWebServerResponse(int status, const String& type) : code(status), content_type(type) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void setCode(int status) { code = status; }
+    void setContentType(const String& type) { content_type = type; }
+    void addHeader(const char* name, const char* value) { headers.push_back(AsyncWebHeader(name, value)); }
+    void addHeader(const char* name, const String& value) { addHeader(name, value.c_str()); }
+    void addHeader(const String& name, const String& value) { addHeader(name.c_str(), value.c_str()); }
+
+    // Server side
+    int hostCode() const { return code; }
+    const String& hostContentType() const { return content_type; }
+    const std::vector<AsyncWebHeader>& hostHeaders() const { return headers; }
+    const std::string& hostBody() const { return body; }
+    virtual bool hostChunked() const { return false; }
+    virtual size_t hostFill(uint8_t* buffer, size_t max_len, size_t index) { return 0; }
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse {
+public:
+    AsyncBasicResponse(int status, const String& type, const char* content, size_t len)
+        : AsyncWebServerResponse(status, type) { body.assign(content, len); }
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+    AsyncResponseStream(const String& type, size_t buffer_size) : AsyncWebServerResponse(200, type) {
+        body.reserve(buffer_size);
+    }
+    using Print::write;
+    size_t write(uint8_t c) override { body.push_back((char)c); return 1; }
+    size_t write(const uint8_t* data, size_t len) override { body.append((const char*)data, len); return len; }
+};
+
+class AsyncChunkedResponse : public AsyncWebServerResponse {
+private:
+    AwsResponseFiller filler;
+
+public:
+    AsyncChunkedResponse(const String& type, AwsResponseFiller callback)
+        : AsyncWebServerResponse(200, type), filler(callback) {}
+    bool hostChunked() const override { return true; }
+    size_t hostFill(uint8_t* buffer, size_t max_len, size_t index) override { return filler(buffer, max_len, index); }
+};
+
+// The connection of a request; only its address and identity are needed
+class AsyncClient {
+private:
+    IPAddress remote_ip;
+    tcp_pcb* host_pcb;
+
+public:
+    AsyncClient() : host_pcb(nullptr) {}
+    AsyncClient(const IPAddress& ip, tcp_pcb* pcb) : remote_ip(ip), host_pcb(pcb) {}
+    IPAddress remoteIP() const { return remote_ip; }
+    tcp_pcb* pcb() { return host_pcb; }
+};
+
+class AsyncWebServerRequest {
+    friend struct HostHttpServer;
+
+private:
+    WebRequestMethod request_method;
+    String request_url;
+    std::vector<AsyncWebHeader> request_headers;
+    std::vector<AsyncWebParameter> request_params;
+    AsyncWebServerResponse* response;
+    bool sent;
+    HostHttpServer* host_server;
+    HostHttpConnection* host_connection;
+    AsyncClient host_client;
+    ArDisconnectHandler on_disconnect;
+
+public:
+    void* _tempObject;      // handler state across body callbacks, free()d with the request
+
+    AsyncWebServerRequest();
+    ~AsyncWebServerRequest();
+
+    AsyncClient* client() { return &host_client; }
+    void onDisconnect(ArDisconnectHandler fn) { on_disconnect = fn; }
+    WebRequestMethodComposite method() const { return request_method; }
+    const String& url() const { return request_url; }
+
+    size_t params() const { return request_params.size(); }
+    const AsyncWebParameter* getParam(size_t index) const;
+    bool hasParam(const char* name, bool post = false, bool file = false) const;
+    bool hasParam(const String& name, bool post = false, bool file = false) const { return hasParam(name.c_str(), post, file); }
+    const AsyncWebParameter* getParam(const char* name, bool post = false, bool file = false) const;
+    const AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const { return getParam(name.c_str(), post, file); }
+
+    size_t headers() const { return request_headers.size(); }
+    bool hasHeader(const char* name) const;
+    bool hasHeader(const String& name) const { return hasHeader(name.c_str()); }
+    const String& header(const char* name) const;
+    const String& header(const String& name) const { return header(name.c_str()); }
+    const String& contentType() const { return header("Content-Type"); }
+    size_t contentLength() const { return (size_t)header("Content-Length").toInt(); }
+
+    AsyncWebServerResponse* beginResponse(int code, const char* content_type = "", const char* content = "");
+    AsyncWebServerResponse* beginResponse(int code, const char* content_type, const String& content);
+    AsyncWebServerResponse* beginResponse(int code, const String& content_type, const String& content) { return beginResponse(code, content_type.c_str(), content); }
+    AsyncResponseStream* beginResponseStream(const char* content_type, size_t buffer_size = 1460);
+    AsyncWebServerResponse* beginChunkedResponse(const char* content_type, AwsResponseFiller callback);
+
+    void send(AsyncWebServerResponse* res);
+    void send(int code, const char* content_type = "", const char* content = "") { send(beginResponse(code, content_type, content)); }
+    void send(int code, const char* content_type, const String& content) { send(beginResponse(code, content_type, content)); }
+    void send(int code, const String& content_type, const String& content) { send(beginResponse(code, content_type, content)); }
+    void redirect(const char* url);
+    void redirect(const String& url) { redirect(url.c_str()); }
+};
+
+class AsyncWebServer {
+    friend struct HostHttpServer;
+
+private:
+    struct Route {
+        String uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction on_request;
+        ArUploadHandlerFunction on_upload;
+        ArBodyHandlerFunction on_body;
+    };
+
+    uint16_t port;
+    std::vector<Route> routes;
+    ArRequestHandlerFunction not_found;
+    HostHttpServer* impl;
+
+    const Route* findRoute(const AsyncWebServerRequest* request) const;
+
+public:
+    AsyncWebServer(uint16_t port);
+    ~AsyncWebServer();
+
+    void begin();
+    void end();
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction on_request,
+            ArUploadHandlerFunction on_upload = nullptr, ArBodyHandlerFunction on_body = nullptr);
+    void onNotFound(ArRequestHandlerFunction fn) { not_found = fn; }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+#define HOST_LITTLEFS_BYTES 0xA0000   // spiffs partition in partitions.csv
+#define HOST_LITTLEFS_BLOCK 4096
+
+struct HostFileHandle;
+
+// fs::File over a file or directory below the LittleFS root directory on the
+// host. Copies share the open handle, like the ESP32 core's File.
+class File : public Stream {
+private:
+    std::shared_ptr<HostFileHandle> handle;
+
+public:
+    File() {}
+    explicit File(std::shared_ptr<HostFileHandle> h) : handle(h) {}
+
+    operator bool() const;
+    using Print::write;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* buffer, size_t len);
+    size_t readBytes(char* buffer, size_t len) override { return read((uint8_t*)buffer, len); }
+    bool seek(uint32_t pos);
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close();
+    const char* name() const;
+    const char* path() const;
+    bool isDirectory() const;
+    File openNextFile(const char* mode = FILE_READ);
+    void rewindDirectory();
+};
+
+// LittleFS mounted on a host directory (hostSetLittleFsRoot() in host_hal.h)
+class LittleFSFS {
+private:
+    std::string root;
+    bool mounted;
+
+    std::string hostPath(const char* path) const;
+
+public:
+    LittleFSFS();
+
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    void end() { mounted = false; }
+    bool format();
+    size_t totalBytes() { return HOST_LITTLEFS_BYTES; }
+    size_t usedBytes();
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+
+    void hostSetRoot(const char* dir) { root = dir; }
+};
+
+extern LittleFSFS LittleFS;
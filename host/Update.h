@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+#define UPDATE_ERROR_OK 0
+#define UPDATE_ERROR_WRITE 1
+#define UPDATE_ERROR_SPACE 4
+#define UPDATE_ERROR_SIZE 5
+#define UPDATE_ERROR_ABORT 8
+#define UPDATE_ERROR_BAD_ARGUMENT 9
+#define UPDATE_ERROR_MAGIC_BYTE 10
+
+// Firmware update into memory. The image is checked like the real one (size,
+// 0xE9 magic byte) but never booted; hostImage() returns it.
+class UpdateClass {
+private:
+    std::string image;
+    size_t expected_size;
+    uint8_t error;
+    bool running;
+
+public:
+    UpdateClass() : expected_size(0), error(UPDATE_ERROR_OK), running(false) {}
+
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN);
+    size_t write(uint8_t* data, size_t len);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+    bool isRunning() { return running; }
+    bool hasError() { return error != UPDATE_ERROR_OK; }
+    uint8_t getError() { return error; }
+    const char* errorString();
+    size_t progress() { return image.size(); }
+
+    const std::string& hostImage() { return image; }
+};
+
+extern UpdateClass Update;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3,
+} wifi_mode_t;
+
+class IPAddress : public Printable {
+private:
+    uint8_t octets[4];
+
+public:
+    IPAddress() : octets{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+    uint8_t operator[](int i) const { return octets[i]; }
+    bool operator==(const IPAddress& other) const { return memcmp(octets, other.octets, 4) == 0; }
+    String toString() const;
+    size_t printTo(Print& p) const override { return p.print(toString()); }
+};
+
+// Soft AP with no radio behind it. The simulator serves HTTP on a local
+// socket instead (see hostSetHttpListen() in host_hal.h).
+class WiFiClass {
+private:
+    wifi_mode_t wifi_mode;
+    bool ap_started;
+    IPAddress ap_ip;
+
+public:
+    WiFiClass() : wifi_mode(WIFI_OFF), ap_started(false), ap_ip(192, 168, 4, 1) {}
+
+    bool mode(wifi_mode_t m) { wifi_mode = m; return true; }
+    wifi_mode_t getMode() { return wifi_mode; }
+    uint8_t* macAddress(uint8_t* mac);
+    bool softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet) { ap_ip = local_ip; return true; }
+    bool softAP(const char* ssid, const char* passphrase = nullptr, int channel = 1, int ssid_hidden = 0,
+                int max_connection = 4) { ap_started = true; return true; }
+    bool softAP(const char* ssid, const String& passphrase, int channel = 1, int ssid_hidden = 0,
+                int max_connection = 4) { return softAP(ssid, passphrase.c_str(), channel, ssid_hidden, max_connection); }
+    bool softAPsetHostname(const char* hostname) { return true; }
+    IPAddress softAPIP() { return ap_ip; }
+    bool softAPdisconnect(bool wifioff = false) { ap_started = false; return true; }
+    uint8_t softAPgetStationNum() { return 0; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define HOST_I2C_BUFFER 128
+#define HOST_I2C_DEVICES 4
+
+// A device on the emulated bus. A write transaction delivers its payload
+// (without the address byte); a read asks for len bytes.
+class HostI2CDevice {
+public:
+    virtual ~HostI2CDevice() {}
+    virtual uint8_t i2cAddress() = 0;
+    virtual void i2cWrite(const uint8_t* data, size_t len) = 0;
+    virtual void i2cRead(uint8_t* data, size_t len) = 0;
+};
+
+// Bus totals; bytes include the address byte of every transaction
+struct HostI2CStats {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint64_t bus_us;
+    uint32_t nacks;
+};
+
+// TwoWire with the Arduino-ESP32 calling conventions, routed to attached
+// devices. Every transaction advances the virtual clock by its time on the
+// wire at the configured clock, so polling loops in a driver terminate and
+// bus time shows up in latency measurements.
+class TwoWire {
+private:
+    HostI2CDevice* devices[HOST_I2C_DEVICES];
+    uint8_t device_count;
+    uint32_t clock_hz;
+    uint8_t tx_address;
+    uint8_t tx_buffer[HOST_I2C_BUFFER];
+    size_t tx_length;
+    uint8_t rx_buffer[HOST_I2C_BUFFER];
+    size_t rx_length;
+    size_t rx_index;
+    HostI2CStats stats;
+
+    HostI2CDevice* find(uint8_t address);
+    void account(size_t payload_bytes);
+
+public:
+    TwoWire();
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void setClock(uint32_t frequency) { clock_hz = frequency; }
+    uint32_t getClock() { return clock_hz; }
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t len);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t endTransmission(uint8_t sendStop) { return endTransmission(sendStop != 0); }
+
+    size_t requestFrom(uint16_t address, size_t size, bool sendStop);
+    uint8_t requestFrom(uint8_t address, uint8_t size) { return requestFrom((uint16_t)address, (size_t)size, true); }
+    uint8_t requestFrom(uint8_t address, uint8_t size, uint8_t sendStop) { return requestFrom((uint16_t)address, (size_t)size, sendStop != 0); }
+    uint8_t requestFrom(int address, int size) { return requestFrom((uint16_t)address, (size_t)size, true); }
+    uint8_t requestFrom(int address, int size, int sendStop) { return requestFrom((uint16_t)address, (size_t)size, sendStop != 0); }
+    int available() { return (int)(rx_length - rx_index); }
+    int read() { return rx_index < rx_length ? rx_buffer[rx_index++] : -1; }
+    int peek() { return rx_index < rx_length ? rx_buffer[rx_index] : -1; }
+
+    // Harness side
+    bool hostAttach(HostI2CDevice* device);
+    const HostI2CStats& hostStats() { return stats; }
+    void hostResetStats() { memset(&stats, 0, sizeof(stats)); }
+};
+
+extern TwoWire Wire;
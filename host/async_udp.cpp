@@ -0,0 +1,88 @@
+// AsyncUDP stand-in, see AsyncUDP.h
+
+#include <AsyncUDP.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include "host_hal.h"
+
+#define HOST_UDP_MAX_PACKET 1500
+#define HOST_UDP_POLL_MS 100
+
+static std::string udp_listen_addr = "127.0.0.1";
+static int udp_listen_port = -1;
+
+void hostSetUdpListen(const char* addr, uint16_t port) {
+    udp_listen_addr = addr;
+    udp_listen_port = port;
+}
+
+IPAddress AsyncUDPPacket::remoteIP() const {
+    const uint8_t* b = (const uint8_t*)&remote_addr;
+    return IPAddress(b[0], b[1], b[2], b[3]);
+}
+
+size_t AsyncUDPPacket::write(const uint8_t* data, size_t len) {
+    return udp->hostSendTo(data, len, remote_addr, remote_port);
+}
+
+bool AsyncUDP::listen(uint16_t port) {
+    close();
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(udp_listen_port >= 0 ? udp_listen_port : port);
+    if (inet_pton(AF_INET, udp_listen_addr.c_str(), &addr.sin_addr) != 1) return false;
+
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "[HOST] UDP bind %s:%u: %s\n", udp_listen_addr.c_str(), ntohs(addr.sin_port), strerror(errno));
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    running = true;
+    thread = std::thread(&AsyncUDP::run, this);
+    return true;
+}
+
+void AsyncUDP::close() {
+    if (thread.joinable()) {
+        running = false;
+        thread.join();
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void AsyncUDP::run() {
+    uint8_t buffer[HOST_UDP_MAX_PACKET];
+    while (running) {
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, HOST_UDP_POLL_MS) <= 0) continue;
+
+        sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(fd, buffer, sizeof(buffer), 0, (sockaddr*)&from, &from_len);
+        if (n < 0 || !handler) continue;
+        AsyncUDPPacket packet(this, buffer, (size_t)n, from.sin_addr.s_addr, ntohs(from.sin_port));
+        handler(packet);
+    }
+}
+
+size_t AsyncUDP::hostSendTo(const uint8_t* data, size_t len, uint32_t addr, uint16_t port) {
+    sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = addr;
+    to.sin_port = htons(port);
+    ssize_t n = sendto(fd, data, len, 0, (sockaddr*)&to, sizeof(to));
+    return n < 0 ? 0 : (size_t)n;
+}
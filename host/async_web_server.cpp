@@ -0,0 +1,636 @@
+// ESPAsyncWebServer stand-in, see ESPAsyncWebServer.h. One thread polls the
+// listening socket and every connection, parses requests, runs the handlers
+// and streams the responses back.
+
+#include <ESPAsyncWebServer.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "host_hal.h"
+
+#define HOST_HTTP_MAX_HEADER 8192
+#define HOST_HTTP_MAX_BODY (2 * 1024 * 1024)   // room for a firmware image
+#define HOST_HTTP_SEGMENT 1436                   // upload and chunk size, one TCP segment on the device
+#define HOST_HTTP_MAX_CLIENTS 1024
+#define HOST_HTTP_POLL_MS 100
+#define HOST_HTTP_RETRY_MS 5                     // while a filler answers RESPONSE_TRY_AGAIN
+
+static std::string listen_addr = "127.0.0.1";
+static int listen_port = -1;
+static HostTcpWriteHook tcp_write_hook = nullptr;
+
+void hostSetHttpListen(const char* addr, uint16_t port) {
+    listen_addr = addr;
+    listen_port = port;
+}
+
+void hostSetTcpWriteHook(HostTcpWriteHook hook) {
+    tcp_write_hook = hook;
+}
+
+struct HostHttpConnection {
+    int fd;
+    IPAddress peer;
+    std::string in;
+    std::string out;
+    size_t out_pos;
+    AsyncWebServerRequest* request;     // set once a request is being answered
+    AsyncWebServerResponse* response;
+    size_t chunk_index;
+    bool chunk_waiting;                 // filler asked to be called again
+    bool done;                          // close once out is drained
+};
+
+struct HostHttpServer {
+    AsyncWebServer* server;
+    int listen_fd;
+    std::atomic<bool> running;
+    std::thread thread;
+    std::vector<HostHttpConnection*> connections;
+
+    void run();
+    void acceptClients();
+    bool receive(HostHttpConnection* c);
+    bool transmit(HostHttpConnection* c);
+    void fillChunk(HostHttpConnection* c);
+    void dispatch(HostHttpConnection* c, size_t header_len, size_t body_len);
+    AsyncWebServerRequest* newRequest(HostHttpConnection* c);
+    void fail(HostHttpConnection* c, int code, const char* message);
+    void startResponse(HostHttpConnection* c);
+    void closeConnection(HostHttpConnection* c);
+};
+
+static const char* statusText(int code) {
+    switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "";
+    }
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static String urlDecode(const char* s, size_t len) {
+    std::string out;
+    out.reserve(len);
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '+') {
+            out.push_back(' ');
+        } else if (s[i] == '%' && i + 2 < len && hexValue(s[i + 1]) >= 0 && hexValue(s[i + 2]) >= 0) {
+            out.push_back((char)(hexValue(s[i + 1]) * 16 + hexValue(s[i + 2])));
+            i += 2;
+        } else {
+            out.push_back(s[i]);
+        }
+    }
+    return String(out.c_str(), out.size());
+}
+
+static void parseUrlEncoded(const std::string& text, bool post, std::vector<AsyncWebParameter>& params) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('&', pos);
+        if (end == std::string::npos) end = text.size();
+        size_t eq = text.find('=', pos);
+        if (end > pos) {
+            if (eq == std::string::npos || eq > end) {
+                params.push_back(AsyncWebParameter(urlDecode(text.data() + pos, end - pos), "", post));
+            } else {
+                params.push_back(AsyncWebParameter(urlDecode(text.data() + pos, eq - pos),
+                                                   urlDecode(text.data() + eq + 1, end - eq - 1), post));
+            }
+        }
+        pos = end + 1;
+    }
+}
+
+// Value of key="..." (or key=...) in a header such as Content-Disposition
+static std::string headerAttribute(const std::string& header, const char* key) {
+    std::string needle = std::string(key) + "=";
+    size_t pos = 0;
+    while ((pos = header.find(needle, pos)) != std::string::npos) {
+        if (pos == 0 || header[pos - 1] == ' ' || header[pos - 1] == ';') break;
+        pos += needle.size();
+    }
+    if (pos == std::string::npos) return "";
+    pos += needle.size();
+    if (pos < header.size() && header[pos] == '"') {
+        size_t end = header.find('"', pos + 1);
+        return header.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+    }
+    size_t end = header.find(';', pos);
+    return header.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+}
+
+static bool startsWith(const String& s, const String& prefix) {
+    return strncmp(s.c_str(), prefix.c_str(), prefix.length()) == 0;
+}
+
+// AsyncWebServerRequest
+
+AsyncWebServerRequest::AsyncWebServerRequest()
+    : request_method(HTTP_GET), response(nullptr), sent(false), host_server(nullptr), host_connection(nullptr),
+      _tempObject(nullptr) {}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+    delete response;
+    free(_tempObject);
+}
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(size_t index) const {
+    return index < request_params.size() ? &request_params[index] : nullptr;
+}
+
+bool AsyncWebServerRequest::hasParam(const char* name, bool post, bool file) const {
+    return getParam(name, post, file) != nullptr;
+}
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(const char* name, bool post, bool file) const {
+    for (const AsyncWebParameter& p : request_params) {
+        if (p.name() == name && p.isPost() == post && p.isFile() == file) return &p;
+    }
+    return nullptr;
+}
+
+bool AsyncWebServerRequest::hasHeader(const char* name) const {
+    for (const AsyncWebHeader& h : request_headers) {
+        if (strcasecmp(h.name().c_str(), name) == 0) return true;
+    }
+    return false;
+}
+
+const String& AsyncWebServerRequest::header(const char* name) const {
+    static const String empty;
+    for (const AsyncWebHeader& h : request_headers) {
+        if (strcasecmp(h.name().c_str(), name) == 0) return h.value();
+    }
+    return empty;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const char* content_type, const char* content) {
+    return new AsyncBasicResponse(code, content_type, content, strlen(content));
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const char* content_type, const String& content) {
+    return new AsyncBasicResponse(code, content_type, content.c_str(), content.length());
+}
+
+AsyncResponseStream* AsyncWebServerRequest::beginResponseStream(const char* content_type, size_t buffer_size) {
+    return new AsyncResponseStream(content_type, buffer_size);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const char* content_type, AwsResponseFiller callback) {
+    return new AsyncChunkedResponse(content_type, callback);
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* res) {
+    if (sent) {
+        // The library ignores a second response as well
+        delete res;
+        return;
+    }
+    response = res;
+    sent = true;
+    // Start sending right away, as the TCP stack does on the device, so a
+    // handler that restarts before returning still gets its response out
+    if (host_server != nullptr) {
+        host_server->startResponse(host_connection);
+        host_server->transmit(host_connection);
+    }
+}
+
+void AsyncWebServerRequest::redirect(const char* url) {
+    AsyncWebServerResponse* res = beginResponse(302);
+    res->addHeader("Location", url);
+    send(res);
+}
+
+// AsyncWebServer
+
+AsyncWebServer::AsyncWebServer(uint16_t port) : port(port), impl(nullptr) {}
+
+AsyncWebServer::~AsyncWebServer() {
+    end();
+}
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction on_request,
+                        ArUploadHandlerFunction on_upload, ArBodyHandlerFunction on_body) {
+    routes.push_back(Route{uri, method, on_request, on_upload, on_body});
+}
+
+// Same matching as AsyncCallbackWebHandler: exact, a sub path, or a prefix ending in '*'
+const AsyncWebServer::Route* AsyncWebServer::findRoute(const AsyncWebServerRequest* request) const {
+    for (const Route& route : routes) {
+        if (!(route.method & request->method())) continue;
+        const String& uri = route.uri;
+        const String& url = request->url();
+        if (uri.length() > 0 && uri[uri.length() - 1] == '*') {
+            if (strncmp(url.c_str(), uri.c_str(), uri.length() - 1) == 0) return &route;
+        } else if (url == uri || startsWith(url, uri + "/")) {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+void AsyncWebServer::begin() {
+    if (impl != nullptr) return;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(listen_port >= 0 ? (uint16_t)listen_port : port);
+    if (inet_pton(AF_INET, listen_addr.c_str(), &addr.sin_addr) != 1 ||
+        bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 512) != 0) {
+        Serial.printf("[HTTP] Cannot listen on %s:%u: %s\n", listen_addr.c_str(), ntohs(addr.sin_port), strerror(errno));
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    Serial.printf("[HTTP] Listening on http://%s:%u/\n", listen_addr.c_str(), ntohs(addr.sin_port));
+
+    impl = new HostHttpServer();
+    impl->server = this;
+    impl->listen_fd = fd;
+    impl->running = true;
+    impl->thread = std::thread([this]() { impl->run(); });
+}
+
+void AsyncWebServer::end() {
+    if (impl == nullptr) return;
+    impl->running = false;
+    impl->thread.join();
+    for (HostHttpConnection* c : impl->connections) impl->closeConnection(c);
+    close(impl->listen_fd);
+    delete impl;
+    impl = nullptr;
+}
+
+// HostHttpServer
+
+void HostHttpServer::run() {
+    std::vector<pollfd> fds;
+    while (running) {
+        bool retry = false;
+        fds.clear();
+        fds.push_back(pollfd{listen_fd, POLLIN, 0});
+        for (HostHttpConnection* c : connections) {
+            short events = 0;
+            if (c->out_pos < c->out.size()) {
+                events = POLLOUT;
+            } else if (c->request == nullptr) {
+                events = POLLIN;
+            } else if (c->chunk_waiting) {
+                retry = true;
+            }
+            fds.push_back(pollfd{c->fd, events, 0});
+        }
+
+        if (poll(fds.data(), fds.size(), retry ? HOST_HTTP_RETRY_MS : HOST_HTTP_POLL_MS) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) acceptClients();
+
+        std::vector<HostHttpConnection*> keep;
+        for (size_t i = 0; i < fds.size() - 1 && i < connections.size(); i++) {
+            HostHttpConnection* c = connections[i];
+            bool open = true;
+            if (fds[i + 1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                open = (fds[i + 1].revents & POLLIN) && receive(c);
+            } else if (fds[i + 1].revents & POLLIN) {
+                open = receive(c);
+            }
+            if (open && c->request != nullptr) open = transmit(c);
+            if (open) {
+                keep.push_back(c);
+            } else {
+                closeConnection(c);
+            }
+        }
+        // Connections accepted during this round come after the polled ones
+        for (size_t i = fds.size() - 1; i < connections.size(); i++) keep.push_back(connections[i]);
+        connections.swap(keep);
+    }
+}
+
+void HostHttpServer::acceptClients() {
+    for (;;) {
+        sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        int fd = accept4(listen_fd, (sockaddr*)&peer, &peer_len, SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (connections.size() >= HOST_HTTP_MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        HostHttpConnection* c = new HostHttpConnection();
+        c->fd = fd;
+        const uint8_t* b = (const uint8_t*)&peer.sin_addr.s_addr;
+        c->peer = IPAddress(b[0], b[1], b[2], b[3]);
+        c->out_pos = 0;
+        c->request = nullptr;
+        c->response = nullptr;
+        c->chunk_index = 0;
+        c->chunk_waiting = false;
+        c->done = false;
+        connections.push_back(c);
+    }
+}
+
+void HostHttpServer::closeConnection(HostHttpConnection* c) {
+    close(c->fd);
+    if (c->request != nullptr && c->request->on_disconnect) c->request->on_disconnect();
+    delete c->request;
+    delete c;
+}
+
+// Reads what arrived and dispatches once a whole request is buffered; false closes
+bool HostHttpServer::receive(HostHttpConnection* c) {
+    char buffer[16384];
+    bool eof = false;
+    for (;;) {
+        ssize_t n = recv(c->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            c->in.append(buffer, n);
+            continue;
+        }
+        if (n == 0) {
+            eof = true;
+            break;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        if (errno != EINTR) return false;
+    }
+    if (c->request != nullptr) return true;   // already answering, ignore pipelined data
+
+    size_t header_end = c->in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        if (c->in.size() > HOST_HTTP_MAX_HEADER) fail(c, 431, "Request header too large");
+        return c->request != nullptr || !eof;
+    }
+    size_t header_len = header_end + 4;
+
+    size_t body_len = 0;
+    bool chunked = false;
+    size_t line = c->in.find("\r\n") + 2;
+    while (line < header_end) {
+        size_t next = c->in.find("\r\n", line);
+        std::string h = c->in.substr(line, next - line);
+        if (strncasecmp(h.c_str(), "Content-Length:", 15) == 0) {
+            body_len = strtoul(h.c_str() + 15, nullptr, 10);
+        } else if (strncasecmp(h.c_str(), "Transfer-Encoding:", 18) == 0) {
+            chunked = true;
+        }
+        line = next + 2;
+    }
+    if (chunked) {
+        fail(c, 411, "Chunked request bodies are not supported");
+    } else if (body_len > HOST_HTTP_MAX_BODY) {
+        fail(c, 413, "Request body too large");
+    } else if (c->in.size() >= header_len + body_len) {
+        dispatch(c, header_len, body_len);
+    }
+    return c->request != nullptr || !eof;
+}
+
+AsyncWebServerRequest* HostHttpServer::newRequest(HostHttpConnection* c) {
+    delete c->request;
+    c->request = new AsyncWebServerRequest();
+    c->request->host_server = this;
+    c->request->host_connection = c;
+    c->request->host_client = AsyncClient(c->peer, (tcp_pcb*)c);
+    return c->request;
+}
+
+void HostHttpServer::fail(HostHttpConnection* c, int code, const char* message) {
+    newRequest(c)->send(code, "text/plain", message);
+}
+
+void HostHttpServer::dispatch(HostHttpConnection* c, size_t header_len, size_t body_len) {
+    AsyncWebServerRequest* request = newRequest(c);
+
+    // Request line
+    size_t line_end = c->in.find("\r\n");
+    std::string request_line = c->in.substr(0, line_end);
+    size_t sp1 = request_line.find(' ');
+    size_t sp2 = request_line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) {
+        fail(c, 400, "Bad request line");
+        return;
+    }
+    std::string method = request_line.substr(0, sp1);
+    std::string target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+    static const struct { const char* name; WebRequestMethod method; } methods[] = {
+        {"GET", HTTP_GET}, {"POST", HTTP_POST}, {"DELETE", HTTP_DELETE}, {"PUT", HTTP_PUT},
+        {"PATCH", HTTP_PATCH}, {"HEAD", HTTP_HEAD}, {"OPTIONS", HTTP_OPTIONS},
+    };
+    bool known = false;
+    for (const auto& m : methods) {
+        if (method == m.name) {
+            request->request_method = m.method;
+            known = true;
+        }
+    }
+    if (!known) {
+        fail(c, 501, "Method not implemented");
+        return;
+    }
+
+    size_t query = target.find('?');
+    request->request_url = urlDecode(target.data(), query == std::string::npos ? target.size() : query);
+    if (query != std::string::npos) parseUrlEncoded(target.substr(query + 1), false, request->request_params);
+
+    // Headers
+    size_t line = line_end + 2;
+    while (line < header_len - 2) {
+        size_t next = c->in.find("\r\n", line);
+        size_t colon = c->in.find(':', line);
+        if (colon != std::string::npos && colon < next) {
+            size_t value = c->in.find_first_not_of(" \t", colon + 1);
+            if (value > next) value = next;
+            request->request_headers.push_back(AsyncWebHeader(String(c->in.data() + line, colon - line),
+                                                              String(c->in.data() + value, next - value)));
+        }
+        line = next + 2;
+    }
+
+    const AsyncWebServer::Route* route = server->findRoute(request);
+    std::string body = c->in.substr(header_len, body_len);
+    const String& content_type = request->header("Content-Type");
+
+    // Body: form fields become POST parameters, file parts go to the upload
+    // handler a segment at a time, anything else to the body handler
+    if (strncasecmp(content_type.c_str(), "application/x-www-form-urlencoded", 33) == 0) {
+        parseUrlEncoded(body, true, request->request_params);
+    } else if (strncasecmp(content_type.c_str(), "multipart/form-data", 19) == 0) {
+        std::string delimiter = "--" + headerAttribute(content_type.c_str(), "boundary");
+        size_t pos = body.find(delimiter);
+        while (pos != std::string::npos) {
+            pos += delimiter.size();
+            if (body.compare(pos, 2, "--") == 0) break;
+            size_t part_header_end = body.find("\r\n\r\n", pos);
+            if (part_header_end == std::string::npos) break;
+            std::string part_headers = body.substr(pos, part_header_end - pos);
+            size_t data_start = part_header_end + 4;
+            size_t data_end = body.find("\r\n" + delimiter, data_start);
+            if (data_end == std::string::npos) break;
+
+            std::string name = headerAttribute(part_headers, "name");
+            std::string filename = headerAttribute(part_headers, "filename");
+            if (part_headers.find("filename=") == std::string::npos) {
+                request->request_params.push_back(AsyncWebParameter(name.c_str(),
+                    String(body.data() + data_start, data_end - data_start), true));
+            } else {
+                request->request_params.push_back(AsyncWebParameter(name.c_str(), filename.c_str(), true, true));
+                if (route != nullptr && route->on_upload) {
+                    size_t total = data_end - data_start;
+                    size_t index = 0;
+                    do {
+                        size_t len = min<size_t>(HOST_HTTP_SEGMENT, total - index);
+                        route->on_upload(request, filename.c_str(), index, (uint8_t*)&body[data_start + index],
+                                         len, index + len == total);
+                        index += len;
+                    } while (index < total);
+                }
+            }
+            pos = data_end + 2;
+        }
+    } else if (body_len > 0 && route != nullptr && route->on_body) {
+        for (size_t index = 0; index < body_len; index += HOST_HTTP_SEGMENT) {
+            route->on_body(request, (uint8_t*)&body[index], min<size_t>(HOST_HTTP_SEGMENT, body_len - index),
+                           index, body_len);
+        }
+    }
+
+    if (route != nullptr) {
+        route->on_request(request);
+    } else if (server->not_found) {
+        server->not_found(request);
+    } else {
+        request->send(404);
+    }
+    if (!request->sent) startResponse(c);
+}
+
+void HostHttpServer::startResponse(HostHttpConnection* c) {
+    AsyncWebServerResponse* res = c->request->response;
+    if (res == nullptr) {
+        // The library would leave the client hanging until it times out
+        Serial.printf("[HTTP] No response sent for %s\n", c->request->url().c_str());
+        c->done = true;
+        return;
+    }
+    c->response = res;
+
+    std::string& out = c->out;
+    char line[128];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", res->hostCode(), statusText(res->hostCode()));
+    out = line;
+    if (res->hostContentType().length() > 0) {
+        out += "Content-Type: ";
+        out += res->hostContentType().c_str();
+        out += "\r\n";
+    }
+    if (res->hostChunked()) {
+        out += "Transfer-Encoding: chunked\r\n";
+    } else {
+        snprintf(line, sizeof(line), "Content-Length: %zu\r\n", res->hostBody().size());
+        out += line;
+    }
+    bool has_connection = false;
+    for (const AsyncWebHeader& h : res->hostHeaders()) {
+        if (strcasecmp(h.name().c_str(), "Connection") == 0) has_connection = true;
+        out += h.name().c_str();
+        out += ": ";
+        out += h.value().c_str();
+        out += "\r\n";
+    }
+    if (!has_connection) out += "Connection: close\r\n";
+    out += "\r\n";
+
+    if (c->request->request_method == HTTP_HEAD) {
+        c->done = true;
+    } else if (res->hostChunked()) {
+        c->chunk_waiting = true;
+        fillChunk(c);
+    } else {
+        out += res->hostBody();
+        c->done = true;
+    }
+}
+
+void HostHttpServer::fillChunk(HostHttpConnection* c) {
+    if (c->out_pos < c->out.size()) return;
+    c->out.clear();
+    c->out_pos = 0;
+
+    uint8_t buffer[HOST_HTTP_SEGMENT];
+    size_t len = c->response->hostFill(buffer, sizeof(buffer), c->chunk_index);
+    if (len == RESPONSE_TRY_AGAIN) return;
+    if (len == 0) {
+        c->out = "0\r\n\r\n";
+        c->chunk_waiting = false;
+        c->done = true;
+        return;
+    }
+    char size_line[24];
+    snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    c->out = size_line;
+    c->out.append((const char*)buffer, len);
+    c->out += "\r\n";
+    c->chunk_index += len;
+}
+
+// Sends what is pending; false once the response is complete or the client is gone
+bool HostHttpServer::transmit(HostHttpConnection* c) {
+    for (;;) {
+        while (c->out_pos < c->out.size()) {
+            ssize_t n = send(c->fd, c->out.data() + c->out_pos, c->out.size() - c->out_pos, MSG_NOSIGNAL);
+            if (n > 0) {
+                c->out_pos += n;
+                if (tcp_write_hook != nullptr) tcp_write_hook(c, n);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return true;
+            } else if (n < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+        if (!c->chunk_waiting) return !c->done;
+        fillChunk(c);
+        if (c->out.empty()) return true;   // filler had nothing yet
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hardware RNG on the device; the host draws from the same engine as random()
+uint32_t esp_random();
+void esp_fill_random(void* buf, size_t len);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Same contract as the ROM routine: zlib CRC-32, chainable through crc
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+#include "host_hal.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)hostMicros(); }
@@ -0,0 +1,200 @@
+#include <Update.h>
+#include <WiFi.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+#include "host_hal.h"
+
+#define HOST_FLASH_SECTOR 4096
+
+struct HostPartition {
+    esp_partition_t info;
+    std::vector<uint8_t> data;
+};
+
+static std::vector<std::unique_ptr<HostPartition>> partitions;
+
+static HostPartition* findPartition(const esp_partition_t* partition) {
+    for (auto& p : partitions) {
+        if (&p->info == partition) return p.get();
+    }
+    return nullptr;
+}
+
+static HostPartition* findPartition(const char* label) {
+    for (auto& p : partitions) {
+        if (strcmp(p->info.label, label) == 0) return p.get();
+    }
+    return nullptr;
+}
+
+const esp_partition_t* hostAddPartition(const char* label, esp_partition_type_t type,
+                                        uint8_t subtype, uint32_t size) {
+    std::unique_ptr<HostPartition> p(new HostPartition());
+    memset(&p->info, 0, sizeof(p->info));
+    p->info.type = type;
+    p->info.subtype = (esp_partition_subtype_t)subtype;
+    p->info.size = size;
+    p->info.erase_size = HOST_FLASH_SECTOR;
+    strncpy(p->info.label, label, sizeof(p->info.label) - 1);
+    p->data.assign(size, 0xFF);
+    partitions.push_back(std::move(p));
+    return &partitions.back()->info;
+}
+
+bool hostLoadPartition(const char* label, const char* path) {
+    HostPartition* p = findPartition(label);
+    FILE* f = p ? fopen(path, "rb") : nullptr;
+    if (f == nullptr) return false;
+    size_t n = fread(p->data.data(), 1, p->data.size(), f);
+    fclose(f);
+    memset(p->data.data() + n, 0xFF, p->data.size() - n);
+    return true;
+}
+
+bool hostSavePartition(const char* label, const char* path) {
+    HostPartition* p = findPartition(label);
+    FILE* f = p ? fopen(path, "wb") : nullptr;
+    if (f == nullptr) return false;
+    bool ok = fwrite(p->data.data(), 1, p->data.size(), f) == p->data.size();
+    fclose(f);
+    return ok;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char* label) {
+    for (auto& p : partitions) {
+        if (p->info.type != type) continue;
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY && p->info.subtype != subtype) continue;
+        if (label != nullptr && strcmp(p->info.label, label) != 0) continue;
+        return &p->info;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    HostPartition* p = findPartition(partition);
+    if (p == nullptr || dst == nullptr) return ESP_ERR_INVALID_ARG;
+    if (src_offset > p->data.size() || size > p->data.size() - src_offset) return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, p->data.data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    HostPartition* p = findPartition(partition);
+    if (p == nullptr || src == nullptr) return ESP_ERR_INVALID_ARG;
+    if (dst_offset > p->data.size() || size > p->data.size() - dst_offset) return ESP_ERR_INVALID_SIZE;
+    // NOR flash: programming can only clear bits
+    const uint8_t* bytes = (const uint8_t*)src;
+    for (size_t i = 0; i < size; i++) {
+        p->data[dst_offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    HostPartition* p = findPartition(partition);
+    if (p == nullptr) return ESP_ERR_INVALID_ARG;
+    if (offset % HOST_FLASH_SECTOR != 0 || size % HOST_FLASH_SECTOR != 0) return ESP_ERR_INVALID_ARG;
+    if (offset > p->data.size() || size > p->data.size() - offset) return ESP_ERR_INVALID_SIZE;
+    memset(p->data.data() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// WiFi
+
+WiFiClass WiFi;
+
+String IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(text);
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+    // Espressif OUI, fixed device part
+    static const uint8_t host_mac[6] = {0x40, 0x4C, 0xCA, 0x51, 0x4D, 0x01};
+    memcpy(mac, host_mac, sizeof(host_mac));
+    return mac;
+}
+
+// Update
+
+#define HOST_UPDATE_MAGIC 0xE9   // first byte of an ESP image header
+
+UpdateClass Update;
+
+bool UpdateClass::begin(size_t size) {
+    if (running) {
+        error = UPDATE_ERROR_BAD_ARGUMENT;
+        return false;
+    }
+    if (size != UPDATE_SIZE_UNKNOWN && size > ESP.getFreeSketchSpace()) {
+        error = UPDATE_ERROR_SPACE;
+        return false;
+    }
+    image.clear();
+    expected_size = size;
+    error = UPDATE_ERROR_OK;
+    running = true;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+    if (!running || hasError()) return 0;
+    if (image.empty() && len > 0 && data[0] != HOST_UPDATE_MAGIC) {
+        error = UPDATE_ERROR_MAGIC_BYTE;
+        running = false;
+        return 0;
+    }
+    if (image.size() + len > ESP.getFreeSketchSpace()) {
+        error = UPDATE_ERROR_SPACE;
+        running = false;
+        return 0;
+    }
+    image.append((const char*)data, len);
+    return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+    if (!running) return false;
+    running = false;
+    if (expected_size != UPDATE_SIZE_UNKNOWN && image.size() != expected_size && !evenIfRemaining) {
+        error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    return !hasError();
+}
+
+void UpdateClass::abort() {
+    running = false;
+    error = UPDATE_ERROR_ABORT;
+}
+
+const char* UpdateClass::errorString() {
+    switch (error) {
+        case UPDATE_ERROR_OK: return "No Error";
+        case UPDATE_ERROR_WRITE: return "Flash Write Failed";
+        case UPDATE_ERROR_SPACE: return "Not Enough Space";
+        case UPDATE_ERROR_SIZE: return "Bad Size Given";
+        case UPDATE_ERROR_ABORT: return "Update Aborted";
+        case UPDATE_ERROR_BAD_ARGUMENT: return "Bad Argument";
+        case UPDATE_ERROR_MAGIC_BYTE: return "Wrong Magic Byte";
+        default: return "Unknown Error";
+    }
+}
@@ -0,0 +1,277 @@
+#include <Arduino.h>
+#include <esp_random.h>
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <thread>
+#include "host_hal.h"
+
+#define HOST_PIN_COUNT 64
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static std::atomic<uint64_t> clock_us(0);
+static std::atomic<bool> real_time(false);
+static std::chrono::steady_clock::time_point real_time_start;
+static std::mt19937 random_engine(std::random_device{}());   // hardware RNG on the device
+static std::deque<uint8_t> queued_random;
+static HostRestartHook restart_hook = nullptr;
+static uint32_t free_heap = 256 * 1024;
+static uint32_t max_alloc_heap = 110 * 1024;
+static uint8_t pin_levels[HOST_PIN_COUNT];
+static uint8_t pin_modes[HOST_PIN_COUNT];
+static HostPinHook pin_hook = nullptr;
+static void* pin_hook_arg = nullptr;
+
+// Clock
+
+static uint64_t realMicros() {
+    auto elapsed = std::chrono::steady_clock::now() - real_time_start;
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void hostSetMicros(uint64_t us) { clock_us = us; }
+void hostAdvanceMicros(uint64_t us) { if (!real_time) clock_us += us; }
+uint64_t hostMicros() { return real_time ? realMicros() : clock_us.load(); }
+
+void hostSetRealTime(bool enabled) {
+    real_time_start = std::chrono::steady_clock::now() - std::chrono::microseconds(clock_us.load());
+    real_time = enabled;
+}
+
+uint32_t millis() { return (uint32_t)(hostMicros() / 1000); }
+uint32_t micros() { return (uint32_t)hostMicros(); }
+
+void delay(uint32_t ms) {
+    if (real_time) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    } else {
+        clock_us += (uint64_t)ms * 1000;
+    }
+}
+
+void delayMicroseconds(uint32_t us) {
+    if (real_time) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    } else {
+        clock_us += us;
+    }
+}
+
+void yield() {}
+
+// GPIO
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= HOST_PIN_COUNT) return;
+    pin_modes[pin] = mode;
+    if (mode == INPUT_PULLUP) pin_levels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin >= HOST_PIN_COUNT) return;
+    uint8_t level = value ? HIGH : LOW;
+    bool changed = pin_levels[pin] != level;
+    pin_levels[pin] = level;
+    if (changed && pin_hook != nullptr) {
+        pin_hook(pin, level, pin_hook_arg);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= HOST_PIN_COUNT) return LOW;
+    return pin_levels[pin];
+}
+
+void hostSetPinHook(HostPinHook hook, void* arg) {
+    pin_hook = hook;
+    pin_hook_arg = arg;
+}
+
+uint8_t hostPinLevel(uint8_t pin) { return pin < HOST_PIN_COUNT ? pin_levels[pin] : LOW; }
+
+void hostSetPinLevel(uint8_t pin, uint8_t level) {
+    if (pin < HOST_PIN_COUNT) pin_levels[pin] = level ? HIGH : LOW;
+}
+
+// Random
+
+long random(long max) { return max > 0 ? random(0, max) : 0; }
+
+long random(long min, long max) {
+    if (max <= min) return min;
+    return std::uniform_int_distribution<long>(min, max - 1)(random_engine);
+}
+
+void randomSeed(unsigned long seed) { random_engine.seed(seed); }
+
+uint32_t esp_random() { return (uint32_t)random_engine(); }
+
+void hostQueueRandom(const void* bytes, size_t len) {
+    queued_random.insert(queued_random.end(), (const uint8_t*)bytes, (const uint8_t*)bytes + len);
+}
+
+void esp_fill_random(void* buf, size_t len) {
+    uint8_t* out = (uint8_t*)buf;
+    for (; len > 0 && !queued_random.empty(); len--) {
+        *out++ = queued_random.front();
+        queued_random.pop_front();
+    }
+    while (len > 0) {
+        uint32_t word = esp_random();
+        size_t n = len < sizeof(word) ? len : sizeof(word);
+        memcpy(out, &word, n);
+        out += n;
+        len -= n;
+    }
+}
+
+// ESP
+
+void hostSetRestartHook(HostRestartHook hook) { restart_hook = hook; }
+
+void EspClass::restart() {
+    Serial.println("[HOST] ESP.restart()");
+    Serial.flush();
+    if (restart_hook != nullptr) restart_hook();
+    exit(0);
+}
+
+void hostSetFreeHeap(uint32_t free_bytes, uint32_t max_alloc_bytes) {
+    free_heap = free_bytes;
+    max_alloc_heap = max_alloc_bytes;
+}
+
+uint32_t EspClass::getFreeHeap() { return free_heap; }
+uint32_t EspClass::getMinFreeHeap() { return free_heap; }
+uint32_t EspClass::getMaxAllocHeap() { return max_alloc_heap; }
+uint32_t EspClass::getFreeSketchSpace() { return 0x140000; }   // app partition size in partitions.csv
+
+// Serial
+
+void hostSetLogOutput(FILE* out) { Serial.setOutput(out); }
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (out) fputc(c, out);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t len) {
+    if (out) fwrite(data, 1, len, out);
+    return len;
+}
+
+// Print
+
+size_t Print::write(const uint8_t* data, size_t len) {
+    size_t n = 0;
+    while (n < len && write(data[n])) n++;
+    return n;
+}
+
+size_t Print::print(long v, int base) {
+    if (base == DEC) return printf("%ld", v);
+    return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) {
+    return printf(base == HEX ? "%lX" : "%lu", v);
+}
+
+size_t Print::print(double v, int digits) { return printf("%.*f", digits, v); }
+
+size_t Print::printf(const char* format, ...) {
+    char small[128];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (n < 0) return 0;
+    if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+
+    std::string large(n + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&large[0], large.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)large.data(), n);
+}
+
+size_t Stream::readBytes(char* buffer, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+        int c = read();
+        if (c < 0) break;
+        buffer[n++] = (char)c;
+    }
+    return n;
+}
+
+// String
+
+String::String(long v, unsigned char base) {
+    if (base == DEC) {
+        value = std::to_string(v);
+    } else {
+        *this = String((unsigned long)v, base);
+    }
+}
+
+String::String(unsigned long v, unsigned char base) {
+    if (base < 2 || base > 36) base = DEC;
+    char buffer[8 * sizeof(v) + 1];
+    char* p = buffer + sizeof(buffer) - 1;
+    *p = '\0';
+    do {
+        uint8_t digit = v % base;
+        *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        v /= base;
+    } while (v != 0);
+    value = p;
+}
+
+String::String(float v, unsigned int decimals) : String((double)v, decimals) {}
+
+String::String(double v, unsigned int decimals) {
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, v);
+    value = buffer;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = value.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const char* s, unsigned int from) const {
+    size_t pos = value.find(s, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+bool String::endsWith(const char* s) const {
+    size_t len = strlen(s);
+    return value.size() >= len && value.compare(value.size() - len, len, s) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > value.size()) return String();
+    if (to > value.size()) to = value.size();
+    if (to < from) std::swap(from, to);
+    return String(value.substr(from, to - from));
+}
+
+void String::trim() {
+    size_t start = value.find_first_not_of(" \t\r\n");
+    size_t end = value.find_last_not_of(" \t\r\n");
+    value = start == std::string::npos ? std::string() : value.substr(start, end - start + 1);
+}
+
+void String::toLowerCase() {
+    for (char& c : value) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+    for (char& c : value) c = toupper((unsigned char)c);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <esp_partition.h>
+
+// Controls for the native build's hardware stand-ins (host/*.h).
+// None of this exists on the device; only harnesses include it.
+
+// Virtual clock behind millis()/micros(). delay() advances it as well.
+void hostSetMicros(uint64_t us);
+void hostAdvanceMicros(uint64_t us);
+uint64_t hostMicros();
+
+// Real time instead: the clock follows the host's monotonic clock from its
+// current value on, delay() sleeps and hostAdvanceMicros() is ignored
+void hostSetRealTime(bool enabled);
+
+// GPIO: the hook sees every digitalWrite() that changes a pin
+typedef void (*HostPinHook)(uint8_t pin, uint8_t level, void* arg);
+void hostSetPinHook(HostPinHook hook, void* arg);
+uint8_t hostPinLevel(uint8_t pin);
+void hostSetPinLevel(uint8_t pin, uint8_t level);
+
+// Serial output goes to stdout by default; nullptr silences it
+void hostSetLogOutput(FILE* out);
+
+// esp_fill_random() hands out these bytes first, then goes back to the
+// pseudo-random stream; lets a test choose session tokens
+void hostQueueRandom(const void* bytes, size_t len);
+
+// Called by ESP.restart() before the process exits
+typedef void (*HostRestartHook)();
+void hostSetRestartHook(HostRestartHook hook);
+
+// What ESP.getFreeHeap() (and getMinFreeHeap()) and ESP.getMaxAllocHeap()
+// report (default 256 KB and 110 KB)
+void hostSetFreeHeap(uint32_t free_bytes, uint32_t max_alloc_bytes);
+
+// Directory LittleFS is mounted on (default ./littlefs); begin(true) creates it
+void hostSetLittleFsRoot(const char* dir);
+
+// Address AsyncWebServer listens on instead of the port the firmware asks for
+// (default 127.0.0.1 and that port)
+void hostSetHttpListen(const char* addr, uint16_t port);
+
+// Same for AsyncUDP, e.g. to serve the captive portal DNS on an unprivileged port
+void hostSetUdpListen(const char* addr, uint16_t port);
+
+// Stand-ins for the device's linker wraps of the allocator and lwIP's
+// tcp_write: the heap hook sees every operator new and delete with the block
+// size, the write hook every send on an AsyncWebServer connection (identified
+// by its AsyncClient::pcb()). Hooks may run on any thread.
+typedef void (*HostHeapHook)(size_t size, bool freed);
+typedef void (*HostTcpWriteHook)(const void* pcb, size_t len);
+void hostSetHeapHook(HostHeapHook hook);
+void hostSetTcpWriteHook(HostTcpWriteHook hook);
+
+// Partitions for esp_partition_find_first(), initially erased
+const esp_partition_t* hostAddPartition(const char* label, esp_partition_type_t type,
+                                        uint8_t subtype, uint32_t size);
+bool hostLoadPartition(const char* label, const char* path);
+bool hostSavePartition(const char* label, const char* path);
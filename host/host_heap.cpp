@@ -0,0 +1,40 @@
+// Global operator new and delete with a hook, in the place of the device's
+// malloc/free linker wraps (see hostSetHeapHook()).
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include "host_hal.h"
+
+static std::atomic<HostHeapHook> heap_hook(nullptr);
+static thread_local bool in_hook = false;   // the hook may allocate itself
+
+void hostSetHeapHook(HostHeapHook hook) {
+    heap_hook = hook;
+}
+
+static void notify(void* ptr, bool freed) {
+    HostHeapHook hook = heap_hook.load(std::memory_order_relaxed);
+    if (hook == nullptr || in_hook) return;
+    in_hook = true;
+    hook(malloc_usable_size(ptr), freed);
+    in_hook = false;
+}
+
+void* operator new(size_t size) {
+    void* ptr = malloc(size > 0 ? size : 1);
+    if (ptr == nullptr) throw std::bad_alloc();
+    notify(ptr, false);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) return;
+    notify(ptr, true);
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
@@ -0,0 +1,63 @@
+// mbedtls stand-in on OpenSSL's libcrypto: SHA-256 and verifying a DER ECDSA
+// signature of a hash with a PEM public key. Error codes are only zero or not.
+
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+
+#define HOST_MBEDTLS_ERROR (-1)
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) {
+    ctx->md = nullptr;
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx) {
+    EVP_MD_CTX_free((EVP_MD_CTX*)ctx->md);
+    ctx->md = nullptr;
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224) {
+    if (is224) return HOST_MBEDTLS_ERROR;
+    if (ctx->md == nullptr) ctx->md = EVP_MD_CTX_new();
+    return EVP_DigestInit_ex((EVP_MD_CTX*)ctx->md, EVP_sha256(), nullptr) == 1 ? 0 : HOST_MBEDTLS_ERROR;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len) {
+    return EVP_DigestUpdate((EVP_MD_CTX*)ctx->md, input, len) == 1 ? 0 : HOST_MBEDTLS_ERROR;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+    unsigned int len = 0;
+    return EVP_DigestFinal_ex((EVP_MD_CTX*)ctx->md, output, &len) == 1 && len == 32 ? 0 : HOST_MBEDTLS_ERROR;
+}
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx) {
+    ctx->key = nullptr;
+}
+
+void mbedtls_pk_free(mbedtls_pk_context* ctx) {
+    EVP_PKEY_free((EVP_PKEY*)ctx->key);
+    ctx->key = nullptr;
+}
+
+int mbedtls_pk_parse_public_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen) {
+    if (keylen == 0) return HOST_MBEDTLS_ERROR;
+    BIO* bio = BIO_new_mem_buf(key, (int)(keylen - 1));
+    if (bio == nullptr) return HOST_MBEDTLS_ERROR;
+    ctx->key = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    return ctx->key != nullptr ? 0 : HOST_MBEDTLS_ERROR;
+}
+
+int mbedtls_pk_verify(mbedtls_pk_context* ctx, mbedtls_md_type_t md_alg, const unsigned char* hash, size_t hash_len,
+                      const unsigned char* sig, size_t sig_len) {
+    if (ctx->key == nullptr || md_alg != MBEDTLS_MD_SHA256) return HOST_MBEDTLS_ERROR;
+    EVP_PKEY_CTX* verify = EVP_PKEY_CTX_new((EVP_PKEY*)ctx->key, nullptr);
+    if (verify == nullptr) return HOST_MBEDTLS_ERROR;
+    int ok = EVP_PKEY_verify_init(verify) == 1 &&
+             EVP_PKEY_CTX_set_signature_md(verify, EVP_sha256()) == 1 &&
+             EVP_PKEY_verify(verify, sig, sig_len, hash, hash_len) == 1;
+    EVP_PKEY_CTX_free(verify);
+    return ok ? 0 : HOST_MBEDTLS_ERROR;
+}
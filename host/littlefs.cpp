@@ -0,0 +1,210 @@
+#include <LittleFS.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "host_hal.h"
+
+struct HostFileHandle {
+    int fd = -1;
+    DIR* dir = nullptr;
+    std::string path;       // as the firmware sees it, e.g. /history/00000001.seg
+    std::string name;       // last path component
+    std::string host_path;
+
+    ~HostFileHandle() {
+        if (fd >= 0) ::close(fd);
+        if (dir != nullptr) closedir(dir);
+    }
+};
+
+LittleFSFS LittleFS;
+
+void hostSetLittleFsRoot(const char* dir) { LittleFS.hostSetRoot(dir); }
+
+static std::string baseName(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static bool removeTree(const std::string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) return ::unlink(path.c_str()) == 0;
+    bool ok = true;
+    while (struct dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        ok &= removeTree(path + "/" + entry->d_name);
+    }
+    closedir(dir);
+    return ok && ::rmdir(path.c_str()) == 0;
+}
+
+// File
+
+File::operator bool() const { return handle && (handle->fd >= 0 || handle->dir != nullptr); }
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t* data, size_t len) {
+    if (!handle || handle->fd < 0) return 0;
+    ssize_t n = ::write(handle->fd, data, len);
+    return n > 0 ? (size_t)n : 0;
+}
+
+int File::available() {
+    if (!handle || handle->fd < 0) return 0;
+    return (int)(size() - position());
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!handle || handle->fd < 0) return -1;
+    uint8_t c;
+    if (::pread(handle->fd, &c, 1, lseek(handle->fd, 0, SEEK_CUR)) != 1) return -1;
+    return c;
+}
+
+size_t File::read(uint8_t* buffer, size_t len) {
+    if (!handle || handle->fd < 0) return 0;
+    ssize_t n = ::read(handle->fd, buffer, len);
+    return n > 0 ? (size_t)n : 0;
+}
+
+bool File::seek(uint32_t pos) {
+    if (!handle || handle->fd < 0) return false;
+    return lseek(handle->fd, pos, SEEK_SET) == (off_t)pos;
+}
+
+size_t File::position() const {
+    if (!handle || handle->fd < 0) return 0;
+    off_t pos = lseek(handle->fd, 0, SEEK_CUR);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!handle || handle->fd < 0) return 0;
+    struct stat st;
+    return fstat(handle->fd, &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::flush() {
+    if (handle && handle->fd >= 0) fdatasync(handle->fd);
+}
+
+void File::close() { handle.reset(); }
+
+const char* File::name() const { return handle ? handle->name.c_str() : ""; }
+const char* File::path() const { return handle ? handle->path.c_str() : ""; }
+bool File::isDirectory() const { return handle && handle->dir != nullptr; }
+
+File File::openNextFile(const char* mode) {
+    if (!handle || handle->dir == nullptr) return File();
+    while (struct dirent* entry = readdir(handle->dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        std::string path = handle->path == "/" ? "/" + std::string(entry->d_name)
+                                               : handle->path + "/" + entry->d_name;
+        return LittleFS.open(path.c_str(), mode);
+    }
+    return File();
+}
+
+void File::rewindDirectory() {
+    if (handle && handle->dir != nullptr) rewinddir(handle->dir);
+}
+
+// LittleFSFS
+
+LittleFSFS::LittleFSFS() : root("littlefs"), mounted(false) {}
+
+std::string LittleFSFS::hostPath(const char* path) const {
+    std::string p = path ? path : "";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return root + p;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    struct stat st;
+    if (stat(root.c_str(), &st) != 0) {
+        if (!formatOnFail || ::mkdir(root.c_str(), 0755) != 0) return false;
+    } else if (!S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    mounted = true;
+    return true;
+}
+
+bool LittleFSFS::format() {
+    removeTree(root);
+    return ::mkdir(root.c_str(), 0755) == 0;
+}
+
+size_t LittleFSFS::usedBytes() {
+    // Block granular, like LittleFS reports it
+    size_t used = 0;
+    std::vector<std::string> pending(1, root);
+    while (!pending.empty()) {
+        std::string dir_path = pending.back();
+        pending.pop_back();
+        used += HOST_LITTLEFS_BLOCK;
+        DIR* dir = opendir(dir_path.c_str());
+        if (dir == nullptr) continue;
+        while (struct dirent* entry = readdir(dir)) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            std::string path = dir_path + "/" + entry->d_name;
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0) continue;
+            if (S_ISDIR(st.st_mode)) {
+                pending.push_back(path);
+            } else {
+                used += (st.st_size + HOST_LITTLEFS_BLOCK - 1) / HOST_LITTLEFS_BLOCK * HOST_LITTLEFS_BLOCK;
+            }
+        }
+        closedir(dir);
+    }
+    return used;
+}
+
+File LittleFSFS::open(const char* path, const char* mode, bool create) {
+    if (!mounted || path == nullptr) return File();
+    std::shared_ptr<HostFileHandle> h = std::make_shared<HostFileHandle>();
+    h->path = path;
+    h->name = baseName(h->path);
+    h->host_path = hostPath(path);
+
+    struct stat st;
+    if (stat(h->host_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        h->dir = opendir(h->host_path.c_str());
+        return h->dir ? File(h) : File();
+    }
+
+    int flags = O_RDONLY;
+    bool plus = strchr(mode, '+') != nullptr;
+    switch (mode[0]) {
+        case 'w': flags = (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC; break;
+        case 'a': flags = (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND; break;
+        default: flags = plus ? O_RDWR : O_RDONLY; break;
+    }
+    h->fd = ::open(h->host_path.c_str(), flags | O_CLOEXEC, 0644);
+    return h->fd >= 0 ? File(h) : File();
+}
+
+bool LittleFSFS::exists(const char* path) {
+    struct stat st;
+    return mounted && stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) { return mounted && ::unlink(hostPath(path).c_str()) == 0; }
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    return mounted && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool LittleFSFS::mkdir(const char* path) { return mounted && ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+
+bool LittleFSFS::rmdir(const char* path) { return mounted && ::rmdir(hostPath(path).c_str()) == 0; }
@@ -0,0 +1,56 @@
+#include "raw_log.h"
+#include <stdio.h>
+#include <algorithm>
+#include "raw_recorder.h"
+
+bool loadRawLog(const char* path, std::map<uint16_t, RawLogSession>& sessions) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    std::vector<RawPage> pages;
+    RawPage page;
+    uint32_t bad = 0;
+    while (fread(&page, 1, RAW_PAGE_BYTES, f) == RAW_PAGE_BYTES) {
+        if (page.header.magic != RAW_PAGE_MAGIC) continue;
+        if (page.header.crc != RawRecorder::pageCrc(page)) {
+            bad++;
+            continue;
+        }
+        pages.push_back(page);
+    }
+    fclose(f);
+    if (bad > 0) fprintf(stderr, "warning: %u pages with a bad CRC skipped\n", bad);
+
+    std::sort(pages.begin(), pages.end(), [](const RawPage& a, const RawPage& b) {
+        return a.header.page_seq < b.header.page_seq;
+    });
+
+    for (const RawPage& p : pages) {
+        RawLogSession& session = sessions[p.header.session];
+        if (p.header.type == RAW_PAGE_SESSION) {
+            if (p.session.format_version < 1 || p.session.format_version > RAW_FORMAT_VERSION) {
+                fprintf(stderr, "unsupported raw format version %u\n", p.session.format_version);
+                return false;
+            }
+            session.info = p.session;
+            session.has_info = true;
+        } else if (p.header.type == RAW_PAGE_SAMPLES) {
+            uint8_t count = min((uint8_t)p.header.count, (uint8_t)RAW_SAMPLES_PER_PAGE);
+            for (uint8_t i = 0; i < count; i++) {
+                RawLogSample sample;
+                sample.raw = p.samples[i];
+                // Unwrap the 32 bit clock
+                uint64_t base = session.samples.empty() ? 0 : session.samples.back().time_us & ~0xFFFFFFFFULL;
+                sample.time_us = base | sample.raw.time_us;
+                if (!session.samples.empty() && sample.time_us < session.samples.back().time_us) {
+                    sample.time_us += 1ULL << 32;
+                }
+                session.samples.push_back(sample);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "raw_format.h"
+
+// Reader for raw logs downloaded from /api/raw-log, shared by the host tools
+
+struct RawLogSample {
+    uint64_t time_us;     // unwrapped sample clock
+    RawSample raw;
+};
+
+struct RawLogSession {
+    bool has_info = false;
+    RawSessionInfo info;
+    std::vector<RawLogSample> samples;
+};
+
+// Reads every valid page of the log at path into sessions, keyed by session id.
+// Returns false (with a message on stderr) if the file cannot be read or uses a
+// newer format.
+bool loadRawLog(const char* path, std::map<uint16_t, RawLogSession>& sessions);
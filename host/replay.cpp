@@ -0,0 +1,151 @@
+// Replays a raw sample log (downloaded from /api/raw-log) through the
+// firmware's SensorManager on the host and compares the output states with the
+// ones the device recorded for every sample.
+//
+// Build and run with PlatformIO:
+//   pio run -e native && .pio/build/native/program rawlog.bin [--session N]
+//       [--csv out.csv] [--verbose]
+//
+// Exit code 0 when every sample matches, 1 on a mismatch, 2 on a bad log.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "host_hal.h"
+#include "raw_log.h"
+#include "sensor_manager.h"
+#include "sys_init.h"
+
+#define REPLAY_LOOP_MS 50   // main loop period, used to step through gaps in the log
+
+int main(int argc, char** argv) {
+    const char* log_path = nullptr;
+    const char* csv_path = nullptr;
+    int session_id = -1;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--session") == 0 && i + 1 < argc) {
+            session_id = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (argv[i][0] != '-' && log_path == nullptr) {
+            log_path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s rawlog.bin [--session N] [--csv out.csv] [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (log_path == nullptr) {
+        fprintf(stderr, "usage: %s rawlog.bin [--session N] [--csv out.csv] [--verbose]\n", argv[0]);
+        return 2;
+    }
+
+    std::map<uint16_t, RawLogSession> sessions;
+    if (!loadRawLog(log_path, sessions)) return 2;
+
+    // Default to the newest session that has samples
+    if (session_id < 0) {
+        for (auto& entry : sessions) {
+            if (!entry.second.samples.empty()) session_id = entry.first;
+        }
+    }
+    auto found = sessions.find((uint16_t)session_id);
+    if (session_id < 0 || found == sessions.end() || found->second.samples.empty()) {
+        fprintf(stderr, "no samples for session %d\n", session_id);
+        return 2;
+    }
+    RawLogSession& session = found->second;
+    if (!session.has_info) {
+        fprintf(stderr, "warning: session page overwritten, outputs run with the defaults\n");
+    }
+
+    hostSetLogOutput(verbose ? stdout : nullptr);
+    hostSetMicros(session.samples.front().time_us - REPLAY_LOOP_MS * 1000);
+
+    Adafruit_VL53L1X sensor;
+    Adafruit_NeoPixel pixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
+    SensorManager manager(&sensor, &pixel, PIN_OUT_1, PIN_OUT_2);
+
+    if (session.has_info) {
+        const RawSessionInfo& info = session.info;
+        manager.setOutput1Config(info.output1_min, info.output1_max, info.output1_hysteresis, info.output1_active_in_range);
+        manager.setOutput2Config(info.output2_min, info.output2_max, info.output2_hysteresis, info.output2_active_in_range);
+        manager.enableOutput1(info.output1_enabled);
+        manager.enableOutput2(info.output2_enabled);
+    }
+    if (!manager.initialize()) {
+        fprintf(stderr, "sensor manager failed to initialize\n");
+        return 2;
+    }
+    if (session.has_info) {
+        sensor.setTimingBudget(session.info.timing_budget_ms);
+        if (session.info.format_version >= 2) {
+            manager.restoreState(session.info.state);
+        } else {
+            fprintf(stderr, "warning: format version 1 has no filter state, the first samples may differ\n");
+        }
+    }
+
+    FILE* csv = nullptr;
+    if (csv_path != nullptr) {
+        csv = fopen(csv_path, "w");
+        if (csv == nullptr) {
+            fprintf(stderr, "cannot write %s\n", csv_path);
+            return 2;
+        }
+        fprintf(csv, "time_us,distance,range_status,filtered,output1,output2,recorded_output1,recorded_output2\n");
+    }
+
+    uint32_t mismatches = 0;
+    uint32_t transitions = 0;
+    uint8_t last_flags = 0;
+    uint64_t loop_time_us = hostMicros();
+
+    for (size_t i = 0; i < session.samples.size(); i++) {
+        const RawLogSample& sample = session.samples[i];
+
+        // The device polls every loop; step through long gaps so timeouts fire as they did there
+        while (sample.time_us - loop_time_us > (uint64_t)SENSOR_TIMEOUT_MS * 1000) {
+            loop_time_us += REPLAY_LOOP_MS * 1000;
+            hostSetMicros(loop_time_us);
+            manager.update();
+        }
+
+        HostSensorSample queued = {sample.time_us, sample.raw.distance, sample.raw.range_status,
+                                   sample.raw.signal_rate, sample.raw.ambient_rate};
+        sensor.hostQueue(queued);
+        hostSetMicros(sample.time_us);
+        loop_time_us = sample.time_us;
+        manager.update();
+
+        uint8_t flags = (manager.getOutput1Config().current_state ? RAW_SAMPLE_FLAG_OUTPUT1 : 0) |
+                        (manager.getOutput2Config().current_state ? RAW_SAMPLE_FLAG_OUTPUT2 : 0);
+        uint8_t recorded = sample.raw.flags & (RAW_SAMPLE_FLAG_OUTPUT1 | RAW_SAMPLE_FLAG_OUTPUT2);
+        if (i > 0 && flags != last_flags) transitions++;
+        last_flags = flags;
+
+        if (flags != recorded) {
+            if (mismatches < 10) {
+                fprintf(stderr, "mismatch at sample %zu (t=%.3f s, distance %d): replay %u%u, device %u%u\n",
+                        i, (sample.time_us - session.samples.front().time_us) / 1e6, sample.raw.distance,
+                        flags & RAW_SAMPLE_FLAG_OUTPUT1 ? 1 : 0, flags & RAW_SAMPLE_FLAG_OUTPUT2 ? 1 : 0,
+                        recorded & RAW_SAMPLE_FLAG_OUTPUT1 ? 1 : 0, recorded & RAW_SAMPLE_FLAG_OUTPUT2 ? 1 : 0);
+            }
+            mismatches++;
+        }
+
+        if (csv != nullptr) {
+            fprintf(csv, "%llu,%d,%u,%d,%d,%d,%d,%d\n", (unsigned long long)sample.time_us,
+                    sample.raw.distance, sample.raw.range_status, manager.getDistance(),
+                    flags & RAW_SAMPLE_FLAG_OUTPUT1 ? 1 : 0, flags & RAW_SAMPLE_FLAG_OUTPUT2 ? 1 : 0,
+                    recorded & RAW_SAMPLE_FLAG_OUTPUT1 ? 1 : 0, recorded & RAW_SAMPLE_FLAG_OUTPUT2 ? 1 : 0);
+        }
+    }
+    if (csv != nullptr) fclose(csv);
+
+    printf("session %d: %zu samples, %u output transitions, %u mismatches\n",
+           session_id, session.samples.size(), transitions, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include "scenario.h"
+#include <Arduino.h>
+#include <math.h>
+#include <random>
+#include "host_hal.h"
+#include "sensor_manager.h"
+#include "sys_init.h"
+
+static float trueDistance(const ScenarioParams& p, uint32_t t) {
+    switch (p.kind) {
+        case SCENARIO_STEP:
+            return (t >= p.event_ms && t < p.event_ms + p.hold_ms) ? p.near_mm : p.far_mm;
+        case SCENARIO_RAMP: {
+            uint32_t approach_end = p.event_ms + p.ramp_ms;
+            uint32_t leave_start = approach_end + p.hold_ms;
+            if (t < p.event_ms || t >= leave_start + p.ramp_ms) return p.far_mm;
+            if (t >= approach_end && t < leave_start) return p.near_mm;
+            float progress = t < approach_end ? (float)(t - p.event_ms) / p.ramp_ms
+                                              : 1.0f - (float)(t - leave_start) / p.ramp_ms;
+            return p.far_mm + (p.near_mm - p.far_mm) * progress;
+        }
+        case SCENARIO_VIBRATION:
+            if (t < p.event_ms || t >= p.event_ms + p.hold_ms) return p.far_mm;
+            return p.near_mm + p.vibration_mm * sinf(2.0f * (float)PI * p.vibration_hz * t / 1000.0f);
+        case SCENARIO_STEADY:
+        default:
+            return p.near_mm;
+    }
+}
+
+void generateScenario(const ScenarioParams& params, uint32_t seed, uint16_t sample_ms,
+                      std::vector<ScenarioSample>& samples) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, params.noise_sigma_mm > 0 ? params.noise_sigma_mm : 1e-6f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    samples.clear();
+    for (uint32_t t = 0; t < params.duration_ms; t += sample_ms) {
+        ScenarioSample sample;
+        float truth = trueDistance(params, t);
+        sample.time_ms = t;
+        sample.truth = (int16_t)lroundf(truth);
+        sample.range_status = 0;
+
+        float measured = truth + noise(rng);
+        if (params.impulse_rate > 0 && uniform(rng) < params.impulse_rate) {
+            measured += uniform(rng) < 0.5f ? params.impulse_mm : -params.impulse_mm;
+        }
+        sample.distance = (int16_t)max(1L, lroundf(measured));
+
+        if (params.dropout_rate > 0 && uniform(rng) < params.dropout_rate) {
+            sample.distance = -1;
+            sample.range_status = params.dropout_status;
+        }
+        samples.push_back(sample);
+    }
+}
+
+void runScenario(const std::vector<ScenarioSample>& samples, const ScenarioOutput& output,
+                 std::vector<uint8_t>& states) {
+    const uint64_t start_us = 1000000;
+    hostSetMicros(start_us);
+
+    Adafruit_VL53L1X sensor;
+    Adafruit_NeoPixel pixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
+    SensorManager manager(&sensor, &pixel, PIN_OUT_1, PIN_OUT_2);
+    manager.setOutput1Config(output.range_min, output.range_max, output.hysteresis, output.active_in_range);
+    manager.enableOutput1(true);
+    manager.initialize();
+
+    states.clear();
+    for (const ScenarioSample& sample : samples) {
+        uint64_t now = start_us + (uint64_t)sample.time_ms * 1000;
+        HostSensorSample queued = {now, sample.distance, sample.range_status, 0, 0};
+        sensor.hostQueue(queued);
+        hostSetMicros(now);
+        manager.update();
+        states.push_back(manager.getOutput1Config().current_state);
+    }
+}
+
+struct Episode {
+    uint32_t start_ms;
+    uint32_t end_ms;     // first sample time after the episode
+};
+
+static void findEpisodes(const std::vector<ScenarioSample>& samples, const std::vector<uint8_t>& active,
+                         std::vector<Episode>& episodes) {
+    episodes.clear();
+    uint32_t sample_ms = samples.size() > 1 ? samples[1].time_ms - samples[0].time_ms : 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (!active[i]) continue;
+        if (i == 0 || !active[i - 1]) {
+            episodes.push_back({samples[i].time_ms, samples[i].time_ms + sample_ms});
+        }
+        episodes.back().end_ms = samples[i].time_ms + sample_ms;
+    }
+}
+
+void scoreScenario(const std::vector<ScenarioSample>& samples, const ScenarioOutput& output,
+                   const std::vector<uint8_t>& states, uint32_t grace_ms, ScenarioScore& score) {
+    // What the output should do on the true distance: no noise, so no hysteresis needed
+    std::vector<uint8_t> expected;
+    for (const ScenarioSample& sample : samples) {
+        bool in_range = sample.truth >= output.range_min && sample.truth <= output.range_max;
+        expected.push_back(output.active_in_range ? in_range : !in_range);
+    }
+
+    std::vector<Episode> wanted, actual;
+    findEpisodes(samples, expected, wanted);
+    findEpisodes(samples, states, actual);
+    std::vector<bool> matched(actual.size(), false);
+
+    for (const Episode& w : wanted) {
+        score.expected_episodes++;
+        bool asserted = false;
+        const Episode* last = nullptr;
+        for (size_t a = 0; a < actual.size(); a++) {
+            if (actual[a].end_ms <= w.start_ms || actual[a].start_ms >= w.end_ms + grace_ms) continue;
+            matched[a] = true;
+            if (!asserted) {
+                score.assert_ms.push_back(actual[a].start_ms > w.start_ms ? actual[a].start_ms - w.start_ms : 0);
+                asserted = true;
+            } else {
+                score.glitches++;   // released and re-asserted within one episode
+            }
+            last = &actual[a];
+        }
+        if (!asserted) {
+            score.missed++;
+        } else if (last->end_ms + grace_ms < w.end_ms) {
+            score.glitches++;       // dropped out well before the object left
+        } else {
+            score.release_ms.push_back(last->end_ms > w.end_ms ? last->end_ms - w.end_ms : 0);
+        }
+    }
+
+    for (size_t a = 0; a < actual.size(); a++) {
+        if (!matched[a]) score.false_triggers++;
+    }
+}
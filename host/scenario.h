@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Parametrised distance traces for scoring the filter and trigger logic on the
+// host. Every sample carries the true distance next to what the sensor reports,
+// so the output states the firmware produces can be compared with the states
+// the true distance calls for.
+
+enum ScenarioKind {
+    SCENARIO_STEP,        // object appears at near_mm for hold_ms, then leaves (a short hold is a hand wave)
+    SCENARIO_RAMP,        // object approaches from far_mm to near_mm over ramp_ms and back
+    SCENARIO_VIBRATION,   // like a step, vibrating by vibration_mm at vibration_hz while present
+    SCENARIO_STEADY,      // object held at near_mm for the whole run (noise only)
+};
+
+struct ScenarioParams {
+    const char* name;
+    ScenarioKind kind;
+    uint32_t duration_ms;
+    int16_t far_mm;           // background distance
+    int16_t near_mm;          // object distance
+    uint32_t event_ms;        // when the object arrives
+    uint32_t hold_ms;         // how long it stays
+    uint32_t ramp_ms;
+    float vibration_mm;
+    float vibration_hz;
+    float noise_sigma_mm;     // Gaussian measurement noise
+    float impulse_rate;       // probability of an impulse per sample
+    int16_t impulse_mm;       // impulse offset (sign picked at random)
+    float dropout_rate;       // probability of a dropout per sample
+    uint8_t dropout_status;   // range status reported for a dropout (2 signal fail, 4 out of bounds)
+};
+
+struct ScenarioSample {
+    uint32_t time_ms;
+    int16_t truth;            // true distance
+    int16_t distance;         // as reported by distance(), -1 on a dropout
+    uint8_t range_status;
+};
+
+struct ScenarioOutput {
+    const char* name;
+    uint16_t range_min;
+    uint16_t range_max;
+    uint16_t hysteresis;
+    bool active_in_range;
+};
+
+// Per run scores; latencies in ms from the true edge to the output edge
+struct ScenarioScore {
+    uint32_t expected_episodes;    // times the true distance called for the output
+    uint32_t missed;               // of those, never asserted
+    uint32_t false_triggers;       // asserted without the true distance calling for it
+    uint32_t glitches;             // released while it should have stayed on
+    std::vector<uint32_t> assert_ms;
+    std::vector<uint32_t> release_ms;
+};
+
+void generateScenario(const ScenarioParams& params, uint32_t seed, uint16_t sample_ms,
+                      std::vector<ScenarioSample>& samples);
+
+// Runs the trace through a fresh SensorManager with output 1 configured as
+// given and returns its state after every sample
+void runScenario(const std::vector<ScenarioSample>& samples, const ScenarioOutput& output,
+                 std::vector<uint8_t>& states);
+
+// Compares states with the state the true distance calls for. An output edge
+// within grace_ms after the true edge counts as a late edge, not a miss.
+void scoreScenario(const std::vector<ScenarioSample>& samples, const ScenarioOutput& output,
+                   const std::vector<uint8_t>& states, uint32_t grace_ms, ScenarioScore& score);
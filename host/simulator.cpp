@@ -0,0 +1,218 @@
+// Linux simulator of the whole device: setup() and loop() from main.cpp with
+// ConfigManager, SensorManager, the raw recorder and WebServerManager, serving
+// the real HTTP API on localhost. LittleFS is a directory, the rawlog partition
+// a file, and the sensor is fed from a generated scenario or a raw log
+// downloaded from /api/raw-log, looped for as long as the simulator runs.
+//
+//   pio run -e native_sim
+//   .pio/build/native_sim/program [--port 8080] [--bind 127.0.0.1] [--dns-port 5300] [--data sim-data]
+//       [--scenario step|ramp|vibration|steady] [--seed N] [--replay rawlog.bin [--session N]]
+//       [--free-heap BYTES] [--quiet]
+//
+// The clock runs in real time and the web server answers on its own thread like
+// the async_tcp task does. Ctrl-C saves the rawlog partition and exits;
+// ESP.restart() (after an OTA upload, for one) saves it and starts the
+// simulator again with the same arguments, as a reboot would.
+
+#include <Arduino.h>
+#include <Adafruit_VL53L1X.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "host_hal.h"
+#include "http_trace.h"
+#include "raw_log.h"
+#include "raw_recorder.h"
+#include "scenario.h"
+
+#define SIM_DEFAULT_PORT 8080
+#define SIM_DEFAULT_DNS_PORT 5300        // captive portal DNS; port 53 needs root
+#define SIM_DEFAULT_BIND "127.0.0.1"
+#define SIM_DEFAULT_DATA "sim-data"
+#define SIM_RAWLOG_SIZE 0xC0000          // partitions.csv
+#define SIM_SCENARIO_MS 20000            // one pass of a generated scenario
+#define SIM_SAMPLE_MS 50                 // timing budget SensorManager::initialize() sets
+
+void setup();
+void loop();
+extern Adafruit_VL53L1X vl53;
+
+struct SimSample {
+    uint64_t offset_us;                  // from the start of a pass
+    int16_t distance;
+    uint8_t range_status;
+    uint16_t signal_rate;
+    uint16_t ambient_rate;
+};
+
+static volatile sig_atomic_t stop_requested = 0;
+static std::string rawlog_path;
+static char** sim_argv;
+
+static void onSignal(int) {
+    stop_requested = 1;
+}
+
+static void onRestart() {
+    hostSavePartition(RAW_PARTITION_LABEL, rawlog_path.c_str());
+    fflush(stdout);
+    execvp(sim_argv[0], sim_argv);
+    perror("restart");
+}
+
+static bool buildScenario(const char* name, uint32_t seed, uint16_t sample_ms, std::vector<SimSample>& trace) {
+    ScenarioParams p;
+    memset(&p, 0, sizeof(p));
+    p.name = name;
+    p.duration_ms = SIM_SCENARIO_MS;
+    p.far_mm = 1500;
+    p.near_mm = 400;
+    p.noise_sigma_mm = 3.0f;
+    p.event_ms = 5000;
+    p.hold_ms = 8000;
+    if (strcmp(name, "step") == 0) {
+        p.kind = SCENARIO_STEP;
+    } else if (strcmp(name, "ramp") == 0) {
+        p.kind = SCENARIO_RAMP;
+        p.near_mm = 250;
+        p.ramp_ms = 4000;
+        p.hold_ms = 3000;
+    } else if (strcmp(name, "vibration") == 0) {
+        p.kind = SCENARIO_VIBRATION;
+        p.vibration_mm = 40.0f;
+        p.vibration_hz = 8.0f;
+    } else if (strcmp(name, "steady") == 0) {
+        p.kind = SCENARIO_STEADY;
+    } else {
+        return false;
+    }
+
+    std::vector<ScenarioSample> samples;
+    generateScenario(p, seed, sample_ms, samples);
+    for (const ScenarioSample& s : samples) {
+        trace.push_back(SimSample{(uint64_t)s.time_ms * 1000, s.distance, s.range_status, 0, 0});
+    }
+    return true;
+}
+
+static bool buildReplay(const char* path, int session_id, std::vector<SimSample>& trace) {
+    std::map<uint16_t, RawLogSession> sessions;
+    if (!loadRawLog(path, sessions)) return false;
+    if (session_id < 0) {
+        for (auto& entry : sessions) {
+            if (!entry.second.samples.empty()) session_id = entry.first;
+        }
+    }
+    auto found = sessions.find((uint16_t)session_id);
+    if (session_id < 0 || found == sessions.end() || found->second.samples.empty()) {
+        fprintf(stderr, "no samples for session %d\n", session_id);
+        return false;
+    }
+    uint64_t first_us = found->second.samples.front().time_us;
+    for (const RawLogSample& s : found->second.samples) {
+        trace.push_back(SimSample{s.time_us - first_us, s.raw.distance, s.raw.range_status,
+                                  s.raw.signal_rate, s.raw.ambient_rate});
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint16_t port = SIM_DEFAULT_PORT;
+    const char* bind_addr = SIM_DEFAULT_BIND;
+    uint16_t dns_port = SIM_DEFAULT_DNS_PORT;
+    const char* data_dir = SIM_DEFAULT_DATA;
+    const char* scenario = "step";
+    const char* replay_path = nullptr;
+    uint32_t seed = 1;
+    int session_id = -1;
+    bool quiet = false;
+    long free_heap = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            bind_addr = argv[++i];
+        } else if (strcmp(argv[i], "--dns-port") == 0 && i + 1 < argc) {
+            dns_port = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data_dir = argv[++i];
+        } else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            scenario = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--session") == 0 && i + 1 < argc) {
+            session_id = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--free-heap") == 0 && i + 1 < argc) {
+            free_heap = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            fprintf(stderr, "usage: %s [--port N] [--bind ADDR] [--dns-port N] [--data DIR] [--scenario step|ramp|vibration|steady]\n"
+                            "       [--seed N] [--replay rawlog.bin [--session N]] [--free-heap BYTES] [--quiet]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Sensor trace, one sample per timing budget for generated scenarios
+    std::vector<SimSample> trace;
+    if (replay_path != nullptr) {
+        if (!buildReplay(replay_path, session_id, trace)) return 2;
+    } else if (!buildScenario(scenario, seed, SIM_SAMPLE_MS, trace)) {
+        fprintf(stderr, "unknown scenario %s\n", scenario);
+        return 2;
+    }
+    uint64_t pass_us = trace.back().offset_us + SIM_SAMPLE_MS * 1000ULL;
+
+    // Device storage under the data directory
+    std::string littlefs_dir = std::string(data_dir) + "/littlefs";
+    rawlog_path = std::string(data_dir) + "/rawlog.bin";
+    sim_argv = argv;
+    mkdir(data_dir, 0755);
+    hostSetLittleFsRoot(littlefs_dir.c_str());
+    hostAddPartition(RAW_PARTITION_LABEL, ESP_PARTITION_TYPE_DATA, RAW_PARTITION_SUBTYPE, SIM_RAWLOG_SIZE);
+    hostLoadPartition(RAW_PARTITION_LABEL, rawlog_path.c_str());
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    hostSetRestartHook(onRestart);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    if (quiet) hostSetLogOutput(nullptr);
+    hostSetHttpListen(bind_addr, port);
+    hostSetUdpListen(bind_addr, dns_port);
+    hostSetHeapHook(HttpTracer::heap);          // what the device gets from its linker wraps
+    hostSetTcpWriteHook(HttpTracer::sent);
+    if (free_heap >= 0) hostSetFreeHeap((uint32_t)free_heap, (uint32_t)free_heap);   // e.g. to see load shedding
+    hostSetMicros(1000000);
+    hostSetRealTime(true);
+
+    setup();
+
+    // Like the sensor in continuous mode: the newest measurement is readable
+    // until the next one completes; one the firmware did not read is lost
+    uint64_t start_us = hostMicros();
+    uint64_t next = 0;
+    auto readyAt = [&](uint64_t k) {
+        return start_us + k / trace.size() * pass_us + trace[k % trace.size()].offset_us;
+    };
+    while (!stop_requested) {
+        uint64_t now = hostMicros();
+        if (vl53.hostPending() == 0 && readyAt(next) <= now) {
+            while (readyAt(next + 1) <= now) next++;
+            const SimSample& s = trace[next % trace.size()];
+            HostSensorSample sample = {readyAt(next), s.distance, s.range_status, s.signal_rate, s.ambient_rate};
+            vl53.hostQueue(sample);
+            next++;
+        }
+        loop();
+    }
+
+    hostSavePartition(RAW_PARTITION_LABEL, rawlog_path.c_str());
+    fprintf(stderr, "rawlog partition saved to %s\n", rawlog_path.c_str());
+    return 0;
+}
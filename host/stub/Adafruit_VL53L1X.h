@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+typedef int8_t VL53L1X_ERROR;
+#define VL53L1X_ERROR_NONE 0
+
+#define HOST_SENSOR_QUEUE 256
+
+// One ranging result as the firmware sees it: distance() and vl_status, plus
+// the rates read while recording. time_us is when the data becomes ready on
+// the virtual clock.
+struct HostSensorSample {
+    uint64_t time_us;
+    int16_t distance;
+    uint8_t range_status;
+    uint16_t signal_rate;
+    uint16_t ambient_rate;
+};
+
+// Stand-in for the Adafruit driver. The harness queues samples; dataReady()
+// reports the front sample once the virtual clock has reached its time and
+// clearInterrupt() consumes it, matching the order the firmware calls them in.
+// No I2C traffic; for the real driver against a register-level sensor see
+// vl53l1x_emulator.h.
+class Adafruit_VL53L1X {
+private:
+    HostSensorSample queue[HOST_SENSOR_QUEUE];
+    uint16_t head;
+    uint16_t count;
+    uint16_t timing_budget;
+    bool present;
+    bool ranging;
+
+public:
+    VL53L1X_ERROR vl_status;
+
+    Adafruit_VL53L1X(uint8_t shutdown_pin = -1, uint8_t irq_pin = -1);
+
+    bool begin(uint8_t i2c_addr = 0x29, TwoWire* theWire = &Wire, bool debug = false);
+    uint16_t sensorID() { return present ? 0xEACC : 0; }
+    bool startRanging() { ranging = present; return ranging; }
+    bool stopRanging() { ranging = false; return true; }
+    bool setTimingBudget(uint16_t ms) { timing_budget = ms; return true; }
+    uint16_t getTimingBudget() { return timing_budget; }
+    bool dataReady();
+    int16_t distance();
+    bool clearInterrupt();
+    VL53L1X_ERROR VL53L1X_GetSignalRate(uint16_t* rate);
+    VL53L1X_ERROR VL53L1X_GetAmbientRate(uint16_t* rate);
+
+    // Harness side
+    bool hostQueue(const HostSensorSample& sample);
+    uint16_t hostPending() { return count; }
+    void hostSetPresent(bool value) { present = value; }
+};
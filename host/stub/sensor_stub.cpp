@@ -0,0 +1,54 @@
+#include <Adafruit_VL53L1X.h>
+#include "host_hal.h"
+
+Adafruit_VL53L1X::Adafruit_VL53L1X(uint8_t shutdown_pin, uint8_t irq_pin) {
+    head = 0;
+    count = 0;
+    timing_budget = 50;
+    present = true;
+    ranging = false;
+    vl_status = VL53L1X_ERROR_NONE;
+}
+
+bool Adafruit_VL53L1X::begin(uint8_t i2c_addr, TwoWire* theWire, bool debug) {
+    vl_status = present ? VL53L1X_ERROR_NONE : -13;  // VL53L1_ERROR_CONTROL_INTERFACE
+    return present;
+}
+
+bool Adafruit_VL53L1X::dataReady() {
+    return ranging && count > 0 && queue[head].time_us <= hostMicros();
+}
+
+int16_t Adafruit_VL53L1X::distance() {
+    if (count == 0) {
+        vl_status = VL53L1X_ERROR_NONE;
+        return -1;
+    }
+    vl_status = queue[head].range_status;
+    return queue[head].distance;
+}
+
+bool Adafruit_VL53L1X::clearInterrupt() {
+    if (count > 0) {
+        head = (head + 1) % HOST_SENSOR_QUEUE;
+        count--;
+    }
+    return true;
+}
+
+VL53L1X_ERROR Adafruit_VL53L1X::VL53L1X_GetSignalRate(uint16_t* rate) {
+    *rate = count > 0 ? queue[head].signal_rate : 0;
+    return VL53L1X_ERROR_NONE;
+}
+
+VL53L1X_ERROR Adafruit_VL53L1X::VL53L1X_GetAmbientRate(uint16_t* rate) {
+    *rate = count > 0 ? queue[head].ambient_rate : 0;
+    return VL53L1X_ERROR_NONE;
+}
+
+bool Adafruit_VL53L1X::hostQueue(const HostSensorSample& sample) {
+    if (count >= HOST_SENSOR_QUEUE) return false;
+    queue[(head + count) % HOST_SENSOR_QUEUE] = sample;
+    count++;
+    return true;
+}
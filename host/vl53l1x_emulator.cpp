@@ -0,0 +1,213 @@
+#include "vl53l1x_emulator.h"
+#include "host_hal.h"
+
+#define REG_SOFT_RESET              0x0000
+#define REG_I2C_SLAVE_ADDRESS       0x0001
+#define REG_GPIO_HV_MUX_CTRL        0x0030
+#define REG_GPIO_TIO_HV_STATUS      0x0031
+#define REG_PHASECAL_TIMEOUT        0x004B   // 0x14 short, 0x0A long distance mode
+#define REG_RANGE_TIMEOUT_A_HI      0x005E
+#define REG_INTERMEASUREMENT_PERIOD 0x006C
+#define REG_INTERRUPT_CLEAR         0x0086
+#define REG_MODE_START              0x0087
+#define REG_RESULT_RANGE_STATUS     0x0089
+#define REG_RESULT_SPADS            0x008C
+#define REG_RESULT_AMBIENT_RATE     0x0090
+#define REG_RESULT_DISTANCE         0x0096
+#define REG_RESULT_SIGNAL_RATE      0x0098
+#define REG_OSC_CALIBRATE_VAL       0x00DE
+#define REG_FIRMWARE_SYSTEM_STATUS  0x00E5
+#define REG_MODEL_ID                0x010F
+
+#define MODE_START_CONTINUOUS       0x40
+
+#define EMULATOR_SIGNAL_AT_1M_KCPS  20000.0f
+#define EMULATOR_AMBIENT_KCPS       400
+#define EMULATOR_DEFAULT_BUDGET_MS  100
+
+// Raw device range status for a ULD status code; the ULD maps back with status_rtn[]
+static uint8_t rawRangeStatus(uint8_t uld_status) {
+    switch (uld_status) {
+        case 0: return 9;    // range valid
+        case 1: return 6;    // sigma fail
+        case 2: return 4;    // signal fail
+        case 3: return 8;    // below minimum range
+        case 4: return 5;    // out of bounds
+        case 5: return 3;    // hardware fail
+        case 7: return 7;    // wrap around
+        default: return 4;
+    }
+}
+
+Vl53l1xEmulator::Vl53l1xEmulator(uint32_t seed) : rng(seed) {
+    memset(regs, 0, sizeof(regs));
+    address = VL53L1X_EMULATOR_ADDRESS;
+    index = 0;
+    boot_us = hostMicros();
+    ranging = false;
+    ranging_start_us = 0;
+    last_measurement = -1;
+    data_ready = false;
+    scene = nullptr;
+    scene_arg = nullptr;
+    noise_mm = 2.0f;
+    noise_per_m = 1.5f;
+    max_range_mm = 4000;
+    dropout_rate = 0.0f;
+    dropout_status = 2;
+    measurements = 0;
+    lost_measurements = 0;
+    interrupt_clears = 0;
+
+    // Power-on values the ULD reads before writing its default configuration
+    setWord(REG_MODEL_ID, 0xEACC);
+    regs[REG_GPIO_HV_MUX_CTRL] = 0x01;
+    regs[REG_PHASECAL_TIMEOUT] = 0x0A;
+    setWord(REG_RANGE_TIMEOUT_A_HI, 0x01CC);
+    setWord(REG_OSC_CALIBRATE_VAL, 0x0100);
+}
+
+void Vl53l1xEmulator::setWord(uint16_t reg, uint16_t value) {
+    regs[reg] = value >> 8;
+    regs[(uint16_t)(reg + 1)] = value & 0xFF;
+}
+
+uint16_t Vl53l1xEmulator::getWord(uint16_t reg) {
+    return ((uint16_t)regs[reg] << 8) | regs[(uint16_t)(reg + 1)];
+}
+
+uint32_t Vl53l1xEmulator::getTimingBudgetMs() {
+    // Both columns of the ULD's short/long distance mode tables
+    switch (getWord(REG_RANGE_TIMEOUT_A_HI)) {
+        case 0x001D: return 15;
+        case 0x0051: case 0x001E: return 20;
+        case 0x00D6: case 0x0060: return 33;
+        case 0x01AE: case 0x00AD: return 50;
+        case 0x02E1: case 0x01CC: return 100;
+        case 0x03E1: case 0x02D9: return 200;
+        case 0x0591: case 0x048F: return 500;
+        default: return EMULATOR_DEFAULT_BUDGET_MS;
+    }
+}
+
+uint32_t Vl53l1xEmulator::getPeriodUs() {
+    uint32_t period_us = getTimingBudgetMs() * 1000;
+    // Inter-measurement period is written as ms * PLL * 1.075
+    uint32_t pll = getWord(REG_OSC_CALIBRATE_VAL) & 0x3FF;
+    uint32_t im = ((uint32_t)regs[REG_INTERMEASUREMENT_PERIOD] << 24) |
+                  ((uint32_t)regs[REG_INTERMEASUREMENT_PERIOD + 1] << 16) |
+                  ((uint32_t)regs[REG_INTERMEASUREMENT_PERIOD + 2] << 8) |
+                  regs[REG_INTERMEASUREMENT_PERIOD + 3];
+    if (pll > 0) {
+        uint32_t im_us = (uint32_t)(im * 1000.0 / (pll * 1.075));
+        if (im_us > period_us) period_us = im_us;
+    }
+    return period_us;
+}
+
+void Vl53l1xEmulator::update() {
+    if (!ranging) return;
+    uint64_t now = hostMicros();
+    uint64_t period = getPeriodUs();
+    int64_t completed = (int64_t)((now - ranging_start_us) / period) - 1;
+    if (completed <= last_measurement) return;
+
+    // Every result that completed since the last call; only the newest is kept
+    uint32_t count = (uint32_t)(completed - last_measurement);
+    measurements += count;
+    lost_measurements += count - 1 + (data_ready ? 1 : 0);
+    last_measurement = completed;
+    latch(completed);
+}
+
+void Vl53l1xEmulator::latch(int64_t measurement) {
+    uint64_t period = getPeriodUs();
+    uint64_t middle_us = ranging_start_us + measurement * period + period / 2;
+    int16_t truth = scene ? scene(middle_us, scene_arg) : -1;
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    uint8_t status = 0;
+    uint16_t distance = 0;
+    float signal_kcps = 0.0f;
+    if (truth <= 0 || truth > max_range_mm) {
+        status = 2;   // no target: signal fail
+    } else if (dropout_rate > 0 && uniform(rng) < dropout_rate) {
+        status = dropout_status;
+    } else {
+        std::normal_distribution<float> noise(0.0f, noise_mm + noise_per_m * truth / 1000.0f);
+        distance = (uint16_t)max(1L, lroundf(truth + noise(rng)));
+        float metres = truth / 1000.0f;
+        signal_kcps = EMULATOR_SIGNAL_AT_1M_KCPS / (metres * metres);
+    }
+
+    regs[REG_RESULT_RANGE_STATUS] = rawRangeStatus(status);
+    setWord(REG_RESULT_DISTANCE, distance);
+    setWord(REG_RESULT_SIGNAL_RATE, (uint16_t)min(65535.0f, signal_kcps / 8));   // ULD reads rate * 8
+    setWord(REG_RESULT_AMBIENT_RATE, EMULATOR_AMBIENT_KCPS / 8);
+    setWord(REG_RESULT_SPADS, 16 << 8);
+    data_ready = true;
+}
+
+void Vl53l1xEmulator::onRegisterWrite(uint16_t reg, uint8_t value) {
+    regs[reg] = value;
+    switch (reg) {
+        case REG_SOFT_RESET:
+            if (value & 0x01) {
+                boot_us = hostMicros();
+            } else {
+                ranging = false;
+                boot_us = UINT64_MAX;   // held in reset
+            }
+            break;
+        case REG_I2C_SLAVE_ADDRESS:
+            address = value & 0x7F;
+            break;
+        case REG_INTERRUPT_CLEAR:
+            if (value & 0x01) {
+                data_ready = false;
+                interrupt_clears++;
+            }
+            break;
+        case REG_MODE_START:
+            if (value & MODE_START_CONTINUOUS) {
+                ranging = true;
+                ranging_start_us = hostMicros();
+                last_measurement = -1;
+                data_ready = false;
+            } else if (value == 0) {
+                ranging = false;
+            }
+            break;
+    }
+}
+
+uint8_t Vl53l1xEmulator::readRegister(uint16_t reg) {
+    switch (reg) {
+        case REG_GPIO_TIO_HV_STATUS: {
+            // Interrupt polarity: bit 4 of GPIO_HV_MUX_CTRL set means active low
+            uint8_t active = (regs[REG_GPIO_HV_MUX_CTRL] & 0x10) ? 0 : 1;
+            uint8_t level = data_ready ? active : !active;
+            return (regs[reg] & ~0x01) | level;
+        }
+        case REG_FIRMWARE_SYSTEM_STATUS:
+            return hostMicros() >= boot_us && hostMicros() - boot_us >= VL53L1X_EMULATOR_BOOT_US ? 0x01 : 0x00;
+        default:
+            return regs[reg];
+    }
+}
+
+void Vl53l1xEmulator::i2cWrite(const uint8_t* data, size_t len) {
+    if (len < 2) return;   // address probe
+    update();
+    index = ((uint16_t)data[0] << 8) | data[1];
+    for (size_t i = 2; i < len; i++) {
+        onRegisterWrite(index++, data[i]);
+    }
+}
+
+void Vl53l1xEmulator::i2cRead(uint8_t* data, size_t len) {
+    update();
+    for (size_t i = 0; i < len; i++) {
+        data[i] = readRegister(index++);
+    }
+}
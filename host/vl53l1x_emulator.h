@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Wire.h>
+#include <random>
+
+// Register-level VL53L1X on the emulated I2C bus, for running the real
+// Adafruit/ST ULD driver on the host unchanged. Models what the ULD touches:
+// - boot state (FIRMWARE__SYSTEM_STATUS) shortly after power-on or soft reset
+// - model id 0xEACC, I2C address change
+// - continuous ranging started and stopped through SYSTEM__MODE_START, one
+//   result per max(timing budget, inter-measurement period) decoded from the
+//   registers the ULD writes for them
+// - data ready on GPIO__TIO_HV_STATUS honouring the interrupt polarity, and
+//   the SYSTEM__INTERRUPT_CLEAR handshake. A result that completes before the
+//   previous one was cleared replaces it.
+// - result registers: range status (raw device codes), distance, signal and
+//   ambient rates
+// The scene callback gives the true distance at the middle of each
+// measurement; noise and dropouts are applied on top.
+
+#define VL53L1X_EMULATOR_ADDRESS 0x29
+#define VL53L1X_EMULATOR_BOOT_US 1200
+
+// Distance in mm at time_us, or -1 for no target within range
+typedef int16_t (*Vl53l1xScene)(uint64_t time_us, void* arg);
+
+class Vl53l1xEmulator : public HostI2CDevice {
+private:
+    uint8_t regs[0x10000];
+    uint8_t address;
+    uint16_t index;             // register pointer, big endian on the wire
+    uint64_t boot_us;
+    bool ranging;
+    uint64_t ranging_start_us;
+    int64_t last_measurement;
+    bool data_ready;
+
+    Vl53l1xScene scene;
+    void* scene_arg;
+    std::mt19937 rng;
+    float noise_mm;
+    float noise_per_m;          // additional sigma per metre of distance
+    int16_t max_range_mm;
+    float dropout_rate;
+    uint8_t dropout_status;     // ULD status code (2 signal fail, 4 out of bounds, ...)
+
+    uint32_t measurements;
+    uint32_t lost_measurements; // completed but replaced before being read
+    uint32_t interrupt_clears;
+
+    void update();
+    void latch(int64_t measurement);
+    void onRegisterWrite(uint16_t reg, uint8_t value);
+    uint8_t readRegister(uint16_t reg);
+    void setWord(uint16_t reg, uint16_t value);
+    uint16_t getWord(uint16_t reg);
+
+public:
+    Vl53l1xEmulator(uint32_t seed = 1);
+
+    void setScene(Vl53l1xScene callback, void* arg) { scene = callback; scene_arg = arg; }
+    void setNoise(float sigma_mm, float sigma_per_m) { noise_mm = sigma_mm; noise_per_m = sigma_per_m; }
+    void setMaxRange(int16_t mm) { max_range_mm = mm; }
+    void setDropouts(float rate, uint8_t uld_status) { dropout_rate = rate; dropout_status = uld_status; }
+
+    uint32_t getTimingBudgetMs();
+    uint32_t getPeriodUs();
+    bool isRanging() { return ranging; }
+    uint32_t getMeasurements() { return measurements; }
+    uint32_t getLostMeasurements() { return lost_measurements; }
+    uint32_t getInterruptClears() { return interrupt_clears; }
+
+    // HostI2CDevice
+    uint8_t i2cAddress() override { return address; }
+    void i2cWrite(const uint8_t* data, size_t len) override;
+    void i2cRead(uint8_t* data, size_t len) override;
+};
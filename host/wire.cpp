@@ -0,0 +1,89 @@
+#include <Wire.h>
+#include "host_hal.h"
+
+#define HOST_I2C_DEFAULT_CLOCK 100000
+#define HOST_I2C_BITS_PER_BYTE 9    // 8 data bits and the ACK
+
+TwoWire Wire;
+
+TwoWire::TwoWire() {
+    device_count = 0;
+    clock_hz = HOST_I2C_DEFAULT_CLOCK;
+    tx_address = 0;
+    tx_length = 0;
+    rx_length = 0;
+    rx_index = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    if (frequency != 0) clock_hz = frequency;
+    return true;
+}
+
+HostI2CDevice* TwoWire::find(uint8_t address) {
+    for (uint8_t i = 0; i < device_count; i++) {
+        if (devices[i]->i2cAddress() == address) return devices[i];
+    }
+    return nullptr;
+}
+
+void TwoWire::account(size_t payload_bytes) {
+    // Address byte plus payload, plus roughly one bit time each for start and stop
+    uint64_t bits = (payload_bytes + 1) * HOST_I2C_BITS_PER_BYTE + 2;
+    uint64_t us = (bits * 1000000ULL + clock_hz - 1) / clock_hz;
+    stats.transactions++;
+    stats.bytes += payload_bytes + 1;
+    stats.bus_us += us;
+    hostAdvanceMicros(us);
+}
+
+bool TwoWire::hostAttach(HostI2CDevice* device) {
+    if (device_count >= HOST_I2C_DEVICES) return false;
+    devices[device_count++] = device;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    tx_address = address;
+    tx_length = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (tx_length >= HOST_I2C_BUFFER) return 0;
+    tx_buffer[tx_length++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+    size_t n = 0;
+    while (n < len && write(data[n])) n++;
+    return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    HostI2CDevice* device = find(tx_address);
+    account(device ? tx_length : 0);
+    if (device == nullptr) {
+        stats.nacks++;
+        return 2;   // NACK on address
+    }
+    device->i2cWrite(tx_buffer, tx_length);
+    tx_length = 0;
+    return 0;
+}
+
+size_t TwoWire::requestFrom(uint16_t address, size_t size, bool sendStop) {
+    rx_length = 0;
+    rx_index = 0;
+    HostI2CDevice* device = find((uint8_t)address);
+    if (size > HOST_I2C_BUFFER) size = HOST_I2C_BUFFER;
+    account(device ? size : 0);
+    if (device == nullptr) {
+        stats.nacks++;
+        return 0;
+    }
+    device->i2cRead(rx_buffer, size);
+    rx_length = size;
+    return size;
+}
@@ -0,0 +1,453 @@
+#include "api_core.h"
+#include <ArduinoJson.h>
+
+#define API_ERROR(message) "{\"status\":\"error\",\"message\":\"" message "\"}"
+
+// Config form fields: output index (or -1 for capture) and field bit
+struct ApiConfigField {
+    const char* name;
+    int8_t output;
+    uint8_t bit;
+};
+
+static const ApiConfigField config_fields[] = {
+    {"output1_enabled", 0, API_CFG_OUTPUT_ENABLED},
+    {"output1_min", 0, API_CFG_OUTPUT_MIN},
+    {"output1_max", 0, API_CFG_OUTPUT_MAX},
+    {"output1_hysteresis", 0, API_CFG_OUTPUT_HYSTERESIS},
+    {"output1_polarity", 0, API_CFG_OUTPUT_POLARITY},
+    {"output1_ota_state", 0, API_CFG_OUTPUT_OTA_STATE},
+    {"output2_enabled", 1, API_CFG_OUTPUT_ENABLED},
+    {"output2_min", 1, API_CFG_OUTPUT_MIN},
+    {"output2_max", 1, API_CFG_OUTPUT_MAX},
+    {"output2_hysteresis", 1, API_CFG_OUTPUT_HYSTERESIS},
+    {"output2_polarity", 1, API_CFG_OUTPUT_POLARITY},
+    {"output2_ota_state", 1, API_CFG_OUTPUT_OTA_STATE},
+    {"capture_pre", -1, API_CFG_CAPTURE_PRE},
+    {"capture_post", -1, API_CFG_CAPTURE_POST},
+};
+
+bool apiParseConfigField(ApiConfigParams& params, const char* name, const char* value) {
+    for (const ApiConfigField& field : config_fields) {
+        if (strcmp(name, field.name) != 0) continue;
+
+        // Numbers parse like String::toInt(): leading digits, 0 when there are none
+        int32_t number = (int32_t)strtol(value, nullptr, 10);
+        if (field.output < 0) {
+            params.capture_present |= field.bit;
+            if (field.bit == API_CFG_CAPTURE_PRE) params.capture_pre = number;
+            else params.capture_post = number;
+            return true;
+        }
+
+        ApiOutputParams& out = params.outputs[field.output];
+        out.present |= field.bit;
+        switch (field.bit) {
+            case API_CFG_OUTPUT_ENABLED: out.enabled = strcmp(value, "1") == 0; break;
+            case API_CFG_OUTPUT_MIN: out.min = number; break;
+            case API_CFG_OUTPUT_MAX: out.max = number; break;
+            case API_CFG_OUTPUT_HYSTERESIS: out.hysteresis = number; break;
+            case API_CFG_OUTPUT_POLARITY: out.active_in_range = strcmp(value, "in_range") == 0; break;
+            case API_CFG_OUTPUT_OTA_STATE: out.ota_state = outputOtaStateFromName(value); break;
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool parseOutputJson(ApiOutputParams& out, JsonObjectConst object, ApiReply& error) {
+    for (JsonPairConst member : object) {
+        const char* key = member.key().c_str();
+        JsonVariantConst value = member.value();
+        uint8_t bit;
+        if (strcmp(key, "enabled") == 0) bit = API_CFG_OUTPUT_ENABLED;
+        else if (strcmp(key, "min") == 0) bit = API_CFG_OUTPUT_MIN;
+        else if (strcmp(key, "max") == 0) bit = API_CFG_OUTPUT_MAX;
+        else if (strcmp(key, "hysteresis") == 0) bit = API_CFG_OUTPUT_HYSTERESIS;
+        else if (strcmp(key, "active_in_range") == 0) bit = API_CFG_OUTPUT_POLARITY;
+        else if (strcmp(key, "ota_state") == 0) bit = API_CFG_OUTPUT_OTA_STATE;
+        else {
+            error = {400, API_ERROR("Unknown field")};
+            return false;
+        }
+
+        bool is_flag = bit == API_CFG_OUTPUT_ENABLED || bit == API_CFG_OUTPUT_POLARITY;
+        bool is_name = bit == API_CFG_OUTPUT_OTA_STATE;
+        if (is_name ? !value.is<const char*>() : is_flag ? !value.is<bool>() : !value.is<int32_t>()) {
+            error = {400, API_ERROR("Wrong type for a field")};
+            return false;
+        }
+        out.present |= bit;
+        switch (bit) {
+            case API_CFG_OUTPUT_ENABLED: out.enabled = value.as<bool>(); break;
+            case API_CFG_OUTPUT_MIN: out.min = value.as<int32_t>(); break;
+            case API_CFG_OUTPUT_MAX: out.max = value.as<int32_t>(); break;
+            case API_CFG_OUTPUT_HYSTERESIS: out.hysteresis = value.as<int32_t>(); break;
+            case API_CFG_OUTPUT_POLARITY: out.active_in_range = value.as<bool>(); break;
+            case API_CFG_OUTPUT_OTA_STATE: out.ota_state = outputOtaStateFromName(value.as<const char*>()); break;
+        }
+    }
+    return true;
+}
+
+bool apiParseConfigJson(ApiConfigParams& params, const char* json, size_t len, ApiReply& error) {
+    JsonDocument doc;
+    if (deserializeJson(doc, json, len) || !doc.is<JsonObjectConst>()) {
+        error = {400, API_ERROR("Invalid JSON")};
+        return false;
+    }
+
+    for (JsonPairConst member : doc.as<JsonObjectConst>()) {
+        const char* key = member.key().c_str();
+        JsonVariantConst value = member.value();
+        if (strcmp(key, "output1") == 0 || strcmp(key, "output2") == 0) {
+            if (!value.is<JsonObjectConst>()) {
+                error = {400, API_ERROR("Wrong type for a field")};
+                return false;
+            }
+            if (!parseOutputJson(params.outputs[key[6] - '1'], value.as<JsonObjectConst>(), error)) return false;
+        } else if (strcmp(key, "capture") == 0) {
+            if (!value.is<JsonObjectConst>()) {
+                error = {400, API_ERROR("Wrong type for a field")};
+                return false;
+            }
+            for (JsonPairConst field : value.as<JsonObjectConst>()) {
+                bool pre = strcmp(field.key().c_str(), "pre") == 0;
+                if (!pre && strcmp(field.key().c_str(), "post") != 0) {
+                    error = {400, API_ERROR("Unknown field")};
+                    return false;
+                }
+                if (!field.value().is<int32_t>()) {
+                    error = {400, API_ERROR("Wrong type for a field")};
+                    return false;
+                }
+                params.capture_present |= pre ? API_CFG_CAPTURE_PRE : API_CFG_CAPTURE_POST;
+                (pre ? params.capture_pre : params.capture_post) = field.value().as<int32_t>();
+            }
+        } else if (strcmp(key, "device_name") == 0) {
+            const char* name = value.as<const char*>();
+            if (name == nullptr || strlen(name) == 0 || strlen(name) > API_DEVICE_NAME_MAX) {
+                error = {400, API_ERROR("Device name must be 1-32 characters")};
+                return false;
+            }
+            params.has_device_name = true;
+            apiCopyField(params.device_name, sizeof(params.device_name), name, strlen(name));
+        } else {
+            error = {400, API_ERROR("Unknown field")};
+            return false;
+        }
+    }
+    return true;
+}
+
+void apiCopyField(char* field, size_t size, const char* value, size_t len) {
+    if (len >= size) len = size - 1;
+    memcpy(field, value, len);
+    field[len] = '\0';
+}
+
+ApiCore::ApiCore(ConfigManager* config_mgr, SensorManager* sensor_mgr) {
+    config_manager = config_mgr;
+    sensor_manager = sensor_mgr;
+    config_lock = xSemaphoreCreateMutex();
+}
+
+bool ApiCore::validateSession(const char* token, size_t len) {
+    return sessions.validate(token, len, millis());
+}
+
+ApiReply ApiCore::login(const ApiLoginParams& params, char* token) {
+    bool valid = false;
+    if (params.has_password) {
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        valid = config_manager->validatePassword(params.password);
+        xSemaphoreGive(config_lock);
+    }
+    if (!valid) {
+        return {401, "{\"status\":\"error\",\"message\":\"Invalid password\"}"};
+    }
+
+    sessions.create(token, millis());
+    return {200, "{\"status\":\"success\",\"message\":\"Logged in\"}"};
+}
+
+void ApiCore::logout(const char* token, size_t len) {
+    sessions.remove(token, len);
+}
+
+ApiReply ApiCore::changePassword(const ApiPasswordParams& params) {
+    if (!params.has_current || !params.has_new) {
+        return {400, "{\"status\":\"error\",\"message\":\"Missing required parameters\"}"};
+    }
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    if (!config_manager->validatePassword(params.current_password)) {
+        xSemaphoreGive(config_lock);
+        return {400, "{\"status\":\"error\",\"message\":\"Current password is incorrect\"}"};
+    }
+
+    config_manager->setAdminPassword(params.new_password);
+    config_manager->saveConfig();
+    xSemaphoreGive(config_lock);
+    Serial.println("Admin password changed");
+    return {200, "{\"status\":\"success\",\"message\":\"Password changed successfully\"}"};
+}
+
+void ApiCore::readStatus(StatusSample& sample) {
+    SensorSnapshot snapshot = sensor_manager->getSnapshot();
+    sample.sequence = snapshot.sequence;
+    sample.timestamp_us = snapshot.timestamp_us;
+    sample.distance = snapshot.distance;
+    sample.raw_distance = snapshot.raw_distance;
+    sample.status = (uint8_t)snapshot.status;
+    sample.flags = 0;
+    if (snapshot.outputs[0].current_state) sample.flags |= STATUS_FLAG_OUTPUT1;
+    if (snapshot.outputs[1].current_state) sample.flags |= STATUS_FLAG_OUTPUT2;
+    if (snapshot.out_of_range) sample.flags |= STATUS_FLAG_OUT_OF_RANGE;
+    if (snapshot.sensor_ready) sample.flags |= STATUS_FLAG_SENSOR_READY;
+}
+
+void ApiCore::writeStatusJson(JsonWriter& json) {
+    StatusSample sample;
+    readStatus(sample);
+    writeStatusJson(json, sample);
+}
+
+void ApiCore::writeStatusJson(JsonWriter& json, const StatusSample& sample) {
+    json.beginObject();
+    json.addInt("distance", sample.distance);
+    json.addInt("raw_distance", sample.raw_distance);
+    json.addBool("sensor_ready", (sample.flags & STATUS_FLAG_SENSOR_READY) != 0);
+    json.addBool("out_of_range", (sample.flags & STATUS_FLAG_OUT_OF_RANGE) != 0);
+
+    switch (sample.status) {
+        case STATUS_OK:
+            json.addString("status", "OK");
+            break;
+        case STATUS_TRIGGERED:
+            json.addString("status", "TRIGGERED");
+            break;
+        case STATUS_FAULT:
+            json.addString("status", "FAULT");
+            break;
+    }
+
+    json.addBool("output1_state", (sample.flags & STATUS_FLAG_OUTPUT1) != 0);
+    json.addBool("output2_state", (sample.flags & STATUS_FLAG_OUTPUT2) != 0);
+    json.addUInt("timestamp", millis());
+    json.endObject();
+}
+
+void ApiCore::writeConfigJson(JsonWriter& json) {
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    config_manager->writeConfigJson(json);
+    xSemaphoreGive(config_lock);
+}
+
+// Applies one output's fields; returns true if anything changed
+static bool applyOutput(const ApiOutputParams& in, bool& enabled, uint16_t& min, uint16_t& max,
+                        uint16_t& hysteresis, bool& active_in_range, uint8_t& ota_state) {
+    bool changed = false;
+    if ((in.present & API_CFG_OUTPUT_ENABLED) && in.enabled != enabled) {
+        enabled = in.enabled;
+        changed = true;
+    }
+    if ((in.present & API_CFG_OUTPUT_MIN) && in.min != min) {
+        min = in.min;
+        changed = true;
+    }
+    if ((in.present & API_CFG_OUTPUT_MAX) && in.max != max) {
+        max = in.max;
+        changed = true;
+    }
+    if ((in.present & API_CFG_OUTPUT_HYSTERESIS) && in.hysteresis != hysteresis) {
+        hysteresis = in.hysteresis;
+        changed = true;
+    }
+    if ((in.present & API_CFG_OUTPUT_POLARITY) && in.active_in_range != active_in_range) {
+        active_in_range = in.active_in_range;
+        changed = true;
+    }
+    if ((in.present & API_CFG_OUTPUT_OTA_STATE) && in.ota_state != ota_state) {
+        ota_state = in.ota_state;
+        changed = true;
+    }
+    return changed;
+}
+
+// Value ranges, checked before the values are narrowed into DeviceConfig
+static const char* checkParams(const ApiConfigParams& params) {
+    for (const ApiOutputParams& out : params.outputs) {
+        if (((out.present & API_CFG_OUTPUT_MIN) && (out.min < 0 || out.min > API_DISTANCE_MAX)) ||
+            ((out.present & API_CFG_OUTPUT_MAX) && (out.max < 0 || out.max > API_DISTANCE_MAX))) {
+            return API_ERROR("Distances must be 0-4000 mm");
+        }
+        if ((out.present & API_CFG_OUTPUT_HYSTERESIS) && (out.hysteresis < 0 || out.hysteresis > API_HYSTERESIS_MAX)) {
+            return API_ERROR("Hysteresis must be 0-500 mm");
+        }
+        if ((out.present & API_CFG_OUTPUT_OTA_STATE) && out.ota_state < 0) {
+            return API_ERROR("OTA state must be live, hold, low or high");
+        }
+    }
+    if (((params.capture_present & API_CFG_CAPTURE_PRE) && (params.capture_pre < 0 || params.capture_pre >= CAPTURE_RING_SAMPLES)) ||
+        ((params.capture_present & API_CFG_CAPTURE_POST) && (params.capture_post < 0 || params.capture_post >= CAPTURE_RING_SAMPLES))) {
+        return API_ERROR("Capture window too large");
+    }
+    return nullptr;
+}
+
+// Consistency of the config as a whole
+static const char* checkOutput(uint16_t min, uint16_t max, uint16_t hysteresis, bool active_in_range) {
+    if (min >= max) {
+        return API_ERROR("Minimum distance must be below the maximum");
+    }
+    // Active out of range releases inside [min + hysteresis, max - hysteresis],
+    // which must not be empty
+    if (!active_in_range && 2 * hysteresis > max - min) {
+        return API_ERROR("Hysteresis too large for the range");
+    }
+    return nullptr;
+}
+
+static const char* checkConfig(const DeviceConfig& config) {
+    const char* error = checkOutput(config.output1_min, config.output1_max,
+                                    config.output1_hysteresis, config.output1_active_in_range);
+    if (error == nullptr) {
+        error = checkOutput(config.output2_min, config.output2_max,
+                            config.output2_hysteresis, config.output2_active_in_range);
+    }
+    if (error == nullptr && config.capture_pre_samples + 1 + config.capture_post_samples > CAPTURE_RING_SAMPLES) {
+        error = API_ERROR("Capture window too large");
+    }
+    return error;
+}
+
+ApiReply ApiCore::setConfig(const ApiConfigParams& params) {
+    const char* error = checkParams(params);
+    if (error != nullptr) return {400, error};
+
+    // Prepared off to the side; ConfigManager and SensorManager only ever get
+    // a complete, validated config
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    DeviceConfig config = config_manager->getDeviceConfig();
+    bool config_changed = false;
+
+    config_changed |= applyOutput(params.outputs[0], config.output1_enabled, config.output1_min,
+                                  config.output1_max, config.output1_hysteresis, config.output1_active_in_range,
+                                  config.output1_ota_state);
+    config_changed |= applyOutput(params.outputs[1], config.output2_enabled, config.output2_min,
+                                  config.output2_max, config.output2_hysteresis, config.output2_active_in_range,
+                                  config.output2_ota_state);
+
+    // Capture window (samples before/after an output transition)
+    if ((params.capture_present & API_CFG_CAPTURE_PRE) && params.capture_pre != config.capture_pre_samples) {
+        config.capture_pre_samples = params.capture_pre;
+        config_changed = true;
+    }
+    if ((params.capture_present & API_CFG_CAPTURE_POST) && params.capture_post != config.capture_post_samples) {
+        config.capture_post_samples = params.capture_post;
+        config_changed = true;
+    }
+    if (params.has_device_name && config.device_name != params.device_name) {
+        config.device_name = params.device_name;
+        config_changed = true;
+    }
+
+    if (!config_changed) {
+        xSemaphoreGive(config_lock);
+        return {200, "{\"status\":\"no_change\",\"message\":\"No changes detected\"}"};
+    }
+    error = checkConfig(config);
+    if (error != nullptr) {
+        xSemaphoreGive(config_lock);
+        return {400, error};
+    }
+
+    config_manager->setDeviceConfig(config);
+    config_manager->saveConfig();
+    sensor_manager->updateConfiguration(config);
+    xSemaphoreGive(config_lock);
+    Serial.println("Configuration updated");
+    return {200, "{\"status\":\"success\",\"message\":\"Configuration updated\"}"};
+}
+
+ApiReply ApiCore::resetConfig() {
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    if (!config_manager->resetToDefaults()) {
+        xSemaphoreGive(config_lock);
+        return {500, "{\"status\":\"error\",\"message\":\"Failed to save default configuration\"}"};
+    }
+
+    // Apply the default output settings immediately
+    sensor_manager->updateConfiguration(config_manager->getDeviceConfig());
+    xSemaphoreGive(config_lock);
+    Serial.println("Configuration reset to defaults");
+    return {200, "{\"status\":\"success\",\"message\":\"Configuration reset to defaults\"}"};
+}
+
+ApiReply ApiCore::clearHistory() {
+    config_manager->clearHistory();
+    Serial.println("History cleared");
+    return {200, "{\"status\":\"success\",\"message\":\"History cleared\"}"};
+}
+
+void ApiCore::writeCapturesJson(JsonWriter& json) {
+    CaptureBuffer* captures = sensor_manager->getCaptureBuffer();
+    json.beginObject();
+    json.addUInt("pre", captures->getPreSamples());
+    json.addUInt("post", captures->getPostSamples());
+    json.beginArray("captures");
+    for (uint8_t i = 0; i < captures->getSlotCount(); i++) {
+        const CaptureSlot* slot = captures->getSlot(i);
+        if (slot == nullptr) continue;
+
+        CaptureHeader header = slot->header;
+        if (header.id == 0) continue; // Being rewritten
+        json.beginObject();
+        json.addUInt("id", header.id);
+        json.addUInt("output", header.output);
+        json.addBool("state", header.new_state);
+        json.addUInt("trigger_time", header.trigger_time_ms);
+        json.addUInt("pre", header.pre_samples);
+        json.addUInt("samples", header.sample_count);
+        json.endObject();
+    }
+    json.endArray();
+    json.addUInt("current_time", millis());
+    json.endObject();
+}
+
+void ApiCore::writeRawStatusJson(JsonWriter& json) {
+    RawRecorder* recorder = sensor_manager->getRawRecorder();
+    json.beginObject();
+    if (recorder == nullptr || !recorder->isAvailable()) {
+        json.addBool("available", false);
+    } else {
+        json.addBool("available", true);
+        json.addBool("recording", recorder->isRecording());
+        json.addUInt("session", recorder->getSession());
+        json.addUInt("samples", recorder->getSampleCount());
+        json.addUInt("pages", recorder->getNextPageSeq() - recorder->getOldestPageSeq());
+        json.addUInt("capacity_pages", recorder->getPageTotal());
+        json.addUInt("dropped_pages", recorder->getDroppedPages());
+    }
+    json.endObject();
+}
+
+ApiReply ApiCore::rawControl(uint8_t action) {
+    RawRecorder* recorder = sensor_manager->getRawRecorder();
+    if (recorder == nullptr || !recorder->isAvailable()) {
+        return {503, "{\"status\":\"error\",\"message\":\"Raw recorder unavailable\"}"};
+    }
+
+    switch (action) {
+        case RAW_CONTROL_START:
+            sensor_manager->startRawRecording();
+            return {200, "{\"status\":\"success\",\"message\":\"Raw recording started\"}"};
+        case RAW_CONTROL_STOP:
+            sensor_manager->stopRawRecording();
+            return {200, "{\"status\":\"success\",\"message\":\"Raw recording stopped\"}"};
+        default:
+            recorder->erase();
+            return {200, "{\"status\":\"success\",\"message\":\"Raw log erase scheduled\"}"};
+    }
+}
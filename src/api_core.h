@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config_manager.h"
+#include "sensor_manager.h"
+#include "status_codec.h"
+#include "json_writer.h"
+#include "session_store.h"
+
+// Transport-independent API core. The business logic behind the HTTP
+// handlers works on fixed-size parameter structs that a transport fills in
+// one pass over its input, and answers with an ApiReply or through a
+// JsonWriter. WebServerManager (HTTP) and SerialConsole are thin adapters on
+// top; host programs call it directly.
+
+#define API_PASSWORD_MAX 64       // longest accepted password, bytes
+#define API_TOKEN_LENGTH SESSION_TOKEN_CHARS
+#define API_DEVICE_NAME_MAX 32
+#define API_CONFIG_JSON_MAX 1024  // largest accepted JSON config body, bytes
+
+// Accepted configuration values
+#define API_DISTANCE_MAX 4000     // mm, VL53L1X long distance mode
+#define API_HYSTERESIS_MAX 500    // mm
+
+// ApiConfigParams field bits
+#define API_CFG_OUTPUT_ENABLED     0x01
+#define API_CFG_OUTPUT_MIN         0x02
+#define API_CFG_OUTPUT_MAX         0x04
+#define API_CFG_OUTPUT_HYSTERESIS  0x08
+#define API_CFG_OUTPUT_POLARITY    0x10
+#define API_CFG_OUTPUT_OTA_STATE   0x20
+#define API_CFG_CAPTURE_PRE        0x01
+#define API_CFG_CAPTURE_POST       0x02
+
+// Status code (HTTP semantics, also used by the other transports) and a
+// static JSON body
+struct ApiReply {
+    uint16_t code;
+    const char* body;
+};
+
+struct ApiOutputParams {
+    uint8_t present;            // API_CFG_OUTPUT_* bits
+    bool enabled;
+    bool active_in_range;
+    int32_t min;
+    int32_t max;
+    int32_t hysteresis;
+    int8_t ota_state;           // OutputOtaState, -1 for an unknown name
+};
+
+struct ApiConfigParams {
+    ApiOutputParams outputs[2];
+    uint8_t capture_present;    // API_CFG_CAPTURE_* bits
+    int32_t capture_pre;
+    int32_t capture_post;
+    bool has_device_name;
+    char device_name[API_DEVICE_NAME_MAX + 1];
+};
+
+struct ApiLoginParams {
+    bool has_password;
+    char password[API_PASSWORD_MAX + 1];
+};
+
+struct ApiPasswordParams {
+    bool has_current;
+    bool has_new;
+    char current_password[API_PASSWORD_MAX + 1];
+    char new_password[API_PASSWORD_MAX + 1];
+};
+
+// Raw recorder control actions
+#define RAW_CONTROL_START 0
+#define RAW_CONTROL_STOP 1
+#define RAW_CONTROL_ERASE 2
+
+// Parses one "name=value" pair of a config update into params, with the
+// form field names of POST /api/config. Returns false for an unknown name.
+bool apiParseConfigField(ApiConfigParams& params, const char* name, const char* value);
+
+// Parses a JSON config update, the same shape GET /api/config returns:
+// {"output1": {"enabled", "min", "max", "hysteresis", "active_in_range",
+// "ota_state"},
+// "output2": {...}, "capture": {"pre", "post"}, "device_name"}; every member
+// is optional. Unknown members and wrong types are errors, reported in error.
+bool apiParseConfigJson(ApiConfigParams& params, const char* json, size_t len, ApiReply& error);
+
+// Copies value into a fixed-size field, truncating; len is value's length
+void apiCopyField(char* field, size_t size, const char* value, size_t len);
+
+class ApiCore {
+private:
+    ConfigManager* config_manager;
+    SensorManager* sensor_manager;
+
+    SessionStore sessions;
+    // Held around every access to the config Strings (device name, admin
+    // password): the web server and the serial console run on different tasks
+    SemaphoreHandle_t config_lock;
+
+public:
+    ApiCore(ConfigManager* config_mgr, SensorManager* sensor_mgr);
+
+    // Sessions
+    bool validateSession(const char* token, size_t len);
+    // On success token receives a new session token (API_TOKEN_LENGTH + 1 bytes)
+    ApiReply login(const ApiLoginParams& params, char* token);
+    void logout(const char* token, size_t len);
+    ApiReply changePassword(const ApiPasswordParams& params);
+    SessionStats getSessionStats() const { return sessions.getStats(); }
+
+    // Status and configuration
+    void readStatus(StatusSample& sample);
+    void writeStatusJson(JsonWriter& json);
+    void writeStatusJson(JsonWriter& json, const StatusSample& sample);   // sample from readStatus()
+    void writeConfigJson(JsonWriter& json);
+    // Applies the present fields on top of the current config, validates the
+    // result as a whole and saves and applies it only if all of it is valid
+    ApiReply setConfig(const ApiConfigParams& params);
+    ApiReply resetConfig();
+    ApiReply clearHistory();
+
+    // Captures and raw recorder
+    void writeCapturesJson(JsonWriter& json);
+    void writeRawStatusJson(JsonWriter& json);
+    ApiReply rawControl(uint8_t action);
+};
@@ -0,0 +1,202 @@
+#include "captive_dns.h"
+
+#define DNS_HEADER_SIZE 12
+#define DNS_ANSWER_SIZE 16          // name pointer, type, class, TTL, length, IPv4 address
+#define DNS_TYPE_A 1
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+
+// Names phones and desktops resolve to decide whether there is a captive portal
+static const char* const probe_names[] = {
+    "captive.apple.com",
+    "www.apple.com",
+    "connectivitycheck.gstatic.com",
+    "connectivitycheck.android.com",
+    "clients3.google.com",
+    "www.msftconnecttest.com",
+    "detectportal.firefox.com",
+    "nmcheck.gnome.org",
+};
+
+static uint16_t readU16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Length of the single question after the header (name, type and class), or
+// 0 if the packet is not a standard query we can answer
+static size_t parseQuery(const uint8_t* packet, size_t len) {
+    if (len < DNS_HEADER_SIZE) return 0;
+    if ((packet[2] & 0x80) != 0 || (packet[2] & 0x78) != 0) return 0;    // a response, or not QUERY
+    if (readU16(packet + 4) != 1) return 0;
+
+    size_t pos = DNS_HEADER_SIZE;
+    while (pos < len && packet[pos] != 0) {
+        if ((packet[pos] & 0xC0) != 0) return 0;                         // no compression in a question
+        pos += packet[pos] + 1;
+        if (pos - DNS_HEADER_SIZE > 255) return 0;
+    }
+    pos += 1 + 4;
+    if (pos > len) return 0;
+    return pos - DNS_HEADER_SIZE;
+}
+
+// Question bytes for an A query of a dotted name
+static size_t encodeQuestion(const char* name, uint8_t* out, size_t size) {
+    size_t pos = 0;
+    while (*name != '\0') {
+        const char* dot = strchr(name, '.');
+        size_t label = dot != nullptr ? (size_t)(dot - name) : strlen(name);
+        if (pos + 1 + label + 5 > size) return 0;
+        out[pos++] = (uint8_t)label;
+        memcpy(out + pos, name, label);
+        pos += label;
+        name += label;
+        if (*name == '.') name++;
+    }
+    out[pos++] = 0;
+    out[pos++] = 0;
+    out[pos++] = DNS_TYPE_A;
+    out[pos++] = 0;
+    out[pos++] = DNS_CLASS_IN;
+    return pos;
+}
+
+CaptiveDns::CaptiveDns() {
+    memset(address, 0, sizeof(address));
+    memset(cache, 0, sizeof(cache));
+    memset(&stats, 0, sizeof(stats));
+    task = nullptr;
+    pinned = 0;
+    next_victim = 0;
+}
+
+bool CaptiveDns::begin(const IPAddress& ip, uint16_t port) {
+    stop();
+    for (int i = 0; i < 4; i++) address[i] = ip[i];
+
+    // Replies for the probe names, so the first query of a phone is a hit
+    memset(cache, 0, sizeof(cache));
+    pinned = 0;
+    for (const char* name : probe_names) {
+        uint8_t query[DNS_HEADER_SIZE + CAPTIVE_DNS_MAX_QUESTION];
+        memset(query, 0, DNS_HEADER_SIZE);
+        size_t question_len = encodeQuestion(name, query + DNS_HEADER_SIZE, CAPTIVE_DNS_MAX_QUESTION);
+        if (question_len == 0 || pinned >= CAPTIVE_DNS_CACHE_SLOTS) continue;
+        CacheEntry& entry = cache[pinned++];
+        entry.question_len = (uint8_t)question_len;
+        entry.reply_len = (uint8_t)buildReply(query + DNS_HEADER_SIZE, question_len, entry.reply);
+    }
+    next_victim = pinned;
+
+    if (!udp.listen(port)) return false;
+    udp.onPacket([this](AsyncUDPPacket& packet) { handlePacket(packet); });
+    return true;
+}
+
+void CaptiveDns::stop() {
+    udp.close();
+}
+
+size_t CaptiveDns::buildReply(const uint8_t* question, size_t question_len, uint8_t* reply) {
+    uint16_t qtype = readU16(question + question_len - 4);
+    uint16_t qclass = readU16(question + question_len - 2);
+    bool answer = (qtype == DNS_TYPE_A || qtype == DNS_TYPE_ANY) && qclass == DNS_CLASS_IN;
+
+    // ID and flags are filled in per query
+    memset(reply, 0, DNS_HEADER_SIZE);
+    reply[5] = 1;                           // QDCOUNT
+    reply[7] = answer ? 1 : 0;              // ANCOUNT
+    memcpy(reply + DNS_HEADER_SIZE, question, question_len);
+    size_t len = DNS_HEADER_SIZE + question_len;
+    if (!answer) return len;
+
+    uint8_t* a = reply + len;
+    a[0] = 0xC0;                            // name: pointer to the question
+    a[1] = DNS_HEADER_SIZE;
+    a[2] = 0;
+    a[3] = DNS_TYPE_A;
+    a[4] = 0;
+    a[5] = DNS_CLASS_IN;
+    a[6] = (uint8_t)(CAPTIVE_DNS_TTL >> 24);
+    a[7] = (uint8_t)(CAPTIVE_DNS_TTL >> 16);
+    a[8] = (uint8_t)(CAPTIVE_DNS_TTL >> 8);
+    a[9] = (uint8_t)CAPTIVE_DNS_TTL;
+    a[10] = 0;
+    a[11] = 4;
+    memcpy(a + 12, address, 4);
+    return len + DNS_ANSWER_SIZE;
+}
+
+const CaptiveDns::CacheEntry* CaptiveDns::lookup(const uint8_t* question, size_t question_len) const {
+    for (const CacheEntry& entry : cache) {
+        if (entry.question_len == question_len &&
+            memcmp(entry.reply + DNS_HEADER_SIZE, question, question_len) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void CaptiveDns::store(const uint8_t* reply, size_t reply_len, size_t question_len) {
+    if (question_len > CAPTIVE_DNS_MAX_QUESTION || pinned >= CAPTIVE_DNS_CACHE_SLOTS) return;
+    CacheEntry& entry = cache[next_victim];
+    memcpy(entry.reply, reply, reply_len);
+    entry.reply_len = (uint8_t)reply_len;
+    entry.question_len = (uint8_t)question_len;
+    next_victim = next_victim + 1 < CAPTIVE_DNS_CACHE_SLOTS ? next_victim + 1 : pinned;
+}
+
+void CaptiveDns::handlePacket(AsyncUDPPacket& packet) {
+    uint32_t start_us = micros();
+    const uint8_t* query = packet.data();
+    size_t len = packet.length();
+    if (task == nullptr) task = xTaskGetCurrentTaskHandle();
+    stats.queries++;
+
+    size_t question_len = parseQuery(query, len);
+    if (question_len == 0) {
+        stats.dropped++;
+        return;
+    }
+    const uint8_t* question = query + DNS_HEADER_SIZE;
+
+    uint8_t reply[DNS_HEADER_SIZE + 260 + DNS_ANSWER_SIZE];
+    size_t reply_len;
+    const CacheEntry* hit = lookup(question, question_len);
+    if (hit != nullptr) {
+        reply_len = hit->reply_len;
+        memcpy(reply, hit->reply, reply_len);
+        stats.cache_hits++;
+    } else {
+        reply_len = buildReply(question, question_len, reply);
+        store(reply, reply_len, question_len);
+    }
+
+    reply[0] = query[0];                    // ID
+    reply[1] = query[1];
+    reply[2] = 0x84 | (query[2] & 0x01);    // QR, AA, RD as asked
+    reply[3] = 0x80;                        // RA, NOERROR
+    packet.write(reply, reply_len);
+
+    if (reply[7] != 0) stats.answered++;
+    else stats.empty++;
+    stats.latency.record(micros() - start_us);
+}
+
+void CaptiveDns::writeStatsJson(JsonWriter& json) const {
+    CaptiveDnsStats s = stats;
+    json.beginObject();
+    json.addUInt("queries", s.queries);
+    json.addUInt("answered", s.answered);
+    json.addUInt("empty", s.empty);
+    json.addUInt("dropped", s.dropped);
+    json.addUInt("cache_hits", s.cache_hits);
+    json.addUInt("max_us", s.latency.max_us);
+    json.beginArray("latency_bounds_us");
+    for (int k = 0; k < LATENCY_HISTOGRAM_BUCKETS - 1; k++) json.addUInt(LatencyHistogram::bound(k));
+    json.endArray();
+    json.beginArray("latency_counts");
+    for (uint32_t count : s.latency.counts) json.addUInt(count);
+    json.endArray();
+    json.endObject();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "json_writer.h"
+#include "latency_histogram.h"
+
+// Captive portal DNS on AsyncUDP. Every query is answered from the async_udp
+// task as soon as it arrives, independent of loop() and its delay: A queries
+// for any name get the soft AP address, other types (AAAA, HTTPS, ...) an
+// immediate empty answer so a phone does not wait for a timeout before trying
+// IPv4. Replies are kept in a small cache keyed by the question bytes; the
+// connectivity check names phones probe are put in it at start and never
+// evicted, so a hit only patches the ID and flags.
+#define CAPTIVE_DNS_PORT 53
+#define CAPTIVE_DNS_TTL 60                  // seconds
+#define CAPTIVE_DNS_CACHE_SLOTS 16
+#define CAPTIVE_DNS_MAX_QUESTION 64         // longer questions are answered but not cached
+
+struct CaptiveDnsStats {
+    uint32_t queries;
+    uint32_t answered;          // A record returned
+    uint32_t empty;             // other query types, answered without records
+    uint32_t dropped;           // malformed, responses, other opcodes
+    uint32_t cache_hits;
+    LatencyHistogram latency;   // packet received to reply sent
+};
+
+class CaptiveDns {
+private:
+    struct CacheEntry {
+        uint8_t question_len;   // 0 while unused
+        uint8_t reply_len;
+        uint8_t reply[12 + CAPTIVE_DNS_MAX_QUESTION + 16];
+    };
+
+    AsyncUDP udp;
+    uint8_t address[4];
+    CacheEntry cache[CAPTIVE_DNS_CACHE_SLOTS];
+    uint8_t pinned;             // probe entries at the front of cache
+    uint8_t next_victim;
+    CaptiveDnsStats stats;
+    TaskHandle_t task;          // task running the packet handler, once a packet came in
+
+    void handlePacket(AsyncUDPPacket& packet);
+    size_t buildReply(const uint8_t* question, size_t question_len, uint8_t* reply);
+    const CacheEntry* lookup(const uint8_t* question, size_t question_len) const;
+    void store(const uint8_t* reply, size_t reply_len, size_t question_len);
+
+public:
+    CaptiveDns();
+
+    // Answers with ip on port; false if the socket could not be opened
+    bool begin(const IPAddress& ip, uint16_t port = CAPTIVE_DNS_PORT);
+    void stop();
+
+    const CaptiveDnsStats& getStats() const { return stats; }
+    TaskHandle_t getTask() const { return task; }
+    void writeStatsJson(JsonWriter& json) const;
+};
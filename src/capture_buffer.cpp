@@ -0,0 +1,114 @@
+#include "capture_buffer.h"
+#include <string.h>
+
+static_assert(sizeof(CaptureSample) == 8, "CaptureSample must stay packed to 8 bytes");
+static_assert(sizeof(CaptureHeader) == 24, "CaptureHeader layout is part of the download format");
+static_assert((CAPTURE_RING_SAMPLES & (CAPTURE_RING_SAMPLES - 1)) == 0, "Capture ring size must be a power of two");
+static_assert(CAPTURE_DEFAULT_PRE_SAMPLES + CAPTURE_DEFAULT_POST_SAMPLES <= CAPTURE_RING_SAMPLES,
+              "Default capture window exceeds the ring");
+
+CaptureBuffer::CaptureBuffer() {
+    write_count = 0;
+    next_id = 1;
+    armed_pending = false;
+    trigger_index = 0;
+    trigger_time_ms = 0;
+    trigger_output = 0;
+    trigger_state = 0;
+    for (uint8_t i = 0; i < CAPTURE_SLOTS; i++) {
+        slots[i].header.id = 0;
+    }
+    setWindow(CAPTURE_DEFAULT_PRE_SAMPLES, CAPTURE_DEFAULT_POST_SAMPLES);
+}
+
+void CaptureBuffer::setWindow(uint16_t pre, uint16_t post) {
+    // The trigger sample itself takes one place in the window
+    if (pre >= CAPTURE_RING_SAMPLES) pre = CAPTURE_RING_SAMPLES - 1;
+    if (pre + 1 + post > CAPTURE_RING_SAMPLES) post = CAPTURE_RING_SAMPLES - 1 - pre;
+    pre_samples = pre;
+    post_samples = post;
+    armed_pending = false; // A capture in progress used the old window
+}
+
+void CaptureBuffer::addSample(uint32_t now_ms, int16_t raw_distance, int16_t filtered_distance,
+                              uint8_t range_status, uint8_t flags, uint8_t transition_output, bool new_state) {
+    CaptureSample& sample = ring[write_count & (CAPTURE_RING_SAMPLES - 1)];
+    sample.time_ms = (uint16_t)now_ms;
+    sample.raw_distance = raw_distance;
+    sample.filtered_distance = filtered_distance;
+    sample.range_status = range_status;
+    sample.flags = flags;
+
+    // A transition while a capture is still collecting its post window is
+    // already visible in that capture, so it does not start a new one
+    if (transition_output != 0 && !armed_pending) {
+        armed_pending = true;
+        trigger_index = write_count;
+        trigger_time_ms = now_ms;
+        trigger_output = transition_output;
+        trigger_state = new_state ? 1 : 0;
+    }
+
+    write_count++;
+
+    if (armed_pending && write_count - trigger_index > post_samples) {
+        freeze();
+        armed_pending = false;
+    }
+}
+
+void CaptureBuffer::freeze() {
+    // Early triggers may not have a full pre window yet
+    uint32_t pre = pre_samples;
+    if (trigger_index < pre) pre = trigger_index;
+
+    uint32_t first = trigger_index - pre;
+    uint32_t count = write_count - first;
+
+    // Reuse the oldest slot
+    CaptureSlot* slot = &slots[0];
+    for (uint8_t i = 1; i < CAPTURE_SLOTS; i++) {
+        if (slots[i].header.id < slot->header.id) {
+            slot = &slots[i];
+        }
+    }
+
+    // Mark the slot empty while it is rewritten so readers can detect reuse
+    slot->header.id = 0;
+
+    uint32_t start = first & (CAPTURE_RING_SAMPLES - 1);
+    uint32_t head = CAPTURE_RING_SAMPLES - start;
+    if (head > count) head = count;
+    memcpy(slot->samples, &ring[start], head * sizeof(CaptureSample));
+    memcpy(slot->samples + head, ring, (count - head) * sizeof(CaptureSample));
+
+    slot->header.magic = CAPTURE_MAGIC;
+    slot->header.version = CAPTURE_FORMAT_VERSION;
+    slot->header.output = trigger_output;
+    slot->header.new_state = trigger_state;
+    slot->header.sample_size = sizeof(CaptureSample);
+    slot->header.trigger_time_ms = trigger_time_ms;
+    slot->header.pre_samples = (uint16_t)pre;
+    slot->header.sample_count = (uint16_t)count;
+    slot->header.reserved = 0;
+
+    // Publish the capture only after it has been written
+    slot->header.id = next_id++;
+}
+
+const CaptureSlot* CaptureBuffer::getSlot(uint8_t index) {
+    if (index >= CAPTURE_SLOTS || slots[index].header.id == 0) {
+        return nullptr;
+    }
+    return &slots[index];
+}
+
+int CaptureBuffer::findSlot(uint32_t id) {
+    if (id == 0) return -1;
+    for (uint8_t i = 0; i < CAPTURE_SLOTS; i++) {
+        if (slots[i].header.id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pre/post trigger capture ("scope mode") around output transitions.
+//
+// Every sensor sample goes into a full-rate ring in O(1). When an output changes
+// state the trigger position is remembered; once the post-trigger window has
+// filled, the pre + post samples are copied out of the ring into a capture slot
+// in one go. Nothing is copied on the sample path until a trigger completes.
+#define CAPTURE_RING_SAMPLES 256       // power of two, >= pre + post window
+#define CAPTURE_SLOTS 4
+#define CAPTURE_DEFAULT_PRE_SAMPLES 64
+#define CAPTURE_DEFAULT_POST_SAMPLES 32
+
+// Binary download format (little endian), decoded by tools/capture_to_csv.py
+#define CAPTURE_MAGIC 0x54504143UL     // "CAPT"
+#define CAPTURE_FORMAT_VERSION 1
+#define CAPTURE_CONTENT_TYPE "application/octet-stream"
+
+#define CAPTURE_FLAG_OUTPUT1 0x01
+#define CAPTURE_FLAG_OUTPUT2 0x02
+#define CAPTURE_FLAG_OUT_OF_RANGE 0x04
+
+// One sample - 8 bytes
+struct CaptureSample {
+    uint16_t time_ms;       // low 16 bits of millis(); the decoder unwraps it
+    int16_t raw_distance;   // mm, -1 if out of range
+    int16_t filtered_distance;
+    uint8_t range_status;   // VL53L1X range status
+    uint8_t flags;          // CAPTURE_FLAG_*
+};
+
+// Header written in front of the samples of a downloaded capture - 24 bytes
+struct CaptureHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t output;          // output (1 or 2) whose transition triggered the capture
+    uint8_t new_state;       // state the output changed to
+    uint8_t sample_size;     // sizeof(CaptureSample)
+    uint32_t id;             // capture number, increases for every capture
+    uint32_t trigger_time_ms;
+    uint16_t pre_samples;    // samples before the trigger; the trigger sample follows
+    uint16_t sample_count;
+    uint32_t reserved;
+};
+
+struct CaptureSlot {
+    CaptureHeader header;    // header.id == 0 while the slot is empty or being written
+    CaptureSample samples[CAPTURE_RING_SAMPLES];
+};
+
+class CaptureBuffer {
+private:
+    CaptureSample ring[CAPTURE_RING_SAMPLES];
+    uint32_t write_count;        // samples written to the ring, never reset
+
+    CaptureSlot slots[CAPTURE_SLOTS];
+    uint32_t next_id;
+
+    uint16_t pre_samples;
+    uint16_t post_samples;
+
+    // Trigger waiting for its post window
+    bool armed_pending;
+    uint32_t trigger_index;      // write_count of the trigger sample
+    uint32_t trigger_time_ms;
+    uint8_t trigger_output;
+    uint8_t trigger_state;
+
+    void freeze();
+
+public:
+    CaptureBuffer();
+
+    // Clamps pre + post to the ring size
+    void setWindow(uint16_t pre, uint16_t post);
+    uint16_t getPreSamples() { return pre_samples; }
+    uint16_t getPostSamples() { return post_samples; }
+
+    // Records one sample. transition_output is 0, or the output (1/2) that
+    // changed state on this sample. O(1) except when a capture completes.
+    void addSample(uint32_t now_ms, int16_t raw_distance, int16_t filtered_distance,
+                   uint8_t range_status, uint8_t flags, uint8_t transition_output, bool new_state);
+
+    uint8_t getSlotCount() { return CAPTURE_SLOTS; }
+    // Returns nullptr for an empty slot. The slot may be reused by a later
+    // capture; callers re-check header.id after copying it out.
+    const CaptureSlot* getSlot(uint8_t index);
+    int findSlot(uint32_t id);
+};
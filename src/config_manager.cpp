@@ -1,9 +1,8 @@
 #include "config_manager.h"
 
-ConfigManager::ConfigManager() {
-    history_index = 0;
-    history_count = 0;
+ConfigManager::ConfigManager() : history_points(HISTORY_INTERVAL_MS) {
     last_history_time = 0;
+    history_clear_request = false;
     setDefaultConfig();
 }
 
@@ -50,6 +49,11 @@ bool ConfigManager::initialize() {
         saveConfigToFile();
     }
     
+    // Persistent history is optional - the device works without it
+    if (!history_log.begin()) {
+        Serial.println("Persistent history unavailable");
+    }
+    
     return true;
 }
 
@@ -67,12 +71,17 @@ void ConfigManager::setDefaultConfig() {
     device_config.output1_hysteresis = 25;
     device_config.output1_active_in_range = true;
     device_config.output1_enabled = false;
+    device_config.output1_ota_state = OUTPUT_OTA_LIVE;
     
     device_config.output2_min = 0;
     device_config.output2_max = 100;
     device_config.output2_hysteresis = 25;
     device_config.output2_active_in_range = true;
     device_config.output2_enabled = false;
+    device_config.output2_ota_state = OUTPUT_OTA_LIVE;
+    
+    device_config.capture_pre_samples = CAPTURE_DEFAULT_PRE_SAMPLES;
+    device_config.capture_post_samples = CAPTURE_DEFAULT_POST_SAMPLES;
 }
 
 bool ConfigManager::loadConfigFromFile() {
@@ -117,6 +126,8 @@ bool ConfigManager::loadConfigFromFile() {
             device_config.output1_hysteresis = out1["hysteresis"] | 25;
             device_config.output1_active_in_range = out1["active_in_range"] | true;
             device_config.output1_enabled = out1["enabled"] | true;
+            int8_t ota_state = outputOtaStateFromName(out1["ota_state"] | "live");
+            device_config.output1_ota_state = ota_state < 0 ? OUTPUT_OTA_LIVE : ota_state;
         }
         
         if (device["output2"].is<JsonObject>()) {
@@ -126,6 +137,14 @@ bool ConfigManager::loadConfigFromFile() {
             device_config.output2_hysteresis = out2["hysteresis"] | 50;
             device_config.output2_active_in_range = out2["active_in_range"] | false;
             device_config.output2_enabled = out2["enabled"] | true;
+            int8_t ota_state = outputOtaStateFromName(out2["ota_state"] | "live");
+            device_config.output2_ota_state = ota_state < 0 ? OUTPUT_OTA_LIVE : ota_state;
+        }
+        
+        if (device["capture"].is<JsonObject>()) {
+            JsonObject capture = device["capture"];
+            device_config.capture_pre_samples = capture["pre"] | CAPTURE_DEFAULT_PRE_SAMPLES;
+            device_config.capture_post_samples = capture["post"] | CAPTURE_DEFAULT_POST_SAMPLES;
         }
     }
     
@@ -153,6 +172,7 @@ bool ConfigManager::saveConfigToFile() {
     out1["hysteresis"] = device_config.output1_hysteresis;
     out1["active_in_range"] = device_config.output1_active_in_range;
     out1["enabled"] = device_config.output1_enabled;
+    out1["ota_state"] = outputOtaStateName(device_config.output1_ota_state);
     
     JsonObject out2 = device["output2"].to<JsonObject>();
     out2["min"] = device_config.output2_min;
@@ -160,6 +180,11 @@ bool ConfigManager::saveConfigToFile() {
     out2["hysteresis"] = device_config.output2_hysteresis;
     out2["active_in_range"] = device_config.output2_active_in_range;
     out2["enabled"] = device_config.output2_enabled;
+    out2["ota_state"] = outputOtaStateName(device_config.output2_ota_state);
+    
+    JsonObject capture = device["capture"].to<JsonObject>();
+    capture["pre"] = device_config.capture_pre_samples;
+    capture["post"] = device_config.capture_post_samples;
     
     File file = LittleFS.open(CONFIG_FILE_PATH, "w");
     if (!file) {
@@ -179,50 +204,104 @@ bool ConfigManager::saveConfigToFile() {
 }
 
 void ConfigManager::addHistoryPoint(int16_t distance, bool out1_state, bool out2_state) {
-    if (millis() - last_history_time < HISTORY_INTERVAL_MS) {
+    applyHistoryClear();
+    
+    // Every sample is folded into the aggregated tiers
+    history_store.addSample(millis(), distance, out1_state, out2_state);
+    
+    uint32_t now = millis();
+    if (now - last_history_time < HISTORY_INTERVAL_MS) {
         return; // Too soon for next point
     }
     
-    history_buffer[history_index].timestamp = millis();
-    history_buffer[history_index].distance = distance;
-    history_buffer[history_index].output1_state = out1_state;
-    history_buffer[history_index].output2_state = out2_state;
-    
-    history_index = (history_index + 1) % MAX_HISTORY_POINTS;
-    if (history_count < MAX_HISTORY_POINTS) {
-        history_count++;
+    // Keep a fixed cadence so point timestamps stay implicit; after a stall the
+    // schedule restarts at the current time and the packed history opens a new block
+    if (last_history_time != 0 && now - last_history_time < 2 * HISTORY_INTERVAL_MS) {
+        last_history_time += HISTORY_INTERVAL_MS;
+    } else {
+        last_history_time = now;
     }
     
-    last_history_time = millis();
+    history_points.append(last_history_time, distance, out1_state, out2_state);
+    history_log.append(distance, out1_state, out2_state);
 }
 
-String ConfigManager::getHistoryJson() {
-    JsonDocument doc;
-    JsonArray points = doc["points"].to<JsonArray>();
-    
-    // Add points in chronological order
-    uint8_t start_index = (history_count < MAX_HISTORY_POINTS) ? 0 : history_index;
-    for (uint8_t i = 0; i < history_count; i++) {
-        uint8_t idx = (start_index + i) % MAX_HISTORY_POINTS;
-        JsonObject point = points.add<JsonObject>();
-        point["timestamp"] = history_buffer[idx].timestamp;
-        point["distance"] = history_buffer[idx].distance;
-        point["output1"] = history_buffer[idx].output1_state;
-        point["output2"] = history_buffer[idx].output2_state;
+bool ConfigManager::getHistoryPoint(uint32_t seq, HistoryPoint& point) {
+    // Not written yet, cleared or already evicted returns false
+    return history_points.get(seq, point.timestamp, point.distance, point.output1_state, point.output2_state);
+}
+
+uint32_t ConfigManager::getHistoryOldestSeq(int8_t tier) {
+    if (tier == HISTORY_TIER_POINTS) {
+        return history_points.getOldestSeq();
+    }
+    return history_store.getOldestSeq(tier);
+}
+
+uint32_t ConfigManager::getHistoryNextSeq(int8_t tier) {
+    if (tier == HISTORY_TIER_POINTS) {
+        return history_points.getNextSeq();
+    }
+    return history_store.getNextSeq(tier);
+}
+
+uint32_t ConfigManager::getHistoryIntervalMs(int8_t tier) {
+    if (tier == HISTORY_TIER_POINTS) {
+        return HISTORY_INTERVAL_MS;
+    }
+    return history_store.getIntervalMs(tier);
+}
+
+bool ConfigManager::writeHistoryItemJson(JsonWriter& json, int8_t tier, uint32_t seq) {
+    if (tier == HISTORY_TIER_POINTS) {
+        HistoryPoint point;
+        if (!getHistoryPoint(seq, point)) return false;
+        
+        json.beginObject();
+        json.addUInt("seq", seq);
+        json.addUInt("timestamp", point.timestamp);
+        json.addInt("distance", point.distance);
+        json.addBool("output1", point.output1_state);
+        json.addBool("output2", point.output2_state);
+        json.endObject();
+        return true;
     }
     
-    doc["count"] = history_count;
-    doc["current_time"] = millis();
-    
-    String result;
-    serializeJson(doc, result);
-    return result;
+    HistoryBucket bucket;
+    if (!history_store.getBucket(tier, seq, bucket)) return false;
+    
+    json.beginObject();
+    json.addUInt("seq", seq);
+    json.addUInt("timestamp", history_store.getBucketTime(tier, seq));
+    if (bucket.mean_distance == HISTORY_NO_DATA) {
+        json.addNull("min");
+        json.addNull("max");
+        json.addNull("mean");
+    } else {
+        json.addInt("min", bucket.min_distance);
+        json.addInt("max", bucket.max_distance);
+        json.addInt("mean", bucket.mean_distance);
+    }
+    json.addUInt("duty1", bucket.output1_duty);
+    json.addUInt("duty2", bucket.output2_duty);
+    json.endObject();
+    return true;
 }
 
 void ConfigManager::clearHistory() {
-    history_index = 0;
-    history_count = 0;
+    history_clear_request.store(true, std::memory_order_release);
+}
+
+// On the task that adds points: the history stores allow a single writer
+void ConfigManager::applyHistoryClear() {
+    if (!history_clear_request.load(std::memory_order_relaxed)) return;
+    if (!history_clear_request.exchange(false, std::memory_order_acquire)) return;
+    
+    // The sequence keeps counting so client cursors stay valid across a clear
+    history_points.clear();
     last_history_time = 0;
+    history_store.clear();
+    history_log.clear();
 }
 
 void ConfigManager::setWiFiConfig(const WiFiConfig& config) {
@@ -233,11 +312,11 @@ void ConfigManager::setDeviceConfig(const DeviceConfig& config) {
     device_config = config;
 }
 
-bool ConfigManager::validatePassword(const String& password) {
-    return password == wifi_config.admin_password;
+bool ConfigManager::validatePassword(const char* password) {
+    return strcmp(password, wifi_config.admin_password.c_str()) == 0;
 }
 
-void ConfigManager::setAdminPassword(const String& password) {
+void ConfigManager::setAdminPassword(const char* password) {
     wifi_config.admin_password = password;
 }
 
@@ -251,65 +330,37 @@ bool ConfigManager::resetToDefaults() {
     return saveConfigToFile();
 }
 
-String ConfigManager::getConfigJson() {
-    JsonDocument doc;
+void ConfigManager::writeConfigJson(JsonWriter& json) {
+    json.beginObject();
     
     // Device info
-    doc["device_name"] = device_config.device_name;
+    json.addString("device_name", device_config.device_name.c_str());
     
     // Output 1 config
-    JsonObject out1 = doc["output1"].to<JsonObject>();
-    out1["min"] = device_config.output1_min;
-    out1["max"] = device_config.output1_max;
-    out1["hysteresis"] = device_config.output1_hysteresis;
-    out1["active_in_range"] = device_config.output1_active_in_range;
-    out1["enabled"] = device_config.output1_enabled;
+    json.beginObject("output1");
+    json.addUInt("min", device_config.output1_min);
+    json.addUInt("max", device_config.output1_max);
+    json.addUInt("hysteresis", device_config.output1_hysteresis);
+    json.addBool("active_in_range", device_config.output1_active_in_range);
+    json.addBool("enabled", device_config.output1_enabled);
+    json.addString("ota_state", outputOtaStateName(device_config.output1_ota_state));
+    json.endObject();
     
     // Output 2 config
-    JsonObject out2 = doc["output2"].to<JsonObject>();
-    out2["min"] = device_config.output2_min;
-    out2["max"] = device_config.output2_max;
-    out2["hysteresis"] = device_config.output2_hysteresis;
-    out2["active_in_range"] = device_config.output2_active_in_range;
-    out2["enabled"] = device_config.output2_enabled;
-    
-    String result;
-    serializeJson(doc, result);
-    return result;
-}
-
-bool ConfigManager::setConfigFromJson(const String& json) {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, json);
-    
-    if (error) {
-        Serial.print("Failed to parse config JSON: ");
-        Serial.println(error.c_str());
-        return false;
-    }
-    
-    // Update device config
-    if (doc["device_name"].is<String>()) {
-        device_config.device_name = doc["device_name"].as<String>();
-    }
-    
-    if (doc["output1"].is<JsonObject>()) {
-        JsonObject out1 = doc["output1"].to<JsonObject>();
-        device_config.output1_min = out1["min"] | device_config.output1_min;
-        device_config.output1_max = out1["max"] | device_config.output1_max;
-        device_config.output1_hysteresis = out1["hysteresis"] | device_config.output1_hysteresis;
-        device_config.output1_active_in_range = out1["active_in_range"] | device_config.output1_active_in_range;
-        device_config.output1_enabled = out1["enabled"] | device_config.output1_enabled;
-    }
-    
-    if (doc["output2"].is<JsonObject>()) {
-        JsonObject out2 = doc["output2"].to<JsonObject>();
-        device_config.output2_min = out2["min"] | device_config.output2_min;
-        device_config.output2_max = out2["max"] | device_config.output2_max;
-        device_config.output2_hysteresis = out2["hysteresis"] | device_config.output2_hysteresis;
-        device_config.output2_active_in_range = out2["active_in_range"] | device_config.output2_active_in_range;
-        device_config.output2_enabled = out2["enabled"] | device_config.output2_enabled;
-    }
-    
-    return true;
+    json.beginObject("output2");
+    json.addUInt("min", device_config.output2_min);
+    json.addUInt("max", device_config.output2_max);
+    json.addUInt("hysteresis", device_config.output2_hysteresis);
+    json.addBool("active_in_range", device_config.output2_active_in_range);
+    json.addBool("enabled", device_config.output2_enabled);
+    json.addString("ota_state", outputOtaStateName(device_config.output2_ota_state));
+    json.endObject();
+    
+    // Capture window
+    json.beginObject("capture");
+    json.addUInt("pre", device_config.capture_pre_samples);
+    json.addUInt("post", device_config.capture_post_samples);
+    json.endObject();
+    
+    json.endObject();
 }
@@ -4,14 +4,19 @@
 #include <WiFi.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <atomic>
 #include "sys_init.h"
+#include "json_writer.h"
+#include "history_store.h"
+#include "packed_history.h"
+#include "history_log.h"
+#include "device_config.h"
 
 // Default configuration values
 #define DEFAULT_AP_SSID "ProximitySensor"
 #define DEFAULT_AP_PASSWORD "sensor123"
 #define DEFAULT_ADMIN_PASSWORD "admin"
 #define CONFIG_FILE_PATH "/config.json"
-#define HISTORY_FILE_PATH "/history.json"
 
 // WiFi and web server settings
 #define AP_CHANNEL 1
@@ -19,8 +24,9 @@
 #define WEB_SERVER_PORT 80
 
 // History settings
-#define MAX_HISTORY_POINTS 60  // 1 minute at 1Hz
-#define HISTORY_INTERVAL_MS 1000
+#define HISTORY_INTERVAL_MS 1000  // Point cadence; capacity depends on how fast distance changes (see packed_history.h)
+#define HISTORY_JSON_POINT_MAX 112  // Worst case size of one serialized history point/bucket
+#define HISTORY_TIER_POINTS -1      // Tier id of the 1Hz point buffer; 0.. select HistoryStore tiers
 
 struct WiFiConfig {
     String ap_ssid;
@@ -29,21 +35,6 @@ struct WiFiConfig {
     bool ap_enabled;
 };
 
-struct DeviceConfig {
-    String device_name;
-    uint16_t output1_min;
-    uint16_t output1_max;
-    uint16_t output1_hysteresis;
-    bool output1_active_in_range;
-    bool output1_enabled;
-    
-    uint16_t output2_min;
-    uint16_t output2_max;
-    uint16_t output2_hysteresis;
-    bool output2_active_in_range;
-    bool output2_enabled;
-};
-
 struct HistoryPoint {
     uint32_t timestamp;
     int16_t distance;
@@ -55,11 +46,13 @@ class ConfigManager {
 private:
     WiFiConfig wifi_config;
     DeviceConfig device_config;
-    HistoryPoint history_buffer[MAX_HISTORY_POINTS];
-    uint8_t history_index;
-    uint8_t history_count;
+    PackedHistory history_points; // delta-encoded 1Hz points, sequence never reset
+    HistoryStore history_store; // aggregated multi-resolution tiers
+    HistoryLog history_log;     // 1Hz points persisted to LittleFS
     uint32_t last_history_time;
+    std::atomic<bool> history_clear_request;   // set on any task, applied by addHistoryPoint()
     
+    void applyHistoryClear();
     bool loadConfigFromFile();
     bool saveConfigToFile();
     void setDefaultConfig();
@@ -79,18 +72,24 @@ public:
     void setDeviceConfig(const DeviceConfig& config);
     
     // Authentication
-    bool validatePassword(const String& password);
-    void setAdminPassword(const String& password);
+    bool validatePassword(const char* password);
+    void setAdminPassword(const char* password);
     
-    // History management
-    String getHistoryJson();
+    // History management - items are addressed by tier and a monotonic sequence number
+    bool isValidHistoryTier(int8_t tier) { return tier == HISTORY_TIER_POINTS || (tier >= 0 && tier < HISTORY_TIER_COUNT); }
+    uint32_t getHistoryOldestSeq(int8_t tier);
+    uint32_t getHistoryNextSeq(int8_t tier);
+    uint32_t getHistoryIntervalMs(int8_t tier);
+    bool getHistoryPoint(uint32_t seq, HistoryPoint& point);
+    bool writeHistoryItemJson(JsonWriter& json, int8_t tier, uint32_t seq);
+    // Takes effect with the next point: the stores have a single writer
     void clearHistory();
+    HistoryLog* getHistoryLog() { return &history_log; }
     
     // File operations
     bool saveConfig();
     bool resetToDefaults();
     
     // JSON serialization
-    String getConfigJson();
-    bool setConfigFromJson(const String& json);
+    void writeConfigJson(JsonWriter& json);
 };
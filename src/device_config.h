@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include "capture_buffer.h"
+
+// What an output does while a firmware update is written to flash
+enum OutputOtaState : uint8_t {
+    OUTPUT_OTA_LIVE = 0,    // keeps following the samples (default)
+    OUTPUT_OTA_HOLD,        // frozen at its state when the update started
+    OUTPUT_OTA_LOW,         // driven to a fixed level until the update ends
+    OUTPUT_OTA_HIGH,
+};
+
+#define OUTPUT_OTA_STATE_COUNT 4
+
+// Name used in the config file and API, and back; -1 for an unknown name
+inline const char* outputOtaStateName(uint8_t state) {
+    static const char* const names[OUTPUT_OTA_STATE_COUNT] = {"live", "hold", "low", "high"};
+    return state < OUTPUT_OTA_STATE_COUNT ? names[state] : names[OUTPUT_OTA_LIVE];
+}
+
+inline int8_t outputOtaStateFromName(const char* name) {
+    for (uint8_t state = 0; state < OUTPUT_OTA_STATE_COUNT; state++) {
+        if (name != nullptr && strcmp(name, outputOtaStateName(state)) == 0) return (int8_t)state;
+    }
+    return -1;
+}
+
+// Output and capture settings shared by ConfigManager (persistence) and
+// SensorManager (runtime). Kept free of storage and network dependencies so
+// the sensor path also builds for the native host target.
+struct DeviceConfig {
+    String device_name;
+    uint16_t output1_min;
+    uint16_t output1_max;
+    uint16_t output1_hysteresis;
+    bool output1_active_in_range;
+    bool output1_enabled;
+    uint8_t output1_ota_state;      // OutputOtaState
+    
+    uint16_t output2_min;
+    uint16_t output2_max;
+    uint16_t output2_hysteresis;
+    bool output2_active_in_range;
+    bool output2_enabled;
+    uint8_t output2_ota_state;
+    
+    uint16_t capture_pre_samples;   // scope mode window around output transitions
+    uint16_t capture_post_samples;
+};
@@ -0,0 +1,356 @@
+#include "gzip_decoder.h"
+#include <string.h>
+#include <esp_rom_crc.h>
+
+#define GZIP_FLAG_HCRC 0x02
+#define GZIP_FLAG_EXTRA 0x04
+#define GZIP_FLAG_NAME 0x08
+#define GZIP_FLAG_COMMENT 0x10
+#define GZIP_FLAG_RESERVED 0xE0
+#define GZIP_METHOD_DEFLATE 8
+#define GZIP_SYMBOL_BITS_MAX 48     // literal/length code, extra bits, distance code, extra bits
+
+// Base values and extra bits of length symbols 257..285 and distance symbols
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order code length code lengths are sent in
+static const uint8_t code_length_order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+GzipDecoder::GzipDecoder() {
+    begin(nullptr, nullptr);
+}
+
+void GzipDecoder::begin(Sink output, void* context) {
+    sink = output;
+    sink_context = context;
+    state = STATE_HEADER;
+    error = GZIP_OK;
+    last_block = false;
+    finishing = false;
+    input_len = 0;
+    input_pos = 0;
+    bit_buffer = 0;
+    bit_count = 0;
+    overrun = false;
+    out_pos = 0;
+    flushed = 0;
+    crc = 0;
+    stored_left = 0;
+}
+
+bool GzipDecoder::fail(GzipError reason) {
+    if (state != STATE_FAILED) error = reason;
+    state = STATE_FAILED;
+    return false;
+}
+
+// Next count bits, LSB first. Callers check haveBits() first; past the end
+// of the input (only once finishing) it sets overrun and returns 0.
+uint32_t GzipDecoder::bits(uint8_t count) {
+    uint32_t value = bit_buffer;
+    while (bit_count < count) {
+        if (input_pos >= input_len) {
+            overrun = true;
+            return 0;
+        }
+        value |= (uint32_t)input[input_pos++] << bit_count;
+        bit_count += 8;
+    }
+    bit_buffer = value >> count;
+    bit_count -= count;
+    return value & ((1UL << count) - 1);
+}
+
+int GzipDecoder::decodeSymbol(const Huffman& code) {
+    int value = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len < 16; len++) {
+        value |= bits(1);
+        int count = code.count[len];
+        if (value - count < first) return code.symbol[index + (value - first)];
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return -1;
+}
+
+// 0 for a complete code, > 0 if incomplete, < 0 if over-subscribed
+int GzipDecoder::buildHuffman(Huffman& code, const uint8_t* lengths, int n) {
+    memset(code.count, 0, sizeof(code.count));
+    for (int s = 0; s < n; s++) code.count[lengths[s]]++;
+    if (code.count[0] == n) return 0;
+
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left = (left << 1) - code.count[len];
+        if (left < 0) return left;
+    }
+
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (int len = 1; len < 15; len++) offsets[len + 1] = offsets[len] + code.count[len];
+    for (int s = 0; s < n; s++) {
+        if (lengths[s] != 0) code.symbol[offsets[lengths[s]]++] = (uint16_t)s;
+    }
+    return left;
+}
+
+bool GzipDecoder::flush() {
+    uint32_t len = out_pos - flushed;
+    if (len == 0) return true;
+    const uint8_t* data = window + (flushed & (GZIP_WINDOW_SIZE - 1));
+    crc = esp_rom_crc32_le(crc, data, len);
+    flushed = out_pos;
+    if (!sink(sink_context, data, len)) return fail(GZIP_ERROR_SINK);
+    return true;
+}
+
+bool GzipDecoder::put(uint8_t byte) {
+    window[out_pos & (GZIP_WINDOW_SIZE - 1)] = byte;
+    out_pos++;
+    if ((out_pos & (GZIP_FLUSH_SIZE - 1)) == 0) return flush();
+    return true;
+}
+
+// Fixed part, then the optional extra field, name, comment and header CRC;
+// the whole header has to be staged at once
+bool GzipDecoder::readHeader() {
+    const uint8_t* p = input + input_pos;
+    size_t n = available();
+    size_t pos = 10;
+    bool complete = n >= pos;
+    if (complete) {
+        if (p[0] != 0x1F || p[1] != 0x8B || p[2] != GZIP_METHOD_DEFLATE || (p[3] & GZIP_FLAG_RESERVED) != 0) {
+            return fail(GZIP_ERROR_HEADER);
+        }
+        uint8_t flags = p[3];
+        if (flags & GZIP_FLAG_EXTRA) {
+            if (n < pos + 2) complete = false;
+            else pos += 2 + (p[pos] | (p[pos + 1] << 8));
+        }
+        static const uint8_t strings[2] = {GZIP_FLAG_NAME, GZIP_FLAG_COMMENT};
+        for (uint8_t flag : strings) {
+            if (!complete || !(flags & flag)) continue;
+            while (pos < n && p[pos] != 0) pos++;
+            if (pos >= n) complete = false;
+            else pos++;
+        }
+        if (flags & GZIP_FLAG_HCRC) pos += 2;
+        if (pos > n) complete = false;
+    }
+    if (!complete) {
+        if (finishing) return fail(GZIP_ERROR_TRUNCATED);
+        if (input_pos == 0 && input_len == GZIP_INPUT_SIZE) return fail(GZIP_ERROR_HEADER);
+        return false;
+    }
+    input_pos += pos;
+    state = STATE_BLOCK;
+    return true;
+}
+
+bool GzipDecoder::readDynamicTables() {
+    uint8_t lengths[286 + 30];
+    int literal_count = bits(5) + 257;
+    int distance_count = bits(5) + 1;
+    int length_count = bits(4) + 4;
+    if (literal_count > 286 || distance_count > 30) return fail(GZIP_ERROR_DATA);
+
+    memset(lengths, 0, 19);
+    for (int i = 0; i < length_count; i++) lengths[code_length_order[i]] = (uint8_t)bits(3);
+    if (buildHuffman(lencode, lengths, 19) != 0) return fail(GZIP_ERROR_DATA);
+
+    int index = 0;
+    while (index < literal_count + distance_count) {
+        int symbol = decodeSymbol(lencode);
+        if (overrun) return fail(GZIP_ERROR_TRUNCATED);
+        if (symbol < 0) return fail(GZIP_ERROR_DATA);
+        if (symbol < 16) {
+            lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+        uint8_t len = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) return fail(GZIP_ERROR_DATA);
+            len = lengths[index - 1];
+            repeat = 3 + bits(2);
+        } else if (symbol == 17) {
+            repeat = 3 + bits(3);
+        } else {
+            repeat = 11 + bits(7);
+        }
+        if (index + repeat > literal_count + distance_count) return fail(GZIP_ERROR_DATA);
+        while (repeat-- > 0) lengths[index++] = len;
+    }
+    if (lengths[256] == 0) return fail(GZIP_ERROR_DATA);
+
+    // Incomplete codes are only allowed with a single code
+    int left = buildHuffman(lencode, lengths, literal_count);
+    if (left < 0 || (left > 0 && literal_count - lencode.count[0] != 1)) return fail(GZIP_ERROR_DATA);
+    left = buildHuffman(distcode, lengths + literal_count, distance_count);
+    if (left < 0 || (left > 0 && distance_count - distcode.count[0] != 1)) return fail(GZIP_ERROR_DATA);
+    return true;
+}
+
+bool GzipDecoder::readBlockHeader() {
+    if (!haveBits(GZIP_BLOCK_HEADER_MAX * 8)) return false;
+    last_block = bits(1) != 0;
+    uint32_t type = bits(2);
+
+    if (type == 0) {
+        // Stored: LEN and its complement from the next byte boundary
+        bit_buffer = 0;
+        bit_count = 0;
+        uint32_t len = bits(16);
+        uint32_t complement = bits(16);
+        if (overrun) return fail(GZIP_ERROR_TRUNCATED);
+        if ((len ^ 0xFFFF) != complement) return fail(GZIP_ERROR_DATA);
+        stored_left = len;
+        state = STATE_STORED;
+        return true;
+    }
+
+    if (type == 1) {
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 256 - 144);
+        memset(lengths + 256, 7, 280 - 256);
+        memset(lengths + 280, 8, 288 - 280);
+        buildHuffman(lencode, lengths, 288);
+        memset(lengths, 5, 30);
+        buildHuffman(distcode, lengths, 30);
+    } else if (type == 2) {
+        if (!readDynamicTables()) return false;
+    } else {
+        return fail(GZIP_ERROR_DATA);
+    }
+    if (overrun) return fail(GZIP_ERROR_TRUNCATED);
+    state = STATE_CODES;
+    return true;
+}
+
+bool GzipDecoder::copyStored() {
+    while (stored_left > 0) {
+        if (input_pos >= input_len) return finishing ? fail(GZIP_ERROR_TRUNCATED) : false;
+        if (!put(input[input_pos++])) return false;
+        stored_left--;
+    }
+    state = last_block ? STATE_TRAILER : STATE_BLOCK;
+    return true;
+}
+
+bool GzipDecoder::decodeCodes() {
+    while (haveBits(GZIP_SYMBOL_BITS_MAX)) {
+        int symbol = decodeSymbol(lencode);
+        if (overrun) return fail(GZIP_ERROR_TRUNCATED);
+        if (symbol < 0) return fail(GZIP_ERROR_DATA);
+        if (symbol < 256) {
+            if (!put((uint8_t)symbol)) return false;
+            continue;
+        }
+        if (symbol == 256) {
+            state = last_block ? STATE_TRAILER : STATE_BLOCK;
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29) return fail(GZIP_ERROR_DATA);
+        uint32_t len = length_base[symbol] + bits(length_extra[symbol]);
+        int code = decodeSymbol(distcode);
+        if (code < 0 || code >= 30) return fail(overrun ? GZIP_ERROR_TRUNCATED : GZIP_ERROR_DATA);
+        uint32_t distance = distance_base[code] + bits(distance_extra[code]);
+        if (overrun) return fail(GZIP_ERROR_TRUNCATED);
+        if (distance > GZIP_WINDOW_SIZE || distance > out_pos) return fail(GZIP_ERROR_DISTANCE);
+        while (len-- > 0) {
+            if (!put(window[(out_pos - distance) & (GZIP_WINDOW_SIZE - 1)])) return false;
+        }
+    }
+    return false;
+}
+
+// CRC-32 and length of the data, from the next byte boundary
+bool GzipDecoder::readTrailer() {
+    bit_buffer = 0;
+    bit_count = 0;
+    if (available() < 8) return finishing ? fail(GZIP_ERROR_TRUNCATED) : false;
+    if (!flush()) return false;
+
+    const uint8_t* p = input + input_pos;
+    uint32_t check = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    uint32_t size = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+    input_pos += 8;
+    if (check != crc || size != out_pos) return fail(GZIP_ERROR_CHECK);
+    state = STATE_DONE;
+    return true;
+}
+
+// Decodes as far as the staged input allows
+void GzipDecoder::run() {
+    bool progress = true;
+    while (progress) {
+        switch (state) {
+            case STATE_HEADER: progress = readHeader(); break;
+            case STATE_BLOCK: progress = readBlockHeader(); break;
+            case STATE_STORED: progress = copyStored(); break;
+            case STATE_CODES: progress = decodeCodes(); break;
+            case STATE_TRAILER: progress = readTrailer(); break;
+            default: return;
+        }
+    }
+}
+
+bool GzipDecoder::write(const uint8_t* data, size_t len) {
+    while (len > 0 && state != STATE_FAILED) {
+        if (state == STATE_DONE) return fail(GZIP_ERROR_TRAILING);
+        if (input_pos > 0) {
+            input_len -= input_pos;
+            memmove(input, input + input_pos, input_len);
+            input_pos = 0;
+        }
+        size_t take = GZIP_INPUT_SIZE - input_len;
+        if (take > len) take = len;
+        memcpy(input + input_len, data, take);
+        input_len += take;
+        data += take;
+        len -= take;
+        run();
+    }
+    return state != STATE_FAILED;
+}
+
+bool GzipDecoder::end() {
+    if (state == STATE_FAILED) return false;
+    finishing = true;
+    run();
+    if (state == STATE_FAILED) return false;
+    if (state != STATE_DONE) return fail(GZIP_ERROR_TRUNCATED);
+    if (available() > 0) return fail(GZIP_ERROR_TRAILING);
+    return true;
+}
+
+const char* GzipDecoder::errorString(GzipError error) {
+    switch (error) {
+        case GZIP_OK: return "No error";
+        case GZIP_ERROR_HEADER: return "Not a gzip stream";
+        case GZIP_ERROR_DATA: return "Corrupt compressed data";
+        case GZIP_ERROR_DISTANCE: return "Compressed with a window larger than 8 KB";
+        case GZIP_ERROR_TRUNCATED: return "Compressed data ends early";
+        case GZIP_ERROR_TRAILING: return "Data after the end of the compressed stream";
+        case GZIP_ERROR_CHECK: return "CRC or length of the decompressed data does not match";
+        case GZIP_ERROR_SINK: return "Output refused";
+        default: return "Unknown error";
+    }
+}
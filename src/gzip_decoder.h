@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming gzip (RFC 1952/1951) decoder with bounded memory, for compressed
+// OTA images.
+//
+// Compressed bytes are pushed in as they arrive, split anywhere. Output goes
+// to a sink in GZIP_FLUSH_SIZE pieces (the flash page size) from a circular
+// window of GZIP_WINDOW_SIZE bytes, which is also the LZ77 dictionary: streams
+// must be compressed with a window no larger than that (zlib wbits 13, as
+// tools/ota_pack.py does), a longer back reference fails the stream. Input is
+// staged in GZIP_INPUT_SIZE bytes so a symbol or block header never has to be
+// resumed halfway; Huffman codes are decoded canonically, bit by bit. The
+// CRC-32 and length in the gzip trailer are checked at the end.
+#define GZIP_WINDOW_BITS 13
+#define GZIP_WINDOW_SIZE (1 << GZIP_WINDOW_BITS)
+#define GZIP_FLUSH_SIZE 4096
+#define GZIP_INPUT_SIZE 1024
+#define GZIP_BLOCK_HEADER_MAX 600       // bytes a dynamic block header can take
+
+enum GzipError : uint8_t {
+    GZIP_OK = 0,
+    GZIP_ERROR_HEADER,          // not gzip, not deflate, or a header too long to stage
+    GZIP_ERROR_DATA,            // invalid block type, code lengths or symbol
+    GZIP_ERROR_DISTANCE,        // back reference beyond the window or the start
+    GZIP_ERROR_TRUNCATED,
+    GZIP_ERROR_TRAILING,        // bytes after the end of the stream
+    GZIP_ERROR_CHECK,           // CRC-32 or length mismatch
+    GZIP_ERROR_SINK,            // the sink refused output
+};
+
+class GzipDecoder {
+public:
+    // Returns false to stop decoding
+    typedef bool (*Sink)(void* context, const uint8_t* data, size_t len);
+
+    static bool isGzip(const uint8_t* data, size_t len) { return len >= 2 && data[0] == 0x1F && data[1] == 0x8B; }
+
+private:
+    enum State : uint8_t { STATE_HEADER, STATE_BLOCK, STATE_STORED, STATE_CODES, STATE_TRAILER, STATE_DONE, STATE_FAILED };
+
+    // Canonical Huffman code: codes per length, symbols ordered by code
+    struct Huffman {
+        uint16_t count[16];
+        uint16_t symbol[288];
+    };
+
+    Sink sink;
+    void* sink_context;
+    State state;
+    GzipError error;
+    bool last_block;
+    bool finishing;             // no more input will come
+
+    uint8_t input[GZIP_INPUT_SIZE];
+    size_t input_len;
+    size_t input_pos;
+    uint32_t bit_buffer;
+    uint8_t bit_count;
+    bool overrun;               // a read went past the input
+
+    uint8_t window[GZIP_WINDOW_SIZE];
+    uint32_t out_pos;           // total bytes decoded
+    uint32_t flushed;           // total bytes handed to the sink
+    uint32_t crc;
+    uint32_t stored_left;
+
+    Huffman lencode;
+    Huffman distcode;
+
+    size_t available() const { return input_len - input_pos; }
+    bool haveBits(uint32_t bits) const { return finishing || (uint32_t)available() * 8 + bit_count >= bits; }
+    uint32_t bits(uint8_t count);
+    int decodeSymbol(const Huffman& code);
+    static int buildHuffman(Huffman& code, const uint8_t* lengths, int n);
+
+    bool fail(GzipError reason);
+    bool put(uint8_t byte);
+    bool flush();
+    void run();
+    bool readHeader();
+    bool readBlockHeader();
+    bool readDynamicTables();
+    bool copyStored();
+    bool decodeCodes();
+    bool readTrailer();
+
+public:
+    GzipDecoder();
+
+    void begin(Sink output, void* context);
+    bool write(const uint8_t* data, size_t len);
+    // After the last input: false unless the stream ended with a good trailer
+    bool end();
+
+    GzipError getError() const { return error; }
+    static const char* errorString(GzipError error);
+    uint32_t getDecodedSize() const { return out_pos; }
+};
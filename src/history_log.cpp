@@ -0,0 +1,414 @@
+#include "history_log.h"
+#include <esp_timer.h>
+
+static_assert(sizeof(HistoryLogRecord) == 8, "HistoryLogRecord must stay packed to 8 bytes");
+static_assert(HISTORY_LOG_PAGE_BYTES % sizeof(HistoryLogRecord) == 0, "Pages must hold whole records");
+static_assert(HISTORY_LOG_MAX_SEGMENTS >= 2, "History log budget must hold at least two segments");
+
+uint8_t HistoryLog::checksum(const HistoryLogRecord& record) {
+    const uint8_t* bytes = (const uint8_t*)&record;
+    uint8_t crc = 0;
+    for (size_t i = 0; i < offsetof(HistoryLogRecord, check); i++) {
+        crc ^= bytes[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void HistoryLog::segmentPath(char* path, size_t len, uint32_t id, const char* ext) {
+    snprintf(path, len, HISTORY_LOG_DIR "/%08lx.%s", (unsigned long)id, ext);
+}
+
+HistoryLog::HistoryLog() {
+    fill_page = 0;
+    fill_count = 0;
+    flush_page = 0;
+    flush_pending = false;
+    clear_pending = false;
+    dropped_pages = 0;
+    segment_count = 0;
+    head_pages = 0;
+    head_open = false;
+    next_segment_id = 0;
+    time_offset_s = 0;
+    lock = nullptr;
+    task = nullptr;
+    started = false;
+}
+
+uint32_t HistoryLog::now() {
+    return (uint32_t)(esp_timer_get_time() / 1000000ULL) + time_offset_s;
+}
+
+bool HistoryLog::begin() {
+    if (!LittleFS.exists(HISTORY_LOG_DIR) && !LittleFS.mkdir(HISTORY_LOG_DIR)) {
+        Serial.println("[HISTORY] Failed to create log directory");
+        return false;
+    }
+
+    lock = xSemaphoreCreateMutex();
+    if (lock == nullptr) {
+        return false;
+    }
+
+    recover();
+
+    if (xTaskCreate(taskEntry, "history_log", HISTORY_LOG_TASK_STACK, this,
+                    HISTORY_LOG_TASK_PRIORITY, &task) != pdPASS) {
+        Serial.println("[HISTORY] Failed to start writer task");
+        return false;
+    }
+
+    started = true;
+    Serial.printf("[HISTORY] %u segments on flash, log time %lu s\n",
+                  segment_count, (unsigned long)now());
+    return true;
+}
+
+void HistoryLog::recover() {
+    // Collect segment ids, keeping the newest HISTORY_LOG_MAX_SEGMENTS
+    File dir = LittleFS.open(HISTORY_LOG_DIR);
+    File entry = dir.openNextFile();
+    while (entry) {
+        const char* name = entry.name();
+        const char* slash = strrchr(name, '/');
+        if (slash) name = slash + 1;
+        size_t name_len = strlen(name);
+
+        if (name_len == 12 && strcmp(name + 8, ".seg") == 0) {
+            uint32_t id = strtoul(name, nullptr, 16);
+            if (segment_count == HISTORY_LOG_MAX_SEGMENTS) {
+                // Over budget (e.g. the budget shrank) - drop the oldest
+                uint32_t drop_id = id;
+                if (id > segments[0].id) {
+                    drop_id = segments[0].id;
+                    memmove(&segments[0], &segments[1], (segment_count - 1) * sizeof(HistoryLogSegment));
+                    segment_count--;
+                }
+                char path[32];
+                segmentPath(path, sizeof(path), drop_id, "seg");
+                LittleFS.remove(path);
+                segmentPath(path, sizeof(path), drop_id, "idx");
+                LittleFS.remove(path);
+            }
+            if (segment_count < HISTORY_LOG_MAX_SEGMENTS) {
+                // Insertion sort by id, oldest first
+                uint8_t pos = segment_count;
+                while (pos > 0 && segments[pos - 1].id > id) {
+                    segments[pos] = segments[pos - 1];
+                    pos--;
+                }
+                segments[pos].id = id;
+                segments[pos].first_time_s = 0;
+                segment_count++;
+            }
+            if (id >= next_segment_id) {
+                next_segment_id = id + 1;
+            }
+        }
+        entry = dir.openNextFile();
+    }
+
+    // First page time of each segment comes from its index; segments that never
+    // got a complete page (power lost right after creation) are removed
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < segment_count; i++) {
+        char path[32];
+        segmentPath(path, sizeof(path), segments[i].id, "idx");
+        File idx = LittleFS.open(path, "r");
+        uint32_t first_time_s = 0;
+        bool valid = idx && idx.read((uint8_t*)&first_time_s, sizeof(first_time_s)) == sizeof(first_time_s);
+        idx.close();
+        if (!valid) {
+            LittleFS.remove(path);
+            segmentPath(path, sizeof(path), segments[i].id, "seg");
+            LittleFS.remove(path);
+            continue;
+        }
+        segments[kept].id = segments[i].id;
+        segments[kept].first_time_s = first_time_s;
+        kept++;
+    }
+    segment_count = kept;
+
+    // The newest valid record sets the time base for this boot
+    uint32_t last_time_s = 0;
+    for (int i = segment_count - 1; i >= 0 && last_time_s == 0; i--) {
+        char path[32];
+        segmentPath(path, sizeof(path), segments[i].id, "seg");
+        File seg = LittleFS.open(path, "r");
+        if (!seg) continue;
+
+        int32_t page_index = (int32_t)(seg.size() / HISTORY_LOG_PAGE_BYTES) - 1;
+        HistoryLogRecord page[HISTORY_LOG_RECORDS_PER_PAGE];
+        for (; page_index >= 0 && last_time_s == 0; page_index--) {
+            seg.seek(page_index * HISTORY_LOG_PAGE_BYTES);
+            if (seg.read((uint8_t*)page, sizeof(page)) != sizeof(page)) break;
+            for (int r = HISTORY_LOG_RECORDS_PER_PAGE - 1; r >= 0; r--) {
+                if (page[r].check == checksum(page[r])) {
+                    last_time_s = page[r].time_s;
+                    break;
+                }
+            }
+        }
+    }
+
+    uint32_t uptime_s = (uint32_t)(esp_timer_get_time() / 1000000ULL);
+    if (last_time_s >= uptime_s) {
+        time_offset_s = last_time_s + 1 - uptime_s;
+    }
+}
+
+void HistoryLog::append(int16_t distance, bool output1, bool output2) {
+    if (!started) return;
+
+    HistoryLogRecord& record = pages[fill_page][fill_count];
+    record.time_s = now();
+    record.distance = distance;
+    record.flags = (output1 ? HISTORY_LOG_FLAG_OUTPUT1 : 0) | (output2 ? HISTORY_LOG_FLAG_OUTPUT2 : 0);
+    record.check = checksum(record);
+
+    if (++fill_count < HISTORY_LOG_RECORDS_PER_PAGE) {
+        return;
+    }
+    fill_count = 0;
+
+    if (flush_pending) {
+        // Writer has not finished the previous page; refill this one instead of blocking
+        dropped_pages++;
+        return;
+    }
+    flush_page = fill_page;
+    flush_pending = true;
+    fill_page ^= 1;
+    xTaskNotifyGive(task);
+}
+
+void HistoryLog::clear() {
+    if (!started) return;
+    clear_pending = true;
+    xTaskNotifyGive(task);
+}
+
+void HistoryLog::taskEntry(void* arg) {
+    static_cast<HistoryLog*>(arg)->taskLoop();
+}
+
+void HistoryLog::taskLoop() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (clear_pending) {
+            removeAll();
+            clear_pending = false;
+        }
+        if (flush_pending) {
+            writePage(pages[flush_page]);
+            flush_pending = false;
+        }
+    }
+}
+
+bool HistoryLog::openNewSegment(uint32_t first_time_s) {
+    segment_file.close();
+    index_file.close();
+
+    char path[32];
+    if (segment_count == HISTORY_LOG_MAX_SEGMENTS) {
+        // Rotate the oldest segment out of the budget
+        xSemaphoreTake(lock, portMAX_DELAY);
+        uint32_t old_id = segments[0].id;
+        memmove(&segments[0], &segments[1], (segment_count - 1) * sizeof(HistoryLogSegment));
+        segment_count--;
+        xSemaphoreGive(lock);
+
+        segmentPath(path, sizeof(path), old_id, "seg");
+        LittleFS.remove(path);
+        segmentPath(path, sizeof(path), old_id, "idx");
+        LittleFS.remove(path);
+    }
+
+    uint32_t id = next_segment_id++;
+    segmentPath(path, sizeof(path), id, "seg");
+    segment_file = LittleFS.open(path, "w");
+    segmentPath(path, sizeof(path), id, "idx");
+    index_file = LittleFS.open(path, "w");
+    if (!segment_file || !index_file) {
+        Serial.println("[HISTORY] Failed to create segment");
+        segment_file.close();
+        index_file.close();
+        return false;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    segments[segment_count].id = id;
+    segments[segment_count].first_time_s = first_time_s;
+    segment_count++;
+    xSemaphoreGive(lock);
+
+    head_pages = 0;
+    head_open = true;
+    return true;
+}
+
+void HistoryLog::writePage(const HistoryLogRecord* page) {
+    // Segments from a previous boot are never appended to, so a torn tail
+    // page from a power loss can only ever be the last page of a segment
+    if (!head_open || head_pages >= HISTORY_LOG_SEGMENT_PAGES) {
+        if (!openNewSegment(page[0].time_s)) return;
+    }
+
+    if (segment_file.write((const uint8_t*)page, HISTORY_LOG_PAGE_BYTES) != HISTORY_LOG_PAGE_BYTES) {
+        Serial.println("[HISTORY] Segment write failed");
+        head_open = false;
+        return;
+    }
+    segment_file.flush();
+
+    // Index entry goes in after its page so it never points past the data
+    index_file.write((const uint8_t*)&page[0].time_s, sizeof(uint32_t));
+    index_file.flush();
+    head_pages++;
+}
+
+void HistoryLog::removeAll() {
+    segment_file.close();
+    index_file.close();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t count = segment_count;
+    uint32_t ids[HISTORY_LOG_MAX_SEGMENTS];
+    for (uint8_t i = 0; i < count; i++) {
+        ids[i] = segments[i].id;
+    }
+    segment_count = 0;
+    xSemaphoreGive(lock);
+
+    char path[32];
+    for (uint8_t i = 0; i < count; i++) {
+        segmentPath(path, sizeof(path), ids[i], "seg");
+        LittleFS.remove(path);
+        segmentPath(path, sizeof(path), ids[i], "idx");
+        LittleFS.remove(path);
+    }
+    head_open = false;
+    Serial.println("[HISTORY] Log cleared");
+}
+
+bool HistoryLog::openRange(HistoryLogCursor& cursor, uint32_t from_s, uint32_t to_s) {
+    cursor.from_s = from_s;
+    cursor.to_s = to_s;
+    cursor.segment_total = 0;
+    cursor.done = true;
+    if (!started) return false;
+
+    // Snapshot the segment list; the newest segment that starts at or before
+    // from_s is the first one that can hold matching records
+    uint8_t first = 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < segment_count; i++) {
+        cursor.segment_ids[i] = segments[i].id;
+        if (segments[i].first_time_s <= from_s) {
+            first = i;
+        }
+    }
+    cursor.segment_total = segment_count;
+    xSemaphoreGive(lock);
+
+    if (cursor.segment_total == 0) return true;
+
+    // Binary search the page index for the last page starting at or before from_s
+    char path[32];
+    segmentPath(path, sizeof(path), cursor.segment_ids[first], "idx");
+    File idx = LittleFS.open(path, "r");
+    uint32_t page_index = 0;
+    if (idx) {
+        uint32_t lo = 0;
+        uint32_t hi = idx.size() / sizeof(uint32_t);
+        while (hi - lo > 1) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            uint32_t mid_time = 0;
+            idx.seek(mid * sizeof(uint32_t));
+            if (idx.read((uint8_t*)&mid_time, sizeof(mid_time)) != sizeof(mid_time)) break;
+            if (mid_time <= from_s) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        page_index = lo;
+    }
+
+    cursor.done = false;
+    return cursor.openSegment(first, page_index);
+}
+
+HistoryLogCursor::HistoryLogCursor() {
+    segment_total = 0;
+    segment_index = 0;
+    from_s = 0;
+    to_s = 0;
+    page_count = 0;
+    page_pos = 0;
+    done = true;
+}
+
+bool HistoryLogCursor::openSegment(uint8_t index, uint32_t page_index) {
+    file.close();
+    page_count = 0;
+    page_pos = 0;
+    segment_index = index;
+    if (index >= segment_total) {
+        done = true;
+        return false;
+    }
+
+    char path[32];
+    HistoryLog::segmentPath(path, sizeof(path), segment_ids[index], "seg");
+    file = LittleFS.open(path, "r");
+    if (!file) {
+        // Rotated out since the snapshot - move on to the next one
+        return openSegment(index + 1, 0);
+    }
+    file.seek(page_index * HISTORY_LOG_PAGE_BYTES);
+    return true;
+}
+
+bool HistoryLogCursor::loadPage() {
+    while (!done) {
+        if (file && file.read((uint8_t*)page, sizeof(page)) == sizeof(page)) {
+            page_count = HISTORY_LOG_RECORDS_PER_PAGE;
+            page_pos = 0;
+            return true;
+        }
+        // End of segment (a short trailing page is a torn write and is skipped)
+        openSegment(segment_index + 1, 0);
+    }
+    return false;
+}
+
+bool HistoryLogCursor::next(HistoryLogRecord& record) {
+    while (!done) {
+        if (page_pos >= page_count && !loadPage()) {
+            break;
+        }
+
+        const HistoryLogRecord& candidate = page[page_pos++];
+        if (candidate.check != HistoryLog::checksum(candidate)) {
+            continue;
+        }
+        if (candidate.time_s < from_s) {
+            continue;
+        }
+        if (candidate.time_s > to_s) {
+            done = true;
+            file.close();
+            break;
+        }
+        record = candidate;
+        return true;
+    }
+    return false;
+}
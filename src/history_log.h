@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+// Persistent history log on LittleFS.
+//
+// Records are batched in RAM and written one flash page at a time by a
+// background task, so the sample loop never touches the filesystem. Pages are
+// appended to fixed-size segment files; each segment has a companion .idx file
+// holding the time of the first record of every page, which lets a range query
+// binary search to the right page in a few reads. When the size budget is
+// reached the oldest segment is deleted.
+//
+// Time is in log seconds: uptime plus an offset recovered from the newest record
+// at boot, so it keeps increasing across reboots and power cycles.
+#define HISTORY_LOG_DIR "/history"
+#define HISTORY_LOG_PAGE_BYTES 256
+#define HISTORY_LOG_SEGMENT_PAGES 128   // 32 KB per segment
+#define HISTORY_LOG_BUDGET_BYTES 262144 // total flash used by segments
+#define HISTORY_LOG_SEGMENT_BYTES (HISTORY_LOG_PAGE_BYTES * HISTORY_LOG_SEGMENT_PAGES)
+#define HISTORY_LOG_MAX_SEGMENTS (HISTORY_LOG_BUDGET_BYTES / HISTORY_LOG_SEGMENT_BYTES)
+#define HISTORY_LOG_TASK_STACK 4096
+#define HISTORY_LOG_TASK_PRIORITY 1
+
+#define HISTORY_LOG_FLAG_OUTPUT1 0x01
+#define HISTORY_LOG_FLAG_OUTPUT2 0x02
+
+// One logged point - 8 bytes
+struct HistoryLogRecord {
+    uint32_t time_s;   // log seconds
+    int16_t distance;  // mm, -1 if out of range
+    uint8_t flags;     // HISTORY_LOG_FLAG_*
+    uint8_t check;     // CRC-8 of the other bytes; rejects torn or erased pages
+};
+
+#define HISTORY_LOG_RECORDS_PER_PAGE (HISTORY_LOG_PAGE_BYTES / sizeof(HistoryLogRecord))
+
+struct HistoryLogSegment {
+    uint32_t id;
+    uint32_t first_time_s;
+};
+
+class HistoryLog;
+
+// Sequential reader over a time range, used by the web server to stream a
+// query. Holds one page of records; segments are opened as they are reached.
+class HistoryLogCursor {
+private:
+    friend class HistoryLog;
+
+    uint32_t segment_ids[HISTORY_LOG_MAX_SEGMENTS];
+    uint8_t segment_total;
+    uint8_t segment_index;
+    uint32_t from_s;
+    uint32_t to_s;
+    File file;
+    HistoryLogRecord page[HISTORY_LOG_RECORDS_PER_PAGE];
+    uint8_t page_count;
+    uint8_t page_pos;
+    bool done;
+
+    bool openSegment(uint8_t index, uint32_t page_index);
+    bool loadPage();
+
+public:
+    HistoryLogCursor();
+
+    // Returns the next record inside [from, to], or false at the end of the range
+    bool next(HistoryLogRecord& record);
+};
+
+class HistoryLog {
+private:
+    HistoryLogRecord pages[2][HISTORY_LOG_RECORDS_PER_PAGE]; // double buffered
+    uint8_t fill_page;
+    uint8_t fill_count;
+    uint8_t flush_page;
+    volatile bool flush_pending;
+    volatile bool clear_pending;
+    uint32_t dropped_pages;
+
+    HistoryLogSegment segments[HISTORY_LOG_MAX_SEGMENTS]; // oldest first
+    uint8_t segment_count;
+    uint16_t head_pages;    // pages written to the newest segment this boot
+    bool head_open;         // a segment has been opened for writing this boot
+    uint32_t next_segment_id;
+    uint32_t time_offset_s;
+
+    File segment_file;
+    File index_file;
+    SemaphoreHandle_t lock;
+    TaskHandle_t task;
+    bool started;
+
+    static void taskEntry(void* arg);
+    void taskLoop();
+    void writePage(const HistoryLogRecord* page);
+    bool openNewSegment(uint32_t first_time_s);
+    void removeAll();
+    void recover();
+
+public:
+    HistoryLog();
+
+    // Scans existing segments and starts the writer task. LittleFS must be mounted.
+    bool begin();
+
+    // Queues one record. O(1), no flash access - safe to call from the sample loop.
+    void append(int16_t distance, bool output1, bool output2);
+
+    // Deletes all segments (performed by the writer task)
+    void clear();
+
+    uint32_t now();
+    uint32_t getDroppedPages() { return dropped_pages; }
+    TaskHandle_t getTask() { return task; }
+
+    // Positions cursor on the first record at or after from_s
+    bool openRange(HistoryLogCursor& cursor, uint32_t from_s, uint32_t to_s);
+
+    static uint8_t checksum(const HistoryLogRecord& record);
+    static void segmentPath(char* path, size_t len, uint32_t id, const char* ext);
+};
@@ -0,0 +1,150 @@
+#include "history_store.h"
+#include <atomic>
+
+static_assert(sizeof(HistoryBucket) == 8, "HistoryBucket must stay packed to 8 bytes");
+static_assert((HISTORY_TOTAL_BUCKETS + HISTORY_TIER_COUNT) * sizeof(HistoryBucket) <= HISTORY_RAM_BUDGET,
+              "History tiers exceed their RAM budget");
+
+HistoryStore::HistoryStore() {
+    static const uint32_t intervals[HISTORY_TIER_COUNT] = {
+        HISTORY_TIER0_INTERVAL_MS, HISTORY_TIER1_INTERVAL_MS, HISTORY_TIER2_INTERVAL_MS
+    };
+    static const uint16_t capacities[HISTORY_TIER_COUNT] = {
+        HISTORY_TIER0_BUCKETS, HISTORY_TIER1_BUCKETS, HISTORY_TIER2_BUCKETS
+    };
+
+    HistoryBucket* next_storage = storage;
+    for (uint8_t i = 0; i < HISTORY_TIER_COUNT; i++) {
+        tiers[i].buckets = next_storage;
+        tiers[i].capacity = capacities[i];
+        tiers[i].slots = capacities[i] + 1;
+        tiers[i].interval_ms = intervals[i];
+        tiers[i].next_seq = 0;
+        next_storage += tiers[i].slots;
+    }
+    clear();
+}
+
+void HistoryStore::resetAccumulator(Accumulator& acc) {
+    acc.sum = 0;
+    acc.valid_count = 0;
+    acc.sample_count = 0;
+    acc.output1_count = 0;
+    acc.output2_count = 0;
+    acc.min_distance = INT16_MAX;
+    acc.max_distance = INT16_MIN;
+}
+
+void HistoryStore::commit(Tier& tier) {
+    // The ring has one slot more than the window, so this one holds no bucket
+    // a reader may be copying
+    HistoryBucket& bucket = tier.buckets[tier.next_seq % tier.slots];
+    const Accumulator& acc = tier.acc;
+
+    if (acc.sample_count == 0) {
+        bucket.min_distance = HISTORY_NO_DATA;
+        bucket.max_distance = HISTORY_NO_DATA;
+        bucket.mean_distance = HISTORY_NO_DATA;
+        bucket.output1_duty = 0;
+        bucket.output2_duty = 0;
+    } else {
+        if (acc.valid_count == 0) {
+            // Samples arrived but none had a target in range
+            bucket.min_distance = -1;
+            bucket.max_distance = -1;
+            bucket.mean_distance = -1;
+        } else {
+            bucket.min_distance = acc.min_distance;
+            bucket.max_distance = acc.max_distance;
+            bucket.mean_distance = (int16_t)(acc.sum / (int32_t)acc.valid_count);
+        }
+        bucket.output1_duty = (uint8_t)((acc.output1_count * 100UL) / acc.sample_count);
+        bucket.output2_duty = (uint8_t)((acc.output2_count * 100UL) / acc.sample_count);
+    }
+
+    // Publish the bucket only after it has been written
+    std::atomic_thread_fence(std::memory_order_release);
+    tier.next_seq++;
+    if (tier.count < tier.capacity) {
+        tier.count++;
+    }
+    resetAccumulator(tier.acc);
+}
+
+void HistoryStore::commitEmpty(Tier& tier, uint32_t periods) {
+    // Only the newest `capacity` empty buckets are retained, but the sequence
+    // still advances by every missed period so bucket times stay implicit
+    if (periods > tier.capacity) {
+        tier.count = 0;     // none of the retained buckets belongs to the new window
+        std::atomic_thread_fence(std::memory_order_release);
+        tier.next_seq += periods - tier.capacity;
+        periods = tier.capacity;
+    }
+    for (uint32_t i = 0; i < periods; i++) {
+        commit(tier);
+    }
+}
+
+void HistoryStore::addSample(uint32_t now_ms, int16_t distance, bool output1, bool output2) {
+    if (!started) {
+        for (uint8_t i = 0; i < HISTORY_TIER_COUNT; i++) {
+            tiers[i].bucket_start_ms = now_ms;
+            tiers[i].origin_ms = now_ms - tiers[i].next_seq * tiers[i].interval_ms;
+        }
+        started = true;
+    }
+
+    for (uint8_t i = 0; i < HISTORY_TIER_COUNT; i++) {
+        Tier& tier = tiers[i];
+
+        // Close the current bucket once its interval has elapsed; any further
+        // whole intervals without samples become empty buckets
+        uint32_t elapsed = now_ms - tier.bucket_start_ms;
+        if (elapsed >= tier.interval_ms) {
+            uint32_t periods = elapsed / tier.interval_ms;
+            commit(tier);
+            if (periods > 1) {
+                commitEmpty(tier, periods - 1);
+            }
+            tier.bucket_start_ms += periods * tier.interval_ms;
+        }
+
+        Accumulator& acc = tier.acc;
+        acc.sample_count++;
+        if (output1) acc.output1_count++;
+        if (output2) acc.output2_count++;
+        if (distance >= 0) {
+            acc.sum += distance;
+            acc.valid_count++;
+            if (distance < acc.min_distance) acc.min_distance = distance;
+            if (distance > acc.max_distance) acc.max_distance = distance;
+        }
+    }
+}
+
+void HistoryStore::clear() {
+    // Sequence numbers keep counting so client cursors and bucket times stay valid
+    for (uint8_t i = 0; i < HISTORY_TIER_COUNT; i++) {
+        tiers[i].count = 0;
+        resetAccumulator(tiers[i].acc);
+    }
+    started = false;
+}
+
+bool HistoryStore::getBucket(uint8_t tier, uint32_t seq, HistoryBucket& bucket) {
+    if (tier >= HISTORY_TIER_COUNT) return false;
+
+    const Tier& t = tiers[tier];
+    uint32_t next_seq = t.next_seq;
+    if (seq >= next_seq || next_seq - seq > t.count) {
+        return false; // Not committed yet, cleared or already overwritten
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bucket = t.buckets[seq % t.slots];
+
+    // commit() may have run meanwhile; once seq has left the window its slot
+    // can be the one being rewritten and the copy torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return t.next_seq - seq <= t.count;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Round-robin history tiers (RRD style). Every sensor sample is folded into
+// each tier's running accumulator in O(1); when a tier's interval elapses the
+// accumulator is committed as one bucket. All storage is static.
+#define HISTORY_TIER_COUNT 3
+#define HISTORY_TIER0_INTERVAL_MS 1000UL      // 1 s buckets
+#define HISTORY_TIER0_BUCKETS 600             // 10 minutes
+#define HISTORY_TIER1_INTERVAL_MS 60000UL     // 1 min buckets
+#define HISTORY_TIER1_BUCKETS 1440            // 24 hours
+#define HISTORY_TIER2_INTERVAL_MS 3600000UL   // 1 h buckets
+#define HISTORY_TIER2_BUCKETS 720             // 30 days
+#define HISTORY_TOTAL_BUCKETS (HISTORY_TIER0_BUCKETS + HISTORY_TIER1_BUCKETS + HISTORY_TIER2_BUCKETS)
+#define HISTORY_RAM_BUDGET 24576              // bytes reserved for tier buckets
+
+#define HISTORY_NO_DATA INT16_MIN  // bucket had no samples at all (e.g. sensor fault)
+
+// One committed bucket - 8 bytes
+struct HistoryBucket {
+    int16_t min_distance;   // mm, -1 if every sample was out of range
+    int16_t max_distance;   // mm
+    int16_t mean_distance;  // mm
+    uint8_t output1_duty;   // % of samples with output 1 active
+    uint8_t output2_duty;   // % of samples with output 2 active
+};
+
+class HistoryStore {
+private:
+    struct Accumulator {
+        int32_t sum;
+        uint32_t valid_count;
+        uint32_t sample_count;
+        uint32_t output1_count;
+        uint32_t output2_count;
+        int16_t min_distance;
+        int16_t max_distance;
+    };
+
+    struct Tier {
+        HistoryBucket* buckets;
+        uint16_t capacity;         // buckets kept
+        uint16_t slots;            // capacity + 1: commit() never writes a slot readers may copy
+        uint16_t count;
+        uint32_t interval_ms;
+        uint32_t next_seq;         // sequence of the bucket being accumulated
+        uint32_t origin_ms;        // start time of bucket sequence 0
+        uint32_t bucket_start_ms;  // start time of the bucket being accumulated
+        Accumulator acc;
+    };
+
+    HistoryBucket storage[HISTORY_TOTAL_BUCKETS + HISTORY_TIER_COUNT];
+    Tier tiers[HISTORY_TIER_COUNT];
+    bool started;
+
+    void resetAccumulator(Accumulator& acc);
+    void commit(Tier& tier);
+    void commitEmpty(Tier& tier, uint32_t periods);
+
+public:
+    HistoryStore();
+
+    void addSample(uint32_t now_ms, int16_t distance, bool output1, bool output2);
+    void clear();
+
+    uint8_t getTierCount() { return HISTORY_TIER_COUNT; }
+    uint32_t getIntervalMs(uint8_t tier) { return tiers[tier].interval_ms; }
+    uint32_t getOldestSeq(uint8_t tier) { return tiers[tier].next_seq - tiers[tier].count; }
+    uint32_t getNextSeq(uint8_t tier) { return tiers[tier].next_seq; }
+    uint32_t getBucketTime(uint8_t tier, uint32_t seq) { return tiers[tier].origin_ms + seq * tiers[tier].interval_ms; }
+    bool getBucket(uint8_t tier, uint32_t seq, HistoryBucket& bucket);
+};
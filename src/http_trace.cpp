@@ -0,0 +1,196 @@
+#include "http_trace.h"
+
+HttpTracer* HttpTracer::installed = nullptr;
+
+HttpTracer::HttpTracer() {
+    memset(routes, 0, sizeof(routes));
+    memset(ring, 0, sizeof(ring));
+    route_count = 0;
+    next_id = 1;
+    active = nullptr;
+    active_task = nullptr;
+    active_start_us = 0;
+}
+
+int HttpTracer::addRoute(const char* uri, const char* method) {
+    if (route_count >= HTTP_TRACE_ROUTES) return -1;
+    HttpRouteStats& stats = routes[route_count];
+    stats.uri = uri;
+    stats.method = method;
+    stats.time.reset();
+    return route_count++;
+}
+
+HttpTrace* HttpTracer::findOpen(int route, const void* request) {
+    for (HttpTrace& trace : ring) {
+        if (trace.id != 0 && trace.open && trace.request == request && trace.route == route) return &trace;
+    }
+    return nullptr;
+}
+
+void HttpTracer::begin(int route, const void* request, const void* connection) {
+    if (route < 0) return;
+    HttpTrace* trace = findOpen(route, request);
+    if (trace == nullptr) {
+        uint32_t id = next_id++;
+        if (next_id == 0) next_id = 1;
+        trace = &ring[id % HTTP_TRACE_RING];
+        if (trace->open) finish(*trace);    // overwritten before its handler ran
+        memset(trace, 0, sizeof(*trace));
+        trace->id = id;
+        trace->start_ms = millis();
+        trace->route = (uint8_t)route;
+        trace->open = true;
+        trace->request = request;
+        trace->connection = connection;
+    }
+    active_task = xTaskGetCurrentTaskHandle();
+    active_start_us = micros();
+    active = trace;
+}
+
+void HttpTracer::end(bool complete) {
+    HttpTrace* trace = active;
+    if (trace == nullptr) return;
+    active = nullptr;
+    trace->time_us += micros() - active_start_us;
+    if (complete) finish(*trace);
+}
+
+void HttpTracer::finish(HttpTrace& trace) {
+    trace.open = false;
+    HttpRouteStats& stats = routes[trace.route];
+    stats.time.record(trace.time_us);
+    stats.alloc_bytes += trace.alloc_bytes;
+    stats.freed_bytes += trace.freed_bytes;
+    if (trace.alloc_bytes > stats.max_alloc_bytes) stats.max_alloc_bytes = trace.alloc_bytes;
+}
+
+void HttpTracer::disconnect(const void* connection) {
+    for (HttpTrace& trace : ring) {
+        if (trace.id == 0 || trace.connection != connection) continue;
+        trace.connection = nullptr;
+        if (trace.open && &trace != active) finish(trace);
+    }
+}
+
+void HttpTracer::heap(size_t size, bool freed) {
+    HttpTracer* tracer = installed;
+    if (tracer == nullptr) return;
+    HttpTrace* trace = tracer->active;
+    if (trace == nullptr || xTaskGetCurrentTaskHandle() != tracer->active_task) return;
+    if (freed) {
+        trace->freed_bytes += size;
+    } else {
+        trace->alloc_bytes += size;
+        if (trace->allocs < UINT16_MAX) trace->allocs++;
+    }
+}
+
+// The newest trace on the connection; an older one only keeps it if its slot
+// was reused before the connection closed
+void HttpTracer::sent(const void* connection, size_t len) {
+    HttpTracer* tracer = installed;
+    if (tracer == nullptr || connection == nullptr) return;
+    HttpTrace* match = nullptr;
+    for (HttpTrace& trace : tracer->ring) {
+        if (trace.id != 0 && trace.connection == connection && (match == nullptr || (int32_t)(trace.id - match->id) > 0)) {
+            match = &trace;
+        }
+    }
+    if (match == nullptr) return;
+    match->response_bytes += len;
+    tracer->routes[match->route].response_bytes += len;
+}
+
+void HttpTracer::writeJson(JsonWriter& json) const {
+    json.beginObject();
+    json.beginArray("routes");
+    for (int i = 0; i < route_count; i++) {
+        const HttpRouteStats& stats = routes[i];
+        if (stats.time.count == 0) continue;
+        json.beginObject();
+        json.addString("route", stats.uri);
+        json.addString("method", stats.method);
+        json.addUInt("count", stats.time.count);
+        json.addUInt("time_ms_total", stats.time.sum_ms);
+        json.addUInt("time_us_max", stats.time.max_us);
+        json.addUInt("alloc_bytes_total", stats.alloc_bytes);
+        json.addUInt("alloc_bytes_max", stats.max_alloc_bytes);
+        json.addUInt("freed_bytes_total", stats.freed_bytes);
+        json.addUInt("response_bytes_total", stats.response_bytes);
+        json.endObject();
+    }
+    json.endArray();
+
+    json.beginArray("recent");
+    for (uint32_t n = 1; n <= HTTP_TRACE_RING; n++) {
+        const HttpTrace& trace = ring[(next_id - n) % HTTP_TRACE_RING];
+        if (trace.id == 0 || trace.id != next_id - n) continue;
+        json.beginObject();
+        json.addUInt("id", trace.id);
+        json.addUInt("start_ms", trace.start_ms);
+        json.addString("route", routes[trace.route].uri);
+        json.addString("method", routes[trace.route].method);
+        json.addUInt("time_us", trace.time_us);
+        json.addUInt("alloc_bytes", trace.alloc_bytes);
+        json.addUInt("allocs", trace.allocs);
+        json.addUInt("freed_bytes", trace.freed_bytes);
+        json.addUInt("response_bytes", trace.response_bytes);
+        json.addBool("open", trace.open);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+}
+
+#ifdef HTTP_TRACE_WRAP
+// Linker wraps (-Wl,--wrap=...). Block sizes come from the heap so an
+// allocation and its free count the same.
+#include <esp_heap_caps.h>
+#include <lwip/tcp.h>
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+err_t __real_tcp_write(struct tcp_pcb* pcb, const void* data, u16_t len, u8_t apiflags);
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    if (ptr != nullptr && HttpTracer::tracing()) HttpTracer::heap(heap_caps_get_allocated_size(ptr), false);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+    if (ptr != nullptr && HttpTracer::tracing()) HttpTracer::heap(heap_caps_get_allocated_size(ptr), false);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (!HttpTracer::tracing()) return __real_realloc(ptr, size);
+    size_t old_size = ptr != nullptr ? heap_caps_get_allocated_size(ptr) : 0;
+    void* moved = __real_realloc(ptr, size);
+    if (moved != nullptr) {
+        if (old_size > 0) HttpTracer::heap(old_size, true);
+        HttpTracer::heap(heap_caps_get_allocated_size(moved), false);
+    } else if (size == 0 && old_size > 0) {
+        HttpTracer::heap(old_size, true);
+    }
+    return moved;
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr != nullptr && HttpTracer::tracing()) HttpTracer::heap(heap_caps_get_allocated_size(ptr), true);
+    __real_free(ptr);
+}
+
+err_t __wrap_tcp_write(struct tcp_pcb* pcb, const void* data, u16_t len, u8_t apiflags) {
+    err_t err = __real_tcp_write(pcb, data, len, apiflags);
+    if (err == ERR_OK) HttpTracer::sent(pcb, len);
+    return err;
+}
+}
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "json_writer.h"
+#include "latency_histogram.h"
+
+// Per-request tracing of the web server's handlers.
+//
+// Every route WebServerManager registers is wrapped so each callback of a
+// request (upload and body chunks, then the handler) runs between begin() and
+// end(). A trace collects the time spent in them, the heap allocated and
+// freed by the web task meanwhile, and the bytes queued on the request's
+// connection until it closes, headers included; the last HTTP_TRACE_RING
+// traces are kept and each finished one is added to its route's totals.
+//
+// Heap and sent bytes come from hooks below the library: on the device the
+// linker wraps malloc/calloc/realloc/free (and so new, delete and String) and
+// lwIP's tcp_write (HTTP_TRACE_WRAP, see platformio.ini); the host simulator
+// installs the two hooks with hostSetHeapHook() and hostSetTcpWriteHook().
+// Allocations ESP-IDF makes with heap_caps_malloc() directly are not seen.
+#define HTTP_TRACE_ROUTES 32
+#define HTTP_TRACE_RING 32
+
+struct HttpRouteStats {
+    const char* uri;
+    const char* method;
+    LatencyHistogram time;          // per finished request, all its callbacks
+    uint32_t alloc_bytes;           // totals over finished requests
+    uint32_t freed_bytes;
+    uint32_t max_alloc_bytes;       // most allocated by one request
+    uint32_t response_bytes;        // total sent on the routes' connections
+};
+
+struct HttpTrace {
+    uint32_t id;                    // 0 while the slot is unused
+    uint32_t start_ms;
+    uint32_t time_us;
+    uint32_t alloc_bytes;
+    uint32_t freed_bytes;
+    uint32_t response_bytes;        // grows while the connection sends
+    uint16_t allocs;
+    uint8_t route;
+    bool open;                      // more callbacks of the request to come
+    const void* request;
+    const void* connection;         // the tcp_pcb, until it disconnects
+};
+
+// Not thread safe apart from the hooks: begin(), end() and the readers run
+// on the web server task. The hooks may run on any task; heap() only counts
+// for the task that called begin(), sent() matches on the connection.
+class HttpTracer {
+private:
+    HttpRouteStats routes[HTTP_TRACE_ROUTES];
+    uint8_t route_count;
+    HttpTrace ring[HTTP_TRACE_RING];
+    uint32_t next_id;
+
+    HttpTrace* volatile active;     // trace of the callback running now
+    TaskHandle_t active_task;
+    uint32_t active_start_us;
+
+    static HttpTracer* installed;
+
+    HttpTrace* findOpen(int route, const void* request);
+    void finish(HttpTrace& trace);
+
+public:
+    HttpTracer();
+
+    // Routes the hooks to this tracer
+    void install() { installed = this; }
+
+    // Index for the trace calls, or -1 once HTTP_TRACE_ROUTES are in use.
+    // uri and method must be literals.
+    int addRoute(const char* uri, const char* method);
+
+    // Around one callback of a request; complete after its last one (the
+    // handler). A request whose trace is still open continues it.
+    void begin(int route, const void* request, const void* connection);
+    void end(bool complete);
+
+    // Connection closed; a trace left open by a failed upload is finished
+    void disconnect(const void* connection);
+
+    uint8_t getRouteCount() const { return route_count; }
+    const HttpRouteStats& getRoute(int index) const { return routes[index]; }
+
+    // {"routes": totals of routes with requests, "recent": traces, newest first}
+    void writeJson(JsonWriter& json) const;
+
+    // Hooks, forwarded to the installed tracer. tracing() is the cheap test
+    // the allocator wraps make before they look up a block's size.
+    static bool tracing() { return installed != nullptr && installed->active != nullptr; }
+    static void heap(size_t size, bool freed);
+    static void sent(const void* connection, size_t len);
+};
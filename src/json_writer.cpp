@@ -0,0 +1,175 @@
+#include "json_writer.h"
+#include <string.h>
+
+JsonWriter::JsonWriter(char* out_buffer, size_t out_capacity) {
+    buffer = out_buffer;
+    capacity = out_capacity;
+    used = 0;
+    total = 0;
+    overflow = false;
+    flush_callback = nullptr;
+    flush_context = nullptr;
+    depth = 0;
+    has_items = 0;
+}
+
+JsonWriter::JsonWriter(FlushCallback callback, void* context) {
+    buffer = staging;
+    capacity = JSON_WRITER_STAGING_SIZE;
+    used = 0;
+    total = 0;
+    overflow = false;
+    flush_callback = callback;
+    flush_context = context;
+    depth = 0;
+    has_items = 0;
+}
+
+#if defined(ARDUINO) || defined(HOST_SIMULATOR)
+JsonWriter::JsonWriter(Print& out) : JsonWriter(flushToPrint, &out) {}
+
+void JsonWriter::flushToPrint(void* context, const char* data, size_t len) {
+    static_cast<Print*>(context)->write(reinterpret_cast<const uint8_t*>(data), len);
+}
+#endif
+
+void JsonWriter::flush() {
+    if (flush_callback && used > 0) {
+        flush_callback(flush_context, buffer, used);
+        used = 0;
+    }
+}
+
+void JsonWriter::put(char c) {
+    if (flush_callback) {
+        if (used == capacity) {
+            flush();
+        }
+    } else if (used + 1 >= capacity) {
+        // Keep one byte for the terminating NUL
+        overflow = true;
+        return;
+    }
+    buffer[used++] = c;
+    total++;
+}
+
+void JsonWriter::put(const char* data, size_t len) {
+    while (len > 0) {
+        size_t room;
+        if (flush_callback) {
+            if (used == capacity) {
+                flush();
+            }
+            room = capacity - used;
+        } else {
+            room = (used + 1 < capacity) ? capacity - 1 - used : 0;
+            if (room == 0) {
+                overflow = true;
+                return;
+            }
+        }
+
+        size_t n = len < room ? len : room;
+        memcpy(buffer + used, data, n);
+        used += n;
+        total += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void JsonWriter::separator() {
+    if (depth == 0) return;
+    uint16_t bit = 1u << (depth - 1);
+    if (has_items & bit) {
+        put(',');
+    } else {
+        has_items |= bit;
+    }
+}
+
+void JsonWriter::writeKey(const char* key, size_t len) {
+    separator();
+    put('"');
+    put(key, len);
+    put("\":", 2);
+}
+
+void JsonWriter::writeString(const char* value) {
+    static const char hex[] = "0123456789abcdef";
+
+    put('"');
+    if (value) {
+        const char* run = value;
+        for (const char* p = value; *p; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+            // Emit the clean run before the character that needs escaping
+            put(run, p - run);
+            run = p + 1;
+            switch (c) {
+                case '"':  put("\\\"", 2); break;
+                case '\\': put("\\\\", 2); break;
+                case '\n': put("\\n", 2); break;
+                case '\r': put("\\r", 2); break;
+                case '\t': put("\\t", 2); break;
+                default: {
+                    char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+                    put(esc, sizeof(esc));
+                    break;
+                }
+            }
+        }
+        put(run, strlen(run));
+    }
+    put('"');
+}
+
+void JsonWriter::writeUInt(uint32_t value) {
+    char digits[10];
+    uint8_t n = 0;
+    do {
+        digits[sizeof(digits) - 1 - n] = '0' + (value % 10);
+        value /= 10;
+        n++;
+    } while (value > 0);
+    put(digits + sizeof(digits) - n, n);
+}
+
+void JsonWriter::writeInt(int32_t value) {
+    if (value < 0) {
+        put('-');
+        writeUInt(0u - (uint32_t)value);
+    } else {
+        writeUInt((uint32_t)value);
+    }
+}
+
+void JsonWriter::open(char bracket) {
+    put(bracket);
+    if (depth < JSON_WRITER_MAX_DEPTH) {
+        depth++;
+        has_items &= ~(1u << (depth - 1));
+    } else {
+        overflow = true;
+    }
+}
+
+void JsonWriter::close(char bracket) {
+    // An open past the maximum depth was not counted; the document is broken
+    // anyway, so leave depth alone rather than close a level still open
+    if (overflow) return;
+    if (depth > 0) depth--;
+    put(bracket);
+}
+
+size_t JsonWriter::finish() {
+    if (flush_callback) {
+        flush();
+    } else if (capacity > 0) {
+        buffer[used] = '\0';
+    }
+    return total;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ARDUINO) || defined(HOST_SIMULATOR)
+#include <Print.h>
+#endif
+
+// JSON writer settings
+#define JSON_WRITER_MAX_DEPTH 16    // Maximum object/array nesting
+#define JSON_WRITER_STAGING_SIZE 128 // Bytes staged before flushing to a stream
+
+// Allocation-free streaming JSON writer.
+//
+// Output goes either straight into a caller supplied fixed buffer, or through a
+// small staging buffer that is flushed to a sink (an AsyncResponseStream or any
+// other Print). Keys must be string literals so their length is fixed at compile
+// time. Commas are tracked per nesting level, so callers only describe structure.
+class JsonWriter {
+public:
+    typedef void (*FlushCallback)(void* context, const char* data, size_t len);
+
+private:
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    size_t total;
+    bool overflow;
+
+    FlushCallback flush_callback;
+    void* flush_context;
+    char staging[JSON_WRITER_STAGING_SIZE];
+
+    uint8_t depth;
+    uint16_t has_items;  // one bit per nesting level - set once the level has a member
+
+    void put(char c);
+    void put(const char* data, size_t len);
+    void flush();
+    void separator();
+    void writeKey(const char* key, size_t len);
+    void writeString(const char* value);
+    void writeInt(int32_t value);
+    void writeUInt(uint32_t value);
+    void open(char bracket);
+    void close(char bracket);
+
+#if defined(ARDUINO) || defined(HOST_SIMULATOR)
+    static void flushToPrint(void* context, const char* data, size_t len);
+#endif
+
+public:
+    JsonWriter(char* out_buffer, size_t out_capacity);
+    JsonWriter(FlushCallback callback, void* context);
+#if defined(ARDUINO) || defined(HOST_SIMULATOR)
+    JsonWriter(Print& out);
+#endif
+
+    // Anonymous containers (document root or array elements)
+    void beginObject() { separator(); open('{'); }
+    void beginArray() { separator(); open('['); }
+    void endObject() { close('}'); }
+    void endArray() { close(']'); }
+
+    // Named containers inside an object
+    template <size_t N> void beginObject(const char (&key)[N]) { writeKey(key, N - 1); open('{'); }
+    template <size_t N> void beginArray(const char (&key)[N]) { writeKey(key, N - 1); open('['); }
+
+    // Object members
+    template <size_t N> void addInt(const char (&key)[N], int32_t value) { writeKey(key, N - 1); writeInt(value); }
+    template <size_t N> void addUInt(const char (&key)[N], uint32_t value) { writeKey(key, N - 1); writeUInt(value); }
+    template <size_t N> void addBool(const char (&key)[N], bool value) { writeKey(key, N - 1); put(value ? "true" : "false", value ? 4 : 5); }
+    template <size_t N> void addString(const char (&key)[N], const char* value) { writeKey(key, N - 1); writeString(value); }
+    template <size_t N> void addNull(const char (&key)[N]) { writeKey(key, N - 1); put("null", 4); }
+
+    // Array elements
+    void addInt(int32_t value) { separator(); writeInt(value); }
+    void addUInt(uint32_t value) { separator(); writeUInt(value); }
+    void addBool(bool value) { separator(); put(value ? "true" : "false", value ? 4 : 5); }
+    void addString(const char* value) { separator(); writeString(value); }
+
+    // Flushes any staged output and NUL-terminates fixed buffer output.
+    // Returns the total number of JSON bytes produced.
+    size_t finish();
+
+    size_t size() const { return total; }
+    bool overflowed() const { return overflow; }
+};
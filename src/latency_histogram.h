@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Histogram of durations in microseconds with power-of-two buckets: bucket 0
+// counts values up to 1 µs, bucket k values in (2^(k-1), 2^k] µs, and the last
+// bucket everything above 2^(LATENCY_HISTOGRAM_BUCKETS - 2) µs. record() is a
+// count-leading-zeros and three adds, cheap enough for the sample path.
+//
+// Written by one task and read by others without a lock: each field is a
+// 32-bit word, so a reader sees every count whole, but may see a record()
+// half done (a count without its sum). Good enough for metrics.
+#define LATENCY_HISTOGRAM_BUCKETS 20    // last finite bound 2^18 µs = 262 ms
+
+struct LatencyHistogram {
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    uint32_t sum_ms;                    // sum in whole milliseconds plus sum_us below
+    uint32_t sum_us;                    // remainder, below 1000
+    uint32_t max_us;
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    void record(uint32_t us) {
+        int bucket = us <= 1 ? 0 : 32 - __builtin_clz(us - 1);
+        if (bucket > LATENCY_HISTOGRAM_BUCKETS - 1) bucket = LATENCY_HISTOGRAM_BUCKETS - 1;
+        counts[bucket]++;
+        count++;
+        sum_us += us % 1000;
+        sum_ms += us / 1000;
+        if (sum_us >= 1000) {
+            sum_us -= 1000;
+            sum_ms++;
+        }
+        if (us > max_us) max_us = us;
+    }
+
+    // Upper bound of bucket k in µs; the last bucket has none
+    static uint32_t bound(int k) { return 1UL << k; }
+};
@@ -2,11 +2,16 @@
 #include "sensor_manager.h"
 #include "config_manager.h"
 #include "web_server.h"
+#include "api_core.h"
+#include "serial_console.h"
 
 // Global instances
 SensorManager* sensorManager;
 ConfigManager* configManager;
 WebServerManager* webServer;
+RawRecorder* rawRecorder;
+ApiCore* apiCore;
+SerialConsole* serialConsole;
 Adafruit_NeoPixel led = Adafruit_NeoPixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800);
 Adafruit_VL53L1X vl53 = Adafruit_VL53L1X(PIN_TOF_SHUTDOWN, PIN_TOF_INT);
 
@@ -36,6 +41,11 @@ void setup() {
     Serial.println("Initializing sensor manager...");
     sensorManager = new SensorManager(&vl53, &led, PIN_OUT_1, PIN_OUT_2);
     
+    // Raw sample recorder on its own flash partition (idle until started from the web API)
+    rawRecorder = new RawRecorder();
+    rawRecorder->begin();
+    sensorManager->setRawRecorder(rawRecorder);
+    
     // Initialize sensor
     if (sensorManager->initialize()) {
         Serial.println("Sensor initialization complete!");
@@ -43,22 +53,8 @@ void setup() {
         // Load configuration from storage and apply to sensor manager
         DeviceConfig device_config = configManager->getDeviceConfig();
         
-        sensorManager->setOutput1Config(
-            device_config.output1_min,
-            device_config.output1_max,
-            device_config.output1_hysteresis,
-            device_config.output1_active_in_range
-        );
-        
-        sensorManager->setOutput2Config(
-            device_config.output2_min,
-            device_config.output2_max,
-            device_config.output2_hysteresis,
-            device_config.output2_active_in_range
-        );
-        
-        sensorManager->enableOutput1(device_config.output1_enabled);
-        sensorManager->enableOutput2(device_config.output2_enabled);
+        // All settings at once, OTA output states included
+        sensorManager->updateConfiguration(device_config);
         
         Serial.println("Configuration loaded and applied to sensor manager");
         Serial.print("Output 1: ");
@@ -87,9 +83,13 @@ void setup() {
         Serial.println("Sensor initialization FAILED!");
     }
     
+    // API core shared by the web server and the serial console
+    apiCore = new ApiCore(configManager, sensorManager);
+    serialConsole = new SerialConsole(apiCore, &Serial);
+    
     // Initialize web server
     Serial.println("Initializing web server...");
-    webServer = new WebServerManager(configManager, sensorManager);
+    webServer = new WebServerManager(configManager, sensorManager, apiCore);
     if (webServer->startAccessPoint()) {
         if (webServer->initialize()) {
             Serial.println("Web server started successfully");
@@ -124,15 +124,21 @@ void loop() {
     // Update sensor manager (handles all sensor reading, filtering, and output control)
     sensorManager->update();
     
-    // Handle web server requests
-    webServer->handleClient();
+    // Commands from the serial console
+    serialConsole->poll();
+    
+    // Restart after an OTA update, once it has been answered
+    webServer->poll();
     
-    // Add data to history buffer for web interface
-    if (sensorManager->isSensorReady()) {
+    // Add each new sample to the history for web interface
+    static uint32_t last_history_sample = 0;
+    SensorSnapshot snapshot = sensorManager->getSnapshot();
+    if (snapshot.sensor_ready && snapshot.sequence != last_history_sample) {
+        last_history_sample = snapshot.sequence;
         configManager->addHistoryPoint(
-            sensorManager->getDistance(),
-            sensorManager->getOutput1Config().current_state,
-            sensorManager->getOutput2Config().current_state
+            snapshot.distance,
+            snapshot.outputs[0].current_state,
+            snapshot.outputs[1].current_state
         );
     }
     
@@ -141,14 +147,14 @@ void loop() {
     if (millis() - last_status_print > 5000) {
         last_status_print = millis();
         
-        if (sensorManager->isSensorReady()) {
+        if (snapshot.sensor_ready) {
             Serial.print("[STATUS] Distance: ");
-            Serial.print(sensorManager->getDistance());
+            Serial.print(snapshot.distance);
             Serial.print("mm (raw: ");
-            Serial.print(sensorManager->getRawDistance());
+            Serial.print(snapshot.raw_distance);
             Serial.print("mm) | Status: ");
             
-            switch (sensorManager->getStatus()) {
+            switch (snapshot.status) {
                 case STATUS_OK:
                     Serial.print("OK");
                     break;
@@ -161,9 +167,9 @@ void loop() {
             }
             
             Serial.print(" | Out1: ");
-            Serial.print(sensorManager->getOutput1Config().current_state ? "ON" : "OFF");
+            Serial.print(snapshot.outputs[0].current_state ? "ON" : "OFF");
             Serial.print(" | Out2: ");
-            Serial.print(sensorManager->getOutput2Config().current_state ? "ON" : "OFF");
+            Serial.print(snapshot.outputs[1].current_state ? "ON" : "OFF");
             Serial.print(" | WiFi Clients: ");
             Serial.println(WiFi.softAPgetStationNum());
         } else {
@@ -172,5 +178,5 @@ void loop() {
     }
     
     // Small delay to prevent overwhelming the system
-    delay(50);
+    delay(MAIN_LOOP_DELAY_MS);
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+// Public half of the OTA signing key, generated by tools/ota_sign.py header.
+// Uploaded images must carry a signature made with the private half.
+//
+// This is a placeholder: its private half was discarded when it was
+// generated, so no image verifies against it and device builds refuse it
+// (ota_updater.cpp). Replace this file with your own key, see
+// tools/ota_sign.py.
+#define OTA_PUBLIC_KEY_PLACEHOLDER
+#define OTA_PUBLIC_KEY_PEM \
+    "-----BEGIN PUBLIC KEY-----\n" \
+    "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAEi4Amg0jwlmVHIYeQmip+OFYoqrnX\n" \
+    "Jnp4bmQbmCKdyjrD2LNiTWs5XQL7UmPtfq+YwnnTSmdiQlssE2UwQjISGQ==\n" \
+    "-----END PUBLIC KEY-----\n"
@@ -0,0 +1,241 @@
+#include "ota_updater.h"
+#include "ota_public_key.h"
+#include <new>
+
+#define OTA_HASH_SIZE 32
+
+// No image verifies against the placeholder key, so a device built with it
+// could never be updated. Host builds keep it; firmware needs a key of your
+// own, or -D OTA_ALLOW_PLACEHOLDER_KEY
+#if defined(OTA_PUBLIC_KEY_PLACEHOLDER) && defined(ESP_PLATFORM) && !defined(OTA_ALLOW_PLACEHOLDER_KEY)
+#error "src/ota_public_key.h holds the placeholder OTA key: run tools/ota_sign.py keygen and header"
+#endif
+
+// Application image header for this chip, as the bootloader expects it
+static bool checkImageHeader(const uint8_t* data, size_t len) {
+    if (len < sizeof(esp_image_header_t)) return false;
+    esp_image_header_t header;
+    memcpy(&header, data, sizeof(header));
+    return header.magic == ESP_IMAGE_HEADER_MAGIC &&
+           header.chip_id == CONFIG_IDF_FIRMWARE_CHIP_ID &&
+           header.segment_count > 0 && header.segment_count <= ESP_IMAGE_MAX_SEGMENTS;
+}
+
+OtaUpdater::OtaUpdater() {
+    memset(tail, 0, sizeof(tail));
+    tail_len = 0;
+    written = 0;
+    received = 0;
+    space = 0;
+    running = false;
+    error = OTA_OK;
+    gzip = nullptr;
+    gzip_error = GZIP_OK;
+    page = nullptr;
+    page_len = 0;
+    gate = nullptr;
+    gate_context = nullptr;
+    flash_time.reset();
+    mbedtls_sha256_init(&sha);
+}
+
+bool OtaUpdater::begin() {
+    if (running) {
+        error = OTA_ERROR_BUSY;
+        return false;
+    }
+    error = OTA_OK;
+    gzip_error = GZIP_OK;
+    tail_len = 0;
+    written = 0;
+    received = 0;
+    page_len = 0;
+    flash_time.reset();
+    space = ESP.getFreeSketchSpace();
+    page = new (std::nothrow) uint8_t[OTA_PAGE_SIZE];
+    if (page == nullptr) {
+        error = OTA_ERROR_MEMORY;
+        return false;
+    }
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+        error = OTA_ERROR_WRITE;
+        release();
+        return false;
+    }
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    running = true;
+    return true;
+}
+
+bool OtaUpdater::fail(OtaError reason) {
+    error = reason;
+    if (running) {
+        running = false;
+        Update.abort();
+        mbedtls_sha256_free(&sha);
+    }
+    return false;
+}
+
+// Buffers of the upload. Only from the public calls: fail() can be reached
+// from writeDecoded(), inside the decoder.
+void OtaUpdater::release() {
+    delete gzip;
+    gzip = nullptr;
+    delete[] page;
+    page = nullptr;
+}
+
+// The decoder failed: either on the stream itself, or because writeDecoded()
+// already failed the update
+bool OtaUpdater::failCompressed() {
+    if (running) {
+        gzip_error = gzip->getError();
+        fail(OTA_ERROR_COMPRESSED);
+    }
+    return false;
+}
+
+bool OtaUpdater::decoded(void* context, const uint8_t* data, size_t len) {
+    return ((OtaUpdater*)context)->writeDecoded(data, len);
+}
+
+void OtaUpdater::abort() {
+    fail(OTA_ERROR_ABORTED);
+    release();
+}
+
+bool OtaUpdater::flushPage() {
+    if (page_len == 0) return true;
+    if (gate != nullptr) gate(gate_context);
+    uint32_t start_us = micros();
+    size_t accepted = Update.write(page, page_len);
+    flash_time.record(micros() - start_us);
+    if (accepted != page_len) return fail(OTA_ERROR_WRITE);
+    page_len = 0;
+    return true;
+}
+
+bool OtaUpdater::writeImage(const uint8_t* data, size_t len) {
+    if (written + len > space) return fail(OTA_ERROR_SPACE);
+    mbedtls_sha256_update(&sha, data, len);
+    written += len;
+    while (len > 0) {
+        size_t take = OTA_PAGE_SIZE - page_len;
+        if (take > len) take = len;
+        memcpy(page + page_len, data, take);
+        page_len += take;
+        data += take;
+        len -= take;
+        if (page_len == OTA_PAGE_SIZE && !flushPage()) return false;
+    }
+    return true;
+}
+
+bool OtaUpdater::write(const uint8_t* data, size_t len) {
+    if (!running) return false;
+    if (received == 0 && GzipDecoder::isGzip(data, len)) {
+        gzip = new (std::nothrow) GzipDecoder();
+        if (gzip == nullptr) {
+            fail(OTA_ERROR_MEMORY);
+            release();
+            return false;
+        }
+        gzip->begin(decoded, this);
+    }
+    received += len;
+    bool ok = gzip != nullptr ? gzip->write(data, len) || failCompressed() : writeDecoded(data, len);
+    if (!ok) release();
+    return ok;
+}
+
+bool OtaUpdater::writeDecoded(const uint8_t* data, size_t len) {
+    if (!running) return false;
+    if (written == 0 && tail_len == 0 && !checkImageHeader(data, len)) return fail(OTA_ERROR_HEADER);
+
+    // Everything but the last OTA_TRAILER_SIZE bytes received so far goes to
+    // flash: first what was held back, then the front of this chunk
+    size_t total = tail_len + len;
+    if (total <= OTA_TRAILER_SIZE) {
+        memcpy(tail + tail_len, data, len);
+        tail_len = total;
+        return true;
+    }
+    size_t flush = total - OTA_TRAILER_SIZE;
+    size_t from_tail = flush < tail_len ? flush : tail_len;
+    size_t from_data = flush - from_tail;
+    if (from_tail > 0 && !writeImage(tail, from_tail)) return false;
+    if (from_data > 0 && !writeImage(data, from_data)) return false;
+
+    size_t kept = tail_len - from_tail;
+    memmove(tail, tail + from_tail, kept);
+    memcpy(tail + kept, data + from_data, len - from_data);
+    tail_len = OTA_TRAILER_SIZE;
+    return true;
+}
+
+bool OtaUpdater::verifySignature(const OtaTrailer& trailer, const uint8_t* hash) {
+    static const char public_key[] = OTA_PUBLIC_KEY_PEM;
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    int result = mbedtls_pk_parse_public_key(&key, (const unsigned char*)public_key, sizeof(public_key));
+    if (result == 0) {
+        result = mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, hash, OTA_HASH_SIZE,
+                                   trailer.signature, trailer.signature_len);
+    }
+    mbedtls_pk_free(&key);
+    return result == 0;
+}
+
+bool OtaUpdater::end() {
+    bool ok = finish();
+    release();
+    return ok;
+}
+
+bool OtaUpdater::finish() {
+    if (!running) return false;
+    if (gzip != nullptr && !gzip->end()) return failCompressed();
+
+    OtaTrailer trailer;
+    if (tail_len != OTA_TRAILER_SIZE) return fail(OTA_ERROR_TRAILER);
+    memcpy(&trailer, tail, sizeof(trailer));
+    if (trailer.magic != OTA_TRAILER_MAGIC || trailer.image_size != written ||
+        trailer.signature_len == 0 || trailer.signature_len > OTA_SIGNATURE_MAX) {
+        return fail(OTA_ERROR_TRAILER);
+    }
+    if (written < OTA_MIN_IMAGE_SIZE) return fail(OTA_ERROR_SIZE);
+
+    uint8_t hash[OTA_HASH_SIZE];
+    mbedtls_sha256_finish(&sha, hash);
+    if (!verifySignature(trailer, hash)) return fail(OTA_ERROR_SIGNATURE);
+    if (!flushPage()) return false;
+
+    // Update.end() writes what it still buffers and the boot selection
+    running = false;
+    mbedtls_sha256_free(&sha);
+    if (gate != nullptr) gate(gate_context);
+    if (!Update.end(true)) {
+        error = OTA_ERROR_WRITE;
+        return false;
+    }
+    return true;
+}
+
+const char* OtaUpdater::errorString() const {
+    switch (error) {
+        case OTA_OK: return "No error";
+        case OTA_ERROR_BUSY: return "Another update is in progress";
+        case OTA_ERROR_HEADER: return "Not a firmware image for this device";
+        case OTA_ERROR_SPACE: return "Image larger than the update partition";
+        case OTA_ERROR_WRITE: return Update.errorString();
+        case OTA_ERROR_SIZE: return "Image too small";
+        case OTA_ERROR_TRAILER: return "Image is not signed";
+        case OTA_ERROR_SIGNATURE: return "Signature check failed";
+        case OTA_ERROR_ABORTED: return "Update aborted";
+        case OTA_ERROR_COMPRESSED: return GzipDecoder::errorString(gzip_error);
+        case OTA_ERROR_MEMORY: return "Not enough memory to decompress";
+        default: return "Unknown error";
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Update.h>
+#include <esp_app_format.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include "gzip_decoder.h"
+#include "latency_histogram.h"
+
+// Signed firmware upload, streamed into Update as the chunks arrive.
+//
+// The first chunk must start with an ESP application image header for this
+// chip, otherwise the upload is refused before anything is written. Every
+// image byte is hashed with SHA-256 on its way to flash (the SHA peripheral
+// does the work through mbedtls), so nothing is read back. The upload ends
+// with a fixed size trailer (tools/ota_sign.py) holding the image size and an
+// ECDSA P-256 signature of the hash; the last OTA_TRAILER_SIZE bytes received
+// are held back from flash until the end shows whether they are the trailer.
+// The signature is checked against OTA_PUBLIC_KEY_PEM (ota_public_key.h)
+// before Update.end(), so an unsigned or altered image is never made bootable.
+//
+// An upload starting with the gzip magic is a signed image compressed whole
+// (tools/ota_pack.py). It is inflated on the fly by a GzipDecoder allocated
+// for the upload (about 10 KB, freed at the end), which hands the image on in
+// flash sector sized pieces; header check, hash and trailer work as above on
+// the decompressed bytes. Any failure aborts Update, and the running image is
+// left as it was.
+//
+// Image bytes reach Update one flash sector (OTA_PAGE_SIZE) at a time, so
+// every Update.write() is exactly one erase and write, with the CPU stalled
+// meanwhile. A flash gate, if set, runs before each one and may block to
+// time it (the web server waits for a gap between sensor samples); the
+// time Update.write() takes is kept in getFlashTime().
+#define OTA_TRAILER_MAGIC 0x5341544F    // "OTAS"
+#define OTA_SIGNATURE_MAX 72            // DER ECDSA P-256 signature, padded
+#define OTA_MIN_IMAGE_SIZE 200000       // anything smaller is not this firmware
+#define OTA_PAGE_SIZE 4096              // flash sector, Update's own buffer size
+
+struct OtaTrailer {
+    uint32_t magic;
+    uint32_t image_size;
+    uint16_t signature_len;
+    uint16_t reserved;
+    uint8_t signature[OTA_SIGNATURE_MAX];
+};
+
+#define OTA_TRAILER_SIZE sizeof(OtaTrailer)
+
+enum OtaError : uint8_t {
+    OTA_OK = 0,
+    OTA_ERROR_BUSY,             // an upload is already running
+    OTA_ERROR_HEADER,           // not an application image for this chip
+    OTA_ERROR_SPACE,
+    OTA_ERROR_WRITE,            // Update refused the data, see Update.errorString()
+    OTA_ERROR_SIZE,
+    OTA_ERROR_TRAILER,          // no signature trailer, or its size does not match
+    OTA_ERROR_SIGNATURE,
+    OTA_ERROR_ABORTED,
+    OTA_ERROR_COMPRESSED,       // bad gzip stream, see getCompressedError()
+    OTA_ERROR_MEMORY,
+};
+
+class OtaUpdater {
+public:
+    typedef void (*FlashGate)(void* context);
+
+private:
+    mbedtls_sha256_context sha;
+    uint8_t tail[OTA_TRAILER_SIZE];     // last bytes received, not yet written
+    size_t tail_len;
+    size_t written;                     // image bytes hashed and passed on
+    size_t received;                    // upload bytes, compressed or not
+    size_t space;                       // size of the update partition
+    bool running;
+    OtaError error;
+    GzipDecoder* gzip;                  // set while a compressed upload runs
+    GzipError gzip_error;
+    uint8_t* page;                      // next sector for Update, set while running
+    size_t page_len;
+    FlashGate gate;
+    void* gate_context;
+    LatencyHistogram flash_time;        // Update.write() of one page
+
+    bool writeImage(const uint8_t* data, size_t len);
+    bool writeDecoded(const uint8_t* data, size_t len);
+    static bool decoded(void* context, const uint8_t* data, size_t len);
+    bool flushPage();
+    bool finish();
+    bool failCompressed();
+    void release();
+    bool fail(OtaError reason);
+    bool verifySignature(const OtaTrailer& trailer, const uint8_t* hash);
+
+public:
+    OtaUpdater();
+
+    // Called before each flash write, from the uploading task
+    void setFlashGate(FlashGate flash_gate, void* context) { gate = flash_gate; gate_context = context; }
+
+    // begin() before the first chunk, write() with every chunk, end() after
+    // the last. Each returns false once the upload has failed; Update is
+    // aborted then and later calls do nothing.
+    bool begin();
+    bool write(const uint8_t* data, size_t len);
+    bool end();
+    void abort();
+
+    bool isRunning() const { return running; }
+    OtaError getError() const { return error; }
+    const char* errorString() const;
+    size_t getWritten() const { return written; }
+    size_t getReceived() const { return received; }
+    GzipError getCompressedError() const { return gzip_error; }
+    const LatencyHistogram& getFlashTime() const { return flash_time; }    // this upload's
+};
@@ -0,0 +1,160 @@
+#include "packed_history.h"
+
+static_assert(sizeof(PackedHistoryBlock) == 12 + PACKED_HISTORY_BLOCK_BYTES, "PackedHistoryBlock header must stay 12 bytes");
+static_assert(PACKED_HISTORY_BLOCKS >= 2, "Packed history needs at least two blocks");
+static_assert(PACKED_HISTORY_BLOCK_BYTES <= 255, "Block payload offset must fit in uint8_t");
+
+static inline uint32_t zigzagEncode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzagDecode(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+PackedHistory::PackedHistory(uint32_t point_interval_ms) {
+    interval_ms = point_interval_ms;
+    next_seq = 0;
+    clear();
+}
+
+void PackedHistory::clear() {
+    // The sequence keeps counting so client cursors stay valid across a clear
+    for (uint8_t i = 0; i < PACKED_HISTORY_BLOCKS; i++) {
+        blocks[i].count = 0;
+        blocks[i].used = 0;
+    }
+    head = 0;
+    block_count = 0;
+    oldest_seq = next_seq;
+    last_time_ms = 0;
+    last_distance = 0;
+    cursor_valid = false;
+}
+
+void PackedHistory::startBlock(uint32_t time_ms, int16_t distance) {
+    uint8_t next = (block_count == 0) ? head : (head + 1) % PACKED_HISTORY_BLOCKS;
+    PackedHistoryBlock& block = blocks[next];
+
+    if (block_count == PACKED_HISTORY_BLOCKS) {
+        oldest_seq += block.count; // Evict the oldest block
+    } else {
+        block_count++;
+    }
+
+    // Invalidate before reuse; readers re-check first_seq after decoding
+    block.count = 0;
+    block.used = 0;
+    block.first_seq = next_seq;
+    block.first_time_ms = time_ms;
+    block.base_distance = distance;
+
+    head = next;
+    last_distance = distance;
+}
+
+void PackedHistory::append(uint32_t time_ms, int16_t distance, bool output1, bool output2) {
+    PackedHistoryBlock* block = &blocks[head];
+    if (block_count == 0 ||
+        time_ms - last_time_ms != interval_ms ||
+        block->count == UINT8_MAX ||
+        block->used + PACKED_HISTORY_VARINT_MAX > PACKED_HISTORY_BLOCK_BYTES) {
+        startBlock(time_ms, distance);
+        block = &blocks[head];
+    }
+
+    uint32_t word = (zigzagEncode((int32_t)distance - last_distance) << 2) |
+                    (output2 ? 2 : 0) | (output1 ? 1 : 0);
+    uint8_t pos = block->used;
+    while (word >= 0x80) {
+        block->data[pos++] = (uint8_t)(word | 0x80);
+        word >>= 7;
+    }
+    block->data[pos++] = (uint8_t)word;
+
+    // Publish the point only after it has been written
+    block->used = pos;
+    block->count++;
+    next_seq++;
+
+    last_distance = distance;
+    last_time_ms = time_ms;
+}
+
+int PackedHistory::findBlock(uint32_t seq) {
+    for (uint8_t i = 0; i < block_count; i++) {
+        const PackedHistoryBlock& block = blocks[i];
+        if (seq - block.first_seq < block.count) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool PackedHistory::get(uint32_t seq, uint32_t& time_ms, int16_t& distance, bool& output1, bool& output2) {
+    if (seq - oldest_seq >= next_seq - oldest_seq) {
+        return false; // Not written yet, cleared or already evicted
+    }
+
+    int index;
+    uint8_t offset;
+    uint32_t pos_seq;
+    int32_t value;
+
+    if (cursor_valid && seq == cursor_seq &&
+        blocks[cursor_block].first_seq == cursor_block_seq &&
+        seq - cursor_block_seq < blocks[cursor_block].count) {
+        // Continue from the previous read
+        index = cursor_block;
+        offset = cursor_offset;
+        pos_seq = cursor_seq;
+        value = cursor_distance;
+    } else {
+        index = findBlock(seq);
+        if (index < 0) return false;
+        offset = 0;
+        pos_seq = blocks[index].first_seq;
+        value = blocks[index].base_distance;
+    }
+
+    const PackedHistoryBlock& block = blocks[index];
+    uint32_t block_seq = block.first_seq;
+    uint32_t word = 0;
+
+    while (true) {
+        word = 0;
+        uint8_t shift = 0;
+        uint8_t byte;
+        do {
+            if (offset >= PACKED_HISTORY_BLOCK_BYTES) {
+                cursor_valid = false;
+                return false; // Block was recycled while decoding
+            }
+            byte = block.data[offset++];
+            word |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        value += zigzagDecode(word >> 2);
+        if (pos_seq == seq) break;
+        pos_seq++;
+    }
+
+    if (block.first_seq != block_seq) {
+        cursor_valid = false;
+        return false; // Block was recycled while decoding
+    }
+
+    time_ms = block.first_time_ms + (seq - block_seq) * interval_ms;
+    distance = (int16_t)value;
+    output1 = word & 1;
+    output2 = word & 2;
+
+    cursor_valid = true;
+    cursor_block = index;
+    cursor_offset = offset;
+    cursor_seq = seq + 1;
+    cursor_block_seq = block_seq;
+    cursor_distance = (int16_t)value;
+    return true;
+}
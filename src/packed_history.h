@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bit-packed, delta-encoded storage for the fixed-interval history points.
+//
+// Points are grouped in blocks. A block stores the sequence number and time of
+// its first point, so per-point timestamps are implicit from the slot index.
+// Each point is one varint holding (zigzag(distance delta) << 2) | output bits;
+// slowly changing distances take a single byte instead of an 8 byte struct.
+// Blocks are located by sequence number (random access by block) and decoded
+// sequentially; a decode cursor makes in-order reads O(1) per point.
+#define PACKED_HISTORY_RAM_BYTES 480     // same RAM as the previous 60 point buffer
+#define PACKED_HISTORY_BLOCK_BYTES 64    // encoded payload bytes per block
+#define PACKED_HISTORY_VARINT_MAX 3      // 16 bit zigzag delta + 2 output bits
+
+struct PackedHistoryBlock {
+    uint32_t first_seq;       // sequence number of the first point
+    uint32_t first_time_ms;   // millis() of the first point
+    int16_t base_distance;    // distance the first delta is relative to
+    uint8_t count;            // points in this block
+    uint8_t used;             // payload bytes in use
+    uint8_t data[PACKED_HISTORY_BLOCK_BYTES];
+};
+
+#define PACKED_HISTORY_BLOCKS (PACKED_HISTORY_RAM_BYTES / sizeof(PackedHistoryBlock))
+
+class PackedHistory {
+private:
+    PackedHistoryBlock blocks[PACKED_HISTORY_BLOCKS];
+    uint8_t head;             // block currently being appended to
+    uint8_t block_count;      // blocks holding points
+    uint32_t interval_ms;
+    uint32_t next_seq;
+    uint32_t oldest_seq;
+    uint32_t last_time_ms;
+    int16_t last_distance;
+
+    // Decode cursor for sequential reads
+    bool cursor_valid;
+    uint8_t cursor_block;
+    uint8_t cursor_offset;
+    uint32_t cursor_seq;       // next sequence the cursor will decode
+    uint32_t cursor_block_seq; // first_seq of the block the cursor belongs to
+    int16_t cursor_distance;
+
+    void startBlock(uint32_t time_ms, int16_t distance);
+    int findBlock(uint32_t seq);
+
+public:
+    PackedHistory(uint32_t point_interval_ms);
+
+    // Appends the next point. A point that is not exactly one interval after the
+    // previous one starts a new block so timestamps stay implicit.
+    void append(uint32_t time_ms, int16_t distance, bool output1, bool output2);
+    void clear();
+
+    uint32_t getOldestSeq() { return oldest_seq; }
+    uint32_t getNextSeq() { return next_seq; }
+    uint32_t getCount() { return next_seq - oldest_seq; }
+
+    // Decodes one point. Returns false if seq is not (or no longer) stored.
+    bool get(uint32_t seq, uint32_t& time_ms, int16_t& distance, bool& output1, bool& output2);
+};
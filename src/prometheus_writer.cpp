@@ -0,0 +1,78 @@
+#include "prometheus_writer.h"
+#include <stdarg.h>
+
+// µs as seconds with six decimals, without floating point
+static void formatSeconds(char* out, size_t size, uint32_t seconds, uint32_t us) {
+    snprintf(out, size, "%lu.%06lu", (unsigned long)seconds, (unsigned long)us);
+}
+
+void PrometheusWriter::line(const char* format, ...) {
+    char buffer[PROMETHEUS_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer) - 1, format, args);
+    va_end(args);
+    if (len < 0) return;
+    if (len > (int)sizeof(buffer) - 2) len = sizeof(buffer) - 2;
+    buffer[len++] = '\n';
+    out.write((const uint8_t*)buffer, len);
+}
+
+// name + suffix, the labels and one extra label (le for buckets), then the value
+void PrometheusWriter::sample(const char* name, const char* suffix, const char* labels, const char* extra,
+                              const char* value) {
+    bool has_labels = labels != nullptr && labels[0] != '\0';
+    if (!has_labels && extra == nullptr) {
+        line("%s%s %s", name, suffix, value);
+    } else {
+        line("%s%s{%s%s%s} %s", name, suffix, has_labels ? labels : "", has_labels && extra != nullptr ? "," : "",
+             extra != nullptr ? extra : "", value);
+    }
+}
+
+void PrometheusWriter::describe(const char* name, const char* type, const char* help) {
+    line("# HELP %s %s", name, help);
+    line("# TYPE %s %s", name, type);
+}
+
+void PrometheusWriter::value(const char* name, const char* labels, uint32_t value) {
+    char text[12];
+    snprintf(text, sizeof(text), "%lu", (unsigned long)value);
+    sample(name, "", labels, nullptr, text);
+}
+
+void PrometheusWriter::counter(const char* name, const char* help, uint32_t value) {
+    describe(name, "counter", help);
+    this->value(name, nullptr, value);
+}
+
+void PrometheusWriter::gauge(const char* name, const char* help, uint32_t value) {
+    describe(name, "gauge", help);
+    this->value(name, nullptr, value);
+}
+
+void PrometheusWriter::histogram(const char* name, const char* labels, const LatencyHistogram& histogram) {
+    // Copy first so the buckets add up to the count even while record() runs
+    LatencyHistogram h = histogram;
+    char le[24];
+    char text[24];
+    uint32_t cumulative = 0;
+    for (int k = 0; k < LATENCY_HISTOGRAM_BUCKETS - 1; k++) {
+        cumulative += h.counts[k];
+        if (k % PROMETHEUS_BUCKET_STEP != 0) continue;
+        uint32_t bound = LatencyHistogram::bound(k);
+        strcpy(le, "le=\"");
+        formatSeconds(le + 4, sizeof(le) - 5, bound / 1000000, bound % 1000000);
+        strcat(le, "\"");
+        snprintf(text, sizeof(text), "%lu", (unsigned long)cumulative);
+        sample(name, "_bucket", labels, le, text);
+    }
+    cumulative += h.counts[LATENCY_HISTOGRAM_BUCKETS - 1];
+    snprintf(text, sizeof(text), "%lu", (unsigned long)cumulative);
+    sample(name, "_bucket", labels, "le=\"+Inf\"", text);
+
+    formatSeconds(text, sizeof(text), h.sum_ms / 1000, (h.sum_ms % 1000) * 1000 + h.sum_us);
+    sample(name, "_sum", labels, nullptr, text);
+    snprintf(text, sizeof(text), "%lu", (unsigned long)cumulative);
+    sample(name, "_count", labels, nullptr, text);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include "latency_histogram.h"
+
+// Writes metrics in the Prometheus text exposition format (version 0.0.4)
+// to a Print, one line at a time through a small stack buffer. Durations are
+// converted from µs to seconds as Prometheus expects. Labels are passed
+// preformatted without braces, e.g. "route=\"/api/status\"", or nullptr.
+#define PROMETHEUS_CONTENT_TYPE "text/plain; version=0.0.4"
+#define PROMETHEUS_LINE_MAX 160
+#define PROMETHEUS_BUCKET_STEP 2        // every second histogram bound (x4 steps), to keep a scrape small
+
+class PrometheusWriter {
+private:
+    Print& out;
+
+    void line(const char* format, ...);
+    void sample(const char* name, const char* suffix, const char* labels, const char* extra, const char* value);
+
+public:
+    PrometheusWriter(Print& output) : out(output) {}
+
+    // # HELP and # TYPE lines; once per metric name, before its samples
+    void describe(const char* name, const char* type, const char* help);
+
+    void value(const char* name, const char* labels, uint32_t value);
+
+    // Shortcuts for a metric with a single unlabelled sample
+    void counter(const char* name, const char* help, uint32_t value);
+    void gauge(const char* name, const char* help, uint32_t value);
+
+    // _bucket, _sum and _count samples of a histogram described as "histogram"
+    void histogram(const char* name, const char* labels, const LatencyHistogram& histogram);
+};
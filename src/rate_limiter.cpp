@@ -0,0 +1,73 @@
+#include "rate_limiter.h"
+#include <string.h>
+
+#define RATE_LIMIT_TOKEN 1000                                   // one request, in thousandths
+#define RATE_LIMIT_CAPACITY (RATE_LIMIT_BURST * RATE_LIMIT_TOKEN)
+#define RATE_LIMIT_FULL_MS (RATE_LIMIT_CAPACITY / RATE_LIMIT_PER_SECOND)   // empty to full
+
+static_assert(RATE_LIMIT_FULL_MS > 0, "RATE_LIMIT_PER_SECOND this high refills every bucket at once: no limit");
+
+RateLimiter::RateLimiter() {
+    clear();
+}
+
+void RateLimiter::clear() {
+    memset(buckets, 0, sizeof(buckets));
+    allowed = 0;
+    limited = 0;
+}
+
+RateLimiter::Bucket& RateLimiter::bucketFor(uint32_t client, uint32_t now) {
+    Bucket* oldest = &buckets[0];
+    for (Bucket& bucket : buckets) {
+        if (bucket.used && bucket.client == client) return bucket;
+        if (!bucket.used) {
+            if (oldest->used) oldest = &bucket;
+        } else if (oldest->used && (int32_t)(bucket.last_ms - oldest->last_ms) < 0) {
+            oldest = &bucket;
+        }
+    }
+
+    // A free slot if there is one, else the client seen longest ago
+    oldest->client = client;
+    oldest->tokens = RATE_LIMIT_CAPACITY;
+    oldest->last_ms = now;
+    oldest->used = true;
+    return *oldest;
+}
+
+bool RateLimiter::allow(uint32_t client, uint32_t now, uint32_t& retry_after_s) {
+    Bucket& bucket = bucketFor(client, now);
+
+    // Refill; anything longer than an empty-to-full refill is just full
+    uint32_t elapsed = now - bucket.last_ms;
+    if (elapsed >= RATE_LIMIT_FULL_MS) {
+        bucket.tokens = RATE_LIMIT_CAPACITY;
+    } else {
+        bucket.tokens += elapsed * RATE_LIMIT_PER_SECOND;
+        if (bucket.tokens > RATE_LIMIT_CAPACITY) bucket.tokens = RATE_LIMIT_CAPACITY;
+    }
+    bucket.last_ms = now;
+
+    if (bucket.tokens >= RATE_LIMIT_TOKEN) {
+        bucket.tokens -= RATE_LIMIT_TOKEN;
+        allowed++;
+        return true;
+    }
+
+    uint32_t wait_ms = (RATE_LIMIT_TOKEN - bucket.tokens + RATE_LIMIT_PER_SECOND - 1) / RATE_LIMIT_PER_SECOND;
+    retry_after_s = (wait_ms + 999) / 1000;
+    limited++;
+    return false;
+}
+
+RateLimitStats RateLimiter::getStats() const {
+    RateLimitStats stats;
+    stats.allowed = allowed;
+    stats.limited = limited;
+    stats.clients = 0;
+    for (const Bucket& bucket : buckets) {
+        if (bucket.used) stats.clients++;
+    }
+    return stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-client token buckets for the HTTP API.
+//
+// Each client address gets a bucket of RATE_LIMIT_BURST requests that refills
+// at RATE_LIMIT_PER_SECOND. The page polls the status every 200 ms, so two
+// tabs take 10 requests per second and leave 5 for the config, history and
+// login requests around them. Tokens are
+// kept in thousandths so the refill is integer arithmetic on milliseconds.
+// The table is a fixed array scanned linearly; with more clients than slots
+// the one seen longest ago is forgotten and starts again with a full bucket.
+// Not thread safe: all calls come from the web server task.
+#define RATE_LIMIT_CLIENTS 8            // soft AP allows AP_MAX_CONNECTIONS stations
+
+// Overridable with -D
+#ifndef RATE_LIMIT_BURST
+#define RATE_LIMIT_BURST 20             // requests
+#endif
+#ifndef RATE_LIMIT_PER_SECOND
+#define RATE_LIMIT_PER_SECOND 15        // requests per second, sustained
+#endif
+
+struct RateLimitStats {
+    uint32_t allowed;
+    uint32_t limited;
+    uint8_t clients;                    // buckets in use
+};
+
+class RateLimiter {
+private:
+    struct Bucket {
+        uint32_t client;                // IPv4 address
+        uint32_t tokens;                // thousandths of a request
+        uint32_t last_ms;               // last refill
+        bool used;
+    };
+
+    Bucket buckets[RATE_LIMIT_CLIENTS];
+    uint32_t allowed;
+    uint32_t limited;
+
+    Bucket& bucketFor(uint32_t client, uint32_t now);
+
+public:
+    RateLimiter();
+
+    // Takes a token for one request of client. False if the bucket is empty;
+    // retry_after_s is then the whole seconds until the next token.
+    bool allow(uint32_t client, uint32_t now, uint32_t& retry_after_s);
+    void clear();
+
+    RateLimitStats getStats() const;
+};
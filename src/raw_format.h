@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// On-flash and download format of the raw sample recorder (see raw_recorder.h).
+// Shared with the host decoder (tools/raw_decode.py) and replay, so this header
+// must stay free of Arduino dependencies. All fields are little endian.
+//
+// The log is a sequence of 256 byte pages. Every page starts with a RawPageHeader;
+// a session page carries a RawSessionInfo, a sample page up to
+// RAW_SAMPLES_PER_PAGE RawSamples. Pages with a bad magic or CRC are skipped.
+#define RAW_FORMAT_VERSION 2
+#define RAW_PAGE_MAGIC 0x50574152UL   // "RAWP"
+#define RAW_PAGE_BYTES 256
+#define RAW_SECTOR_BYTES 4096
+
+#define RAW_PAGE_SESSION 1
+#define RAW_PAGE_SAMPLES 2
+
+#define RAW_SAMPLE_FLAG_OUTPUT1 0x01  // output state after this sample (for comparison on replay)
+#define RAW_SAMPLE_FLAG_OUTPUT2 0x02
+
+struct RawPageHeader {
+    uint32_t magic;
+    uint32_t page_seq;    // increases for every page written, never reused
+    uint16_t session;     // recording session the page belongs to
+    uint8_t type;         // RAW_PAGE_*
+    uint8_t count;        // samples in a sample page
+    uint32_t crc;         // CRC-32 (zlib) of the page with this field zeroed
+};
+
+#define RAW_FILTER_READINGS 8
+#define RAW_FILTER_CHANGE_DETECTED 0x01
+#define RAW_FILTER_INITIALIZED 0x02
+
+// Sample path state at the start of a session, so a replay continues exactly
+// where the device was instead of starting from a cold filter - 32 bytes
+struct RawFilterState {
+    float filtered_value;
+    int16_t recent_readings[RAW_FILTER_READINGS];
+    uint8_t recent_index;
+    uint8_t recent_count;
+    uint8_t change_confirmation_count;
+    uint8_t filter_flags;        // RAW_FILTER_*
+    int16_t current_distance;
+    int16_t filtered_distance;
+    uint8_t out_of_range;
+    uint8_t output1_state;
+    uint8_t output2_state;
+    uint8_t fault_count;
+};
+
+// Everything the sample path depends on besides the samples themselves
+struct RawSessionInfo {
+    uint8_t format_version;
+    uint8_t reserved;
+    uint16_t timing_budget_ms;
+    uint32_t start_time_us;      // low 32 bits of the sample clock at start
+    uint16_t output1_min;
+    uint16_t output1_max;
+    uint16_t output1_hysteresis;
+    uint8_t output1_active_in_range;
+    uint8_t output1_enabled;
+    uint16_t output2_min;
+    uint16_t output2_max;
+    uint16_t output2_hysteresis;
+    uint8_t output2_active_in_range;
+    uint8_t output2_enabled;
+    char firmware[16];
+    RawFilterState state;        // since format version 2
+};
+
+// One data-ready sample as read from the sensor - 12 bytes
+struct RawSample {
+    uint32_t time_us;        // low 32 bits of the sample clock; the decoder unwraps it
+    int16_t distance;        // mm, as returned by distance()
+    uint8_t range_status;    // vl_status
+    uint8_t flags;           // RAW_SAMPLE_FLAG_*
+    uint16_t signal_rate;    // kcps
+    uint16_t ambient_rate;   // kcps
+};
+
+#define RAW_SAMPLES_PER_PAGE ((RAW_PAGE_BYTES - sizeof(RawPageHeader)) / sizeof(RawSample))
+
+struct RawPage {
+    RawPageHeader header;
+    union {
+        RawSessionInfo session;
+        RawSample samples[RAW_SAMPLES_PER_PAGE];
+        uint8_t payload[RAW_PAGE_BYTES - sizeof(RawPageHeader)];
+    };
+};
+
+static_assert(sizeof(RawPageHeader) == 16, "RawPageHeader layout is part of the format");
+static_assert(sizeof(RawFilterState) == 32, "RawFilterState layout is part of the format");
+static_assert(sizeof(RawSessionInfo) == 72, "RawSessionInfo layout is part of the format");
+static_assert(sizeof(RawSample) == 12, "RawSample layout is part of the format");
+static_assert(sizeof(RawPage) == RAW_PAGE_BYTES, "RawPage must fill one flash page");
+static_assert(RAW_SECTOR_BYTES % RAW_PAGE_BYTES == 0, "Sectors must hold whole pages");
@@ -0,0 +1,234 @@
+#include "raw_recorder.h"
+#include <esp_rom_crc.h>
+
+#define RAW_PAGES_PER_SECTOR (RAW_SECTOR_BYTES / RAW_PAGE_BYTES)
+
+RawRecorder::RawRecorder() {
+    partition = nullptr;
+    page_total = 0;
+    write_page = 0;
+    next_page_seq = 1;
+    oldest_page_seq = 1;
+    session = 0;
+    fill_page = 0;
+    flush_page = 0;
+    flush_pending = false;
+    session_pending = false;
+    erase_pending = false;
+    recording = false;
+    dropped_pages = 0;
+    sample_count = 0;
+    task = nullptr;
+    memset(pages, 0, sizeof(pages));
+    memset(&session_page, 0, sizeof(session_page));
+}
+
+uint32_t RawRecorder::pageCrc(const RawPage& page) {
+    // CRC over the header without its crc field, then the payload
+    const uint8_t* bytes = (const uint8_t*)&page;
+    uint32_t crc = esp_rom_crc32_le(0, bytes, offsetof(RawPageHeader, crc));
+    return esp_rom_crc32_le(crc, bytes + sizeof(RawPageHeader), RAW_PAGE_BYTES - sizeof(RawPageHeader));
+}
+
+bool RawRecorder::readPage(uint32_t index, void* out) {
+    if (partition == nullptr || index >= page_total) return false;
+    return esp_partition_read(partition, index * RAW_PAGE_BYTES, out, RAW_PAGE_BYTES) == ESP_OK;
+}
+
+bool RawRecorder::begin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         (esp_partition_subtype_t)RAW_PARTITION_SUBTYPE,
+                                         RAW_PARTITION_LABEL);
+    if (partition == nullptr) {
+        Serial.println("[RAW] No rawlog partition - raw recording disabled");
+        return false;
+    }
+
+    page_total = (partition->size / RAW_SECTOR_BYTES) * RAW_PAGES_PER_SECTOR;
+    scan();
+
+    if (xTaskCreate(taskEntry, "raw_recorder", RAW_TASK_STACK, this,
+                    RAW_TASK_PRIORITY, &task) != pdPASS) {
+        Serial.println("[RAW] Failed to start writer task");
+        partition = nullptr;
+        return false;
+    }
+
+    Serial.printf("[RAW] %lu KB log, pages %lu..%lu, next session %u\n",
+                  (unsigned long)(partition->size / 1024), (unsigned long)oldest_page_seq,
+                  (unsigned long)next_page_seq, session + 1);
+    return true;
+}
+
+void RawRecorder::scan() {
+    // Only the page headers are read; the newest page decides where to resume
+    uint32_t newest_seq = 0;
+    uint32_t newest_index = 0;
+    uint32_t oldest_seq = UINT32_MAX;
+
+    for (uint32_t i = 0; i < page_total; i++) {
+        RawPageHeader header;
+        if (esp_partition_read(partition, i * RAW_PAGE_BYTES, &header, sizeof(header)) != ESP_OK) continue;
+        if (header.magic != RAW_PAGE_MAGIC) continue;
+
+        if (header.page_seq >= newest_seq) {
+            newest_seq = header.page_seq;
+            newest_index = i;
+            session = header.session;
+        }
+        if (header.page_seq < oldest_seq) {
+            oldest_seq = header.page_seq;
+        }
+    }
+
+    if (newest_seq == 0) {
+        write_page = 0;
+        next_page_seq = 1;
+        oldest_page_seq = 1;
+        return;
+    }
+
+    // Resume at the next sector boundary: the rest of the current sector may
+    // hold a page that was torn by a power loss and cannot be programmed again
+    write_page = ((newest_index / RAW_PAGES_PER_SECTOR) + 1) * RAW_PAGES_PER_SECTOR;
+    if (write_page >= page_total) write_page = 0;
+    next_page_seq = newest_seq + 1;
+    oldest_page_seq = oldest_seq;
+}
+
+void RawRecorder::start(const RawSessionInfo& info) {
+    if (partition == nullptr || recording) return;
+
+    session++;
+    memset(&session_page, 0xFF, sizeof(session_page));
+    session_page.header.magic = RAW_PAGE_MAGIC;
+    session_page.header.session = session;
+    session_page.header.type = RAW_PAGE_SESSION;
+    session_page.header.count = 0;
+    session_page.session = info;
+    session_page.session.format_version = RAW_FORMAT_VERSION;
+
+    pages[fill_page].header.count = 0;
+    sample_count = 0;
+    session_pending = true;
+    recording = true;
+    xTaskNotifyGive(task);
+    Serial.printf("[RAW] Recording session %u\n", session);
+}
+
+void RawRecorder::stop() {
+    if (!recording) return;
+    recording = false;
+
+    // Hand over the partially filled page
+    if (pages[fill_page].header.count > 0 && !flush_pending) {
+        pages[fill_page].header.session = session;
+        flush_page = fill_page;
+        flush_pending = true;
+        fill_page ^= 1;
+        pages[fill_page].header.count = 0;
+        xTaskNotifyGive(task);
+    }
+    Serial.printf("[RAW] Session %u stopped, %lu samples\n", session, (unsigned long)sample_count);
+}
+
+void RawRecorder::append(const RawSample& sample) {
+    if (!recording) return;
+
+    RawPage& page = pages[fill_page];
+    page.samples[page.header.count++] = sample;
+    sample_count++;
+
+    if (page.header.count < RAW_SAMPLES_PER_PAGE) {
+        return;
+    }
+
+    if (flush_pending) {
+        // Writer has not finished the previous page; refill this one instead of blocking
+        dropped_pages++;
+        page.header.count = 0;
+        return;
+    }
+    // Stamp the session now; a new session may start before the page is written
+    page.header.session = session;
+    flush_page = fill_page;
+    flush_pending = true;
+    fill_page ^= 1;
+    pages[fill_page].header.count = 0;
+    xTaskNotifyGive(task);
+}
+
+void RawRecorder::erase() {
+    if (partition == nullptr) return;
+    erase_pending = true;
+    xTaskNotifyGive(task);
+}
+
+void RawRecorder::taskEntry(void* arg) {
+    static_cast<RawRecorder*>(arg)->taskLoop();
+}
+
+void RawRecorder::taskLoop() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (erase_pending) {
+            eraseAll();
+            erase_pending = false;
+        }
+        if (session_pending) {
+            writePage(session_page);
+            session_pending = false;
+        }
+        if (flush_pending) {
+            RawPage& page = pages[flush_page];
+            page.header.magic = RAW_PAGE_MAGIC;
+            page.header.type = RAW_PAGE_SAMPLES;
+            // Unused sample slots read back as erased flash
+            memset(&page.samples[page.header.count], 0xFF,
+                   (RAW_SAMPLES_PER_PAGE - page.header.count) * sizeof(RawSample));
+            writePage(page);
+            flush_pending = false;
+        }
+    }
+}
+
+void RawRecorder::writePage(RawPage& page) {
+    uint32_t offset = write_page * RAW_PAGE_BYTES;
+
+    // Entering a sector: erase it, dropping the oldest pages of the circular log
+    if (write_page % RAW_PAGES_PER_SECTOR == 0) {
+        if (esp_partition_erase_range(partition, offset, RAW_SECTOR_BYTES) != ESP_OK) {
+            Serial.println("[RAW] Sector erase failed");
+            return;
+        }
+        if (next_page_seq > page_total - RAW_PAGES_PER_SECTOR) {
+            uint32_t floor_seq = next_page_seq - (page_total - RAW_PAGES_PER_SECTOR);
+            if (oldest_page_seq < floor_seq) oldest_page_seq = floor_seq;
+        }
+    }
+
+    page.header.page_seq = next_page_seq;
+    page.header.crc = pageCrc(page);
+    if (esp_partition_write(partition, offset, &page, RAW_PAGE_BYTES) != ESP_OK) {
+        Serial.println("[RAW] Page write failed");
+    }
+
+    next_page_seq++;
+    write_page++;
+    if (write_page >= page_total) write_page = 0;
+}
+
+void RawRecorder::eraseAll() {
+    bool was_recording = recording;
+    recording = false;
+    esp_partition_erase_range(partition, 0, page_total * RAW_PAGE_BYTES);
+    write_page = 0;
+    oldest_page_seq = next_page_seq;
+    Serial.println("[RAW] Log erased");
+    if (was_recording) {
+        // Keep the session header in front of the samples that follow
+        session_pending = true;
+        recording = true;
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "raw_format.h"
+
+// Full-rate raw sample recorder.
+//
+// Writes every data-ready sample to the "rawlog" data partition (see
+// partitions.csv) through the esp_partition API, bypassing the filesystem.
+// Samples are batched into 256 byte pages in RAM and written by a background
+// task as a circular log: a sector is erased when the write position enters it,
+// so the oldest 16 pages are dropped at a time and wear is spread evenly over
+// the whole partition. Recording is off until start() is called.
+#define RAW_PARTITION_LABEL "rawlog"
+#define RAW_PARTITION_SUBTYPE 0x40
+#define RAW_TASK_STACK 3072
+#define RAW_TASK_PRIORITY 1
+
+class RawRecorder {
+private:
+    const esp_partition_t* partition;
+    uint32_t page_total;
+    uint32_t write_page;        // page index the next page is written to
+    uint32_t next_page_seq;
+    uint32_t oldest_page_seq;   // lowest page_seq still in the partition
+    uint16_t session;
+
+    RawPage pages[2];           // double buffered sample pages
+    RawPage session_page;
+    uint8_t fill_page;
+    uint8_t flush_page;
+    volatile bool flush_pending;
+    volatile bool session_pending;
+    volatile bool erase_pending;
+    volatile bool recording;
+    uint32_t dropped_pages;
+    uint32_t sample_count;
+
+    TaskHandle_t task;
+
+    static void taskEntry(void* arg);
+    void taskLoop();
+    void writePage(RawPage& page);
+    void eraseAll();
+    void scan();
+
+public:
+    RawRecorder();
+
+    // Locates the partition and resumes after the newest page on it
+    bool begin();
+    bool isAvailable() { return partition != nullptr; }
+
+    // Starts a new session; info describes the configuration the samples run
+    // under. start() and stop() belong to the task that calls append().
+    void start(const RawSessionInfo& info);
+    void stop();
+    bool isRecording() { return recording; }
+
+    // Queues one sample. O(1), no flash access - safe to call from the sample loop.
+    void append(const RawSample& sample);
+
+    // Erases the whole log (performed by the writer task)
+    void erase();
+
+    uint32_t getPageTotal() { return page_total; }
+    uint32_t getOldestPageSeq() { return oldest_page_seq; }
+    uint32_t getNextPageSeq() { return next_page_seq; }
+    uint32_t getWritePage() { return write_page; }
+    uint32_t getDroppedPages() { return dropped_pages; }
+    TaskHandle_t getTask() { return task; }
+    uint32_t getSampleCount() { return sample_count; }
+    uint16_t getSession() { return session; }
+
+    // Reads page index `index` (0 .. page_total-1) of the partition into
+    // RAW_PAGE_BYTES of out (which need not be aligned)
+    bool readPage(uint32_t index, void* out);
+    static uint32_t pageCrc(const RawPage& page);
+};
@@ -1,4 +1,5 @@
 #include "sensor_manager.h"
+#include "sys_init.h"
 
 // MovingAverage implementation
 MovingAverage::MovingAverage(uint8_t buffer_size) {
@@ -317,12 +318,36 @@ float AdaptiveFilter::getVariance() {
     return variance_sum / (recent_count - 1);
 }
 
+void AdaptiveFilter::getState(RawFilterState& state) {
+    state.filtered_value = filtered_value;
+    for (uint8_t i = 0; i < RAW_FILTER_READINGS; i++) {
+        state.recent_readings[i] = i < buffer_size ? recent_readings[i] : 0;
+    }
+    state.recent_index = recent_index;
+    state.recent_count = recent_count;
+    state.change_confirmation_count = change_confirmation_count;
+    state.filter_flags = (change_detected ? RAW_FILTER_CHANGE_DETECTED : 0) |
+                         (is_initialized ? RAW_FILTER_INITIALIZED : 0);
+}
+
+void AdaptiveFilter::setState(const RawFilterState& state) {
+    filtered_value = state.filtered_value;
+    for (uint8_t i = 0; i < buffer_size; i++) {
+        recent_readings[i] = i < RAW_FILTER_READINGS ? state.recent_readings[i] : 0;
+    }
+    recent_index = state.recent_index % buffer_size;
+    recent_count = min(state.recent_count, buffer_size);
+    change_confirmation_count = state.change_confirmation_count;
+    change_detected = state.filter_flags & RAW_FILTER_CHANGE_DETECTED;
+    is_initialized = state.filter_flags & RAW_FILTER_INITIALIZED;
+}
+
 // SensorManager implementation
 SensorManager::SensorManager(Adafruit_VL53L1X* tof, Adafruit_NeoPixel* led, uint8_t out1_pin, uint8_t out2_pin) {
     tof_sensor = tof;
     status_led = led;
-    output1_pin = out1_pin;
-    output2_pin = out2_pin;
+    output_pins[0] = out1_pin;
+    output_pins[1] = out2_pin;
     
     distance_filter = new AdaptiveFilter(MOVING_AVERAGE_SIZE);
     
@@ -333,6 +358,25 @@ SensorManager::SensorManager(Adafruit_VL53L1X* tof, Adafruit_NeoPixel* led, uint
     fault_count = 0;
     out_of_range = false;
     last_reading_time = 0;
+    sample_sequence = 0;
+    sample_time_us = 0;
+    last_micros = micros();
+    uptime_us = last_micros;
+    transition_output = 0;
+    transition_state = false;
+    raw_recorder = nullptr;
+    raw_request = RAW_REQUEST_NONE;
+    metrics.sample_interval.reset();
+    metrics.update_time.reset();
+    metrics.filter_time.reset();
+    metrics.output_latency.reset();
+    metrics.faults = 0;
+    metrics.recoveries = 0;
+    metrics.ota_sample_interval.reset();
+    metrics.ota_missed_samples = 0;
+    sample_task = nullptr;
+    sample_period_us = SAMPLE_PERIOD_DEFAULT_US;
+    gap_waiter.store(nullptr);
     
     // Initialize enhanced noise detection variables
     rejected_readings_count = 0;
@@ -347,18 +391,32 @@ SensorManager::SensorManager(Adafruit_VL53L1X* tof, Adafruit_NeoPixel* led, uint
     custom_led_b = 0;
     
     // Initialize output configurations as disabled
-    output1_config = {false, 0, 0, HYSTERESIS_DEFAULT, true, false};
-    output2_config = {false, 0, 0, HYSTERESIS_DEFAULT, true, false};
+    settings_staged.outputs[0] = {false, 0, 0, HYSTERESIS_DEFAULT, true, OUTPUT_OTA_LIVE};
+    settings_staged.outputs[1] = {false, 0, 0, HYSTERESIS_DEFAULT, true, OUTPUT_OTA_LIVE};
+    settings_staged.capture_pre = CAPTURE_DEFAULT_PRE_SAMPLES;
+    settings_staged.capture_post = CAPTURE_DEFAULT_POST_SAMPLES;
+    for (int i = 0; i < 3; i++) settings_slots[i] = settings_staged;
+    settings_front = 0;
+    settings_middle.store(1);
+    settings_back = 2;
+    settings = &settings_slots[settings_front];
+    settings_lock = xSemaphoreCreateMutex();
+    output_states[0] = false;
+    output_states[1] = false;
     
     // Configure output pins
-    pinMode(output1_pin, OUTPUT);
-    pinMode(output2_pin, OUTPUT);
-    digitalWrite(output1_pin, LOW);
-    digitalWrite(output2_pin, LOW);
+    for (int i = 0; i < 2; i++) {
+        pinMode(output_pins[i], OUTPUT);
+        digitalWrite(output_pins[i], LOW);
+    }
+    
+    snapshot_sequence.store(0);
+    publishSnapshot();
 }
 
 SensorManager::~SensorManager() {
     delete distance_filter;
+    vSemaphoreDelete(settings_lock);
 }
 
 bool SensorManager::initialize() {
@@ -401,6 +459,66 @@ bool SensorManager::initialize() {
 }
 
 void SensorManager::update() {
+    // Settings published since the last call; fixed from here to the end of the sample
+    applyPendingSettings();
+    applyRawRequest();
+    if (sample_task == nullptr) sample_task = xTaskGetCurrentTaskHandle();
+    
+    uint32_t start_us = micros();
+    uint32_t previous_sequence = sample_sequence;
+    uint64_t previous_sample_us = sample_time_us;
+    updateSample();
+    bool sampled = sample_sequence != previous_sequence;
+    if (sampled) {
+        metrics.update_time.record(micros() - start_us);
+        if (previous_sequence != 0) recordInterval((uint32_t)(sample_time_us - previous_sample_us));
+    }
+    
+    publishSnapshot();
+    
+    // A sample has just been handled: wake the update writer, if it waits
+    // for the gap before the next one
+    if (sampled) {
+        TaskHandle_t waiter = gap_waiter.exchange(nullptr);
+        if (waiter != nullptr) xTaskNotifyGive(waiter);
+    }
+}
+
+// Outside updates the intervals keep the usual period current (outliers such
+// as a sensor recovery left out); during one they also go to their own
+// histogram, and each interval over one and a half periods counts the
+// samples it skipped.
+void SensorManager::recordInterval(uint32_t interval_us) {
+    metrics.sample_interval.record(interval_us);
+    if (!ota_update_mode.load(std::memory_order_relaxed)) {
+        if (interval_us < 4 * sample_period_us) {
+            sample_period_us = (int32_t)sample_period_us + ((int32_t)interval_us - (int32_t)sample_period_us) / 8;
+        }
+        return;
+    }
+    metrics.ota_sample_interval.record(interval_us);
+    if (interval_us > sample_period_us + sample_period_us / 2) {
+        metrics.ota_missed_samples += (interval_us + sample_period_us / 2) / sample_period_us - 1;
+    }
+}
+
+bool SensorManager::waitForSampleGap(uint32_t timeout_ms) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (!sensor_initialized || sample_task == nullptr || self == sample_task) return false;
+    
+    ulTaskNotifyTake(pdTRUE, 0);    // a wake-up left over from a wait that timed out
+    gap_waiter.store(self);
+    bool sampled = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0;
+    gap_waiter.store(nullptr);
+    return sampled;
+}
+
+void SensorManager::updateSample() {
+    // Extend micros() to 64 bits (it wraps every ~71 minutes)
+    uint32_t now_us = micros();
+    uptime_us += (uint32_t)(now_us - last_micros);
+    last_micros = now_us;
+    
     if (!sensor_initialized) {
         // Try to recover the sensor every 5 seconds
         static unsigned long last_recovery_attempt = 0;
@@ -408,6 +526,7 @@ void SensorManager::update() {
             last_recovery_attempt = millis();
             Serial.println("Attempting sensor recovery...");
             if (initialize()) {
+                metrics.recoveries++;
                 Serial.println("Sensor recovery successful!");
                 return;
             } else {
@@ -424,6 +543,9 @@ void SensorManager::update() {
     if (tof_sensor->dataReady()) {
         int16_t raw_distance = tof_sensor->distance();
         uint8_t range_status = tof_sensor->vl_status;
+        sample_time_us = uptime_us;
+        sample_sequence++;
+        transition_output = 0;
         
         // Check if this is a genuine sensor fault or just out of range
         bool is_genuine_fault = false;
@@ -455,6 +577,7 @@ void SensorManager::update() {
         
         if (is_genuine_fault) {
             fault_count++;
+            metrics.faults++;
             Serial.print("Sensor fault count: ");
             Serial.println(fault_count);
             
@@ -479,6 +602,7 @@ void SensorManager::update() {
                 
                 if (signal_quality_ok) {
                     // Add value to adaptive filter (always accepts, but adapts rate based on change detection)
+                    uint32_t filter_start_us = micros();
                     distance_filter->addValue(raw_distance);
                     
                     if (distance_filter->isReady()) {
@@ -487,6 +611,7 @@ void SensorManager::update() {
                         
                         // Calculate current variance for noise assessment
                         current_variance = distance_filter->getVariance();
+                        metrics.filter_time.record(micros() - filter_start_us);
                         
                         // Check if filter detected a sustained change
                         bool change_detected = distance_filter->isChangeDetected();
@@ -507,11 +632,11 @@ void SensorManager::update() {
                         
                         // Update device status based on output triggers
                         bool any_triggered = false;
-                        if (output1_config.enabled && checkOutputTrigger(output1_config, filtered_distance)) {
-                            any_triggered = true;
-                        }
-                        if (output2_config.enabled && checkOutputTrigger(output2_config, filtered_distance)) {
-                            any_triggered = true;
+                        for (int i = 0; i < 2; i++) {
+                            if (settings->outputs[i].enabled &&
+                                checkOutputTrigger(settings->outputs[i], output_states[i], filtered_distance)) {
+                                any_triggered = true;
+                            }
                         }
                         
                         device_status = any_triggered ? STATUS_TRIGGERED : STATUS_OK;
@@ -549,11 +674,10 @@ void SensorManager::update() {
                 
                 // Update device status based on current output states after the update
                 bool any_triggered = false;
-                if (output1_config.enabled && output1_config.current_state) {
-                    any_triggered = true;
-                }
-                if (output2_config.enabled && output2_config.current_state) {
-                    any_triggered = true;
+                for (int i = 0; i < 2; i++) {
+                    if (settings->outputs[i].enabled && output_states[i]) {
+                        any_triggered = true;
+                    }
                 }
                 
                 device_status = any_triggered ? STATUS_TRIGGERED : STATUS_OK;
@@ -566,6 +690,27 @@ void SensorManager::update() {
             last_reading_time = millis();
         }
         
+        uint8_t capture_flags = (output_states[0] ? CAPTURE_FLAG_OUTPUT1 : 0) |
+                                (output_states[1] ? CAPTURE_FLAG_OUTPUT2 : 0) |
+                                (out_of_range ? CAPTURE_FLAG_OUT_OF_RANGE : 0);
+        capture_buffer.addSample(millis(), raw_distance, filtered_distance, range_status,
+                                 capture_flags, transition_output, transition_state);
+        
+        if (raw_recorder != nullptr && raw_recorder->isRecording()) {
+            // Signal and ambient rates cost two extra I2C reads, so only while recording
+            RawSample raw;
+            raw.time_us = (uint32_t)sample_time_us;
+            raw.distance = raw_distance;
+            raw.range_status = range_status;
+            raw.flags = (output_states[0] ? RAW_SAMPLE_FLAG_OUTPUT1 : 0) |
+                        (output_states[1] ? RAW_SAMPLE_FLAG_OUTPUT2 : 0);
+            raw.signal_rate = 0;
+            raw.ambient_rate = 0;
+            tof_sensor->VL53L1X_GetSignalRate(&raw.signal_rate);
+            tof_sensor->VL53L1X_GetAmbientRate(&raw.ambient_rate);
+            raw_recorder->append(raw);
+        }
+        
         // Clear interrupt for next reading
         tof_sensor->clearInterrupt();
     }
@@ -573,6 +718,7 @@ void SensorManager::update() {
     // Check for sensor timeout (only if we've had readings before)
     if (last_reading_time > 0 && millis() - last_reading_time > SENSOR_TIMEOUT_MS) {
         fault_count++;
+        metrics.faults++;
         Serial.print("Sensor timeout, fault count: ");
         Serial.println(fault_count);
         
@@ -659,46 +805,45 @@ void SensorManager::updateOutputs() {
     // Use current_distance if out of range, otherwise use filtered_distance
     int16_t distance_for_trigger = out_of_range ? current_distance : filtered_distance;
     
-    // Update output 1
-    if (output1_config.enabled) {
-        bool new_state = checkOutputTrigger(output1_config, distance_for_trigger);
-        if (new_state != output1_config.current_state) {
-            output1_config.current_state = new_state;
-            digitalWrite(output1_pin, new_state ? HIGH : LOW);
-            Serial.print("Output 1 state changed to: ");
-            Serial.print(new_state ? "HIGH" : "LOW");
-            Serial.print(" (distance: ");
-            Serial.print(distance_for_trigger);
-            Serial.print(", out_of_range: ");
-            Serial.print(out_of_range ? "true" : "false");
-            Serial.println(")");
-        }
-    } else {
-        output1_config.current_state = false;
-        digitalWrite(output1_pin, LOW);
-    }
-    
-    // Update output 2
-    if (output2_config.enabled) {
-        bool new_state = checkOutputTrigger(output2_config, distance_for_trigger);
-        if (new_state != output2_config.current_state) {
-            output2_config.current_state = new_state;
-            digitalWrite(output2_pin, new_state ? HIGH : LOW);
-            Serial.print("Output 2 state changed to: ");
-            Serial.print(new_state ? "HIGH" : "LOW");
-            Serial.print(" (distance: ");
-            Serial.print(distance_for_trigger);
-            Serial.print(", out_of_range: ");
-            Serial.print(out_of_range ? "true" : "false");
-            Serial.println(")");
+    // During a firmware update an output may be held or driven to a fixed level
+    bool updating = ota_update_mode.load(std::memory_order_relaxed);
+    
+    for (int i = 0; i < 2; i++) {
+        if (settings->outputs[i].enabled) {
+            bool new_state;
+            OutputOtaState mode = updating ? (OutputOtaState)settings->outputs[i].ota_state : OUTPUT_OTA_LIVE;
+            switch (mode) {
+                case OUTPUT_OTA_HOLD: new_state = output_states[i]; break;
+                case OUTPUT_OTA_LOW: new_state = false; break;
+                case OUTPUT_OTA_HIGH: new_state = true; break;
+                default: new_state = checkOutputTrigger(settings->outputs[i], output_states[i], distance_for_trigger); break;
+            }
+            if (new_state != output_states[i]) {
+                output_states[i] = new_state;
+                digitalWrite(output_pins[i], new_state ? HIGH : LOW);
+                metrics.output_latency.record(micros() - (uint32_t)sample_time_us);
+                if (transition_output == 0) {
+                    transition_output = i + 1;
+                    transition_state = new_state;
+                }
+                Serial.print("Output ");
+                Serial.print(i + 1);
+                Serial.print(" state changed to: ");
+                Serial.print(new_state ? "HIGH" : "LOW");
+                Serial.print(" (distance: ");
+                Serial.print(distance_for_trigger);
+                Serial.print(", out_of_range: ");
+                Serial.print(out_of_range ? "true" : "false");
+                Serial.println(")");
+            }
+        } else {
+            output_states[i] = false;
+            digitalWrite(output_pins[i], LOW);
         }
-    } else {
-        output2_config.current_state = false;
-        digitalWrite(output2_pin, LOW);
     }
 }
 
-bool SensorManager::checkOutputTrigger(const OutputConfig& config, int16_t distance) {
+bool SensorManager::checkOutputTrigger(const OutputSettings& config, bool current_state, int16_t distance) {
     // Handle out-of-range condition (distance < 0)
     if (distance < 0) {
         // If sensor is out of range and output is configured as "Active out of range",
@@ -713,7 +858,7 @@ bool SensorManager::checkOutputTrigger(const OutputConfig& config, int16_t dista
     bool in_range = (distance >= config.range_min && distance <= config.range_max);
     
     // Apply hysteresis
-    if (config.current_state) {
+    if (current_state) {
         // Currently active - add hysteresis to turn off
         if (config.active_in_range) {
             // Active in range - extend range outward to turn off
@@ -729,60 +874,120 @@ bool SensorManager::checkOutputTrigger(const OutputConfig& config, int16_t dista
     return config.active_in_range ? in_range : !in_range;
 }
 
+void SensorManager::publishSettings() {
+    settings_slots[settings_back] = settings_staged;
+    settings_back = settings_middle.exchange(settings_back | SETTINGS_FRESH, std::memory_order_acq_rel) & SETTINGS_SLOT_MASK;
+}
+
+void SensorManager::applyPendingSettings() {
+    if ((settings_middle.load(std::memory_order_relaxed) & SETTINGS_FRESH) == 0) return;
+    
+    // The old front slot goes back to the writers with the exchange, so read it first
+    uint16_t old_pre = settings->capture_pre;
+    uint16_t old_post = settings->capture_post;
+    settings_front = settings_middle.exchange(settings_front, std::memory_order_acq_rel) & SETTINGS_SLOT_MASK;
+    settings = &settings_slots[settings_front];
+    
+    // If outputs are disabled, turn them off immediately
+    for (int i = 0; i < 2; i++) {
+        if (!settings->outputs[i].enabled) {
+            output_states[i] = false;
+            digitalWrite(output_pins[i], LOW);
+        }
+    }
+    if (settings->capture_pre != old_pre || settings->capture_post != old_post) {
+        capture_buffer.setWindow(settings->capture_pre, settings->capture_post);
+    }
+}
+
+void SensorManager::publishSnapshot() {
+    uint32_t sequence = snapshot_sequence.load(std::memory_order_relaxed) + 1;
+    
+    // Readers of the previous sequence may still be copying this slot; the
+    // fence keeps the stores below after the bump they recheck
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    SensorSnapshot& snapshot = snapshot_slots[sequence & 1];
+    snapshot.sequence = sample_sequence;
+    snapshot.timestamp_us = sample_time_us;
+    snapshot.distance = filtered_distance;
+    snapshot.raw_distance = current_distance;
+    snapshot.status = device_status;
+    snapshot.sensor_ready = sensor_initialized && distance_filter->isReady();
+    snapshot.out_of_range = out_of_range;
+    snapshot.high_noise = high_noise_detected;
+    snapshot.variance = current_variance;
+    snapshot.signal_rate = signal_rate;
+    snapshot.rejected_readings = rejected_readings_count;
+    snapshot.valid_samples = distance_filter->getValidSampleCount();
+    for (int i = 0; i < 2; i++) {
+        const OutputSettings& out = settings->outputs[i];
+        snapshot.outputs[i] = {out.enabled, out.range_min, out.range_max, out.hysteresis, out.active_in_range, output_states[i]};
+    }
+    snapshot_sequence.store(sequence, std::memory_order_release);
+}
+
+SensorSnapshot SensorManager::getSnapshot() const {
+    SensorSnapshot snapshot;
+    uint32_t sequence = snapshot_sequence.load(std::memory_order_acquire);
+    while (true) {
+        snapshot = snapshot_slots[sequence & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        
+        // Unchanged: update() has not started refilling this slot meanwhile
+        uint32_t current = snapshot_sequence.load(std::memory_order_relaxed);
+        if (current == sequence) return snapshot;
+        sequence = current;
+    }
+}
+
 void SensorManager::setOutput1Config(uint16_t min_range, uint16_t max_range, uint16_t hysteresis, bool active_in_range) {
-    output1_config.range_min = min_range;
-    output1_config.range_max = max_range;
-    output1_config.hysteresis = hysteresis;
-    output1_config.active_in_range = active_in_range;
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+    OutputSettings& out = settings_staged.outputs[0];
+    out.range_min = min_range;
+    out.range_max = max_range;
+    out.hysteresis = hysteresis;
+    out.active_in_range = active_in_range;
+    publishSettings();
+    xSemaphoreGive(settings_lock);
 }
 
 void SensorManager::setOutput2Config(uint16_t min_range, uint16_t max_range, uint16_t hysteresis, bool active_in_range) {
-    output2_config.range_min = min_range;
-    output2_config.range_max = max_range;
-    output2_config.hysteresis = hysteresis;
-    output2_config.active_in_range = active_in_range;
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+    OutputSettings& out = settings_staged.outputs[1];
+    out.range_min = min_range;
+    out.range_max = max_range;
+    out.hysteresis = hysteresis;
+    out.active_in_range = active_in_range;
+    publishSettings();
+    xSemaphoreGive(settings_lock);
 }
 
 void SensorManager::updateConfiguration(const DeviceConfig& config) {
-    // Update Output 1 configuration
-    output1_config.range_min = config.output1_min;
-    output1_config.range_max = config.output1_max;
-    output1_config.hysteresis = config.output1_hysteresis;
-    output1_config.active_in_range = config.output1_active_in_range;
-    output1_config.enabled = config.output1_enabled;
-    
-    // Update Output 2 configuration
-    output2_config.range_min = config.output2_min;
-    output2_config.range_max = config.output2_max;
-    output2_config.hysteresis = config.output2_hysteresis;
-    output2_config.active_in_range = config.output2_active_in_range;
-    output2_config.enabled = config.output2_enabled;
+    SensorSettings next;
+    next.outputs[0] = {config.output1_enabled, config.output1_min, config.output1_max,
+                       config.output1_hysteresis, config.output1_active_in_range, config.output1_ota_state};
+    next.outputs[1] = {config.output2_enabled, config.output2_min, config.output2_max,
+                       config.output2_hysteresis, config.output2_active_in_range, config.output2_ota_state};
+    next.capture_pre = config.capture_pre_samples;
+    next.capture_post = config.capture_post_samples;
     
-    // If outputs are disabled, turn them off immediately
-    if (!output1_config.enabled) {
-        output1_config.current_state = false;
-        digitalWrite(output1_pin, LOW);
-    }
-    if (!output2_config.enabled) {
-        output2_config.current_state = false;
-        digitalWrite(output2_pin, LOW);
-    }
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+    settings_staged = next;
+    publishSettings();
+    xSemaphoreGive(settings_lock);
     
     Serial.println("[CONFIG] Sensor manager configuration updated");
-    Serial.print("Output 1: ");
-    Serial.print(output1_config.enabled ? "Enabled" : "Disabled");
-    Serial.print(" - ");
-    Serial.print(output1_config.range_min);
-    Serial.print("-");
-    Serial.print(output1_config.range_max);
-    Serial.println("mm");
-    Serial.print("Output 2: ");
-    Serial.print(output2_config.enabled ? "Enabled" : "Disabled");
-    Serial.print(" - ");
-    Serial.print(output2_config.range_min);
-    Serial.print("-");
-    Serial.print(output2_config.range_max);
-    Serial.println("mm");
+    for (int i = 0; i < 2; i++) {
+        Serial.print("Output ");
+        Serial.print(i + 1);
+        Serial.print(": ");
+        Serial.print(next.outputs[i].enabled ? "Enabled" : "Disabled");
+        Serial.print(" - ");
+        Serial.print(next.outputs[i].range_min);
+        Serial.print("-");
+        Serial.print(next.outputs[i].range_max);
+        Serial.println("mm");
+    }
 }
 
 void SensorManager::resetSensor() {
@@ -795,10 +1000,10 @@ void SensorManager::resetSensor() {
     device_status = STATUS_FAULT;
     
     // Turn off outputs
-    digitalWrite(output1_pin, LOW);
-    digitalWrite(output2_pin, LOW);
-    output1_config.current_state = false;
-    output2_config.current_state = false;
+    for (int i = 0; i < 2; i++) {
+        digitalWrite(output_pins[i], LOW);
+        output_states[i] = false;
+    }
     
     updateLED();
     
@@ -808,8 +1013,11 @@ void SensorManager::resetSensor() {
 
 void SensorManager::factoryReset() {
     // Reset to default configurations
-    output1_config = {false, 100, 300, HYSTERESIS_DEFAULT, true, false};
-    output2_config = {false, 400, 600, HYSTERESIS_DEFAULT, true, false};
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+    settings_staged.outputs[0] = {false, 100, 300, HYSTERESIS_DEFAULT, true, OUTPUT_OTA_LIVE};
+    settings_staged.outputs[1] = {false, 400, 600, HYSTERESIS_DEFAULT, true, OUTPUT_OTA_LIVE};
+    publishSettings();
+    xSemaphoreGive(settings_lock);
     
     resetSensor();
 }
@@ -839,9 +1047,92 @@ void SensorManager::setCustomLEDColor(uint8_t r, uint8_t g, uint8_t b) {
 }
 
 void SensorManager::enableOutput1(bool enabled) {
-    output1_config.enabled = enabled;
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+    settings_staged.outputs[0].enabled = enabled;
+    publishSettings();
+    xSemaphoreGive(settings_lock);
 }
 
 void SensorManager::enableOutput2(bool enabled) {
-    output2_config.enabled = enabled;
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+    settings_staged.outputs[1].enabled = enabled;
+    publishSettings();
+    xSemaphoreGive(settings_lock);
+}
+
+bool SensorManager::startRawRecording() {
+    if (raw_recorder == nullptr || !raw_recorder->isAvailable()) {
+        return false;
+    }
+    raw_request.store(RAW_REQUEST_START, std::memory_order_release);
+    return true;
+}
+
+void SensorManager::stopRawRecording() {
+    if (raw_recorder != nullptr) {
+        raw_request.store(RAW_REQUEST_STOP, std::memory_order_release);
+    }
+}
+
+// Starts or stops the recorder on the sample task, between samples: append()
+// and the filter state copied into the session never change underneath
+void SensorManager::applyRawRequest() {
+    if (raw_request.load(std::memory_order_relaxed) == RAW_REQUEST_NONE) return;
+    uint8_t request = raw_request.exchange(RAW_REQUEST_NONE, std::memory_order_acquire);
+    if (request == RAW_REQUEST_STOP) {
+        raw_recorder->stop();
+        return;
+    }
+    if (request != RAW_REQUEST_START) return;
+    
+    // Record the settings the samples are processed with so a replay can reproduce them
+    RawSessionInfo info;
+    memset(&info, 0, sizeof(info));
+    info.timing_budget_ms = sensor_initialized ? tof_sensor->getTimingBudget() : 0;
+    info.start_time_us = (uint32_t)uptime_us;
+    info.output1_min = settings->outputs[0].range_min;
+    info.output1_max = settings->outputs[0].range_max;
+    info.output1_hysteresis = settings->outputs[0].hysteresis;
+    info.output1_active_in_range = settings->outputs[0].active_in_range;
+    info.output1_enabled = settings->outputs[0].enabled;
+    info.output2_min = settings->outputs[1].range_min;
+    info.output2_max = settings->outputs[1].range_max;
+    info.output2_hysteresis = settings->outputs[1].hysteresis;
+    info.output2_active_in_range = settings->outputs[1].active_in_range;
+    info.output2_enabled = settings->outputs[1].enabled;
+    strncpy(info.firmware, FW_VERSION, sizeof(info.firmware) - 1);
+    getState(info.state);
+    
+    raw_recorder->start(info);
+}
+
+void SensorManager::getState(RawFilterState& state) {
+    distance_filter->getState(state);
+    state.current_distance = current_distance;
+    state.filtered_distance = filtered_distance;
+    state.out_of_range = out_of_range;
+    state.output1_state = output_states[0];
+    state.output2_state = output_states[1];
+    state.fault_count = fault_count;
+}
+
+void SensorManager::restoreState(const RawFilterState& state) {
+    distance_filter->setState(state);
+    current_distance = state.current_distance;
+    filtered_distance = state.filtered_distance;
+    out_of_range = state.out_of_range;
+    fault_count = state.fault_count;
+    applyPendingSettings();
+    output_states[0] = settings->outputs[0].enabled && state.output1_state;
+    output_states[1] = settings->outputs[1].enabled && state.output2_state;
+    for (int i = 0; i < 2; i++) digitalWrite(output_pins[i], output_states[i] ? HIGH : LOW);
+    publishSnapshot();
+}
+
+void SensorManager::setCaptureWindow(uint16_t pre_samples, uint16_t post_samples) {
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+    settings_staged.capture_pre = pre_samples;
+    settings_staged.capture_post = post_samples;
+    publishSettings();
+    xSemaphoreGive(settings_lock);
 }
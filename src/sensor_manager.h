@@ -3,20 +3,42 @@
 #include <Arduino.h>
 #include <Adafruit_VL53L1X.h>
 #include <Adafruit_NeoPixel.h>
-#include "config_manager.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "device_config.h"
+#include "latency_histogram.h"
+#include "raw_recorder.h"
 
 // Configuration constants
+#ifndef MOVING_AVERAGE_SIZE
 #define MOVING_AVERAGE_SIZE 5
+#endif
 #define MEDIAN_FILTER_SIZE 5
 #define SENSOR_TIMEOUT_MS 1000
 #define HYSTERESIS_DEFAULT 50  // mm
 #define MAX_VARIANCE_THRESHOLD 10000  // mm^2 - readings with higher variance are rejected
 #define MIN_SIGNAL_RATE_THRESHOLD 0.1  // Minimum signal rate for valid reading
 #define MAX_OUTLIER_DEVIATION 100  // mm - reject readings this far from median
+
+// Firmware update pacing, see waitForSampleGap()
+#define SAMPLE_GAP_TIMEOUT_MS 150       // longest wait for a sample, three 50 ms periods
+#define SAMPLE_PERIOD_DEFAULT_US 50000  // expected sample interval until one is measured
+
+// Adaptive filter tuning; overridable with -D for scenario runs (bench/scenario_score.cpp)
+#ifndef CHANGE_DETECTION_THRESHOLD
 #define CHANGE_DETECTION_THRESHOLD 50  // mm - significant change threshold
+#endif
+#ifndef CHANGE_CONFIRMATION_COUNT
 #define CHANGE_CONFIRMATION_COUNT 3  // consecutive readings needed to confirm change
+#endif
+#ifndef RAPID_ADAPT_ALPHA
 #define RAPID_ADAPT_ALPHA 0.7  // aggressive smoothing factor for confirmed changes
+#endif
+#ifndef NORMAL_ADAPT_ALPHA
 #define NORMAL_ADAPT_ALPHA 0.2  // conservative smoothing factor for normal operation
+#endif
 
 // LED status colors (RGB values)
 #define LED_OK_R            0
@@ -42,7 +64,35 @@ enum DeviceStatus {
     STATUS_FAULT
 };
 
-// Output configuration structure
+// Settings of one output
+struct OutputSettings {
+    bool enabled;
+    uint16_t range_min;     // mm
+    uint16_t range_max;     // mm
+    uint16_t hysteresis;    // mm
+    bool active_in_range;   // true = active when in range, false = active when out of range
+    uint8_t ota_state;      // OutputOtaState during a firmware update
+};
+
+// Everything configurable on the sample path. Writers publish a complete set
+// into a triple buffer; update() takes the newest one between samples with a
+// single exchange, so a sample never sees half of an update and the sample
+// path never waits for a writer.
+struct SensorSettings {
+    OutputSettings outputs[2];
+    uint16_t capture_pre;
+    uint16_t capture_post;
+};
+
+#define SETTINGS_SLOT_MASK 0x03
+#define SETTINGS_FRESH 0x80     // set in settings_middle until update() takes it
+
+// Raw recording requests, posted from any task and acted on by update()
+#define RAW_REQUEST_NONE 0
+#define RAW_REQUEST_START 1
+#define RAW_REQUEST_STOP 2
+
+// Output configuration and state, as returned by getOutput1Config()
 struct OutputConfig {
     bool enabled;
     uint16_t range_min;     // mm
@@ -52,6 +102,38 @@ struct OutputConfig {
     bool current_state;     // current output state
 };
 
+// State of the last sample, published once per update(). Readers in other
+// tasks (web server, serial console, history) copy it with getSnapshot()
+// and get one consistent sample instead of fields from different ones.
+struct SensorSnapshot {
+    uint32_t sequence;          // sample_sequence of the sample
+    uint64_t timestamp_us;
+    int16_t distance;           // filtered, mm
+    int16_t raw_distance;       // mm
+    DeviceStatus status;
+    bool sensor_ready;
+    bool out_of_range;
+    bool high_noise;
+    float variance;
+    float signal_rate;
+    uint16_t rejected_readings;
+    uint8_t valid_samples;
+    OutputConfig outputs[2];    // settings the sample was processed with, and output states
+};
+
+// Timing and event counters of the sample path, for /metrics. Updated by
+// update() only; other tasks read them without a lock (see LatencyHistogram).
+struct SensorMetrics {
+    LatencyHistogram sample_interval;   // between data-ready samples
+    LatencyHistogram update_time;       // update() calls that processed a sample
+    LatencyHistogram filter_time;       // adaptive filter step of one valid reading
+    LatencyHistogram output_latency;    // start of update() to the pin write, per output transition
+    uint32_t faults;                    // genuine fault readings and timed out polls
+    uint32_t recoveries;                // sensor reinitialised after it was disabled
+    LatencyHistogram ota_sample_interval;   // sample_interval while a firmware update runs
+    uint32_t ota_missed_samples;        // estimated from those intervals, against the usual period
+};
+
 // Moving average filter class
 class MovingAverage {
 private:
@@ -125,6 +207,10 @@ public:
     bool isReady() { return is_initialized; }
     float getVariance();
     uint8_t getValidSampleCount() { return recent_count; }
+    
+    // Snapshot for raw recording sessions; buffers larger than RAW_FILTER_READINGS are not supported
+    void getState(RawFilterState& state);
+    void setState(const RawFilterState& state);
 };
 
 // Sensor manager class
@@ -135,15 +221,39 @@ private:
     AdaptiveFilter* distance_filter;
     
     uint32_t last_reading_time;
+    uint32_t sample_sequence;     // incremented for every data-ready sample
+    uint64_t sample_time_us;      // microsecond timestamp of the last sample
+    uint64_t uptime_us;           // micros() extended past its 32-bit wrap
+    uint32_t last_micros;
     int16_t current_distance;
     int16_t filtered_distance;
     DeviceStatus device_status;
     
-    OutputConfig output1_config;
-    OutputConfig output2_config;
+    // Settings triple buffer: a writer fills settings_slots[settings_back] and
+    // exchanges it with settings_middle; update() exchanges settings_middle
+    // with settings_front. Only writers take settings_lock.
+    SensorSettings settings_slots[3];
+    SensorSettings settings_staged;         // newest published settings, writer side
+    uint8_t settings_back;
+    std::atomic<uint8_t> settings_middle;   // slot index | SETTINGS_FRESH
+    uint8_t settings_front;
+    const SensorSettings* settings;         // &settings_slots[settings_front], sample task only
+    SemaphoreHandle_t settings_lock;
+    
+    bool output_states[2];
+    uint8_t output_pins[2];
     
-    uint8_t output1_pin;
-    uint8_t output2_pin;
+    // Snapshot seqlock over two slots: update() fills the slot readers are
+    // not pointed at, then bumps snapshot_sequence, whose low bit selects the
+    // slot to read. A reader that preempts update() still finds a complete
+    // slot, so it never spins on a single core.
+    SensorSnapshot snapshot_slots[2];
+    std::atomic<uint32_t> snapshot_sequence;
+    
+    SensorMetrics metrics;
+    TaskHandle_t sample_task;     // task that calls update(), once it has
+    uint32_t sample_period_us;    // usual sample interval, averaged outside updates
+    std::atomic<TaskHandle_t> gap_waiter;   // task in waitForSampleGap(), if any
     
     bool sensor_initialized;
     uint8_t fault_count;
@@ -155,13 +265,29 @@ private:
     float signal_rate;
     bool high_noise_detected;
     
-    // OTA update mode tracking
-    bool ota_update_mode;
+    // Scope mode capture of the samples around output transitions
+    CaptureBuffer capture_buffer;
+    uint8_t transition_output;    // output that changed state on the current sample, 0 if none
+    bool transition_state;
+    
+    // Optional full-rate raw sample recording; the recorder is only started
+    // and stopped on the sample task, which appends to it
+    RawRecorder* raw_recorder;
+    std::atomic<uint8_t> raw_request;       // RAW_REQUEST_*, the latest wins
+    
+    // OTA update mode tracking; set by the web server task
+    std::atomic<bool> ota_update_mode;
     uint8_t custom_led_r, custom_led_g, custom_led_b;
     
     void updateLED();
     void updateOutputs();
-    bool checkOutputTrigger(const OutputConfig& config, int16_t distance);
+    void recordInterval(uint32_t interval_us);
+    bool checkOutputTrigger(const OutputSettings& config, bool current_state, int16_t distance);
+    void publishSettings();         // settings_staged to the sample path, with settings_lock held
+    void applyPendingSettings();
+    void applyRawRequest();
+    void updateSample();
+    void publishSnapshot();
 
 public:
     SensorManager(Adafruit_VL53L1X* tof, Adafruit_NeoPixel* led, uint8_t out1_pin, uint8_t out2_pin);
@@ -170,33 +296,60 @@ public:
     bool initialize();
     void update();
     
-    // Getters
-    int16_t getDistance() { return filtered_distance; }
-    int16_t getRawDistance() { return current_distance; }
-    DeviceStatus getStatus() { return device_status; }
-    bool isSensorReady() { return sensor_initialized && distance_filter->isReady(); }
-    bool isOutOfRange() { return out_of_range; }
+    // State of the last sample; safe from any task, never blocks update()
+    SensorSnapshot getSnapshot() const;
+    
+    // Getters for a single field, from the snapshot. Read getSnapshot() once
+    // instead when several fields have to belong to the same sample.
+    int16_t getDistance() const { return getSnapshot().distance; }
+    int16_t getRawDistance() const { return getSnapshot().raw_distance; }
+    DeviceStatus getStatus() const { return getSnapshot().status; }
+    bool isSensorReady() const { return getSnapshot().sensor_ready; }
+    bool isOutOfRange() const { return getSnapshot().out_of_range; }
+    uint32_t getSampleSequence() const { return getSnapshot().sequence; }
+    uint64_t getSampleTimestampUs() const { return getSnapshot().timestamp_us; }
     
     // Enhanced noise detection getters
-    float getVariance() { return current_variance; }
-    float getSignalRate() { return signal_rate; }
-    uint16_t getRejectedReadingsCount() { return rejected_readings_count; }
-    bool isHighNoiseDetected() { return high_noise_detected; }
-    uint8_t getValidSampleCount() { return distance_filter->getValidSampleCount(); }
+    float getVariance() const { return getSnapshot().variance; }
+    float getSignalRate() const { return getSnapshot().signal_rate; }
+    uint16_t getRejectedReadingsCount() const { return getSnapshot().rejected_readings; }
+    bool isHighNoiseDetected() const { return getSnapshot().high_noise; }
+    uint8_t getValidSampleCount() const { return getSnapshot().valid_samples; }
+    
+    const SensorMetrics& getMetrics() const { return metrics; }
+    TaskHandle_t getSampleTask() const { return sample_task; }
     
     // Configuration methods
     void setOutput1Config(uint16_t min_range, uint16_t max_range, uint16_t hysteresis, bool active_in_range);
     void setOutput2Config(uint16_t min_range, uint16_t max_range, uint16_t hysteresis, bool active_in_range);
     void enableOutput1(bool enabled);
     void enableOutput2(bool enabled);
-    void updateConfiguration(const DeviceConfig& config);
+    void updateConfiguration(const DeviceConfig& config);     // takes effect at the next update()
+    void setCaptureWindow(uint16_t pre_samples, uint16_t post_samples);
+    CaptureBuffer* getCaptureBuffer() { return &capture_buffer; }
+    
+    // Raw sample recording
+    void setRawRecorder(RawRecorder* recorder) { raw_recorder = recorder; }
+    RawRecorder* getRawRecorder() { return raw_recorder; }
+    bool startRawRecording();     // from any task; takes effect at the next update()
+    void stopRawRecording();
+    void getState(RawFilterState& state);
+    void restoreState(const RawFilterState& state);   // replay: continue from a session snapshot
     
-    // LED control methods for OTA updates
+    // OTA update mode: LED colour, and outputs as their ota_state says
     void setOTAUpdateMode(bool enabled);
+    bool isOTAUpdateMode() const { return ota_update_mode.load(std::memory_order_relaxed); }
+    
+    // Blocks the calling task until update() has processed the next sample,
+    // or timeout_ms. The update writer calls it before each flash sector: a
+    // flash erase or write stops the CPU, and the sensor only needs reading
+    // again a sample period later. Returns false on timeout; at once if the
+    // sensor is not sampling.
+    bool waitForSampleGap(uint32_t timeout_ms);
     void setCustomLEDColor(uint8_t r, uint8_t g, uint8_t b);
     
-    OutputConfig getOutput1Config() { return output1_config; }
-    OutputConfig getOutput2Config() { return output2_config; }
+    OutputConfig getOutput1Config() const { return getSnapshot().outputs[0]; }
+    OutputConfig getOutput2Config() const { return getSnapshot().outputs[1]; }
     
     // Reset and diagnostics
     void resetSensor();
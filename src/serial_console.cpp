@@ -0,0 +1,97 @@
+#include "serial_console.h"
+
+SerialConsole::SerialConsole(ApiCore* api_core, Stream* stream) {
+    api = api_core;
+    io = stream;
+    line_len = 0;
+    overflow = false;
+}
+
+void SerialConsole::poll() {
+    while (io->available() > 0) {
+        int c = io->read();
+        if (c < 0) break;
+        
+        if (c == '\n' || c == '\r') {
+            if (overflow) {
+                printReply({400, "{\"status\":\"error\",\"message\":\"Line too long\"}"});
+            } else if (line_len > 0) {
+                line[line_len] = '\0';
+                execute(line);
+            }
+            line_len = 0;
+            overflow = false;
+        } else if (line_len < CONSOLE_LINE_MAX) {
+            line[line_len++] = (char)c;
+        } else {
+            overflow = true;
+        }
+    }
+}
+
+void SerialConsole::printReply(const ApiReply& reply) {
+    io->print(reply.code);
+    io->print(' ');
+    io->println(reply.body);
+}
+
+void SerialConsole::execute(char* command) {
+    char* rest = nullptr;
+    char* verb = strtok_r(command, " ", &rest);
+    if (verb == nullptr) return;
+    
+    if (strcmp(verb, "status") == 0) {
+        JsonWriter json(*io);
+        api->writeStatusJson(json);
+        json.finish();
+        io->println();
+    } else if (strcmp(verb, "config") == 0) {
+        JsonWriter json(*io);
+        api->writeConfigJson(json);
+        json.finish();
+        io->println();
+    } else if (strcmp(verb, "captures") == 0) {
+        JsonWriter json(*io);
+        api->writeCapturesJson(json);
+        json.finish();
+        io->println();
+    } else if (strcmp(verb, "raw-status") == 0) {
+        JsonWriter json(*io);
+        api->writeRawStatusJson(json);
+        json.finish();
+        io->println();
+    } else if (strcmp(verb, "set") == 0) {
+        ApiConfigParams params;
+        memset(&params, 0, sizeof(params));
+        for (char* field = strtok_r(nullptr, " ", &rest); field != nullptr; field = strtok_r(nullptr, " ", &rest)) {
+            char* value = strchr(field, '=');
+            if (value == nullptr) {
+                printReply({400, "{\"status\":\"error\",\"message\":\"Expected field=value\"}"});
+                return;
+            }
+            *value++ = '\0';
+            if (!apiParseConfigField(params, field, value)) {
+                printReply({400, "{\"status\":\"error\",\"message\":\"Unknown field\"}"});
+                return;
+            }
+        }
+        printReply(api->setConfig(params));
+    } else if (strcmp(verb, "raw") == 0) {
+        char* action = strtok_r(nullptr, " ", &rest);
+        if (action != nullptr && strcmp(action, "start") == 0) {
+            printReply(api->rawControl(RAW_CONTROL_START));
+        } else if (action != nullptr && strcmp(action, "stop") == 0) {
+            printReply(api->rawControl(RAW_CONTROL_STOP));
+        } else if (action != nullptr && strcmp(action, "erase") == 0) {
+            printReply(api->rawControl(RAW_CONTROL_ERASE));
+        } else {
+            printReply({400, "{\"status\":\"error\",\"message\":\"Expected raw start, stop or erase\"}"});
+        }
+    } else if (strcmp(verb, "clear-history") == 0) {
+        printReply(api->clearHistory());
+    } else if (strcmp(verb, "reset-config") == 0) {
+        printReply(api->resetConfig());
+    } else {
+        printReply({404, "{\"status\":\"error\",\"message\":\"Unknown command\"}"});
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include "api_core.h"
+
+// Line-based console on the serial port, a second adapter on ApiCore next to
+// the web server. One command per line, one reply line back:
+//
+//   status                       status JSON
+//   config                       configuration JSON
+//   set <field>=<value> ...      config update, fields as in POST /api/config
+//   captures | raw-status        capture list, raw recorder state
+//   raw start|stop|erase         raw recorder control
+//   clear-history | reset-config
+//
+// Action replies are "<code> <json>". No login: the port needs physical access.
+#define CONSOLE_LINE_MAX 160
+
+class SerialConsole {
+private:
+    ApiCore* api;
+    Stream* io;
+    char line[CONSOLE_LINE_MAX + 1];
+    uint16_t line_len;
+    bool overflow;
+
+    void execute(char* command);
+    void printReply(const ApiReply& reply);
+
+public:
+    SerialConsole(ApiCore* api_core, Stream* stream);
+
+    // Reads what has arrived and runs complete lines; call from loop()
+    void poll();
+};
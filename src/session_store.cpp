@@ -0,0 +1,183 @@
+#include "session_store.h"
+#include <string.h>
+#include <esp_random.h>
+
+#define SESSION_TABLE_MASK (SESSION_TABLE_SIZE - 1)
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool decodeToken(const char* text, size_t len, uint8_t* token) {
+    if (len != SESSION_TOKEN_CHARS) return false;
+    for (int i = 0; i < SESSION_TOKEN_BYTES; i++) {
+        int high = hexValue(text[2 * i]);
+        int low = hexValue(text[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        token[i] = (uint8_t)((high << 4) | low);
+    }
+    return true;
+}
+
+// The token is random, so its first bytes are as good as any hash of it
+static int homeSlot(const uint8_t* token) {
+    uint32_t hash = (uint32_t)token[0] | ((uint32_t)token[1] << 8) |
+                    ((uint32_t)token[2] << 16) | ((uint32_t)token[3] << 24);
+    return (int)(hash & SESSION_TABLE_MASK);
+}
+
+// Compares every byte, so the time taken does not depend on where they differ
+static bool tokensEqual(const uint8_t* a, const uint8_t* b) {
+    uint8_t diff = 0;
+    for (int i = 0; i < SESSION_TOKEN_BYTES; i++) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+bool sessionTokenFromCookie(const char* cookie, const char*& token, size_t& len) {
+    const size_t name_len = strlen(SESSION_COOKIE_NAME);
+    const char* p = cookie;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == ';') p++;
+        const char* end = strchr(p, ';');
+        if (end == nullptr) end = p + strlen(p);
+        if ((size_t)(end - p) > name_len && strncmp(p, SESSION_COOKIE_NAME, name_len) == 0 && p[name_len] == '=') {
+            token = p + name_len + 1;
+            len = (size_t)(end - token);
+            while (len > 0 && token[len - 1] == ' ') len--;
+            return true;
+        }
+        p = end;
+    }
+    return false;
+}
+
+SessionStore::SessionStore() {
+    clear();
+}
+
+void SessionStore::clear() {
+    memset(entries, 0, sizeof(entries));
+    active = 0;
+    created = 0;
+    evicted = 0;
+    expired = 0;
+}
+
+int SessionStore::find(const uint8_t* token) const {
+    int slot = homeSlot(token);
+    // The table is never more than half full, so an empty slot ends every probe
+    while (entries[slot].used) {
+        if (tokensEqual(entries[slot].token, token)) return slot;
+        slot = (slot + 1) & SESSION_TABLE_MASK;
+    }
+    return -1;
+}
+
+void SessionStore::removeSlot(int slot) {
+    memset(&entries[slot], 0, sizeof(entries[slot]));
+    active--;
+
+    // Backward shift deletion: move later entries of the probe run into the
+    // hole unless their home slot lies between the hole and where they are
+    int hole = slot;
+    int next = (slot + 1) & SESSION_TABLE_MASK;
+    while (entries[next].used) {
+        int home = homeSlot(entries[next].token);
+        bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!stays) {
+            entries[hole] = entries[next];
+            memset(&entries[next], 0, sizeof(entries[next]));
+            hole = next;
+        }
+        next = (next + 1) & SESSION_TABLE_MASK;
+    }
+}
+
+bool SessionStore::isExpired(const SessionEntry& entry, uint32_t now) const {
+    return now - entry.last_used_ms > SESSION_IDLE_TIMEOUT_MS ||
+           now - entry.created_ms > SESSION_ABSOLUTE_TIMEOUT_MS;
+}
+
+void SessionStore::dropExpired(uint32_t now) {
+    int slot = 0;
+    while (slot < SESSION_TABLE_SIZE) {
+        if (entries[slot].used && isExpired(entries[slot], now)) {
+            removeSlot(slot);
+            expired++;
+            continue;    // another entry may have been shifted into this slot
+        }
+        slot++;
+    }
+}
+
+void SessionStore::evictLeastRecentlyUsed() {
+    int oldest = -1;
+    for (int slot = 0; slot < SESSION_TABLE_SIZE; slot++) {
+        if (!entries[slot].used) continue;
+        if (oldest < 0 || (int32_t)(entries[slot].last_used_ms - entries[oldest].last_used_ms) < 0) {
+            oldest = slot;
+        }
+    }
+    if (oldest >= 0) {
+        removeSlot(oldest);
+        evicted++;
+    }
+}
+
+void SessionStore::create(char* token, uint32_t now) {
+    dropExpired(now);
+    if (active >= SESSION_MAX_ACTIVE) evictLeastRecentlyUsed();
+
+    uint8_t bytes[SESSION_TOKEN_BYTES];
+    do {
+        esp_fill_random(bytes, sizeof(bytes));
+    } while (find(bytes) >= 0);
+
+    int slot = homeSlot(bytes);
+    while (entries[slot].used) slot = (slot + 1) & SESSION_TABLE_MASK;
+    SessionEntry& entry = entries[slot];
+    memcpy(entry.token, bytes, sizeof(bytes));
+    entry.created_ms = now;
+    entry.last_used_ms = now;
+    entry.used = true;
+    active++;
+    created++;
+
+    for (int i = 0; i < SESSION_TOKEN_BYTES; i++) {
+        token[2 * i] = hex_digits[bytes[i] >> 4];
+        token[2 * i + 1] = hex_digits[bytes[i] & 0x0F];
+    }
+    token[SESSION_TOKEN_CHARS] = '\0';
+}
+
+bool SessionStore::validate(const char* token, size_t len, uint32_t now) {
+    uint8_t bytes[SESSION_TOKEN_BYTES];
+    if (!decodeToken(token, len, bytes)) return false;
+
+    int slot = find(bytes);
+    if (slot < 0) return false;
+    if (isExpired(entries[slot], now)) {
+        removeSlot(slot);
+        expired++;
+        return false;
+    }
+    entries[slot].last_used_ms = now;
+    return true;
+}
+
+void SessionStore::remove(const char* token, size_t len) {
+    uint8_t bytes[SESSION_TOKEN_BYTES];
+    if (!decodeToken(token, len, bytes)) return;
+
+    int slot = find(bytes);
+    if (slot >= 0) removeSlot(slot);
+}
+
+SessionStats SessionStore::getStats() const {
+    return {active, created, evicted, expired};
+}
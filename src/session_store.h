@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Login sessions in a fixed-size open-addressing hash table.
+//
+// Tokens are 128 bits from the hardware RNG, sent as 32 hex characters. They
+// are uniformly random, so their first word is the hash: a lookup decodes the
+// cookie value into 16 bytes on the stack and probes from that bucket, which
+// with the table at most half full is one or two slots. Nothing is allocated.
+// Expired sessions are dropped when they are looked up or when a login needs
+// room; with every slot in use the least recently used session is evicted.
+// Not thread safe: all calls come from the web server task.
+#define SESSION_TOKEN_BYTES 16
+#define SESSION_TOKEN_CHARS (SESSION_TOKEN_BYTES * 2)
+#define SESSION_TABLE_SIZE 16                  // power of two
+#define SESSION_MAX_ACTIVE (SESSION_TABLE_SIZE / 2)
+#define SESSION_IDLE_TIMEOUT_MS (30UL * 60 * 1000)
+#define SESSION_ABSOLUTE_TIMEOUT_MS (12UL * 60 * 60 * 1000)
+#define SESSION_COOKIE_NAME "session_token"
+
+struct SessionEntry {
+    uint8_t token[SESSION_TOKEN_BYTES];
+    uint32_t created_ms;
+    uint32_t last_used_ms;
+    bool used;
+};
+
+struct SessionStats {
+    uint8_t active;
+    uint32_t created;
+    uint32_t evicted;           // least recently used, dropped for a new login
+    uint32_t expired;
+};
+
+// Finds the session cookie in a Cookie header ("a=1; session_token=...; b=2")
+// without copying it. Only a whole cookie name matches.
+bool sessionTokenFromCookie(const char* cookie, const char*& token, size_t& len);
+
+class SessionStore {
+private:
+    SessionEntry entries[SESSION_TABLE_SIZE];
+    uint8_t active;
+    uint32_t created;
+    uint32_t evicted;
+    uint32_t expired;
+
+    int find(const uint8_t* token) const;
+    void removeSlot(int slot);
+    bool isExpired(const SessionEntry& entry, uint32_t now) const;
+    void dropExpired(uint32_t now);
+    void evictLeastRecentlyUsed();
+
+public:
+    SessionStore();
+
+    // Starts a session; token receives SESSION_TOKEN_CHARS hex characters and a NUL
+    void create(char* token, uint32_t now);
+    // True for a live session, whose idle timer is then restarted
+    bool validate(const char* token, size_t len, uint32_t now);
+    void remove(const char* token, size_t len);
+    void clear();
+
+    SessionStats getStats() const;
+};
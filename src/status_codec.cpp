@@ -0,0 +1,130 @@
+#include "status_codec.h"
+
+// CBOR major types
+#define CBOR_UINT   0x00
+#define CBOR_NEGINT 0x20
+#define CBOR_ARRAY  0x80
+
+// Writes a CBOR head (major type + argument) using the shortest form
+static size_t writeHead(uint8_t major, uint64_t value, uint8_t* out) {
+    if (value < 24) {
+        out[0] = major | (uint8_t)value;
+        return 1;
+    }
+    if (value <= 0xFF) {
+        out[0] = major | 24;
+        out[1] = (uint8_t)value;
+        return 2;
+    }
+    if (value <= 0xFFFF) {
+        out[0] = major | 25;
+        out[1] = (uint8_t)(value >> 8);
+        out[2] = (uint8_t)value;
+        return 3;
+    }
+    if (value <= 0xFFFFFFFFull) {
+        out[0] = major | 26;
+        for (uint8_t i = 0; i < 4; i++) out[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+        return 5;
+    }
+    out[0] = major | 27;
+    for (uint8_t i = 0; i < 8; i++) out[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+    return 9;
+}
+
+static size_t writeInt(int32_t value, uint8_t* out) {
+    if (value < 0) {
+        // CBOR negative integers encode -1 - value
+        return writeHead(CBOR_NEGINT, (uint64_t)(-1 - (int64_t)value), out);
+    }
+    return writeHead(CBOR_UINT, (uint64_t)value, out);
+}
+
+// Reads a CBOR head. Returns the number of bytes consumed, or 0 on error.
+static size_t readHead(const uint8_t* data, size_t len, uint8_t& major, uint64_t& value) {
+    if (len < 1) return 0;
+    major = data[0] & 0xE0;
+    uint8_t info = data[0] & 0x1F;
+    if (info < 24) {
+        value = info;
+        return 1;
+    }
+
+    uint8_t size;
+    switch (info) {
+        case 24: size = 1; break;
+        case 25: size = 2; break;
+        case 26: size = 4; break;
+        case 27: size = 8; break;
+        default: return 0;  // indefinite lengths and reserved values are not used
+    }
+    if (len < 1u + size) return 0;
+
+    value = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        value = (value << 8) | data[1 + i];
+    }
+    return 1 + size;
+}
+
+static bool readUInt(const uint8_t*& data, size_t& len, uint64_t max, uint64_t& value) {
+    uint8_t major;
+    size_t used = readHead(data, len, major, value);
+    if (used == 0 || major != CBOR_UINT || value > max) return false;
+    data += used;
+    len -= used;
+    return true;
+}
+
+static bool readInt16(const uint8_t*& data, size_t& len, int16_t& value) {
+    uint8_t major;
+    uint64_t raw;
+    size_t used = readHead(data, len, major, raw);
+    if (used == 0) return false;
+    if (major == CBOR_UINT && raw <= INT16_MAX) {
+        value = (int16_t)raw;
+    } else if (major == CBOR_NEGINT && raw <= (uint64_t)INT16_MAX) {
+        value = (int16_t)(-1 - (int32_t)raw);
+    } else {
+        return false;
+    }
+    data += used;
+    len -= used;
+    return true;
+}
+
+size_t encodeStatusCbor(const StatusSample& sample, uint8_t* out, size_t capacity) {
+    if (capacity < STATUS_CBOR_MAX_SIZE) return 0;
+
+    size_t n = writeHead(CBOR_ARRAY, STATUS_CODEC_FIELDS, out);
+    n += writeHead(CBOR_UINT, STATUS_CODEC_VERSION, out + n);
+    n += writeHead(CBOR_UINT, sample.sequence, out + n);
+    n += writeHead(CBOR_UINT, sample.timestamp_us, out + n);
+    n += writeInt(sample.distance, out + n);
+    n += writeInt(sample.raw_distance, out + n);
+    n += writeHead(CBOR_UINT, sample.status, out + n);
+    n += writeHead(CBOR_UINT, sample.flags, out + n);
+    return n;
+}
+
+bool decodeStatusCbor(const uint8_t* data, size_t len, StatusSample& sample) {
+    uint8_t major;
+    uint64_t value;
+    size_t used = readHead(data, len, major, value);
+    if (used == 0 || major != CBOR_ARRAY || value < STATUS_CODEC_FIELDS) return false;
+    data += used;
+    len -= used;
+
+    // Newer minor revisions may append fields; the leading layout is fixed
+    if (!readUInt(data, len, 0xFF, value) || value != STATUS_CODEC_VERSION) return false;
+    if (!readUInt(data, len, 0xFFFFFFFFull, value)) return false;
+    sample.sequence = (uint32_t)value;
+    if (!readUInt(data, len, UINT64_MAX, sample.timestamp_us)) return false;
+    if (!readInt16(data, len, sample.distance)) return false;
+    if (!readInt16(data, len, sample.raw_distance)) return false;
+    if (!readUInt(data, len, 0xFF, value)) return false;
+    sample.status = (uint8_t)value;
+    if (!readUInt(data, len, 0xFF, value)) return false;
+    sample.flags = (uint8_t)value;
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary status encoding for machine clients (SCADA pollers, test rigs).
+//
+// The payload is a CBOR (RFC 8949) array with a fixed field order, so generic
+// CBOR decoders work and fixed-layout decoders can index fields directly:
+//
+//   [ version, sequence, timestamp_us, distance, raw_distance, status, flags ]
+//
+// Integers use the shortest CBOR encoding. Distances are signed (-1 = no target).
+#define STATUS_CODEC_VERSION 1
+#define STATUS_CODEC_FIELDS 7
+#define STATUS_CBOR_MAX_SIZE 40  // 1 array head + worst case field encodings
+#define STATUS_CBOR_CONTENT_TYPE "application/cbor"
+
+// Flag bits
+#define STATUS_FLAG_OUTPUT1       0x01
+#define STATUS_FLAG_OUTPUT2       0x02
+#define STATUS_FLAG_OUT_OF_RANGE  0x04
+#define STATUS_FLAG_SENSOR_READY  0x08
+
+struct StatusSample {
+    uint32_t sequence;       // sensor sample sequence number
+    uint64_t timestamp_us;   // microseconds since boot when the sample was taken
+    int16_t distance;        // filtered distance (mm)
+    int16_t raw_distance;    // last raw distance (mm)
+    uint8_t status;          // DeviceStatus value
+    uint8_t flags;           // STATUS_FLAG_* bits
+};
+
+// Encodes the sample into out. Returns the encoded size, or 0 if it does not fit.
+size_t encodeStatusCbor(const StatusSample& sample, uint8_t* out, size_t capacity);
+
+// Decodes a payload produced by encodeStatusCbor. Returns false on malformed
+// input or an unsupported version.
+bool decodeStatusCbor(const uint8_t* data, size_t len, StatusSample& sample);
@@ -17,5 +17,9 @@
 #define PIN_TOF_SCL             22
 #define PIN_TOF_SDA             23
 
+// Main loop pacing; sets the worst case between a sample becoming ready and the
+// outputs reacting to it (see bench/latency_harness.cpp)
+#define MAIN_LOOP_DELAY_MS      50
+
 extern Adafruit_NeoPixel led;
 extern Adafruit_VL53L1X vl53;
\ No newline at end of file
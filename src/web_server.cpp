@@ -1,48 +1,52 @@
 #include "web_server.h"
 
-WebServerManager::WebServerManager(ConfigManager* config_mgr, SensorManager* sensor_mgr) {
+WebServerManager::WebServerManager(ConfigManager* config_mgr, SensorManager* sensor_mgr, ApiCore* api_core) {
     config_manager = config_mgr;
     sensor_manager = sensor_mgr;
+    api = api_core;
     server = new AsyncWebServer(80);
-    dns_server = new DNSServer();
-    session_count = 0;
-    
-    // Initialize session arrays
-    for (int i = 0; i < 10; i++) {
-        authenticated_sessions[i] = false;
-        session_tokens[i] = "";
-    }
+    captive_dns = new CaptiveDns();
+    shed_count = 0;
+    status_cache.valid = false;
+    tracer.install();
+    ota_request = nullptr;
+    ota_last_chunk_ms = 0;
+    ota_samples_start = 0;
+    ota_missed_start = 0;
+    restart_pending = false;
+    restart_at_ms = 0;
 }
 
 WebServerManager::~WebServerManager() {
     delete server;
-    delete dns_server;
+    delete captive_dns;
 }
 
 bool WebServerManager::initialize() {
-    // Set up basic routes
-    server->on("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    // Set up basic routes; the page, the login form and the API go through
+    // the load and rate checks of onGuarded()
+    onGuarded("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleRoot(request);
     });
     
     // iOS Captive Portal Detection routes
-    server->on("/hotspot-detect.html", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onTraced("/hotspot-detect.html", HTTP_GET, [this](AsyncWebServerRequest* request) {
         request->redirect("/");
     });
     
-    server->on("/library/test/success.html", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onTraced("/library/test/success.html", HTTP_GET, [this](AsyncWebServerRequest* request) {
         request->redirect("/");
     });
     
-    server->on("/captive", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onTraced("/captive", HTTP_GET, [this](AsyncWebServerRequest* request) {
         request->redirect("/");
     });
     
-    server->on("/generate_204", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onTraced("/generate_204", HTTP_GET, [this](AsyncWebServerRequest* request) {
         request->send(204);
     });
     
-    server->on("/fwlink", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onTraced("/fwlink", HTTP_GET, [this](AsyncWebServerRequest* request) {
         request->redirect("/");
     });
     
@@ -55,31 +59,86 @@ bool WebServerManager::initialize() {
         }
     });
     
-    server->on("/api/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onGuarded("/api/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleGetStatus(request);
     });
     
-    server->on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onGuarded("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleGetConfig(request);
     });
     
-    server->on("/api/config", HTTP_POST, [this](AsyncWebServerRequest* request) {
+    onGuarded("/api/config", HTTP_POST, [this](AsyncWebServerRequest* request) {
         handleSetConfig(request);
+    }, [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+        handleConfigBody(request, data, len, index, total);
+    });
+    
+    onGuarded("/api/history", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleGetHistory(request);
+    });
+    
+    onGuarded("/api/clear-history", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        handleClearHistory(request);
+    });
+    
+    onGuarded("/api/captures", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleGetCaptures(request);
+    });
+    
+    onGuarded("/api/capture", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleGetCapture(request);
+    });
+    
+    onGuarded("/api/raw-status", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleRawStatus(request);
+    });
+    
+    onGuarded("/api/raw-start", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        handleRawControl(request, RAW_CONTROL_START);
+    });
+    
+    onGuarded("/api/raw-stop", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        handleRawControl(request, RAW_CONTROL_STOP);
+    });
+    
+    onGuarded("/api/raw-erase", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        handleRawControl(request, RAW_CONTROL_ERASE);
+    });
+    
+    onGuarded("/api/raw-log", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleRawDownload(request);
     });
     
-    server->on("/login", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onGuarded("/api/dns", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleDnsStats(request);
+    });
+    
+    onGuarded("/api/reset-config", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        handleResetConfig(request);
+    });
+    
+    onGuarded("/api/trace", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleTrace(request);
+    });
+    
+    // Prometheus scrape target; read only, so no session is needed
+    onGuarded("/metrics", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleMetrics(request);
+    });
+    
+    onTraced("/login", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleLogin(request);
     });
     
-    server->on("/login", HTTP_POST, [this](AsyncWebServerRequest* request) {
+    onGuarded("/login", HTTP_POST, [this](AsyncWebServerRequest* request) {
         handleLogin(request);
     });
     
-    server->on("/logout", HTTP_POST, [this](AsyncWebServerRequest* request) {
+    onTraced("/logout", HTTP_POST, [this](AsyncWebServerRequest* request) {
         handleLogout(request);
     });
     
-    server->on("/api/change-password", HTTP_POST, [this](AsyncWebServerRequest* request) {
+    onGuarded("/api/change-password", HTTP_POST, [this](AsyncWebServerRequest* request) {
         handleChangePassword(request);
     });
     
@@ -150,8 +209,11 @@ bool WebServerManager::startAccessPoint() {
         Serial.println(ip);
         
         // Start DNS server for captive portal
-        dns_server->start(53, "*", ip);
-        Serial.println("DNS server started for captive portal");
+        if (captive_dns->begin(ip)) {
+            Serial.println("DNS server started for captive portal");
+        } else {
+            Serial.println("Failed to start DNS server");
+        }
         
         return true;
     }
@@ -161,56 +223,136 @@ bool WebServerManager::startAccessPoint() {
 }
 
 void WebServerManager::stopAccessPoint() {
+    captive_dns->stop();
     WiFi.softAPdisconnect(true);
     Serial.println("Access Point stopped");
 }
 
-void WebServerManager::handleClient() {
-    // Process DNS requests for captive portal
-    dns_server->processNextRequest();
+bool WebServerManager::isAuthenticated(AsyncWebServerRequest* request) {
+    if (!request->hasHeader("Cookie")) return false;
+    const char* token;
+    size_t len;
+    return sessionTokenFromCookie(request->header("Cookie").c_str(), token, len) && api->validateSession(token, len);
 }
 
-String WebServerManager::generateSessionToken() {
-    String token = "";
-    for (int i = 0; i < 16; i++) {
-        token += String(random(0, 16), HEX);
-    }
-    return token;
+void WebServerManager::sendReply(AsyncWebServerRequest* request, const ApiReply& reply) {
+    request->send(reply.code, "application/json", reply.body);
 }
 
-void WebServerManager::addSession(const String& token) {
-    for (int i = 0; i < 10; i++) {
-        if (!authenticated_sessions[i]) {
-            authenticated_sessions[i] = true;
-            session_tokens[i] = token;
-            session_count++;
-            break;
-        }
+// Below the free heap or largest block the web server needs to answer safely
+bool WebServerManager::heapLow() {
+    return ESP.getFreeHeap() < WEB_SHED_FREE_HEAP || ESP.getMaxAllocHeap() < WEB_SHED_MAX_ALLOC;
+}
+
+// 503 with Retry-After, counted as shed
+void WebServerManager::sendBusy(AsyncWebServerRequest* request) {
+    char retry_after[12];
+    shed_count++;
+    snprintf(retry_after, sizeof(retry_after), "%u", (unsigned)WEB_SHED_RETRY_AFTER_S);
+    AsyncWebServerResponse* res = request->beginResponse(503, "application/json", "{\"error\":\"Busy\"}");
+    res->addHeader("Retry-After", retry_after);
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+// Answers with 503 when the heap is low and 429 when the client is over its
+// rate; false if the request must not be handled
+bool WebServerManager::admitRequest(AsyncWebServerRequest* request) {
+    char retry_after[12];
+    
+    // Shed load before a handler allocates anything for its reply
+    if (heapLow()) {
+        sendBusy(request);
+        return false;
     }
+    
+    IPAddress ip = request->client()->remoteIP();
+    uint32_t client = ((uint32_t)ip[0] << 24) | ((uint32_t)ip[1] << 16) | ((uint32_t)ip[2] << 8) | ip[3];
+    uint32_t retry_after_s;
+    if (!rate_limiter.allow(client, millis(), retry_after_s)) {
+        snprintf(retry_after, sizeof(retry_after), "%lu", (unsigned long)retry_after_s);
+        AsyncWebServerResponse* res = request->beginResponse(429, "application/json", "{\"error\":\"Too many requests\"}");
+        res->addHeader("Retry-After", retry_after);
+        res->addHeader("Connection", "close");
+        request->send(res);
+        return false;
+    }
+    return true;
 }
 
-bool WebServerManager::validateSession(const String& token) {
-    for (int i = 0; i < 10; i++) {
-        if (authenticated_sessions[i] && session_tokens[i] == token) {
-            return true;
-        }
+// Registers a route whose callbacks are traced (see HttpTracer): each upload
+// or body chunk and the handler, as one request. uri must be a literal.
+void WebServerManager::onTraced(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler,
+                                ArUploadHandlerFunction on_upload, ArBodyHandlerFunction on_body) {
+    int route = tracer.addRoute(uri, method == HTTP_POST ? "POST" : "GET");
+    
+    ArUploadHandlerFunction traced_upload = nullptr;
+    if (on_upload) {
+        traced_upload = [this, route, on_upload](AsyncWebServerRequest* request, const String& filename, size_t index,
+                                                  uint8_t* data, size_t len, bool final) {
+            traceBegin(route, request);
+            on_upload(request, filename, index, data, len, final);
+            tracer.end(false);
+        };
     }
-    return false;
+    ArBodyHandlerFunction traced_body = nullptr;
+    if (on_body) {
+        traced_body = [this, route, on_body](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index,
+                                              size_t total) {
+            traceBegin(route, request);
+            on_body(request, data, len, index, total);
+            tracer.end(false);
+        };
+    }
+    
+    server->on(uri, method, [this, route, handler](AsyncWebServerRequest* request) {
+        traceBegin(route, request);
+        handler(request);
+        tracer.end(true);
+    }, traced_upload, traced_body);
 }
 
-bool WebServerManager::isAuthenticated(AsyncWebServerRequest* request) {
-    if (request->hasHeader("Cookie")) {
-        String cookie = request->header("Cookie");
-        int tokenStart = cookie.indexOf("session_token=");
-        if (tokenStart != -1) {
-            tokenStart += 14; // Length of "session_token="
-            int tokenEnd = cookie.indexOf(";", tokenStart);
-            if (tokenEnd == -1) tokenEnd = cookie.length();
-            String token = cookie.substring(tokenStart, tokenEnd);
-            return validateSession(token);
-        }
+// A traced route whose requests go through admitRequest() first
+void WebServerManager::onGuarded(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler,
+                                 ArBodyHandlerFunction on_body) {
+    onTraced(uri, method, [this, handler](AsyncWebServerRequest* request) {
+        if (!admitRequest(request)) return;
+        handler(request);
+    }, nullptr, on_body);
+}
+
+// Opens or continues the request's trace; the bytes its connection sends are
+// counted until it disconnects. The request has one disconnect callback, so
+// an OTA upload whose client goes away is cleaned up from here too
+void WebServerManager::traceBegin(int route, AsyncWebServerRequest* request) {
+    const void* connection = request->client()->pcb();
+    tracer.begin(route, request, connection);
+    request->onDisconnect([this, request, connection]() {
+        tracer.disconnect(connection);
+        if (request == ota_request) abandonOTA();
+    });
+}
+
+// Status of the current sample, rendered at most once per sample (and
+// STATUS_CACHE_MAX_AGE_MS) however many clients poll it
+const StatusCache& WebServerManager::currentStatus() {
+    StatusSample sample;
+    api->readStatus(sample);
+    uint32_t now = millis();
+    if (status_cache.valid && now - status_cache.rendered_ms < STATUS_CACHE_MAX_AGE_MS &&
+        sample.sequence == status_cache.sample.sequence && sample.status == status_cache.sample.status &&
+        sample.flags == status_cache.sample.flags) {
+        return status_cache;
     }
-    return false;
+    
+    JsonWriter json(status_cache.json, sizeof(status_cache.json));
+    api->writeStatusJson(json, sample);
+    status_cache.json_len = json.finish();
+    status_cache.cbor_len = encodeStatusCbor(sample, status_cache.cbor, sizeof(status_cache.cbor));
+    status_cache.sample = sample;
+    status_cache.rendered_ms = now;
+    status_cache.valid = true;
+    return status_cache;
 }
 
 void WebServerManager::handleRoot(AsyncWebServerRequest* request) {
@@ -304,6 +446,10 @@ String WebServerManager::generateMainPage() {
     html += "<label>Polarity:</label>";
     html += "<select id='output1_polarity' name='output1_polarity'><option value='in_range'>Active In Range</option><option value='out_range'>Active Out of Range</option></select>";
     html += "</div>";
+    html += "<div class='form-grid'>";
+    html += "<label>During Firmware Update:</label>";
+    html += "<select id='output1_ota_state' name='output1_ota_state'><option value='live'>Keep Switching</option><option value='hold'>Hold State</option><option value='low'>Force Low</option><option value='high'>Force High</option></select>";
+    html += "</div>";
     html += "</div>";
     html += "<div class='output-config'>";
     html += "<div class='output-header'>";
@@ -329,6 +475,10 @@ String WebServerManager::generateMainPage() {
     html += "<label>Polarity:</label>";
     html += "<select id='output2_polarity' name='output2_polarity'><option value='in_range'>Active In Range</option><option value='out_range'>Active Out of Range</option></select>";
     html += "</div>";
+    html += "<div class='form-grid'>";
+    html += "<label>During Firmware Update:</label>";
+    html += "<select id='output2_ota_state' name='output2_ota_state'><option value='live'>Keep Switching</option><option value='hold'>Hold State</option><option value='low'>Force Low</option><option value='high'>Force High</option></select>";
+    html += "</div>";
     html += "</div>";
     html += "<button type='button' class='config-btn' onclick='saveConfig()'>Save Configuration</button>";
     html += "</form>";
@@ -359,7 +509,7 @@ String WebServerManager::generateMainPage() {
     html += "<h3>Firmware Update (OTA)</h3>";
     html += "<div class='output-config'>";
     html += "<p style='color: #856404; background: #fff3cd; padding: 10px; border-radius: 5px; border: 1px solid #ffeaa7;'>";
-    html += "<strong>Warning:</strong> Only upload firmware files (.bin) intended for this device. ";
+    html += "<strong>Warning:</strong> Only upload signed firmware files (.signed.bin or .signed.bin.gz, see tools/ota_sign.py and tools/ota_pack.py) intended for this device. ";
     html += "Incorrect firmware can permanently damage the device.";
     html += "</p>";
     html += "<p><strong>Version:   </strong> " + String(FW_VERSION) + "</p>";
@@ -407,11 +557,13 @@ String WebServerManager::generateMainPage() {
     html += "document.getElementById('output1_max').value = data.output1.max;";
     html += "document.getElementById('output1_hysteresis').value = data.output1.hysteresis;";
     html += "document.getElementById('output1_polarity').value = data.output1.active_in_range ? 'in_range' : 'out_range';";
+    html += "document.getElementById('output1_ota_state').value = data.output1.ota_state;";
     html += "document.getElementById('output2_enabled').checked = data.output2.enabled;";
     html += "document.getElementById('output2_min').value = data.output2.min;";
     html += "document.getElementById('output2_max').value = data.output2.max;";
     html += "document.getElementById('output2_hysteresis').value = data.output2.hysteresis;";
     html += "document.getElementById('output2_polarity').value = data.output2.active_in_range ? 'in_range' : 'out_range';";
+    html += "document.getElementById('output2_ota_state').value = data.output2.ota_state;";
     html += "}).catch(error => console.error('Error:', error));";
     html += "}";
     html += "function saveConfig() {";
@@ -421,11 +573,13 @@ String WebServerManager::generateMainPage() {
     html += "formData.append('output1_max', document.getElementById('output1_max').value);";
     html += "formData.append('output1_hysteresis', document.getElementById('output1_hysteresis').value);";
     html += "formData.append('output1_polarity', document.getElementById('output1_polarity').value);";
+    html += "formData.append('output1_ota_state', document.getElementById('output1_ota_state').value);";
     html += "formData.append('output2_enabled', document.getElementById('output2_enabled').checked ? '1' : '0');";
     html += "formData.append('output2_min', document.getElementById('output2_min').value);";
     html += "formData.append('output2_max', document.getElementById('output2_max').value);";
     html += "formData.append('output2_hysteresis', document.getElementById('output2_hysteresis').value);";
     html += "formData.append('output2_polarity', document.getElementById('output2_polarity').value);";
+    html += "formData.append('output2_ota_state', document.getElementById('output2_ota_state').value);";
     html += "fetch('/api/config', { method: 'POST', body: formData })";
     html += ".then(response => response.json()).then(data => {";
     html += "const msgDiv = document.getElementById('config-message');";
@@ -519,31 +673,29 @@ void WebServerManager::handleGetStatus(AsyncWebServerRequest* request) {
         return;
     }
     
-    JsonDocument doc;
-    doc["distance"] = sensor_manager->getDistance();
-    doc["raw_distance"] = sensor_manager->getRawDistance();
-    doc["sensor_ready"] = sensor_manager->isSensorReady();
-    doc["out_of_range"] = sensor_manager->isOutOfRange();
+    // Machine clients can ask for the compact CBOR encoding instead of JSON
+    bool want_cbor = false;
+    if (request->hasParam("format")) {
+        want_cbor = request->getParam("format")->value() == "cbor";
+    } else if (request->hasHeader("Accept")) {
+        want_cbor = request->header("Accept").indexOf(STATUS_CBOR_CONTENT_TYPE) != -1;
+    }
+    
+    // Polls of the same sample share one rendering
+    const StatusCache& status = currentStatus();
     
-    switch (sensor_manager->getStatus()) {
-        case STATUS_OK:
-            doc["status"] = "OK";
-            break;
-        case STATUS_TRIGGERED:
-            doc["status"] = "TRIGGERED";
-            break;
-        case STATUS_FAULT:
-            doc["status"] = "FAULT";
-            break;
+    if (want_cbor) {
+        AsyncResponseStream* res = request->beginResponseStream(STATUS_CBOR_CONTENT_TYPE);
+        res->write(status.cbor, status.cbor_len);
+        res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+        res->addHeader("Connection", "close");
+        request->send(res);
+        return;
     }
     
-    doc["output1_state"] = sensor_manager->getOutput1Config().current_state;
-    doc["output2_state"] = sensor_manager->getOutput2Config().current_state;
-    doc["timestamp"] = millis();
+    AsyncResponseStream* res = request->beginResponseStream("application/json");
+    res->write((const uint8_t*)status.json, status.json_len);
     
-    String response;
-    serializeJson(doc, response);
-    AsyncWebServerResponse* res = request->beginResponse(200, "application/json", response);
     res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     res->addHeader("Pragma", "no-cache");
     res->addHeader("Expires", "0");
@@ -557,8 +709,11 @@ void WebServerManager::handleGetConfig(AsyncWebServerRequest* request) {
         return;
     }
     
-    String config = config_manager->getConfigJson();
-    AsyncWebServerResponse* res = request->beginResponse(200, "application/json", config);
+    AsyncResponseStream* res = request->beginResponseStream("application/json");
+    JsonWriter json(*res);
+    api->writeConfigJson(json);
+    json.finish();
+    
     res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     res->addHeader("Pragma", "no-cache");
     res->addHeader("Expires", "0");
@@ -606,23 +761,24 @@ void WebServerManager::handleLogin(AsyncWebServerRequest* request) {
         request->send(response);
     } else {
         // Process login
-        if (request->hasParam("password", true)) {
-            String password = request->getParam("password", true)->value();
-            WiFiConfig wifi_config = config_manager->getWiFiConfig();
-            
-            if (password == wifi_config.admin_password) {
-                // Generate session token
-                String token = generateSessionToken();
-                addSession(token);
-                
-                // Set cookie and redirect
-                AsyncWebServerResponse* response = request->beginResponse(302);
-                response->addHeader("Location", "/");
-                response->addHeader("Set-Cookie", "session_token=" + token + "; Path=/; HttpOnly");
-                request->send(response);
-            } else {
-                request->redirect("/login?error=1");
-            }
+        ApiLoginParams params;
+        params.has_password = false;
+        const AsyncWebParameter* password = request->getParam("password", true);
+        if (password != nullptr) {
+            params.has_password = true;
+            apiCopyField(params.password, sizeof(params.password), password->value().c_str(), password->value().length());
+        }
+        
+        char token[API_TOKEN_LENGTH + 1];
+        if (api->login(params, token).code == 200) {
+            // Set cookie and redirect; the browser drops it when the session expires anyway
+            char cookie[API_TOKEN_LENGTH + 96];
+            snprintf(cookie, sizeof(cookie), SESSION_COOKIE_NAME "=%s; Path=/; HttpOnly; SameSite=Strict; Max-Age=%lu",
+                     token, SESSION_ABSOLUTE_TIMEOUT_MS / 1000);
+            AsyncWebServerResponse* response = request->beginResponse(302);
+            response->addHeader("Location", "/");
+            response->addHeader("Set-Cookie", cookie);
+            request->send(response);
         } else {
             request->redirect("/login?error=1");
         }
@@ -631,30 +787,16 @@ void WebServerManager::handleLogin(AsyncWebServerRequest* request) {
 
 void WebServerManager::handleLogout(AsyncWebServerRequest* request) {
     // Clear session
-    if (request->hasHeader("Cookie")) {
-        String cookie = request->header("Cookie");
-        int tokenStart = cookie.indexOf("session_token=");
-        if (tokenStart != -1) {
-            tokenStart += 14;
-            int tokenEnd = cookie.indexOf(";", tokenStart);
-            if (tokenEnd == -1) tokenEnd = cookie.length();
-            String token = cookie.substring(tokenStart, tokenEnd);
-            
-            // Remove session
-            for (int i = 0; i < 10; i++) {
-                if (session_tokens[i] == token) {
-                    authenticated_sessions[i] = false;
-                    session_tokens[i] = "";
-                    break;
-                }
-            }
-        }
+    const char* token;
+    size_t len;
+    if (request->hasHeader("Cookie") && sessionTokenFromCookie(request->header("Cookie").c_str(), token, len)) {
+        api->logout(token, len);
     }
     
     // Clear cookie and redirect
     AsyncWebServerResponse* response = request->beginResponse(302);
     response->addHeader("Location", "/login");
-    response->addHeader("Set-Cookie", "session_token=; Path=/; HttpOnly; Max-Age=0");
+    response->addHeader("Set-Cookie", SESSION_COOKIE_NAME "=; Path=/; HttpOnly; Max-Age=0");
     request->send(response);
 }
 
@@ -664,159 +806,579 @@ void WebServerManager::handleChangePassword(AsyncWebServerRequest* request) {
         return;
     }
     
-    if (request->hasParam("current_password", true) && request->hasParam("new_password", true)) {
-        String current_password = request->getParam("current_password", true)->value();
-        String new_password = request->getParam("new_password", true)->value();
-        
-        WiFiConfig wifi_config = config_manager->getWiFiConfig();
-        
-        if (current_password == wifi_config.admin_password) {
-            wifi_config.admin_password = new_password;
-            config_manager->setWiFiConfig(wifi_config);
-            config_manager->saveConfig();
-            
-            Serial.println("Admin password changed via web interface");
-            request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Password changed successfully\"}");
-        } else {
-            request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Current password is incorrect\"}");
+    ApiPasswordParams params;
+    params.has_current = false;
+    params.has_new = false;
+    for (size_t i = 0; i < request->params(); i++) {
+        const AsyncWebParameter* p = request->getParam(i);
+        if (!p->isPost()) continue;
+        if (p->name() == "current_password") {
+            params.has_current = true;
+            apiCopyField(params.current_password, sizeof(params.current_password), p->value().c_str(), p->value().length());
+        } else if (p->name() == "new_password") {
+            params.has_new = true;
+            apiCopyField(params.new_password, sizeof(params.new_password), p->value().c_str(), p->value().length());
         }
-    } else {
-        request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Missing required parameters\"}");
     }
+    sendReply(request, api->changePassword(params));
 }
+
+// Form bodies arrive as parameters, anything else through handleConfigBody()
+static bool isFormContent(const String& content_type) {
+    return strncasecmp(content_type.c_str(), "application/x-www-form-urlencoded", 33) == 0 ||
+           strncasecmp(content_type.c_str(), "multipart/form-data", 19) == 0;
+}
+
+// Collects a JSON body of POST /api/config; form bodies arrive as parameters instead
+void WebServerManager::handleConfigBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    if (index == 0) {
+        // Body callbacks run before admitRequest(): keep nothing while the
+        // heap is short, handleSetConfig() then sheds the request
+        if (!isAuthenticated(request) || heapLow()) return;
+        ConfigBody* body = (ConfigBody*)malloc(sizeof(ConfigBody));
+        if (body == nullptr) return;
+        body->len = 0;
+        body->too_large = total > sizeof(body->data);
+        request->_tempObject = body;
+    }
+    
+    ConfigBody* body = (ConfigBody*)request->_tempObject;
+    if (body == nullptr || body->too_large) return;
+    if (index + len > sizeof(body->data)) {
+        body->too_large = true;
+        return;
+    }
+    memcpy(body->data + index, data, len);
+    body->len = index + len;
+}
+
 void WebServerManager::handleSetConfig(AsyncWebServerRequest* request) {
     if (!isAuthenticated(request)) {
         request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
         return;
     }
     
-    // Parse form data from POST request
-    bool config_changed = false;
-    DeviceConfig current_config = config_manager->getDeviceConfig();
+    ApiConfigParams params;
+    memset(&params, 0, sizeof(params));
     
-    // Output 1 configuration
-    if (request->hasParam("output1_enabled", true)) {
-        bool new_enabled = request->getParam("output1_enabled", true)->value() == "1";
-        if (new_enabled != current_config.output1_enabled) {
-            current_config.output1_enabled = new_enabled;
-            config_changed = true;
+    // JSON: all or nothing, an unknown field or a wrong type rejects the update
+    ConfigBody* body = (ConfigBody*)request->_tempObject;
+    if (body == nullptr && request->contentLength() > 0 && !isFormContent(request->contentType())) {
+        sendBusy(request);   // handleConfigBody() could not keep it
+        return;
+    }
+    if (body != nullptr) {
+        if (body->too_large) {
+            request->send(413, "application/json", "{\"status\":\"error\",\"message\":\"Config too large\"}");
+            return;
         }
+        ApiReply error;
+        if (!apiParseConfigJson(params, body->data, body->len, error)) {
+            sendReply(request, error);
+            return;
+        }
+        sendReply(request, api->setConfig(params));
+        return;
     }
     
-    if (request->hasParam("output1_min", true)) {
-        int new_min = request->getParam("output1_min", true)->value().toInt();
-        if (new_min != current_config.output1_min) {
-            current_config.output1_min = new_min;
-            config_changed = true;
+    // Form: one pass over the fields; unknown names are ignored
+    for (size_t i = 0; i < request->params(); i++) {
+        const AsyncWebParameter* p = request->getParam(i);
+        if (p->isPost() && !p->isFile()) {
+            apiParseConfigField(params, p->name().c_str(), p->value().c_str());
         }
     }
+    sendReply(request, api->setConfig(params));
+}
+
+// Streams history items with sequence >= ?since=<seq> straight out of the ring buffers.
+// Without ?tier= the 1Hz point buffer is returned; ?tier=0..2 selects an aggregated
+// tier (1 s, 1 min, 1 h buckets). Clients pass back "next" to poll for deltas.
+void WebServerManager::handleGetHistory(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
+    }
     
-    if (request->hasParam("output1_max", true)) {
-        int new_max = request->getParam("output1_max", true)->value().toInt();
-        if (new_max != current_config.output1_max) {
-            current_config.output1_max = new_max;
-            config_changed = true;
-        }
+    // Time range queries are served from the persistent log
+    if (request->hasParam("from") || request->hasParam("to")) {
+        handleGetHistoryRange(request);
+        return;
     }
     
-    if (request->hasParam("output1_hysteresis", true)) {
-        int new_hyst = request->getParam("output1_hysteresis", true)->value().toInt();
-        if (new_hyst != current_config.output1_hysteresis) {
-            current_config.output1_hysteresis = new_hyst;
-            config_changed = true;
+    int8_t tier = HISTORY_TIER_POINTS;
+    if (request->hasParam("tier")) {
+        long requested = request->getParam("tier")->value().toInt();
+        if (requested < 0 || requested >= HISTORY_TIER_COUNT) {
+            request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid history tier\"}");
+            return;
         }
+        tier = (int8_t)requested;
     }
     
-    if (request->hasParam("output1_polarity", true)) {
-        bool new_polarity = request->getParam("output1_polarity", true)->value() == "in_range";
-        if (new_polarity != current_config.output1_active_in_range) {
-            current_config.output1_active_in_range = new_polarity;
-            config_changed = true;
+    uint32_t oldest_seq = config_manager->getHistoryOldestSeq(tier);
+    uint32_t end_seq = config_manager->getHistoryNextSeq(tier);
+    uint32_t start_seq = oldest_seq;
+    if (request->hasParam("since")) {
+        uint32_t since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+        // A cursor ahead of the device (e.g. after a reboot) restarts from the oldest item
+        if (since > oldest_seq && since <= end_seq) {
+            start_seq = since;
         }
     }
     
-    // Output 2 configuration
-    if (request->hasParam("output2_enabled", true)) {
-        bool new_enabled = request->getParam("output2_enabled", true)->value() == "1";
-        if (new_enabled != current_config.output2_enabled) {
-            current_config.output2_enabled = new_enabled;
-            config_changed = true;
-        }
+    struct HistoryStream {
+        uint32_t seq;
+        uint32_t end_seq;
+        uint16_t count;
+        int8_t tier;
+        uint8_t phase;  // 0 = header, 1 = items, 2 = trailer, 3 = done
+    };
+    HistoryStream stream = {start_seq, end_seq, 0, tier, 0};
+    ConfigManager* config = config_manager;
+    
+    AsyncWebServerResponse* res = request->beginChunkedResponse("application/json",
+        [config, stream](uint8_t* buffer, size_t max_len, size_t index) mutable -> size_t {
+            size_t len = 0;
+            char item[HISTORY_JSON_POINT_MAX];
+            
+            if (stream.phase == 0) {
+                int item_len = snprintf(item, sizeof(item), "{\"tier\":%d,\"interval_ms\":%lu,\"points\":[",
+                                        stream.tier, (unsigned long)config->getHistoryIntervalMs(stream.tier));
+                if ((size_t)item_len > max_len) return RESPONSE_TRY_AGAIN;
+                memcpy(buffer, item, item_len);
+                len = item_len;
+                stream.phase = 1;
+            }
+            
+            // Fill the chunk one item at a time, never splitting an item across chunks
+            while (stream.phase == 1 && stream.seq < stream.end_seq) {
+                size_t item_len = 0;
+                if (stream.count > 0) item[item_len++] = ',';
+                JsonWriter json(item + item_len, sizeof(item) - item_len);
+                if (!config->writeHistoryItemJson(json, stream.tier, stream.seq)) {
+                    uint32_t oldest = config->getHistoryOldestSeq(stream.tier);
+                    if (stream.seq < oldest) {
+                        // Overwritten while streaming - skip ahead to the oldest retained item
+                        stream.seq = oldest;
+                        continue;
+                    }
+                    stream.seq = stream.end_seq; // Cleared while streaming
+                    break;
+                }
+                item_len += json.finish();
+                
+                if (item_len > max_len - len) break;  // Chunk full
+                memcpy(buffer + len, item, item_len);
+                len += item_len;
+                stream.count++;
+                stream.seq++;
+            }
+            if (stream.phase == 1 && stream.seq >= stream.end_seq) {
+                stream.phase = 2;
+            }
+            
+            if (stream.phase == 2) {
+                int item_len = snprintf(item, sizeof(item), "],\"count\":%u,\"next\":%lu,\"current_time\":%lu}",
+                                        stream.count, (unsigned long)stream.end_seq, (unsigned long)millis());
+                if ((size_t)item_len <= max_len - len) {
+                    memcpy(buffer + len, item, item_len);
+                    len += item_len;
+                    stream.phase = 3;
+                }
+            }
+            
+            if (len == 0) {
+                return stream.phase == 3 ? 0 : RESPONSE_TRY_AGAIN;
+            }
+            return len;
+        });
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+void WebServerManager::handleGetHistoryRange(AsyncWebServerRequest* request) {
+    HistoryLog* log = config_manager->getHistoryLog();
+    uint32_t now_s = log->now();
+    uint32_t from_s = 0;
+    uint32_t to_s = now_s;
+    if (request->hasParam("from")) {
+        from_s = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("to")) {
+        to_s = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+    }
+    if (from_s > to_s) {
+        request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid history range\"}");
+        return;
     }
     
-    if (request->hasParam("output2_min", true)) {
-        int new_min = request->getParam("output2_min", true)->value().toInt();
-        if (new_min != current_config.output2_min) {
-            current_config.output2_min = new_min;
-            config_changed = true;
-        }
+    struct RangeStream {
+        HistoryLogCursor cursor;
+        uint32_t from_s;
+        uint32_t to_s;
+        uint32_t now_s;
+        uint32_t count;
+        bool pending;             // record read but not yet sent (chunk was full)
+        HistoryLogRecord record;
+        uint8_t phase;            // 0 = header, 1 = records, 2 = trailer, 3 = done
+    };
+    // The cursor holds a file handle and a page buffer, so the state is shared
+    // between copies of the filler rather than captured by value
+    std::shared_ptr<RangeStream> stream = std::make_shared<RangeStream>();
+    stream->from_s = from_s;
+    stream->to_s = to_s;
+    stream->now_s = now_s;
+    stream->count = 0;
+    stream->pending = false;
+    stream->phase = 0;
+    log->openRange(stream->cursor, from_s, to_s);
+    
+    AsyncWebServerResponse* res = request->beginChunkedResponse("application/json",
+        [stream](uint8_t* buffer, size_t max_len, size_t index) -> size_t {
+            size_t len = 0;
+            char item[HISTORY_JSON_POINT_MAX];
+            
+            if (stream->phase == 0) {
+                int item_len = snprintf(item, sizeof(item), "{\"from\":%lu,\"to\":%lu,\"points\":[",
+                                        (unsigned long)stream->from_s, (unsigned long)stream->to_s);
+                if ((size_t)item_len > max_len) return RESPONSE_TRY_AGAIN;
+                memcpy(buffer, item, item_len);
+                len = item_len;
+                stream->phase = 1;
+            }
+            
+            while (stream->phase == 1) {
+                if (!stream->pending) {
+                    if (!stream->cursor.next(stream->record)) {
+                        stream->phase = 2;
+                        break;
+                    }
+                    stream->pending = true;
+                }
+                
+                size_t item_len = 0;
+                if (stream->count > 0) item[item_len++] = ',';
+                JsonWriter json(item + item_len, sizeof(item) - item_len);
+                json.beginObject();
+                json.addUInt("time", stream->record.time_s);
+                json.addInt("distance", stream->record.distance);
+                json.addBool("output1", stream->record.flags & HISTORY_LOG_FLAG_OUTPUT1);
+                json.addBool("output2", stream->record.flags & HISTORY_LOG_FLAG_OUTPUT2);
+                json.endObject();
+                item_len += json.finish();
+                
+                if (item_len > max_len - len) break;  // Chunk full
+                memcpy(buffer + len, item, item_len);
+                len += item_len;
+                stream->count++;
+                stream->pending = false;
+            }
+            
+            if (stream->phase == 2) {
+                int item_len = snprintf(item, sizeof(item), "],\"count\":%lu,\"current_time\":%lu}",
+                                        (unsigned long)stream->count, (unsigned long)stream->now_s);
+                if ((size_t)item_len <= max_len - len) {
+                    memcpy(buffer + len, item, item_len);
+                    len += item_len;
+                    stream->phase = 3;
+                }
+            }
+            
+            if (len == 0) {
+                return stream->phase == 3 ? 0 : RESPONSE_TRY_AGAIN;
+            }
+            return len;
+        });
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+void WebServerManager::handleClearHistory(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
     }
     
-    if (request->hasParam("output2_max", true)) {
-        int new_max = request->getParam("output2_max", true)->value().toInt();
-        if (new_max != current_config.output2_max) {
-            current_config.output2_max = new_max;
-            config_changed = true;
-        }
+    sendReply(request, api->clearHistory());
+}
+
+void WebServerManager::handleGetCaptures(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
     }
     
-    if (request->hasParam("output2_hysteresis", true)) {
-        int new_hyst = request->getParam("output2_hysteresis", true)->value().toInt();
-        if (new_hyst != current_config.output2_hysteresis) {
-            current_config.output2_hysteresis = new_hyst;
-            config_changed = true;
-        }
+    AsyncResponseStream* res = request->beginResponseStream("application/json");
+    JsonWriter json(*res);
+    api->writeCapturesJson(json);
+    json.finish();
+    
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+// Downloads one capture as a CaptureHeader followed by its CaptureSamples
+void WebServerManager::handleGetCapture(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
     }
     
-    if (request->hasParam("output2_polarity", true)) {
-        bool new_polarity = request->getParam("output2_polarity", true)->value() == "in_range";
-        if (new_polarity != current_config.output2_active_in_range) {
-            current_config.output2_active_in_range = new_polarity;
-            config_changed = true;
-        }
+    CaptureBuffer* captures = sensor_manager->getCaptureBuffer();
+    uint32_t id = 0;
+    if (request->hasParam("id")) {
+        id = strtoul(request->getParam("id")->value().c_str(), nullptr, 10);
+    }
+    int index = captures->findSlot(id);
+    if (index < 0) {
+        request->send(404, "application/json", "{\"status\":\"error\",\"message\":\"Capture not found\"}");
+        return;
     }
     
-    // Apply changes if any were made
-    if (config_changed) {
-        config_manager->setDeviceConfig(current_config);
-        config_manager->saveConfig();
-        
-        // Update sensor manager with new configuration
-        sensor_manager->updateConfiguration(current_config);
-        
-        Serial.println("Configuration updated via web interface");
-        request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Configuration updated\"}");
-    } else {
-        request->send(200, "application/json", "{\"status\":\"no_change\",\"message\":\"No changes detected\"}");
+    const CaptureSlot* slot = captures->getSlot(index);
+    if (slot == nullptr) {
+        request->send(503, "application/json", "{\"status\":\"error\",\"message\":\"Capture was overwritten, retry\"}");
+        return;
+    }
+    CaptureHeader header = slot->header;
+    if (header.sample_count > CAPTURE_RING_SAMPLES) header.sample_count = CAPTURE_RING_SAMPLES;
+    
+    AsyncResponseStream* res = request->beginResponseStream(CAPTURE_CONTENT_TYPE);
+    res->write((const uint8_t*)&header, sizeof(CaptureHeader));
+    res->write((const uint8_t*)slot->samples, header.sample_count * sizeof(CaptureSample));
+    
+    // The slot may have been reused by a new capture while it was copied
+    if (header.id != id || slot->header.id != id) {
+        delete res;
+        request->send(503, "application/json", "{\"status\":\"error\",\"message\":\"Capture was overwritten, retry\"}");
+        return;
+    }
+    
+    char disposition[48];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=capture_%lu.bin", (unsigned long)id);
+    res->addHeader("Content-Disposition", disposition);
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+void WebServerManager::handleDnsStats(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
+    }
+    
+    AsyncResponseStream* res = request->beginResponseStream("application/json");
+    JsonWriter json(*res);
+    captive_dns->writeStatsJson(json);
+    json.finish();
+    
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+// Stack left unused at the deepest point so far, for each task that is known
+static void writeStackHighWater(PrometheusWriter& metrics, const char* task_name, TaskHandle_t task) {
+    if (task == nullptr) return;
+    char labels[32];
+    snprintf(labels, sizeof(labels), "task=\"%s\"", task_name);
+    metrics.value("task_stack_high_water_bytes", labels, uxTaskGetStackHighWaterMark(task));
+}
+
+void WebServerManager::handleMetrics(AsyncWebServerRequest* request) {
+    AsyncResponseStream* res = request->beginResponseStream(PROMETHEUS_CONTENT_TYPE);
+    PrometheusWriter metrics(*res);
+    
+    // Sample path
+    SensorSnapshot snapshot = sensor_manager->getSnapshot();
+    const SensorMetrics& sensor = sensor_manager->getMetrics();
+    metrics.counter("sensor_samples_total", "Data-ready samples read from the sensor", snapshot.sequence);
+    metrics.counter("sensor_rejected_readings_total", "Readings rejected for poor signal quality", snapshot.rejected_readings);
+    metrics.counter("sensor_faults_total", "Genuine fault readings and timed out polls", sensor.faults);
+    metrics.counter("sensor_recoveries_total", "Sensor reinitialised after it was disabled", sensor.recoveries);
+    metrics.gauge("sensor_ready", "1 while the sensor delivers filtered readings", snapshot.sensor_ready ? 1 : 0);
+    metrics.describe("sensor_sample_interval_seconds", "histogram", "Time between data-ready samples");
+    metrics.histogram("sensor_sample_interval_seconds", nullptr, sensor.sample_interval);
+    metrics.describe("sensor_update_seconds", "histogram", "SensorManager::update() calls that processed a sample");
+    metrics.histogram("sensor_update_seconds", nullptr, sensor.update_time);
+    metrics.describe("sensor_filter_seconds", "histogram", "Adaptive filter step of one reading");
+    metrics.histogram("sensor_filter_seconds", nullptr, sensor.filter_time);
+    metrics.describe("sensor_output_latency_seconds", "histogram", "Start of the sample's update() to the output pin write");
+    metrics.histogram("sensor_output_latency_seconds", nullptr, sensor.output_latency);
+    metrics.describe("sensor_ota_sample_interval_seconds", "histogram", "Time between samples while a firmware update is written");
+    metrics.histogram("sensor_ota_sample_interval_seconds", nullptr, sensor.ota_sample_interval);
+    metrics.counter("sensor_ota_missed_samples_total", "Samples skipped during firmware updates, from intervals over 1.5 usual periods",
+                    sensor.ota_missed_samples);
+    metrics.gauge("ota_update_running", "1 while firmware is written; outputs follow their ota_state", sensor_manager->isOTAUpdateMode() ? 1 : 0);
+    metrics.describe("ota_flash_write_seconds", "histogram", "Flash erase and write of one sector, last firmware upload");
+    metrics.histogram("ota_flash_write_seconds", nullptr, ota.getFlashTime());
+    
+    // Web server
+    char labels[64];
+    metrics.describe("http_handler_seconds", "histogram", "Handler time per route, excluding sending the reply");
+    for (int i = 0; i < tracer.getRouteCount(); i++) {
+        const HttpRouteStats& route = tracer.getRoute(i);
+        if (route.time.count == 0) continue;    // series appear with the first request
+        snprintf(labels, sizeof(labels), "route=\"%s\",method=\"%s\"", route.uri, route.method);
+        metrics.histogram("http_handler_seconds", labels, route.time);
+    }
+    RateLimitStats limits = rate_limiter.getStats();
+    metrics.counter("http_rate_limited_total", "Requests answered 429 by the per-client rate limit", limits.limited);
+    metrics.counter("http_shed_total", "Requests answered 503 for low heap", shed_count);
+    metrics.gauge("http_sessions_active", "Logged in sessions", api->getSessionStats().active);
+    
+    // Captive portal DNS
+    const CaptiveDnsStats& dns = captive_dns->getStats();
+    metrics.counter("dns_queries_total", "Captive portal DNS queries", dns.queries);
+    metrics.counter("dns_cache_hits_total", "Queries answered from the reply cache", dns.cache_hits);
+    metrics.counter("dns_dropped_total", "Malformed or unsupported DNS packets", dns.dropped);
+    metrics.describe("dns_reply_seconds", "histogram", "DNS packet received to reply sent");
+    metrics.histogram("dns_reply_seconds", nullptr, dns.latency);
+    
+    // Logs
+    RawRecorder* recorder = sensor_manager->getRawRecorder();
+    HistoryLog* history = config_manager->getHistoryLog();
+    metrics.describe("log_dropped_pages_total", "counter", "Log pages dropped because flash writes fell behind");
+    if (recorder != nullptr) metrics.value("log_dropped_pages_total", "log=\"raw\"", recorder->getDroppedPages());
+    metrics.value("log_dropped_pages_total", "log=\"history\"", history->getDroppedPages());
+    
+    // Memory
+    metrics.gauge("heap_free_bytes", "Free heap", ESP.getFreeHeap());
+    metrics.gauge("heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    metrics.gauge("heap_largest_free_block_bytes", "Largest block that can be allocated", ESP.getMaxAllocHeap());
+    metrics.describe("task_stack_high_water_bytes", "gauge", "Least stack left unused so far");
+    writeStackHighWater(metrics, "sensor", sensor_manager->getSampleTask());
+    writeStackHighWater(metrics, "web", xTaskGetCurrentTaskHandle());
+    writeStackHighWater(metrics, "dns", captive_dns->getTask());
+    if (recorder != nullptr) writeStackHighWater(metrics, "raw_recorder", recorder->getTask());
+    writeStackHighWater(metrics, "history_log", history->getTask());
+    metrics.gauge("uptime_seconds", "Time since boot", millis() / 1000);
+    
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+// Recent request traces and per-route totals
+void WebServerManager::handleTrace(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
+    }
+    
+    AsyncResponseStream* res = request->beginResponseStream("application/json");
+    JsonWriter json(*res);
+    tracer.writeJson(json);
+    json.finish();
+    
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+void WebServerManager::handleRawStatus(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
+    }
+    
+    AsyncResponseStream* res = request->beginResponseStream("application/json");
+    JsonWriter json(*res);
+    api->writeRawStatusJson(json);
+    json.finish();
+    
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+void WebServerManager::handleRawControl(AsyncWebServerRequest* request, uint8_t action) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
+    }
+    
+    sendReply(request, api->rawControl(action));
+}
+
+// Streams every valid page of the raw log straight from flash, oldest first.
+// The download is the on-flash format; see tools/raw_decode.py.
+void WebServerManager::handleRawDownload(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
     }
+    
+    RawRecorder* recorder = sensor_manager->getRawRecorder();
+    if (recorder == nullptr || !recorder->isAvailable()) {
+        request->send(503, "application/json", "{\"status\":\"error\",\"message\":\"Raw recorder unavailable\"}");
+        return;
+    }
+    
+    // Pages after the write position are the oldest ones
+    uint32_t start_page = recorder->getWritePage();
+    uint32_t pages_left = recorder->getPageTotal();
+    
+    AsyncWebServerResponse* res = request->beginChunkedResponse("application/octet-stream",
+        [recorder, start_page, pages_left](uint8_t* buffer, size_t max_len, size_t index) mutable -> size_t {
+            size_t len = 0;
+            uint32_t page_total = recorder->getPageTotal();
+            
+            while (pages_left > 0 && max_len - len >= RAW_PAGE_BYTES) {
+                uint32_t page_index = (start_page + page_total - pages_left) % page_total;
+                pages_left--;
+                
+                // Erased or never written pages are skipped; the decoder checks CRCs
+                uint32_t magic = 0;
+                if (recorder->readPage(page_index, buffer + len)) {
+                    memcpy(&magic, buffer + len, sizeof(magic));
+                }
+                if (magic == RAW_PAGE_MAGIC) {
+                    len += RAW_PAGE_BYTES;
+                }
+            }
+            
+            if (len == 0) {
+                return pages_left == 0 ? 0 : RESPONSE_TRY_AGAIN;
+            }
+            return len;
+        });
+    res->addHeader("Content-Disposition", "attachment; filename=rawlog.bin");
+    res->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    res->addHeader("Connection", "close");
+    request->send(res);
+}
+
+void WebServerManager::handleResetConfig(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "application/json", "{\"error\":\"Unauthorized\"}");
+        return;
+    }
+    
+    sendReply(request, api->resetConfig());
 }
-void WebServerManager::handleGetHistory(AsyncWebServerRequest* request) {}
-void WebServerManager::handleClearHistory(AsyncWebServerRequest* request) {}
-void WebServerManager::handleResetConfig(AsyncWebServerRequest* request) {}
 
 // OTA Update Implementation
 void WebServerManager::initializeOTA() {
+    // Flash writes go between sensor samples
+    ota.setFlashGate(waitForSampleGap, this);
+    
     // Add OTA update page route
-    server->on("/update", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    onTraced("/update", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleOTAUpdate(request);
     });
     
     // Add OTA upload handler
-    server->on("/update", HTTP_POST, 
-        [this](AsyncWebServerRequest* request) {
-            // Handle the response after upload completes
-            if (Update.hasError()) {
-                request->send(500, "text/plain", "Update Failed: " + String(Update.getError()));
-            } else {
-                request->send(200, "text/plain", "Update Successful! Rebooting...");
-                delay(1000);
-                ESP.restart();
-            }
-        },
-        [this](AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final) {
-            handleOTAUpload(request, filename, index, data, len, final);
-        }
-    );
+    onTraced("/update", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        handleOTAResult(request);
+    }, [this](AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) {
+        handleOTAUpload(request, filename, index, data, len, final);
+    });
     
     Serial.println("OTA Update service initialized");
     Serial.println("Access OTA update at: http://[device-ip]/update");
@@ -851,7 +1413,7 @@ void WebServerManager::handleOTAUpdate(AsyncWebServerRequest* request) {
     html += "<div class='container'>";
     html += "<h1>Firmware Update</h1>";
     html += "<div class='warning'>";
-    html += "<strong>Warning:</strong> Only upload firmware files (.bin) intended for this device. ";
+    html += "<strong>Warning:</strong> Only upload signed firmware files (.signed.bin or .signed.bin.gz, see tools/ota_sign.py and tools/ota_pack.py) intended for this device. ";
     html += "Incorrect firmware can permanently damage the device. Ensure you have a stable power supply during the update.";
     html += "</div>";
     html += "<div class='upload-section'>";
@@ -862,7 +1424,7 @@ void WebServerManager::handleOTAUpdate(AsyncWebServerRequest* request) {
     html += "</div>";
     html += "<form id='upload-form' enctype='multipart/form-data'>";
     html += "<h3>Select Firmware File</h3>";
-    html += "<input type='file' id='firmware-file' accept='.bin' required>";
+    html += "<input type='file' id='firmware-file' accept='.bin,.gz' required>";
     html += "<button type='submit' class='btn' id='upload-btn'>Upload Firmware</button>";
     html += "</form>";
     html += "<div id='progress' style='display: none;'>";
@@ -877,7 +1439,7 @@ void WebServerManager::handleOTAUpdate(AsyncWebServerRequest* request) {
     html += "const fileInput = document.getElementById('firmware-file');";
     html += "const file = fileInput.files[0];";
     html += "if (!file) { alert('Please select a firmware file'); return; }";
-    html += "if (!file.name.endsWith('.bin')) { alert('Please select a .bin file'); return; }";
+    html += "if (!file.name.endsWith('.bin') && !file.name.endsWith('.bin.gz')) { alert('Please select a .bin or .bin.gz file'); return; }";
     html += "uploadFirmware(file);";
     html += "});";
     html += "function uploadFirmware(file) {";
@@ -917,87 +1479,125 @@ void WebServerManager::handleOTAUpdate(AsyncWebServerRequest* request) {
     request->send(200, "text/html", html);
 }
 
-void WebServerManager::handleOTAUpload(AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final) {
-    if (!index) {
-        Serial.printf("OTA Update Start: %s\n", filename.c_str());
-        
-        // Set LED to firmware update mode (orange)
-        sensor_manager->setOTAUpdateMode(true);
-        
-        // Basic security validation
-        if (!filename.endsWith(".bin")) {
-            Serial.println("[SECURITY] Invalid file extension - only .bin files allowed");
-            sensor_manager->setOTAUpdateMode(false);
-            return;
-        }
-        
-        // Check available space
-        size_t free_space = ESP.getFreeSketchSpace();
-        Serial.printf("[SECURITY] Available space: %u bytes\n", free_space);
-        
-        if (free_space < 100000) { // Minimum 100KB required
-            Serial.println("[SECURITY] Insufficient free space for firmware update");
-            sensor_manager->setOTAUpdateMode(false);
-            return;
+// Streams the image through OtaUpdater, which checks the header on the first
+// chunk and the signature after the last
+void WebServerManager::handleOTAUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) {
+    if (index == 0) {
+        if (!isAuthenticated(request)) return;
+        if (ota.isRunning()) {
+            if (millis() - ota_last_chunk_ms < OTA_STALE_MS) {
+                Serial.println("[OTA] Another upload is in progress");
+                return;
+            }
+            Serial.println("[OTA] Abandoned upload aborted");
+            ota.abort();
         }
         
-        // Start the update process
-        if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-            Serial.printf("Update Begin Error: %s\n", Update.errorString());
-            sensor_manager->setOTAUpdateMode(false);
+        Serial.printf("OTA Update Start: %s\n", filename.c_str());
+        ota_request = request;
+        if (!ota.begin()) {
+            Serial.printf("[OTA] Update Begin Error: %s\n", ota.errorString());
             return;
         }
         
-        Serial.println("[OTA] Firmware update started - LED set to orange");
+        // LED to firmware update mode (orange), outputs to their OTA state
+        const SensorMetrics& metrics = sensor_manager->getMetrics();
+        ota_samples_start = metrics.ota_sample_interval.count;
+        ota_missed_start = metrics.ota_missed_samples;
+        sensor_manager->setOTAUpdateMode(true);
     }
+    if (request != ota_request || !ota.isRunning()) return;
+    ota_last_chunk_ms = millis();
     
-    // Write the received data
-    if (Update.write(data, len) != len) {
-        Serial.printf("Update Write Error: %s\n", Update.errorString());
+    if (!ota.write(data, len)) {
+        Serial.printf("[OTA] Update rejected at %u bytes: %s\n", (unsigned)(index + len), ota.errorString());
+        logOTASampling();
         sensor_manager->setOTAUpdateMode(false);
         return;
     }
-    
-    // Print progress
-    Serial.printf("OTA Progress: %u bytes\n", index + len);
+    if ((index + len) / OTA_PROGRESS_LOG_BYTES != index / OTA_PROGRESS_LOG_BYTES) {
+        Serial.printf("OTA Progress: %u bytes, %u written\n", (unsigned)(index + len), (unsigned)ota.getWritten());
+    }
     
     if (final) {
-        // Additional security validation before finalizing
-        size_t total_size = index + len;
-        Serial.printf("[SECURITY] Total firmware size: %u bytes\n", total_size);
-        
-        // Check minimum firmware size (reasonable firmware should be at least 200KB)
-        if (total_size < 200000) {
-            Serial.println("[SECURITY] Firmware too small - possible invalid file");
-            Update.abort();
-            sensor_manager->setOTAUpdateMode(false);
-            return;
-        }
-        
-        // Check maximum firmware size (prevent oversized uploads)
-        if (total_size > ESP.getFreeSketchSpace()) {
-            Serial.println("[SECURITY] Firmware too large for available space");
-            Update.abort();
-            sensor_manager->setOTAUpdateMode(false);
-            return;
-        }
-        
-        // Finalize the update
-        if (Update.end(true)) {
-            Serial.printf("[OTA] Update Success: %u bytes\n", total_size);
-            Serial.println("[OTA] Firmware validation passed - rebooting in 2 seconds");
-            
-            // Keep LED in update mode briefly to show success
-            delay(2000);
-            
-            // Reset LED before reboot
-            sensor_manager->setOTAUpdateMode(false);
-            
-            Serial.println("[OTA] Rebooting now...");
+        if (ota.end()) {
+            Serial.printf("[OTA] Update Success: %u bytes from %u uploaded, signature verified\n",
+                          (unsigned)ota.getWritten(), (unsigned)ota.getReceived());
+            logOTASampling();   // outputs stay in their OTA state until the restart
         } else {
-            Serial.printf("[OTA] Update End Error: %s\n", Update.errorString());
-            Serial.println("[SECURITY] Firmware validation failed");
+            Serial.printf("[OTA] Update End Error: %s\n", ota.errorString());
+            logOTASampling();
             sensor_manager->setOTAUpdateMode(false);
         }
     }
 }
+
+// How sampling fared while this upload wrote flash
+void WebServerManager::logOTASampling() {
+    const SensorMetrics& metrics = sensor_manager->getMetrics();
+    const LatencyHistogram& flash = ota.getFlashTime();
+    Serial.printf("[OTA] Sampling during the update: %u samples, %u missed; %u flash writes, longest %u us\n",
+                  (unsigned)(metrics.ota_sample_interval.count - ota_samples_start),
+                  (unsigned)(metrics.ota_missed_samples - ota_missed_start),
+                  (unsigned)flash.count, (unsigned)flash.max_us);
+}
+
+void WebServerManager::waitForSampleGap(void* context) {
+    ((WebServerManager*)context)->sensor_manager->waitForSampleGap(SAMPLE_GAP_TIMEOUT_MS);
+}
+
+// Reply once the whole upload is in; a successful update restarts from
+// poll() after the reply has gone out, so nothing blocks the async_tcp task
+void WebServerManager::handleOTAResult(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->send(401, "text/plain", "Unauthorized");
+        return;
+    }
+    if (request != ota_request) {
+        if (ota.isRunning()) request->send(409, "text/plain", "Update Failed: another update is in progress");
+        else request->send(400, "text/plain", "Update Failed: no firmware image received");
+        return;
+    }
+    ota_request = nullptr;
+    if (ota.isRunning()) {
+        // The last chunk never arrived
+        ota.abort();
+        logOTASampling();
+        sensor_manager->setOTAUpdateMode(false);
+    }
+    if (ota.getError() != OTA_OK) {
+        request->send(400, "text/plain", String("Update Failed: ") + ota.errorString());
+        return;
+    }
+    
+    request->send(200, "text/plain", "Update Successful! Rebooting...");
+    restart_at_ms = millis() + OTA_RESTART_DELAY_MS;
+    restart_pending = true;
+}
+
+// The upload's client disconnected before handleOTAResult() ran: abort the
+// update, freeing its buffers, and give the LED and outputs back. An image
+// that already verified is committed; only its reply was lost, so restart
+void WebServerManager::abandonOTA() {
+    ota_request = nullptr;
+    if (ota.isRunning()) {
+        ota.abort();
+        Serial.println("[OTA] Upload abandoned: the client disconnected");
+        logOTASampling();
+    } else if (ota.getError() == OTA_OK) {
+        Serial.println("[OTA] Client disconnected after a verified update");
+        restart_at_ms = millis() + OTA_RESTART_DELAY_MS;
+        restart_pending = true;
+        return;
+    }
+    sensor_manager->setOTAUpdateMode(false);
+}
+
+void WebServerManager::poll() {
+    if (restart_pending && (int32_t)(millis() - restart_at_ms) >= 0) {
+        restart_pending = false;
+        sensor_manager->setOTAUpdateMode(false);
+        Serial.println("[OTA] Rebooting now...");
+        ESP.restart();
+    }
+}
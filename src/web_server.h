@@ -4,27 +4,92 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
-#include <DNSServer.h>
 #include <Update.h>
+#include <memory>
+#include "json_writer.h"
+#include "status_codec.h"
 #include "config_manager.h"
 #include "sensor_manager.h"
+#include "api_core.h"
+#include "captive_dns.h"
+#include "rate_limiter.h"
+#include "prometheus_writer.h"
+#include "http_trace.h"
+#include "ota_updater.h"
+
+// Load shedding: with less heap than this, requests are answered with 503
+// and Retry-After before a handler allocates anything. lwIP takes its pbufs
+// from the same heap, so this also covers a starved network stack.
+#define WEB_SHED_FREE_HEAP 24576        // bytes free
+#define WEB_SHED_MAX_ALLOC 8192         // largest free block, bytes
+#define WEB_SHED_RETRY_AFTER_S 2
+
+// Status replies are rendered once per sensor sample and sent to every poll
+// until the next one; a reply is never older than this
+#define STATUS_CACHE_MAX_AGE_MS 250
+#define STATUS_JSON_MAX 256
+
+// Firmware upload: a restart after a successful update waits this long so the
+// reply gets out; an upload whose client disconnects is aborted at once, one
+// without a chunk for OTA_STALE_MS is abandoned when another one starts
+#define OTA_RESTART_DELAY_MS 1000
+#define OTA_STALE_MS 10000
+#define OTA_PROGRESS_LOG_BYTES 65536    // serial progress line every this many bytes
+
+// JSON body of POST /api/config, collected across body callbacks
+struct ConfigBody {
+    size_t len;
+    bool too_large;
+    char data[API_CONFIG_JSON_MAX];
+};
+
+// Status replies of the last sample, shared by all clients polling it
+struct StatusCache {
+    bool valid;
+    StatusSample sample;
+    uint32_t rendered_ms;
+    size_t json_len;
+    char json[STATUS_JSON_MAX];
+    size_t cbor_len;
+    uint8_t cbor[STATUS_CBOR_MAX_SIZE];
+};
+
+// HTTP adapter for ApiCore: parses each request into the core's parameter
+// structs and turns its replies into responses. Pages, history and download
+// streaming and OTA stay here.
 
 class WebServerManager {
 private:
     AsyncWebServer* server;
-    DNSServer* dns_server;
+    CaptiveDns* captive_dns;
     ConfigManager* config_manager;
     SensorManager* sensor_manager;
+    ApiCore* api;
     
-    bool authenticated_sessions[10]; // Simple session management
-    String session_tokens[10];
-    uint8_t session_count;
+    RateLimiter rate_limiter;
+    uint32_t shed_count;
+    StatusCache status_cache;
+    HttpTracer tracer;
+    
+    OtaUpdater ota;
+    AsyncWebServerRequest* ota_request;     // the upload ota belongs to
+    uint32_t ota_last_chunk_ms;
+    uint32_t ota_samples_start;             // sensor OTA metrics when the upload began
+    uint32_t ota_missed_start;
+    bool restart_pending;
+    uint32_t restart_at_ms;
     
-    // Authentication helpers
     bool isAuthenticated(AsyncWebServerRequest* request);
-    String generateSessionToken();
-    void addSession(const String& token);
-    bool validateSession(const String& token);
+    bool admitRequest(AsyncWebServerRequest* request);
+    bool heapLow();
+    void sendBusy(AsyncWebServerRequest* request);
+    void onTraced(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler,
+                  ArUploadHandlerFunction on_upload = nullptr, ArBodyHandlerFunction on_body = nullptr);
+    void onGuarded(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler,
+                   ArBodyHandlerFunction on_body = nullptr);
+    void traceBegin(int route, AsyncWebServerRequest* request);
+    const StatusCache& currentStatus();
+    void sendReply(AsyncWebServerRequest* request, const ApiReply& reply);
     
     // Route handlers
     void handleRoot(AsyncWebServerRequest* request);
@@ -32,17 +97,31 @@ private:
     void handleLogout(AsyncWebServerRequest* request);
     void handleGetConfig(AsyncWebServerRequest* request);
     void handleSetConfig(AsyncWebServerRequest* request);
+    void handleConfigBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total);
     void handleGetStatus(AsyncWebServerRequest* request);
     void handleGetHistory(AsyncWebServerRequest* request);
+    void handleGetHistoryRange(AsyncWebServerRequest* request);
     void handleClearHistory(AsyncWebServerRequest* request);
     void handleResetConfig(AsyncWebServerRequest* request);
+    void handleGetCaptures(AsyncWebServerRequest* request);
+    void handleGetCapture(AsyncWebServerRequest* request);
+    void handleRawStatus(AsyncWebServerRequest* request);
+    void handleRawControl(AsyncWebServerRequest* request, uint8_t action);
+    void handleRawDownload(AsyncWebServerRequest* request);
+    void handleDnsStats(AsyncWebServerRequest* request);
+    void handleMetrics(AsyncWebServerRequest* request);
+    void handleTrace(AsyncWebServerRequest* request);
     void handleChangePassword(AsyncWebServerRequest* request);
     void handleNotFound(AsyncWebServerRequest* request);
     
     // OTA update methods
     void initializeOTA();
     void handleOTAUpdate(AsyncWebServerRequest* request);
-    void handleOTAUpload(AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final);
+    void handleOTAUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final);
+    void handleOTAResult(AsyncWebServerRequest* request);
+    void abandonOTA();
+    void logOTASampling();
+    static void waitForSampleGap(void* context);
     
     // HTML content generators
     String generateLoginPage();
@@ -51,11 +130,13 @@ private:
     String generateJavaScript();
 
 public:
-    WebServerManager(ConfigManager* config_mgr, SensorManager* sensor_mgr);
+    WebServerManager(ConfigManager* config_mgr, SensorManager* sensor_mgr, ApiCore* api_core);
     ~WebServerManager();
     
     bool initialize();
-    void handleClient();
     bool startAccessPoint();
     void stopAccessPoint();
+    
+    // Called from loop(): restarts once an OTA update has been answered
+    void poll();
 };
@@ -0,0 +1,156 @@
+// Streaming gzip decoder tests. Streams are made with zlib the way
+// tools/ota_pack.py makes them (level 9, wbits 16 + 13) and fed in pieces as
+// small as one byte and as large as an upload chunk; a stream compressed with
+// a 32 KB window must be refused.
+//
+//   pio test -e native_test -f test_gzip_decoder
+
+#include <unity.h>
+#include <zlib.h>
+#include <vector>
+#include "gzip_decoder.h"
+
+#define TEST_IMAGE_SIZE (96 * 1024)
+#define TEST_UPLOAD_CHUNK 1436          // one TCP segment, as uploads arrive
+#define TEST_FAR_BLOCK 12288            // random bytes, then a repeat further back than the window
+#define TEST_FAR_REPEAT 4096
+#define TEST_PACK_WBITS (16 + GZIP_WINDOW_BITS)
+#define TEST_GZIP_WBITS (16 + 15)       // gzip(1) and zlib defaults
+
+static GzipDecoder decoder;             // ~10 KB, kept off the stack
+static std::vector<uint8_t> output;
+
+void setUp() {
+    output.clear();
+}
+
+void tearDown() {}
+
+static bool collect(void* context, const uint8_t* data, size_t len) {
+    output.insert(output.end(), data, data + len);
+    return true;
+}
+
+// Firmware-like content: runs of repeated strings and code-like tables at
+// every distance, mixed with incompressible bytes
+static std::vector<uint8_t> makeImage(size_t size) {
+    std::vector<uint8_t> image;
+    uint32_t seed = 12345;
+    while (image.size() < size) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t kind = (seed >> 16) % 4;
+        size_t run = 16 + (seed >> 8) % 200;
+        if (kind == 0) {
+            for (size_t i = 0; i < run; i++) {
+                seed = seed * 1103515245 + 12345;
+                image.push_back((uint8_t)(seed >> 16));
+            }
+        } else if (kind == 1 && image.size() > run) {
+            size_t from = (seed >> 4) % (image.size() - run);
+            for (size_t i = 0; i < run; i++) image.push_back(image[from + i]);
+        } else {
+            for (size_t i = 0; i < run; i++) image.push_back((uint8_t)("Adafruit VL53L1X sensor "[i % 24] + kind));
+        }
+    }
+    image.resize(size);
+    return image;
+}
+
+static std::vector<uint8_t> compress(const std::vector<uint8_t>& data, int level, int wbits) {
+    z_stream stream = {};
+    TEST_ASSERT_EQUAL(Z_OK, deflateInit2(&stream, level, Z_DEFLATED, wbits, 9, Z_DEFAULT_STRATEGY));
+    std::vector<uint8_t> packed(deflateBound(&stream, data.size()));
+    stream.next_in = const_cast<Bytef*>(data.data());
+    stream.avail_in = data.size();
+    stream.next_out = packed.data();
+    stream.avail_out = packed.size();
+    TEST_ASSERT_EQUAL(Z_STREAM_END, deflate(&stream, Z_FINISH));
+    packed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return packed;
+}
+
+// Pushes packed through the decoder in pieces of chunk bytes; true if it all decoded
+static bool inflate(const std::vector<uint8_t>& packed, size_t chunk) {
+    decoder.begin(collect, nullptr);
+    for (size_t pos = 0; pos < packed.size(); pos += chunk) {
+        size_t len = packed.size() - pos < chunk ? packed.size() - pos : chunk;
+        if (!decoder.write(packed.data() + pos, len)) return false;
+    }
+    return decoder.end();
+}
+
+static void assertInflates(const std::vector<uint8_t>& image, const std::vector<uint8_t>& packed, size_t chunk) {
+    output.clear();
+    TEST_ASSERT_TRUE(GzipDecoder::isGzip(packed.data(), packed.size()));
+    TEST_ASSERT_TRUE(inflate(packed, chunk));
+    TEST_ASSERT_EQUAL(GZIP_OK, decoder.getError());
+    TEST_ASSERT_EQUAL_UINT32(image.size(), decoder.getDecodedSize());
+    TEST_ASSERT_EQUAL_size_t(image.size(), output.size());
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), output.data(), image.size());
+}
+
+static void test_packed_stream_byte_by_byte() {
+    std::vector<uint8_t> image = makeImage(TEST_IMAGE_SIZE);
+    assertInflates(image, compress(image, 9, TEST_PACK_WBITS), 1);
+}
+
+static void test_packed_stream_upload_chunks() {
+    std::vector<uint8_t> image = makeImage(TEST_IMAGE_SIZE);
+    std::vector<uint8_t> packed = compress(image, 9, TEST_PACK_WBITS);
+    TEST_ASSERT_TRUE(packed.size() < image.size());
+    assertInflates(image, packed, TEST_UPLOAD_CHUNK);
+}
+
+// Level 0 is all stored blocks, level 1 mostly fixed Huffman codes
+static void test_stored_and_fixed_blocks() {
+    std::vector<uint8_t> image = makeImage(TEST_IMAGE_SIZE);
+    assertInflates(image, compress(image, 0, TEST_PACK_WBITS), TEST_UPLOAD_CHUNK);
+    assertInflates(image, compress(image, 1, TEST_PACK_WBITS), 1);
+}
+
+// A match further back than GZIP_WINDOW_SIZE cannot be resolved
+static void test_wide_window_rejected() {
+    std::vector<uint8_t> image;
+    uint32_t seed = 99;
+    for (size_t i = 0; i < TEST_FAR_BLOCK; i++) {
+        seed = seed * 1103515245 + 12345;
+        image.push_back((uint8_t)(seed >> 16));
+    }
+    image.insert(image.end(), image.begin(), image.begin() + TEST_FAR_REPEAT);
+
+    TEST_ASSERT_FALSE(inflate(compress(image, 9, TEST_GZIP_WBITS), TEST_UPLOAD_CHUNK));
+    TEST_ASSERT_EQUAL(GZIP_ERROR_DISTANCE, decoder.getError());
+
+    // The same content packed for the device goes through
+    assertInflates(image, compress(image, 9, TEST_PACK_WBITS), TEST_UPLOAD_CHUNK);
+}
+
+static void test_corrupt_and_truncated() {
+    std::vector<uint8_t> image = makeImage(TEST_IMAGE_SIZE / 4);
+    std::vector<uint8_t> packed = compress(image, 9, TEST_PACK_WBITS);
+
+    std::vector<uint8_t> bad_crc = packed;
+    bad_crc[bad_crc.size() - 8] ^= 0x01;    // first byte of the trailer's CRC-32
+    TEST_ASSERT_FALSE(inflate(bad_crc, TEST_UPLOAD_CHUNK));
+    TEST_ASSERT_EQUAL(GZIP_ERROR_CHECK, decoder.getError());
+
+    std::vector<uint8_t> truncated(packed.begin(), packed.end() - 100);
+    TEST_ASSERT_FALSE(inflate(truncated, TEST_UPLOAD_CHUNK));
+    TEST_ASSERT_EQUAL(GZIP_ERROR_TRUNCATED, decoder.getError());
+
+    std::vector<uint8_t> trailing = packed;
+    trailing.push_back(0);
+    TEST_ASSERT_FALSE(inflate(trailing, 1));
+    TEST_ASSERT_EQUAL(GZIP_ERROR_TRAILING, decoder.getError());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_packed_stream_byte_by_byte);
+    RUN_TEST(test_packed_stream_upload_chunks);
+    RUN_TEST(test_stored_and_fixed_blocks);
+    RUN_TEST(test_wide_window_rejected);
+    RUN_TEST(test_corrupt_and_truncated);
+    return UNITY_END();
+}
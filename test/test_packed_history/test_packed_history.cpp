@@ -0,0 +1,213 @@
+// Packed 1 Hz history tests: every stored point decodes to what was appended
+// (checked against a plain vector over a long random run), blocks start on
+// gaps and full payloads, the oldest block is evicted as a whole, and the
+// decode cursor never continues into a block that has been recycled.
+//
+//   pio test -e native_test -f test_packed_history
+
+#include <unity.h>
+#include <vector>
+#include "packed_history.h"
+
+#define TEST_INTERVAL_MS 1000
+#define TEST_START_MS 5000
+#define TEST_FUZZ_POINTS 100000
+#define TEST_CHECK_EVERY 7              // full window check every this many appends
+#define TEST_ONE_BYTE_POINTS 62         // per block: used + VARINT_MAX must fit the payload
+#define TEST_THREE_BYTE_POINTS 22       // the first is a zero delta from the block's base: 1 + 21 * 3
+#define TEST_FAR_DELTA 4000             // 3 byte varint: zigzag(delta) << 2 needs 15+ bits
+
+struct TestPoint {
+    uint32_t time_ms;
+    int16_t distance;
+    bool output1;
+    bool output2;
+};
+
+static PackedHistory history(TEST_INTERVAL_MS);
+static std::vector<TestPoint> reference;    // index is the sequence number
+static uint32_t now_ms;
+
+void setUp() {
+    history = PackedHistory(TEST_INTERVAL_MS);
+    reference.clear();
+    now_ms = TEST_START_MS;
+}
+
+void tearDown() {}
+
+// Appends one point gap_intervals after the previous one
+static void append(int16_t distance, bool output1 = false, bool output2 = false, uint32_t gap_intervals = 1) {
+    if (!reference.empty()) now_ms += gap_intervals * TEST_INTERVAL_MS;
+    history.append(now_ms, distance, output1, output2);
+    reference.push_back({now_ms, distance, output1, output2});
+}
+
+static void assertPoint(uint32_t seq) {
+    uint32_t time_ms = 0;
+    int16_t distance = 0;
+    bool output1 = false;
+    bool output2 = false;
+    TEST_ASSERT_TRUE_MESSAGE(history.get(seq, time_ms, distance, output1, output2), "stored point not found");
+    const TestPoint& expected = reference[seq];
+    TEST_ASSERT_EQUAL_UINT32(expected.time_ms, time_ms);
+    TEST_ASSERT_EQUAL_INT16(expected.distance, distance);
+    TEST_ASSERT_EQUAL(expected.output1, output1);
+    TEST_ASSERT_EQUAL(expected.output2, output2);
+}
+
+static bool stored(uint32_t seq) {
+    uint32_t time_ms;
+    int16_t distance;
+    bool output1;
+    bool output2;
+    return history.get(seq, time_ms, distance, output1, output2);
+}
+
+// Everything in [oldest, next) decodes, nothing outside does
+static void assertWindow() {
+    TEST_ASSERT_EQUAL_UINT32(reference.size(), history.getNextSeq());
+    for (uint32_t seq = history.getOldestSeq(); seq < history.getNextSeq(); seq++) {
+        assertPoint(seq);
+    }
+    if (history.getOldestSeq() > 0) TEST_ASSERT_FALSE(stored(history.getOldestSeq() - 1));
+    TEST_ASSERT_FALSE(stored(history.getNextSeq()));
+}
+
+// Random walk with jumps, dropouts to -1, output changes and stalls
+static void test_matches_reference() {
+    uint32_t seed = 2024;
+    int16_t distance = 500;
+    for (uint32_t i = 0; i < TEST_FUZZ_POINTS; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t r = seed >> 8;
+        switch (r % 16) {
+            case 0: distance = (int16_t)((r >> 4) % 4001); break;          // target moved
+            case 1: distance = -1; break;                                  // out of range
+            case 2: distance = (r & 0x10) ? INT16_MAX : INT16_MIN; break;  // widest deltas
+            default: distance = (int16_t)((distance < 0 ? 0 : distance) + (int16_t)((r >> 4) % 21) - 10); break;
+        }
+        uint32_t gap = ((r >> 12) % 50 == 0) ? 2 + (r >> 20) % 5 : 1;
+        append(distance, r & 0x100, r & 0x200, gap);
+
+        TEST_ASSERT_EQUAL_UINT32(history.getNextSeq() - history.getOldestSeq(), history.getCount());
+        if (i % TEST_CHECK_EVERY == 0) assertWindow();
+    }
+    assertWindow();
+}
+
+// A point that is not exactly one interval on starts a block of its own;
+// timestamps on both sides stay exact
+static void test_gap_starts_block() {
+    for (int i = 0; i < 5; i++) append(400 + i);
+    append(500, true, false, 3);
+    append(501, true, false);
+    TEST_ASSERT_EQUAL_UINT32(TEST_START_MS + 8 * TEST_INTERVAL_MS, reference.back().time_ms);
+
+    // Same time again, and back in time after a clock step
+    history.append(now_ms, 502, false, true);
+    reference.push_back({now_ms, 502, false, true});
+    now_ms -= 10 * TEST_INTERVAL_MS;
+    append(503);
+    assertWindow();
+
+    // Four blocks so far: fill the ring with gaps, then one more gap evicts
+    // the first five points together
+    for (uint32_t i = 4; i < PACKED_HISTORY_BLOCKS; i++) append(600, false, false, 2);
+    TEST_ASSERT_EQUAL_UINT32(0, history.getOldestSeq());
+    append(601, false, false, 2);
+    TEST_ASSERT_EQUAL_UINT32(5, history.getOldestSeq());
+    assertWindow();
+}
+
+// Blocks roll over when the payload cannot take a worst case point, and
+// eviction drops the oldest block whole. Every point takes at least a byte,
+// so the payload is always full before a block's count reaches UINT8_MAX.
+static void test_block_rollover_and_eviction() {
+    TEST_ASSERT_TRUE(TEST_ONE_BYTE_POINTS < UINT8_MAX);
+    // Unchanged distance: one byte per point
+    for (uint32_t i = 0; i < PACKED_HISTORY_BLOCKS * TEST_ONE_BYTE_POINTS; i++) append(300);
+    TEST_ASSERT_EQUAL_UINT32(0, history.getOldestSeq());
+    append(300);
+    TEST_ASSERT_EQUAL_UINT32(TEST_ONE_BYTE_POINTS, history.getOldestSeq());
+    assertWindow();
+
+    // Alternating far apart: three bytes per point
+    history.clear();
+    uint32_t first = history.getNextSeq();
+    for (uint32_t i = 0; i < PACKED_HISTORY_BLOCKS * TEST_THREE_BYTE_POINTS; i++) append(i % 2 ? TEST_FAR_DELTA : 0);
+    TEST_ASSERT_EQUAL_UINT32(first, history.getOldestSeq());
+    append(0);
+    TEST_ASSERT_EQUAL_UINT32(first + TEST_THREE_BYTE_POINTS, history.getOldestSeq());
+    assertWindow();
+}
+
+// clear() empties the store but the sequence keeps counting
+static void test_clear_keeps_sequence() {
+    for (int i = 0; i < 10; i++) append(250);
+    history.clear();
+    TEST_ASSERT_EQUAL_UINT32(10, history.getOldestSeq());
+    TEST_ASSERT_EQUAL_UINT32(10, history.getNextSeq());
+    TEST_ASSERT_FALSE(stored(9));
+
+    append(260);
+    TEST_ASSERT_EQUAL_UINT32(1, history.getCount());
+    assertPoint(10);
+}
+
+// The cursor is left at the end of a short block. After the ring has come
+// round, that block holds newer points; the cursor's next sequence number is
+// still stored, in another block, and must not be decoded from the recycled one
+static void test_cursor_skips_recycled_block() {
+    for (int i = 0; i < 3; i++) append(100 + i);
+    assertPoint(2);                             // cursor now expects seq 3 in block 0
+
+    for (uint32_t b = 1; b < PACKED_HISTORY_BLOCKS; b++) {
+        append(200 + b, false, false, 2);
+        for (int i = 0; i < 3; i++) append(200 + b);
+    }
+    append(900, false, false, 2);               // block 0 again: seqs 0..2 evicted
+    for (int i = 1; i < 20; i++) append(900 + 7 * i, i & 1, false);
+
+    TEST_ASSERT_EQUAL_UINT32(3, history.getOldestSeq());
+    TEST_ASSERT_FALSE(stored(2));
+    assertPoint(3);
+    assertWindow();
+}
+
+// Reads in order continue from the cursor; reads out of order, and reads
+// interleaved with appends, start over and still agree
+static void test_cursor_read_orders() {
+    uint32_t seed = 7;
+    for (int i = 0; i < 200; i++) {
+        seed = seed * 1103515245 + 12345;
+        append((int16_t)(400 + (seed >> 16) % 100), seed & 0x100, false, (seed >> 8) % 40 == 0 ? 2 : 1);
+    }
+    uint32_t oldest = history.getOldestSeq();
+    uint32_t next = history.getNextSeq();
+
+    for (uint32_t seq = next; seq-- > oldest;) assertPoint(seq);    // backwards
+    for (int i = 0; i < 500; i++) {
+        seed = seed * 1103515245 + 12345;
+        assertPoint(oldest + (seed >> 8) % (next - oldest));
+    }
+
+    // Poll like a client: read to the end, append, read the new point
+    for (int i = 0; i < 100; i++) {
+        assertPoint(history.getNextSeq() - 1);
+        append((int16_t)(500 + i), false, i & 1);
+        assertPoint(history.getNextSeq() - 1);
+    }
+    assertWindow();
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_gap_starts_block);
+    RUN_TEST(test_block_rollover_and_eviction);
+    RUN_TEST(test_clear_keeps_sequence);
+    RUN_TEST(test_cursor_skips_recycled_block);
+    RUN_TEST(test_cursor_read_orders);
+    return UNITY_END();
+}
@@ -0,0 +1,108 @@
+// Per-client rate limiter tests: the burst, the refill, the Retry-After
+// rounding and which slot a new client takes once the table is full.
+//
+//   pio test -e native_test -f test_rate_limiter
+
+#include <unity.h>
+#include "rate_limiter.h"
+
+#define TEST_CLIENT 0xC0A80402          // 192.168.4.2
+#define TEST_START_MS 1000
+// Time for one token to come back, rounded up to whole milliseconds
+#define TEST_TOKEN_MS ((1000 + RATE_LIMIT_PER_SECOND - 1) / RATE_LIMIT_PER_SECOND)
+
+static RateLimiter limiter;
+
+void setUp() {
+    limiter.clear();
+}
+
+void tearDown() {}
+
+// Takes count requests for client at now; returns how many were allowed
+static uint32_t take(uint32_t client, uint32_t now, uint32_t count) {
+    uint32_t allowed = 0;
+    uint32_t retry_after_s;
+    for (uint32_t i = 0; i < count; i++) {
+        if (limiter.allow(client, now, retry_after_s)) allowed++;
+    }
+    return allowed;
+}
+
+static void test_burst_then_limited() {
+    TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT_BURST, take(TEST_CLIENT, TEST_START_MS, RATE_LIMIT_BURST + 5));
+
+    RateLimitStats stats = limiter.getStats();
+    TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT_BURST, stats.allowed);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.limited);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.clients);
+}
+
+static void test_refill() {
+    uint32_t now = TEST_START_MS;
+    take(TEST_CLIENT, now, RATE_LIMIT_BURST);
+
+    // One token a TEST_TOKEN_MS, not sooner
+    TEST_ASSERT_EQUAL_UINT32(0, take(TEST_CLIENT, now + TEST_TOKEN_MS - 1, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, take(TEST_CLIENT, now + TEST_TOKEN_MS, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, take(TEST_CLIENT, now + TEST_TOKEN_MS, 1));
+
+    // A second's worth sustains RATE_LIMIT_PER_SECOND
+    now += TEST_TOKEN_MS + 1000;
+    TEST_ASSERT_UINT32_WITHIN(1, RATE_LIMIT_PER_SECOND, take(TEST_CLIENT, now, RATE_LIMIT_BURST));
+
+    // Idle for longer than an empty-to-full refill: the whole burst again,
+    // also across the millis() wrap
+    TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT_BURST, take(TEST_CLIENT, now + 60000, RATE_LIMIT_BURST + 1));
+    limiter.clear();
+    take(TEST_CLIENT, UINT32_MAX - 10, RATE_LIMIT_BURST);
+    TEST_ASSERT_EQUAL_UINT32(1, take(TEST_CLIENT, UINT32_MAX - 10 + TEST_TOKEN_MS, 1));
+}
+
+// Retry-After is whole seconds rounded up: never 0 while limited
+static void test_retry_after_rounds_up() {
+    uint32_t retry_after_s = 0;
+    take(TEST_CLIENT, TEST_START_MS, RATE_LIMIT_BURST);
+
+    TEST_ASSERT_FALSE(limiter.allow(TEST_CLIENT, TEST_START_MS, retry_after_s));
+    TEST_ASSERT_EQUAL_UINT32((TEST_TOKEN_MS + 999) / 1000, retry_after_s);
+
+    // 1 ms short of a token
+    retry_after_s = 0;
+    TEST_ASSERT_FALSE(limiter.allow(TEST_CLIENT, TEST_START_MS + TEST_TOKEN_MS - 1, retry_after_s));
+    TEST_ASSERT_EQUAL_UINT32(1, retry_after_s);
+}
+
+// Clients are independent; with more than RATE_LIMIT_CLIENTS the one seen
+// longest ago loses its slot and comes back with a full bucket
+static void test_lru_slot_reuse() {
+    uint32_t now = TEST_START_MS;
+    for (uint32_t i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+        TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT_BURST, take(TEST_CLIENT + i, now + i, RATE_LIMIT_BURST + 1));
+    }
+    TEST_ASSERT_EQUAL_UINT8(RATE_LIMIT_CLIENTS, limiter.getStats().clients);
+
+    // Client 0 is seen again, so client 1 is now the least recent
+    now += RATE_LIMIT_CLIENTS;
+    TEST_ASSERT_EQUAL_UINT32(0, take(TEST_CLIENT, now, 1));
+
+    // A new client takes client 1's slot with a full bucket
+    TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT_BURST, take(TEST_CLIENT + RATE_LIMIT_CLIENTS, now, RATE_LIMIT_BURST));
+    TEST_ASSERT_EQUAL_UINT8(RATE_LIMIT_CLIENTS, limiter.getStats().clients);
+
+    // The others kept their empty buckets; client 1 starts over at the cost
+    // of the next least recent (client 2)
+    TEST_ASSERT_EQUAL_UINT32(0, take(TEST_CLIENT, now, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, take(TEST_CLIENT + 3, now, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, take(TEST_CLIENT + 1, now, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, take(TEST_CLIENT + 2, now, 1));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_burst_then_limited);
+    RUN_TEST(test_refill);
+    RUN_TEST(test_retry_after_rounds_up);
+    RUN_TEST(test_lru_slot_reuse);
+    return UNITY_END();
+}
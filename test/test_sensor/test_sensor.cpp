@@ -0,0 +1,220 @@
+// Sample path tests: the distance filters on their own, and the output trigger
+// logic (checkOutputTrigger() through updateOutputs()) driven end to end by
+// SensorManager::update() on the stub sensor and the virtual clock.
+//
+//   pio test -e native_test -f test_sensor
+
+#include <Arduino.h>
+#include <unity.h>
+#include "host_hal.h"
+#include "sensor_manager.h"
+#include "sys_init.h"
+
+#define TEST_SAMPLE_PERIOD_US 50000
+#define TEST_SETTLE_SAMPLES 30          // samples for the filter to settle after a step
+#define TEST_RANGE_MIN 200              // mm, both outputs
+#define TEST_RANGE_MAX 600
+#define TEST_HYSTERESIS 50
+#define TEST_STATUS_OUT_OF_BOUNDS 4     // range status of a reading with no target
+#define TEST_STATUS_HARDWARE_FAIL 5     // a genuine fault
+
+// SensorManager on the stub sensor, one sample per period
+struct SensorRig {
+    Adafruit_VL53L1X sensor;
+    Adafruit_NeoPixel pixel;
+    SensorManager manager;
+    uint64_t now_us;
+
+    SensorRig() : pixel(1, PIN_LED_DATA, NEO_GRB + NEO_KHZ800), manager(&sensor, &pixel, PIN_OUT_1, PIN_OUT_2) {
+        now_us = 1000000;
+        hostSetMicros(now_us);
+    }
+
+    // Feeds count readings of distance and runs update() on each
+    void feed(int16_t distance, uint32_t count, uint8_t range_status = 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            now_us += TEST_SAMPLE_PERIOD_US;
+            HostSensorSample sample = {now_us, distance, range_status, 0, 0};
+            sensor.hostQueue(sample);
+            hostSetMicros(now_us);
+            manager.update();
+        }
+    }
+
+    void settle(int16_t distance) { feed(distance, TEST_SETTLE_SAMPLES); }
+};
+
+void setUp() {
+    hostSetLogOutput(nullptr);
+}
+
+void tearDown() {}
+
+static void test_moving_average_window() {
+    MovingAverage average(4);
+    TEST_ASSERT_FALSE(average.isReady());
+    average.addValue(100);
+    average.addValue(200);
+    TEST_ASSERT_TRUE(average.isReady());        // half full
+    TEST_ASSERT_EQUAL_INT16(150, average.getAverage());
+
+    // The oldest values drop out once the window is full
+    const int16_t values[] = {300, 400, 500, 600};
+    for (int16_t value : values) average.addValue(value);
+    TEST_ASSERT_EQUAL_INT16(450, average.getAverage());
+    TEST_ASSERT_EQUAL_INT16(500, average.getMedian());
+    TEST_ASSERT_INT_WITHIN(1, 16667, (int32_t)average.getVariance());
+
+    average.reset();
+    TEST_ASSERT_FALSE(average.isReady());
+    TEST_ASSERT_EQUAL_INT16(0, average.getAverage());
+}
+
+static void test_noise_filter_rejects_outlier() {
+    NoiseFilter filter(5);
+    TEST_ASSERT_TRUE(filter.addValue(500));
+    TEST_ASSERT_TRUE(filter.addValue(502));
+    TEST_ASSERT_TRUE(filter.addValue(498));
+
+    // Further than MAX_OUTLIER_DEVIATION from the median: dropped
+    TEST_ASSERT_FALSE(filter.addValue(500 + MAX_OUTLIER_DEVIATION + 1));
+    TEST_ASSERT_EQUAL_UINT8(3, filter.getValidSampleCount());
+    TEST_ASSERT_EQUAL_INT16(500, filter.getFilteredValue());
+
+    TEST_ASSERT_TRUE(filter.addValue(500 + MAX_OUTLIER_DEVIATION - 1));
+    TEST_ASSERT_EQUAL_UINT8(4, filter.getValidSampleCount());
+    TEST_ASSERT_EQUAL_INT16(502, filter.getFilteredValue());
+}
+
+static void test_adaptive_filter_converges_on_step() {
+    AdaptiveFilter filter(5);
+    for (int i = 0; i < 10; i++) filter.addValue(500);
+    TEST_ASSERT_EQUAL_INT16(500, filter.getFilteredValue());
+
+    // The change is confirmed on its CHANGE_CONFIRMATION_COUNT-th reading
+    for (int i = 1; i < CHANGE_CONFIRMATION_COUNT; i++) {
+        filter.addValue(800);
+        TEST_ASSERT_FALSE(filter.isChangeDetected());
+    }
+    filter.addValue(800);
+    TEST_ASSERT_TRUE(filter.isChangeDetected());
+
+    // Rapid adaptation gets close quickly, then normal smoothing settles it
+    filter.addValue(800);
+    filter.addValue(800);
+    TEST_ASSERT_INT_WITHIN(CHANGE_DETECTION_THRESHOLD / 2, 800, filter.getFilteredValue());
+    for (int i = 0; i < TEST_SETTLE_SAMPLES; i++) filter.addValue(800);
+    TEST_ASSERT_INT_WITHIN(1, 800, filter.getFilteredValue());
+    TEST_ASSERT_FALSE(filter.isChangeDetected());
+}
+
+static void test_adaptive_filter_damps_single_spike() {
+    AdaptiveFilter filter(5);
+    for (int i = 0; i < 10; i++) filter.addValue(500);
+    filter.addValue(800);
+    TEST_ASSERT_FALSE(filter.isChangeDetected());
+    TEST_ASSERT_INT_WITHIN(1, 500 + (int)(NORMAL_ADAPT_ALPHA * 300), filter.getFilteredValue());
+    for (int i = 0; i < TEST_SETTLE_SAMPLES; i++) filter.addValue(500);
+    TEST_ASSERT_INT_WITHIN(1, 500, filter.getFilteredValue());
+}
+
+// Active in range: on inside the window, off only past the window plus hysteresis
+static void test_hysteresis_active_in_range() {
+    SensorRig rig;
+    rig.manager.setOutput1Config(TEST_RANGE_MIN, TEST_RANGE_MAX, TEST_HYSTERESIS, true);
+    rig.manager.enableOutput1(true);
+    TEST_ASSERT_TRUE(rig.manager.initialize());
+
+    rig.settle(1000);
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_1));
+    rig.settle(TEST_RANGE_MAX + 20);
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_1));
+    rig.settle(TEST_RANGE_MAX - 20);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_1));
+    TEST_ASSERT_EQUAL(STATUS_TRIGGERED, rig.manager.getStatus());
+
+    // Outside the window but inside the hysteresis band: stays on
+    rig.settle(TEST_RANGE_MAX + TEST_HYSTERESIS - 20);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_1));
+    rig.settle(TEST_RANGE_MAX + TEST_HYSTERESIS + 30);
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_1));
+
+    // Same at the near edge
+    rig.settle(400);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_1));
+    rig.settle(TEST_RANGE_MIN - TEST_HYSTERESIS + 20);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_1));
+    rig.settle(TEST_RANGE_MIN - TEST_HYSTERESIS - 30);
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_1));
+    TEST_ASSERT_EQUAL(STATUS_OK, rig.manager.getStatus());
+}
+
+// Active out of range: on outside the window, off only inside the window
+// shrunk by the hysteresis
+static void test_hysteresis_active_out_of_range() {
+    SensorRig rig;
+    rig.manager.setOutput2Config(TEST_RANGE_MIN, TEST_RANGE_MAX, TEST_HYSTERESIS, false);
+    rig.manager.enableOutput2(true);
+    TEST_ASSERT_TRUE(rig.manager.initialize());
+
+    rig.settle(1000);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_2));
+
+    // Inside the window but not past the hysteresis band: stays on
+    rig.settle(TEST_RANGE_MAX - TEST_HYSTERESIS + 20);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_2));
+    rig.settle(TEST_RANGE_MAX - TEST_HYSTERESIS - 30);
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_2));
+
+    // Off, it turns on again at the window edge itself
+    rig.settle(TEST_RANGE_MAX - 20);
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_2));
+    rig.settle(TEST_RANGE_MAX + 40);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_2));
+}
+
+// A reading with no target turns active-in-range outputs off and
+// active-out-of-range outputs on, whatever the last distance was
+static void test_out_of_range_reading() {
+    SensorRig rig;
+    rig.manager.setOutput1Config(TEST_RANGE_MIN, TEST_RANGE_MAX, TEST_HYSTERESIS, true);
+    rig.manager.setOutput2Config(TEST_RANGE_MIN, TEST_RANGE_MAX, TEST_HYSTERESIS, false);
+    rig.manager.enableOutput1(true);
+    rig.manager.enableOutput2(true);
+    TEST_ASSERT_TRUE(rig.manager.initialize());
+
+    rig.settle(400);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_1));
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_2));
+    TEST_ASSERT_FALSE(rig.manager.isOutOfRange());
+
+    rig.feed(-1, 1, TEST_STATUS_OUT_OF_BOUNDS);
+    TEST_ASSERT_TRUE(rig.manager.isOutOfRange());
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_1));
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_2));
+    TEST_ASSERT_EQUAL(STATUS_TRIGGERED, rig.manager.getStatus());
+
+    // The target comes back where it was
+    rig.feed(400, 1);
+    TEST_ASSERT_FALSE(rig.manager.isOutOfRange());
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_1));
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_2));
+
+    // A genuine fault is not an empty field of view: outputs stay as they are
+    rig.feed(-1, 1, TEST_STATUS_HARDWARE_FAIL);
+    TEST_ASSERT_FALSE(rig.manager.isOutOfRange());
+    TEST_ASSERT_EQUAL_UINT8(HIGH, hostPinLevel(PIN_OUT_1));
+    TEST_ASSERT_EQUAL_UINT8(LOW, hostPinLevel(PIN_OUT_2));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_moving_average_window);
+    RUN_TEST(test_noise_filter_rejects_outlier);
+    RUN_TEST(test_adaptive_filter_converges_on_step);
+    RUN_TEST(test_adaptive_filter_damps_single_spike);
+    RUN_TEST(test_hysteresis_active_in_range);
+    RUN_TEST(test_hysteresis_active_out_of_range);
+    RUN_TEST(test_out_of_range_reading);
+    return UNITY_END();
+}
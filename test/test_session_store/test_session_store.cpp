@@ -0,0 +1,215 @@
+// Login session table tests. Tokens are queued into the RNG stand-in so their
+// home slots are known: probe runs that wrap past the end of the table,
+// backward shift deletion from the middle of a run, idle and absolute expiry,
+// least recently used eviction, and finding the cookie among others whose
+// names share a prefix with it.
+//
+//   pio test -e native_test -f test_session_store
+
+#include <unity.h>
+#include <string.h>
+#include "host_hal.h"
+#include "session_store.h"
+
+#define TEST_START_MS 1000
+#define TEST_LAST_SLOT (SESSION_TABLE_SIZE - 1)
+
+static SessionStore store;
+static char tokens[SESSION_TABLE_SIZE][SESSION_TOKEN_CHARS + 1];
+static uint8_t next_tag;
+
+void setUp() {
+    store.clear();
+    memset(tokens, 0, sizeof(tokens));
+}
+
+void tearDown() {}
+
+// Creates session i whose token hashes to home; tokens differ in their last byte
+static const char* createAt(int i, uint8_t home, uint32_t now) {
+    uint8_t bytes[SESSION_TOKEN_BYTES] = {};
+    bytes[0] = home;
+    bytes[SESSION_TOKEN_BYTES - 1] = ++next_tag;
+    hostQueueRandom(bytes, sizeof(bytes));
+    store.create(tokens[i], now);
+    return tokens[i];
+}
+
+static bool validateSession(int i, uint32_t now) {
+    return store.validate(tokens[i], strlen(tokens[i]), now);
+}
+
+static void removeSession(int i) {
+    store.remove(tokens[i], strlen(tokens[i]));
+}
+
+static void test_create_validate_remove() {
+    const char* token = createAt(0, 3, TEST_START_MS);
+    TEST_ASSERT_EQUAL_size_t(SESSION_TOKEN_CHARS, strlen(token));
+    TEST_ASSERT_TRUE(validateSession(0, TEST_START_MS));
+
+    // Upper case hex is the same token; anything else is not
+    char upper[SESSION_TOKEN_CHARS + 1];
+    for (int i = 0; i <= SESSION_TOKEN_CHARS; i++) upper[i] = (token[i] >= 'a') ? token[i] - 'a' + 'A' : token[i];
+    TEST_ASSERT_TRUE(store.validate(upper, SESSION_TOKEN_CHARS, TEST_START_MS));
+    TEST_ASSERT_FALSE(store.validate(token, SESSION_TOKEN_CHARS - 1, TEST_START_MS));
+    char bad[SESSION_TOKEN_CHARS + 1];
+    memcpy(bad, token, sizeof(bad));
+    bad[5] = 'g';
+    TEST_ASSERT_FALSE(store.validate(bad, SESSION_TOKEN_CHARS, TEST_START_MS));
+
+    removeSession(0);
+    TEST_ASSERT_FALSE(validateSession(0, TEST_START_MS));
+    TEST_ASSERT_EQUAL_UINT8(0, store.getStats().active);
+}
+
+// A run that starts in the last slots continues at slot 0; removing its
+// first entries shifts the wrapped ones back across the end
+static void test_wrapped_probe_run() {
+    createAt(0, TEST_LAST_SLOT - 1, TEST_START_MS);     // slot 14
+    createAt(1, TEST_LAST_SLOT, TEST_START_MS);         // 15
+    createAt(2, TEST_LAST_SLOT, TEST_START_MS);         // 0
+    createAt(3, 0, TEST_START_MS);                      // 1
+    createAt(4, 1, TEST_START_MS);                      // 2
+    for (int i = 0; i < 5; i++) TEST_ASSERT_TRUE(validateSession(i, TEST_START_MS));
+
+    // Nothing may move into slot 14: every later home is past it
+    removeSession(0);
+    for (int i = 1; i < 5; i++) TEST_ASSERT_TRUE(validateSession(i, TEST_START_MS));
+
+    // Slot 15 empties: 2 moves back across the end, then 3 and 4 follow
+    removeSession(1);
+    for (int i = 2; i < 5; i++) TEST_ASSERT_TRUE(validateSession(i, TEST_START_MS));
+    createAt(5, TEST_LAST_SLOT, TEST_START_MS);
+    removeSession(2);
+    TEST_ASSERT_FALSE(validateSession(2, TEST_START_MS));
+    for (int i = 3; i < 6; i++) TEST_ASSERT_TRUE(validateSession(i, TEST_START_MS));
+    TEST_ASSERT_EQUAL_UINT8(3, store.getStats().active);
+}
+
+// Removing from the middle of a run: an entry behind the hole moves up only
+// if the hole is between its home and where it sits
+static void test_remove_mid_run() {
+    createAt(0, 3, TEST_START_MS);      // slot 3
+    createAt(1, 3, TEST_START_MS);      // 4
+    createAt(2, 5, TEST_START_MS);      // 5, home: stays put
+    createAt(3, 5, TEST_START_MS);      // 6, stays behind 2
+    createAt(4, 3, TEST_START_MS);      // 7, moves into the hole
+    createAt(5, 8, TEST_START_MS);      // 8, home: stays put
+
+    removeSession(1);
+    TEST_ASSERT_FALSE(validateSession(1, TEST_START_MS));
+    for (int i = 0; i < 6; i++) {
+        if (i != 1) TEST_ASSERT_TRUE(validateSession(i, TEST_START_MS));
+    }
+
+    // And again at the head of the run
+    removeSession(0);
+    for (int i = 2; i < 6; i++) TEST_ASSERT_TRUE(validateSession(i, TEST_START_MS));
+    TEST_ASSERT_EQUAL_UINT8(4, store.getStats().active);
+}
+
+// Idle: SESSION_IDLE_TIMEOUT_MS after the last use. Absolute:
+// SESSION_ABSOLUTE_TIMEOUT_MS after login however busy. Both across the
+// millis() wrap
+static void test_idle_and_absolute_expiry() {
+    uint32_t start = UINT32_MAX - SESSION_IDLE_TIMEOUT_MS / 2;
+    createAt(0, 2, start);
+    createAt(1, 9, start);
+
+    TEST_ASSERT_TRUE(validateSession(0, start + SESSION_IDLE_TIMEOUT_MS));
+    TEST_ASSERT_FALSE(validateSession(1, start + SESSION_IDLE_TIMEOUT_MS + 1));
+    TEST_ASSERT_EQUAL_UINT32(1, store.getStats().expired);
+
+    uint32_t now = start + SESSION_IDLE_TIMEOUT_MS;
+    while (now - start + SESSION_IDLE_TIMEOUT_MS / 2 <= SESSION_ABSOLUTE_TIMEOUT_MS) {
+        now += SESSION_IDLE_TIMEOUT_MS / 2;
+        TEST_ASSERT_TRUE(validateSession(0, now));
+    }
+    TEST_ASSERT_TRUE(validateSession(0, start + SESSION_ABSOLUTE_TIMEOUT_MS));
+    TEST_ASSERT_FALSE(validateSession(0, start + SESSION_ABSOLUTE_TIMEOUT_MS + 1));
+    TEST_ASSERT_EQUAL_UINT32(2, store.getStats().expired);
+    TEST_ASSERT_EQUAL_UINT8(0, store.getStats().active);
+}
+
+// A login drops every expired session first, including ones that shift into
+// the slot just emptied
+static void test_login_drops_expired() {
+    uint32_t now = TEST_START_MS;
+    createAt(0, 5, now);                // slots 5, 6
+    createAt(1, 5, now);
+    createAt(3, TEST_LAST_SLOT, now);   // 15
+    now += SESSION_IDLE_TIMEOUT_MS;
+    createAt(2, 5, now);                // 7
+    createAt(4, TEST_LAST_SLOT, now);   // 0
+
+    now++;
+    createAt(5, 6, now);
+    SessionStats stats = store.getStats();
+    TEST_ASSERT_EQUAL_UINT32(3, stats.expired);
+    TEST_ASSERT_EQUAL_UINT8(3, stats.active);
+    TEST_ASSERT_TRUE(validateSession(2, now));
+    TEST_ASSERT_TRUE(validateSession(4, now));
+    TEST_ASSERT_TRUE(validateSession(5, now));
+}
+
+// With SESSION_MAX_ACTIVE sessions a login evicts the one used longest ago
+static void test_lru_eviction() {
+    uint32_t now = TEST_START_MS;
+    for (int i = 0; i < SESSION_MAX_ACTIVE; i++) createAt(i, (uint8_t)(i * 3), now + i);
+
+    // Session 0 is used again, so session 1 is now the least recent
+    now += SESSION_MAX_ACTIVE;
+    TEST_ASSERT_TRUE(validateSession(0, now));
+    createAt(SESSION_MAX_ACTIVE, 1, now);
+
+    SessionStats stats = store.getStats();
+    TEST_ASSERT_EQUAL_UINT8(SESSION_MAX_ACTIVE, stats.active);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.evicted);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.expired);
+    TEST_ASSERT_FALSE(validateSession(1, now));
+    for (int i = 0; i <= SESSION_MAX_ACTIVE; i++) {
+        if (i != 1) TEST_ASSERT_TRUE(validateSession(i, now));
+    }
+}
+
+static void assertCookie(const char* cookie, const char* expected) {
+    const char* token = nullptr;
+    size_t len = 0;
+    if (expected == nullptr) {
+        TEST_ASSERT_FALSE(sessionTokenFromCookie(cookie, token, len));
+        return;
+    }
+    TEST_ASSERT_TRUE(sessionTokenFromCookie(cookie, token, len));
+    TEST_ASSERT_EQUAL_size_t(strlen(expected), len);
+    TEST_ASSERT_TRUE(strncmp(expected, token, len) == 0);
+}
+
+// Only the whole name matches, wherever it is in the header
+static void test_cookie_names() {
+    assertCookie("session_token=abc", "abc");
+    assertCookie("a=1; session_token=abc; b=2", "abc");
+    assertCookie("a=1;session_token=abc ", "abc");
+    assertCookie("xsession_token=abc", nullptr);
+    assertCookie("xsession_token=bad; session_token=good", "good");
+    assertCookie("session_tokens=bad; session_token_old=bad; session_token=good", "good");
+    assertCookie("session_token", nullptr);
+    assertCookie("a=session_token=bad", nullptr);
+    assertCookie("", nullptr);
+
+    // An empty value is found but is no session
+    assertCookie("session_token=; b=2", "");
+    TEST_ASSERT_FALSE(store.validate("", 0, TEST_START_MS));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_create_validate_remove);
+    RUN_TEST(test_wrapped_probe_run);
+    RUN_TEST(test_remove_mid_run);
+    RUN_TEST(test_idle_and_absolute_expiry);
+    RUN_TEST(test_login_drops_expired);
+    RUN_TEST(test_lru_eviction);
+    RUN_TEST(test_cookie_names);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+// CBOR status payload tests: encodeStatusCbor() against fixed byte vectors
+// (the layout tools/status_decode.py reads), and back through
+// decodeStatusCbor().
+//
+//   pio test -e native_test -f test_status_codec
+
+#include <unity.h>
+#include "status_codec.h"
+
+#define TEST_STATUS_TRIGGERED 1         // DeviceStatus values, sensor_manager.h
+#define TEST_STATUS_FAULT 2
+
+void setUp() {}
+
+void tearDown() {}
+
+static StatusSample makeSample(uint32_t sequence, uint64_t timestamp_us, int16_t distance, int16_t raw_distance,
+                               uint8_t status, uint8_t flags) {
+    StatusSample sample;
+    sample.sequence = sequence;
+    sample.timestamp_us = timestamp_us;
+    sample.distance = distance;
+    sample.raw_distance = raw_distance;
+    sample.status = status;
+    sample.flags = flags;
+    return sample;
+}
+
+static void assertRoundTrip(const StatusSample& sample) {
+    uint8_t payload[STATUS_CBOR_MAX_SIZE];
+    size_t len = encodeStatusCbor(sample, payload, sizeof(payload));
+    TEST_ASSERT_TRUE(len > 0);
+    StatusSample decoded;
+    TEST_ASSERT_TRUE(decodeStatusCbor(payload, len, decoded));
+    TEST_ASSERT_EQUAL_UINT32(sample.sequence, decoded.sequence);
+    TEST_ASSERT_EQUAL_UINT64(sample.timestamp_us, decoded.timestamp_us);
+    TEST_ASSERT_EQUAL_INT16(sample.distance, decoded.distance);
+    TEST_ASSERT_EQUAL_INT16(sample.raw_distance, decoded.raw_distance);
+    TEST_ASSERT_EQUAL_UINT8(sample.status, decoded.status);
+    TEST_ASSERT_EQUAL_UINT8(sample.flags, decoded.flags);
+}
+
+// Target in the window, output 1 on
+static void test_encode_triggered() {
+    const uint8_t expected[] = {
+        0x87,                               // array of 7
+        0x01,                               // version
+        0x01,                               // sequence
+        0x1A, 0x00, 0x01, 0x23, 0x45,       // timestamp_us, 4 bytes
+        0x19, 0x01, 0x9C,                   // distance 412
+        0x19, 0x01, 0xA2,                   // raw_distance 418
+        0x01,                               // TRIGGERED
+        0x09,                               // OUTPUT1 | SENSOR_READY
+    };
+    StatusSample sample = makeSample(1, 0x12345, 412, 418, TEST_STATUS_TRIGGERED,
+                                     STATUS_FLAG_OUTPUT1 | STATUS_FLAG_SENSOR_READY);
+    uint8_t payload[STATUS_CBOR_MAX_SIZE];
+    size_t len = encodeStatusCbor(sample, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, payload, sizeof(expected));
+    assertRoundTrip(sample);
+}
+
+// No target: distances are -1, a negative CBOR integer
+static void test_encode_out_of_range() {
+    const uint8_t expected[] = {
+        0x87,
+        0x01,
+        0x18, 0x18,                         // sequence 24, first 1 byte argument
+        0x1B, 0x00, 0x00, 0x00, 0x01, 0x2A, 0x05, 0xF2, 0x00,   // timestamp_us past 32 bits
+        0x20,                               // distance -1
+        0x20,                               // raw_distance -1
+        0x01,
+        0x0E,                               // OUTPUT2 | OUT_OF_RANGE | SENSOR_READY
+    };
+    StatusSample sample = makeSample(24, 5000000000ull, -1, -1, TEST_STATUS_TRIGGERED,
+                                     STATUS_FLAG_OUTPUT2 | STATUS_FLAG_OUT_OF_RANGE | STATUS_FLAG_SENSOR_READY);
+    uint8_t payload[STATUS_CBOR_MAX_SIZE];
+    size_t len = encodeStatusCbor(sample, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, payload, sizeof(expected));
+    assertRoundTrip(sample);
+}
+
+static void test_round_trip_flags() {
+    for (uint8_t flags = 0; flags <= 0x0F; flags++) {
+        assertRoundTrip(makeSample(1000, 1000000, 300, 301, 0, flags));
+    }
+}
+
+static void test_round_trip_limits() {
+    assertRoundTrip(makeSample(0, 0, 0, 0, 0, 0));
+    assertRoundTrip(makeSample(23, 23, 23, -24, 0, 0));           // last 0 byte arguments
+    assertRoundTrip(makeSample(0xFFFFFFFF, UINT64_MAX, INT16_MAX, INT16_MIN, TEST_STATUS_FAULT, 0xFF));
+
+    // The worst case fits STATUS_CBOR_MAX_SIZE, and nothing smaller is accepted
+    uint8_t payload[STATUS_CBOR_MAX_SIZE];
+    StatusSample sample = makeSample(0xFFFFFFFF, UINT64_MAX, INT16_MIN, INT16_MIN, 0xFF, 0xFF);
+    TEST_ASSERT_TRUE(encodeStatusCbor(sample, payload, sizeof(payload)) <= STATUS_CBOR_MAX_SIZE);
+    TEST_ASSERT_EQUAL_size_t(0, encodeStatusCbor(sample, payload, STATUS_CBOR_MAX_SIZE - 1));
+}
+
+static void test_decode_rejects_bad_input() {
+    uint8_t payload[STATUS_CBOR_MAX_SIZE + 1];
+    StatusSample sample = makeSample(7, 123456, 250, 251, 0, STATUS_FLAG_SENSOR_READY);
+    size_t len = encodeStatusCbor(sample, payload, sizeof(payload));
+    StatusSample decoded;
+
+    for (size_t cut = 0; cut < len; cut++) {
+        TEST_ASSERT_FALSE(decodeStatusCbor(payload, cut, decoded));
+    }
+
+    payload[1] = STATUS_CODEC_VERSION + 1;
+    TEST_ASSERT_FALSE(decodeStatusCbor(payload, len, decoded));
+    payload[1] = STATUS_CODEC_VERSION;
+
+    payload[0] = 0x86;                      // too few fields
+    TEST_ASSERT_FALSE(decodeStatusCbor(payload, len, decoded));
+
+    // A longer array from a newer minor revision still decodes
+    payload[0] = 0x88;
+    payload[len] = 0x00;
+    TEST_ASSERT_TRUE(decodeStatusCbor(payload, len + 1, decoded));
+    TEST_ASSERT_EQUAL_UINT32(7, decoded.sequence);
+    TEST_ASSERT_EQUAL_UINT8(STATUS_FLAG_SENSOR_READY, decoded.flags);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_encode_triggered);
+    RUN_TEST(test_encode_out_of_range);
+    RUN_TEST(test_round_trip_flags);
+    RUN_TEST(test_round_trip_limits);
+    RUN_TEST(test_decode_rejects_bad_input);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Convert scope mode captures downloaded from /api/capture?id=<n> into CSV.
+
+Usage:
+  capture_to_csv.py capture_12.bin [-o capture_12.csv]   convert a saved capture
+  capture_to_csv.py --url http://192.168.4.1 --password admin [--dir DIR]
+                                                          download every capture
+
+Binary layout (little endian, see src/capture_buffer.h):
+  header  magic u32 "CAPT", version u8, output u8, new_state u8, sample_size u8,
+          id u32, trigger_time_ms u32, pre_samples u16, sample_count u16, reserved u32
+  sample  time_ms u16 (low 16 bits of millis), raw_distance i16,
+          filtered_distance i16, range_status u8, flags u8
+
+CSV time is in ms relative to the trigger sample (negative before it).
+"""
+
+import argparse
+import csv
+import json
+import os
+import struct
+import sys
+import urllib.parse
+import urllib.request
+from http.cookiejar import CookieJar
+
+CAPTURE_MAGIC = 0x54504143
+CAPTURE_FORMAT_VERSION = 1
+HEADER = struct.Struct("<IBBBBIIHHI")
+SAMPLE = struct.Struct("<HhhBB")
+
+FLAG_OUTPUT1 = 0x01
+FLAG_OUTPUT2 = 0x02
+FLAG_OUT_OF_RANGE = 0x04
+
+
+def decode_capture(data):
+    if len(data) < HEADER.size:
+        raise ValueError("capture too short")
+    (magic, version, output, new_state, sample_size, capture_id,
+     trigger_time_ms, pre_samples, sample_count, _) = HEADER.unpack_from(data, 0)
+    if magic != CAPTURE_MAGIC:
+        raise ValueError("not a capture (bad magic)")
+    if version != CAPTURE_FORMAT_VERSION:
+        raise ValueError("unsupported capture version %d" % version)
+    if sample_size < SAMPLE.size or len(data) < HEADER.size + sample_count * sample_size:
+        raise ValueError("truncated capture")
+
+    raw = []
+    for i in range(sample_count):
+        raw.append(SAMPLE.unpack_from(data, HEADER.size + i * sample_size))
+
+    # Unwrap the 16 bit timestamps into ms relative to the trigger sample
+    times = [0] * sample_count
+    for i in range(1, sample_count):
+        times[i] = times[i - 1] + ((raw[i][0] - raw[i - 1][0]) & 0xFFFF)
+    trigger_offset = times[pre_samples] if pre_samples < sample_count else 0
+
+    samples = []
+    for i, (_, raw_distance, filtered_distance, range_status, flags) in enumerate(raw):
+        samples.append({
+            "index": i - pre_samples,
+            "time_ms": times[i] - trigger_offset,
+            "raw_distance": raw_distance,
+            "filtered_distance": filtered_distance,
+            "range_status": range_status,
+            "output1": int(bool(flags & FLAG_OUTPUT1)),
+            "output2": int(bool(flags & FLAG_OUTPUT2)),
+            "out_of_range": int(bool(flags & FLAG_OUT_OF_RANGE)),
+        })
+
+    header = {
+        "id": capture_id,
+        "output": output,
+        "new_state": new_state,
+        "trigger_time_ms": trigger_time_ms,
+        "pre_samples": pre_samples,
+        "sample_count": sample_count,
+    }
+    return header, samples
+
+
+def write_csv(header, samples, out):
+    out.write("# capture %(id)d: output %(output)d -> %(new_state)d at %(trigger_time_ms)d ms\n" % header)
+    writer = csv.DictWriter(out, fieldnames=list(samples[0].keys()) if samples else ["index"])
+    writer.writeheader()
+    writer.writerows(samples)
+
+
+def download_all(url, password, directory):
+    opener = urllib.request.build_opener(urllib.request.HTTPCookieProcessor(CookieJar()))
+    login = urllib.parse.urlencode({"password": password}).encode()
+    opener.open(url + "/login", login)
+
+    with opener.open(url + "/api/captures") as response:
+        listing = json.load(response)
+    for entry in listing["captures"]:
+        with opener.open("%s/api/capture?id=%d" % (url, entry["id"])) as response:
+            header, samples = decode_capture(response.read())
+        path = os.path.join(directory, "capture_%d.csv" % header["id"])
+        with open(path, "w", newline="") as out:
+            write_csv(header, samples, out)
+        print("%s: output %d -> %d, %d samples" % (path, header["output"], header["new_state"], len(samples)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="saved capture ('-' for stdin)")
+    parser.add_argument("-o", "--output", help="CSV file to write (default stdout)")
+    parser.add_argument("--url", help="device base URL, e.g. http://192.168.4.1")
+    parser.add_argument("--password", default="admin")
+    parser.add_argument("--dir", default=".", help="directory for downloaded captures")
+    args = parser.parse_args()
+
+    if args.url:
+        download_all(args.url.rstrip("/"), args.password, args.dir)
+    elif args.file:
+        data = sys.stdin.buffer.read() if args.file == "-" else open(args.file, "rb").read()
+        header, samples = decode_capture(data)
+        if args.output:
+            with open(args.output, "w", newline="") as out:
+                write_csv(header, samples, out)
+        else:
+            write_csv(header, samples, sys.stdout)
+    else:
+        parser.print_usage()
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
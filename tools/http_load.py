@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Load test for the device HTTP API, aimed at the simulator (host/simulator.cpp).
+
+Usage:
+  http_load.py [--url http://127.0.0.1:8080] [--clients 200] [--seconds 10]
+               [--password admin] [--endpoint status|config|login ...] [--out load.json]
+               [--max-error-rate 0.5]
+
+Logs in once, then runs --clients concurrent clients per endpoint for
+--seconds each, every client issuing one request per connection the way the
+web UI does. Prints requests/s, latency percentiles and errors per endpoint
+and optionally writes them as JSON. All clients share one address, so most
+requests past the device's per-client burst get 429: those that carry
+Retry-After are the rate limiter working and are counted as limited, not as
+errors. Exits with 1 when no request is served or errors make up more than
+--max-error-rate of an endpoint's requests. Only the standard library is
+needed, so it runs where wrk or hey are not installed.
+"""
+
+import argparse
+import asyncio
+import json
+import sys
+import time
+from urllib.parse import urlsplit
+
+ENDPOINTS = {
+    "status": ("GET", "/api/status", None),
+    "config": ("GET", "/api/config", None),
+    "login": ("POST", "/login", "password={password}"),
+}
+
+
+async def request(host, port, method, path, body, cookie):
+    reader, writer = await asyncio.open_connection(host, port)
+    try:
+        head = "%s %s HTTP/1.1\r\nHost: %s\r\n" % (method, path, host)
+        if cookie:
+            head += "Cookie: %s\r\n" % cookie
+        if body is not None:
+            head += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %d\r\n" % len(body)
+        writer.write((head + "Connection: close\r\n\r\n").encode() + (body or "").encode())
+        await writer.drain()
+        response = await reader.read()
+    finally:
+        writer.close()
+    status_line, _, rest = response.partition(b"\r\n")
+    parts = status_line.split()
+    if len(parts) < 2:
+        raise ConnectionError("no response")
+    return int(parts[1]), rest
+
+
+async def login(host, port, password):
+    code, rest = await request(host, port, "POST", "/login", "password=" + password, None)
+    for line in rest.split(b"\r\n"):
+        if line.lower().startswith(b"set-cookie:") and b"session_token=" in line:
+            return line.split(b":", 1)[1].split(b";")[0].strip().decode()
+    sys.exit("login failed (HTTP %d)" % code)
+
+
+def has_retry_after(rest):
+    head = rest.partition(b"\r\n\r\n")[0]
+    return any(line.lower().startswith(b"retry-after:") for line in head.split(b"\r\n"))
+
+
+async def client(host, port, endpoint, password, cookie, deadline, latencies, limited, errors):
+    method, path, body = ENDPOINTS[endpoint]
+    if body is not None:
+        body = body.format(password=password)
+    expected = 302 if endpoint == "login" else 200
+    while time.monotonic() < deadline:
+        start = time.monotonic()
+        try:
+            code, rest = await request(host, port, method, path, body, cookie)
+        except (OSError, ConnectionError):
+            errors["connect"] = errors.get("connect", 0) + 1
+            continue
+        if code == expected:
+            latencies.append(time.monotonic() - start)
+        elif code == 429 and has_retry_after(rest):
+            limited.append(time.monotonic() - start)
+        else:
+            errors[str(code)] = errors.get(str(code), 0) + 1
+
+
+def percentile(values, pct):
+    return values[(len(values) - 1) * pct // 100] * 1000 if values else 0.0
+
+
+async def run(args):
+    url = urlsplit(args.url)
+    host, port = url.hostname, url.port or 80
+    cookie = await login(host, port, args.password)
+    results = []
+    for endpoint in args.endpoint:
+        latencies, limited, errors = [], [], {}
+        deadline = time.monotonic() + args.seconds
+        await asyncio.gather(*(client(host, port, endpoint, args.password, cookie, deadline, latencies, limited,
+                                      errors)
+                               for _ in range(args.clients)))
+        latencies.sort()
+        result = {
+            "endpoint": endpoint,
+            "clients": args.clients,
+            "requests": len(latencies),
+            "rps": round(len(latencies) / args.seconds, 1),
+            "p50_ms": round(percentile(latencies, 50), 2),
+            "p95_ms": round(percentile(latencies, 95), 2),
+            "p99_ms": round(percentile(latencies, 99), 2),
+            "max_ms": round(latencies[-1] * 1000 if latencies else 0.0, 2),
+            "limited": len(limited),
+            "limited_rps": round(len(limited) / args.seconds, 1),
+            "errors": errors,
+        }
+        results.append(result)
+        print("%-7s %4d clients %7d req %8.1f req/s  p50 %7.2f  p95 %7.2f  p99 %7.2f  max %7.2f ms  "
+              "limited %d  errors %s" % (
+                  endpoint, args.clients, result["requests"], result["rps"], result["p50_ms"], result["p95_ms"],
+                  result["p99_ms"], result["max_ms"], result["limited"], errors or "-"))
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--url", default="http://127.0.0.1:8080")
+    parser.add_argument("--clients", type=int, default=200)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--password", default="admin")
+    parser.add_argument("--endpoint", action="append", choices=sorted(ENDPOINTS))
+    parser.add_argument("--out")
+    parser.add_argument("--max-error-rate", type=float, default=0.5,
+                        help="fail when this share of an endpoint's requests get errors")
+    args = parser.parse_args()
+    args.endpoint = args.endpoint or ["status", "config", "login"]
+
+    results = asyncio.run(run(args))
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump({"url": args.url, "seconds": args.seconds, "results": results}, f, indent=1)
+
+    failed = False
+    for result in results:
+        errors = sum(result["errors"].values())
+        total = errors + result["requests"] + result["limited"]
+        if result["requests"] == 0 or errors > args.max_error_rate * total:
+            print("%s: %d of %d requests failed" % (result["endpoint"], errors, total), file=sys.stderr)
+            failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
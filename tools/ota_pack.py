@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Compress a signed firmware image for OTA upload.
+
+Usage:
+  ota_pack.py firmware.signed.bin [-o firmware.signed.bin.gz]
+
+The device inflates gzip uploads on the fly with an 8 KB window (see
+src/gzip_decoder.h), so the image is deflated with zlib wbits 13; gzip(1)
+uses 32 KB and its output is refused. The whole signed image is compressed,
+trailer included: the signature covers the decompressed image, which is what
+the device hashes. Sign first with ota_sign.py, then pack.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+TRAILER_MAGIC = b"OTAS"
+TRAILER_SIZE = 84
+IMAGE_MAGIC = 0xE9
+WINDOW_BITS = 13
+GZIP_WBITS = 16 + WINDOW_BITS
+
+
+def pack(args):
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if not image or image[0] != IMAGE_MAGIC:
+        raise ValueError("%s is not an ESP application image (no 0x%02X magic byte)" % (args.image, IMAGE_MAGIC))
+    trailer = image[-TRAILER_SIZE:]
+    if len(image) <= TRAILER_SIZE or trailer[:4] != TRAILER_MAGIC or \
+            struct.unpack_from("<I", trailer, 4)[0] != len(image) - TRAILER_SIZE:
+        raise ValueError("%s is not signed; run ota_sign.py sign first" % args.image)
+
+    compressor = zlib.compressobj(9, zlib.DEFLATED, GZIP_WBITS, 9)
+    packed = compressor.compress(image) + compressor.flush()
+    # Inflate with the device's window to be sure it can
+    if zlib.decompress(packed, GZIP_WBITS) != image:
+        raise RuntimeError("round trip check failed")
+
+    out = args.output or args.image + ".gz"
+    with open(out, "wb") as f:
+        f.write(packed)
+    print("%s: %d -> %d bytes (%.0f%%)" % (out, len(image), len(packed), 100.0 * len(packed) / len(image)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image", help="signed image from ota_sign.py")
+    parser.add_argument("-o", "--output", help="compressed image (default <image>.gz)")
+    args = parser.parse_args()
+    try:
+        pack(args)
+    except (OSError, ValueError, RuntimeError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
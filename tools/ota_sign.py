@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Sign firmware images for OTA upload and manage the signing key.
+
+Usage:
+  ota_sign.py sign [--key key.pem] firmware.bin [-o firmware.signed.bin]
+                                           append the signature trailer
+  ota_sign.py verify [--key key.pem] firmware.signed.bin
+                                           check a signed image as the device does
+  ota_sign.py keygen [--key key.pem]       new ECDSA P-256 private key
+  ota_sign.py header [--key key.pem] [-o src/ota_public_key.h]
+                                           public key header the firmware is built with
+
+The key defaults to $OTA_SIGN_KEY, else ~/.config/ota_sign/ota_key.pem. In CI,
+write the key from a secret to a file outside the checkout and point
+OTA_SIGN_KEY at it. keygen refuses to create a key inside this repository.
+
+The device hashes the image with SHA-256 while it is uploaded and checks the
+trailer's ECDSA signature of that hash before the update is finalised (see
+src/ota_updater.h). Trailer layout, little endian, after the last image byte:
+  magic "OTAS", image size (u32), signature length (u16), reserved (u16),
+  DER signature padded to 72 bytes
+
+The repository's src/ota_public_key.h holds a placeholder key whose private
+half was discarded; device builds refuse it. Make your own first:
+  ota_sign.py keygen && ota_sign.py header
+
+Uses the openssl command line tool.
+"""
+
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+TRAILER_MAGIC = b"OTAS"
+SIGNATURE_MAX = 72
+TRAILER_FORMAT = "<4sIHH%ds" % SIGNATURE_MAX
+TRAILER_SIZE = struct.calcsize(TRAILER_FORMAT)
+IMAGE_MAGIC = 0xE9
+DEFAULT_KEY = os.path.join(os.path.expanduser("~"), ".config", "ota_sign", "ota_key.pem")
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
+
+HEADER_TEMPLATE = """#pragma once
+
+// Public half of the OTA signing key, generated by tools/ota_sign.py header.
+// Uploaded images must carry a signature made with the private half.
+#define OTA_PUBLIC_KEY_PEM \\
+%s
+"""
+
+
+def openssl(*args, data=None):
+    result = subprocess.run(["openssl"] + list(args), input=data, capture_output=True)
+    if result.returncode != 0:
+        raise RuntimeError("openssl %s: %s" % (args[0], result.stderr.decode(errors="replace").strip()))
+    return result.stdout
+
+
+def public_key_pem(key):
+    return openssl("ec", "-in", key, "-pubout").decode()
+
+
+def sign(args):
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if not image or image[0] != IMAGE_MAGIC:
+        raise ValueError("%s is not an ESP application image (no 0x%02X magic byte)" % (args.image, IMAGE_MAGIC))
+    if image[-TRAILER_SIZE:-TRAILER_SIZE + 4] == TRAILER_MAGIC:
+        raise ValueError("%s is already signed" % args.image)
+    signature = openssl("dgst", "-sha256", "-sign", args.key, data=image)
+    if len(signature) > SIGNATURE_MAX:
+        raise ValueError("signature of %d bytes; only ECDSA P-256 keys are supported" % len(signature))
+    trailer = struct.pack(TRAILER_FORMAT, TRAILER_MAGIC, len(image), len(signature), 0, signature)
+    out = args.output or os.path.splitext(args.image)[0] + ".signed.bin"
+    with open(out, "wb") as f:
+        f.write(image + trailer)
+    print("%s: %d byte image, %d byte signature" % (out, len(image), len(signature)))
+
+
+def verify(args):
+    with open(args.image, "rb") as f:
+        data = f.read()
+    if len(data) < TRAILER_SIZE:
+        raise ValueError("too short for a signature trailer")
+    image, trailer = data[:-TRAILER_SIZE], data[-TRAILER_SIZE:]
+    magic, size, signature_len, _, signature = struct.unpack(TRAILER_FORMAT, trailer)
+    if magic != TRAILER_MAGIC or size != len(image) or signature_len > SIGNATURE_MAX:
+        raise ValueError("no valid signature trailer")
+    with tempfile.TemporaryDirectory() as tmp:
+        public = os.path.join(tmp, "public.pem")
+        with open(public, "w") as f:
+            f.write(public_key_pem(args.key))
+        sig_path = os.path.join(tmp, "signature.der")
+        with open(sig_path, "wb") as f:
+            f.write(signature[:signature_len])
+        openssl("dgst", "-sha256", "-verify", public, "-signature", sig_path, data=image)
+    print("%s: signature OK (%d byte image)" % (args.image, size))
+
+
+def keygen(args):
+    path = os.path.realpath(args.key)
+    if os.path.commonpath([path, REPO_ROOT]) == REPO_ROOT:
+        raise ValueError("%s is inside the repository; keep the private key elsewhere" % args.key)
+    if os.path.exists(path):
+        raise ValueError("%s exists, not overwriting it" % args.key)
+    os.makedirs(os.path.dirname(path), mode=0o700, exist_ok=True)
+    openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", path)
+    os.chmod(path, 0o600)
+    print("%s: new ECDSA P-256 key" % args.key)
+
+
+def header(args):
+    lines = public_key_pem(args.key).strip().splitlines()
+    body = " \\\n".join('    "%s\\n"' % line for line in lines)
+    with open(args.output, "w") as f:
+        f.write(HEADER_TEMPLATE % body)
+    print("%s: public key written" % args.output)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    key = os.environ.get("OTA_SIGN_KEY") or DEFAULT_KEY
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    p = commands.add_parser("sign", help="append the signature trailer to an image")
+    p.add_argument("--key", default=key, help="private key (PEM, default %(default)s)")
+    p.add_argument("image")
+    p.add_argument("-o", "--output", help="signed image (default <image>.signed.bin)")
+    p.set_defaults(run=sign)
+
+    p = commands.add_parser("verify", help="check a signed image")
+    p.add_argument("--key", default=key, help="private or public key (PEM, default %(default)s)")
+    p.add_argument("image")
+    p.set_defaults(run=verify)
+
+    p = commands.add_parser("keygen", help="generate a signing key")
+    p.add_argument("--key", default=key, help="private key to create (PEM, default %(default)s)")
+    p.set_defaults(run=keygen)
+
+    p = commands.add_parser("header", help="write the public key header")
+    p.add_argument("--key", default=key, help="private key (PEM, default %(default)s)")
+    p.add_argument("-o", "--output", default="src/ota_public_key.h")
+    p.set_defaults(run=header)
+
+    args = parser.parse_args()
+    try:
+        args.run(args)
+    except (OSError, ValueError, RuntimeError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
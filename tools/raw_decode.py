@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Decode the raw sample log downloaded from /api/raw-log.
+
+Usage:
+  raw_decode.py rawlog.bin                       list recording sessions
+  raw_decode.py rawlog.bin --session 3 -o s3.csv write one session as CSV
+  raw_decode.py --url http://192.168.4.1 --password admin -O rawlog.bin
+                                                 download the log from the device
+
+Format (little endian, see src/raw_format.h): 256 byte pages, each with a
+16 byte header (magic "RAWP", page_seq u32, session u16, type u8, count u8,
+crc32 u32). Session pages hold the output configuration and, since version 2,
+the filter state at the start of the session; sample pages up to 20 samples
+of (time_us u32, distance i16, range_status u8, flags u8, signal_rate u16,
+ambient_rate u16). Pages with a bad CRC are dropped.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import urllib.parse
+import urllib.request
+import zlib
+from http.cookiejar import CookieJar
+
+RAW_FORMAT_VERSIONS = (1, 2)  # 2 appends the filter state, which replay uses
+RAW_PAGE_MAGIC = 0x50574152
+RAW_PAGE_BYTES = 256
+RAW_PAGE_SESSION = 1
+RAW_PAGE_SAMPLES = 2
+
+PAGE_HEADER = struct.Struct("<IIHBBI")
+SESSION_INFO = struct.Struct("<BBHIHHHBBHHHBB16s")
+SAMPLE = struct.Struct("<IhBBHH")
+SAMPLES_PER_PAGE = (RAW_PAGE_BYTES - PAGE_HEADER.size) // SAMPLE.size
+
+FLAG_OUTPUT1 = 0x01
+FLAG_OUTPUT2 = 0x02
+
+
+def page_crc(page):
+    return zlib.crc32(page[:12] + page[PAGE_HEADER.size:]) & 0xFFFFFFFF
+
+
+def read_pages(data):
+    """Yields (header, page bytes) for every valid page, in page_seq order."""
+    pages = []
+    bad = 0
+    for offset in range(0, len(data) - RAW_PAGE_BYTES + 1, RAW_PAGE_BYTES):
+        page = data[offset:offset + RAW_PAGE_BYTES]
+        magic, page_seq, session, page_type, count, crc = PAGE_HEADER.unpack_from(page)
+        if magic != RAW_PAGE_MAGIC:
+            continue
+        if crc != page_crc(page):
+            bad += 1
+            continue
+        pages.append(((page_seq, session, page_type, count), page))
+    pages.sort(key=lambda item: item[0][0])
+    if bad:
+        print("warning: %d pages with a bad CRC skipped" % bad, file=sys.stderr)
+    return pages
+
+
+def decode_sessions(data):
+    sessions = {}
+    for (page_seq, session, page_type, count), page in read_pages(data):
+        entry = sessions.setdefault(session, {"session": session, "info": None, "samples": [], "gaps": 0, "last_seq": None})
+        if page_type == RAW_PAGE_SESSION:
+            fields = SESSION_INFO.unpack_from(page, PAGE_HEADER.size)
+            if fields[0] not in RAW_FORMAT_VERSIONS:
+                raise ValueError("unsupported raw format version %d" % fields[0])
+            entry["info"] = {
+                "timing_budget_ms": fields[2],
+                "start_time_us": fields[3],
+                "output1": {"min": fields[4], "max": fields[5], "hysteresis": fields[6],
+                            "active_in_range": bool(fields[7]), "enabled": bool(fields[8])},
+                "output2": {"min": fields[9], "max": fields[10], "hysteresis": fields[11],
+                            "active_in_range": bool(fields[12]), "enabled": bool(fields[13])},
+                "firmware": fields[14].split(b"\0", 1)[0].decode(errors="replace"),
+            }
+        elif page_type == RAW_PAGE_SAMPLES:
+            if entry["last_seq"] is not None and page_seq != entry["last_seq"] + 1:
+                entry["gaps"] += 1
+            entry["last_seq"] = page_seq
+            for i in range(min(count, SAMPLES_PER_PAGE)):
+                entry["samples"].append(SAMPLE.unpack_from(page, PAGE_HEADER.size + i * SAMPLE.size))
+
+    # Unwrap the 32 bit microsecond clock
+    for entry in sessions.values():
+        unwrapped = []
+        base = 0
+        previous = None
+        for time_us, distance, range_status, flags, signal_rate, ambient_rate in entry["samples"]:
+            if previous is not None and time_us < previous:
+                base += 1 << 32
+            previous = time_us
+            unwrapped.append({
+                "time_us": base + time_us,
+                "distance": distance,
+                "range_status": range_status,
+                "signal_rate": signal_rate,
+                "ambient_rate": ambient_rate,
+                "output1": int(bool(flags & FLAG_OUTPUT1)),
+                "output2": int(bool(flags & FLAG_OUTPUT2)),
+            })
+        entry["samples"] = unwrapped
+    return sessions
+
+
+def download(url, password, path):
+    opener = urllib.request.build_opener(urllib.request.HTTPCookieProcessor(CookieJar()))
+    login = urllib.parse.urlencode({"password": password}).encode()
+    opener.open(url + "/login", login)
+    with opener.open(url + "/api/raw-log") as response, open(path, "wb") as out:
+        size = 0
+        while True:
+            chunk = response.read(65536)
+            if not chunk:
+                break
+            out.write(chunk)
+            size += len(chunk)
+    print("%s: %d bytes" % (path, size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="downloaded raw log")
+    parser.add_argument("--session", type=int, help="session to export")
+    parser.add_argument("-o", "--output", help="CSV file to write (default stdout)")
+    parser.add_argument("--url", help="device base URL, e.g. http://192.168.4.1")
+    parser.add_argument("--password", default="admin")
+    parser.add_argument("-O", "--save", default="rawlog.bin", help="where to store a download")
+    args = parser.parse_args()
+
+    if args.url:
+        download(args.url.rstrip("/"), args.password, args.save)
+        return 0
+    if not args.file:
+        parser.print_usage()
+        return 1
+
+    with open(args.file, "rb") as f:
+        sessions = decode_sessions(f.read())
+
+    if args.session is None:
+        for entry in sorted(sessions.values(), key=lambda e: e["session"]):
+            samples = entry["samples"]
+            duration = (samples[-1]["time_us"] - samples[0]["time_us"]) / 1e6 if len(samples) > 1 else 0
+            info = entry["info"]
+            print("session %d: %d samples, %.1f s, %d page gaps, firmware %s" % (
+                entry["session"], len(samples), duration, entry["gaps"],
+                info["firmware"] if info else "? (session page overwritten)"))
+        return 0
+
+    entry = sessions.get(args.session)
+    if entry is None:
+        print("session %d not found" % args.session, file=sys.stderr)
+        return 1
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.DictWriter(out, fieldnames=["time_us", "distance", "range_status", "signal_rate",
+                                             "ambient_rate", "output1", "output2"])
+    writer.writeheader()
+    writer.writerows(entry["samples"])
+    if args.output:
+        out.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
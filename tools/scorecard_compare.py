@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""Compare two scenario scorecards written by bench/scenario_score.cpp.
+
+Usage:
+  scorecard_compare.py baseline.json candidate.json
+
+Prints every scenario/output pair with the baseline and candidate values and
+marks the ones that got worse. Exits with 1 if any count (missed, false
+triggers, glitches) increased, so it can gate a filter change.
+"""
+
+import json
+import sys
+
+COUNTS = ("missed", "false_triggers", "glitches")
+LATENCIES = ("assert_p95_ms", "release_p95_ms")
+
+
+def load(path):
+    with open(path) as f:
+        card = json.load(f)
+    return card, {(r["scenario"], r["output"]): r for r in card["results"]}
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    base_card, base = load(sys.argv[1])
+    cand_card, cand = load(sys.argv[2])
+    print("%s -> %s" % (base_card["label"], cand_card["label"]))
+    for card in (base_card, cand_card):
+        print("  %-12s %s" % (card["label"], " ".join("%s=%s" % kv for kv in card["filter"].items())))
+
+    worse = False
+    print("%-16s %-13s %-12s %-12s %-12s %-14s %-14s" % (
+        "scenario", "output", "missed", "false", "glitches", "assert p95", "release p95"))
+    for key in base:
+        if key not in cand:
+            continue
+        b, c = base[key], cand[key]
+        cells = []
+        for field in COUNTS + LATENCIES:
+            mark = "*" if c[field] > b[field] else " "
+            if c[field] > b[field] and field in COUNTS:
+                worse = True
+            cells.append("%5d>%-5d%s" % (b[field], c[field], mark))
+        print("%-16s %-13s %s" % (key[0], key[1], " ".join(cells)))
+
+    if worse:
+        print("candidate has more missed, false or glitching triggers (*)")
+    return 1 if worse else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Decode the compact CBOR status payload served by /api/status?format=cbor.
+
+Usage:
+  status_decode.py payload.cbor            decode a saved payload
+  status_decode.py --url http://192.168.4.1 --password admin [--count N]
+                                           log in and poll the device
+
+Payload layout (see src/status_codec.h):
+  [ version, sequence, timestamp_us, distance, raw_distance, status, flags ]
+"""
+
+import argparse
+import sys
+import time
+import urllib.parse
+import urllib.request
+from http.cookiejar import CookieJar
+
+STATUS_CODEC_VERSION = 1
+STATUS_NAMES = {0: "OK", 1: "TRIGGERED", 2: "FAULT"}
+
+FLAG_OUTPUT1 = 0x01
+FLAG_OUTPUT2 = 0x02
+FLAG_OUT_OF_RANGE = 0x04
+FLAG_SENSOR_READY = 0x08
+
+
+def _read_head(data, pos):
+    initial = data[pos]
+    major, info = initial >> 5, initial & 0x1F
+    pos += 1
+    if info < 24:
+        return major, info, pos
+    size = {24: 1, 25: 2, 26: 4, 27: 8}.get(info)
+    if size is None or pos + size > len(data):
+        raise ValueError("unsupported or truncated CBOR head")
+    return major, int.from_bytes(data[pos:pos + size], "big"), pos + size
+
+
+def _read_int(data, pos):
+    major, value, pos = _read_head(data, pos)
+    if major == 0:
+        return value, pos
+    if major == 1:
+        return -1 - value, pos
+    raise ValueError("expected integer, got major type %d" % major)
+
+
+def decode_status(data):
+    major, count, pos = _read_head(data, 0)
+    if major != 4 or count < 7:
+        raise ValueError("expected status array")
+    fields = []
+    for _ in range(7):
+        value, pos = _read_int(data, pos)
+        fields.append(value)
+    version, sequence, timestamp_us, distance, raw_distance, status, flags = fields
+    if version != STATUS_CODEC_VERSION:
+        raise ValueError("unsupported status version %d" % version)
+    return {
+        "sequence": sequence,
+        "timestamp_us": timestamp_us,
+        "distance": distance,
+        "raw_distance": raw_distance,
+        "status": STATUS_NAMES.get(status, str(status)),
+        "output1_state": bool(flags & FLAG_OUTPUT1),
+        "output2_state": bool(flags & FLAG_OUTPUT2),
+        "out_of_range": bool(flags & FLAG_OUT_OF_RANGE),
+        "sensor_ready": bool(flags & FLAG_SENSOR_READY),
+        "bytes": len(data),
+    }
+
+
+def poll(url, password, count, interval):
+    opener = urllib.request.build_opener(urllib.request.HTTPCookieProcessor(CookieJar()))
+    login = urllib.parse.urlencode({"password": password}).encode()
+    opener.open(url + "/login", login)
+
+    request = urllib.request.Request(url + "/api/status", headers={"Accept": "application/cbor"})
+    for _ in range(count):
+        with opener.open(request) as response:
+            print(decode_status(response.read()))
+        time.sleep(interval)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="saved CBOR payload ('-' for stdin)")
+    parser.add_argument("--url", help="device base URL, e.g. http://192.168.4.1")
+    parser.add_argument("--password", default="admin")
+    parser.add_argument("--count", type=int, default=10)
+    parser.add_argument("--interval", type=float, default=0.2)
+    args = parser.parse_args()
+
+    if args.url:
+        poll(args.url.rstrip("/"), args.password, args.count, args.interval)
+    elif args.file:
+        data = sys.stdin.buffer.read() if args.file == "-" else open(args.file, "rb").read()
+        print(decode_status(data))
+    else:
+        parser.print_usage()
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())